@@ -0,0 +1,281 @@
+/*
+ * Arduino.h  (host simulation shim)
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Stands in for the Particle Device OS headers so the Photon firmware in
+ * Software/Photonfirmware can be compiled and run on a PC. Only the parts of the
+ * Particle API that our firmware uses are here. Time comes from a virtual clock
+ * that the simulation advances, so days of puppet behavior can be run in seconds.
+ *
+ * Key pieces
+ *      simClock:  the virtual clock behind millis(), micros() and delay()
+ *      simPins:   values returned by digitalRead() and analogRead()
+ *      Logger:    the Particle logger, silent unless simLogHook is set
+ *      EEPROM:    2047 bytes of emulated EEPROM kept in RAM
+ *      Particle:  publish(), variable() and function() are recorded, not sent
+ *      WiFi, UDP: real UDP sockets on the PC, only when simNetwork.enabled is set.
+ *                 Otherwise WiFi is never ready. simUdpSendHook sees every packet sent.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SIM_ARDUINO_H
+#define _TPP_SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <map>
+#include <initializer_list>
+#include <utility>
+#include <type_traits>
+
+using std::abs;
+
+#define SYSTEM_THREAD(x)
+#define SYSTEM_MODE(x)
+
+// ---------------------------------------------------------
+//-------------------   VIRTUAL CLOCK -----------------------
+
+struct SimClock {
+    uint64_t micros = 0;        // virtual time since power on
+    uint32_t runSeed = 0;       // mixed into randomSeed() so runs differ by seed
+};
+extern SimClock simClock;
+
+inline unsigned long millis() { return (unsigned long)(uint32_t)(simClock.micros / 1000); }
+inline unsigned long micros() { return (unsigned long)(uint32_t)simClock.micros; }
+inline void delay(unsigned long ms) { simClock.micros += (uint64_t)ms * 1000; }
+inline void delayMicroseconds(unsigned int us) { simClock.micros += us; }
+
+// ---------------------------------------------------------
+//-------------------   PINS --------------------------------
+
+enum PinMode { INPUT, OUTPUT, INPUT_PULLUP, INPUT_PULLDOWN };
+#define LOW 0
+#define HIGH 1
+
+enum {
+    D0 = 0, D1, D2, D3, D4, D5, D6, D7,
+    A0 = 10, A1, A2, A3, A4, A5, A6, A7,
+    SIM_NUM_PINS
+};
+
+struct SimPins {
+    int digital[SIM_NUM_PINS] = {0};    // value read by digitalRead(), written by digitalWrite()
+    int analog[SIM_NUM_PINS] = {0};     // value read by analogRead()
+};
+extern SimPins simPins;
+
+inline void pinMode(int, PinMode) {}
+inline int digitalRead(int pin) { return simPins.digital[pin]; }
+inline void digitalWrite(int pin, int value) { simPins.digital[pin] = value; }
+inline int analogRead(int pin) { return simPins.analog[pin]; }
+
+// ---------------------------------------------------------
+//-------------------   MATH HELPERS ------------------------
+
+template <typename T, typename U>
+inline typename std::common_type<T, U>::type min(T a, U b) { return (a < b) ? a : b; }
+template <typename T, typename U>
+inline typename std::common_type<T, U>::type max(T a, U b) { return (a > b) ? a : b; }
+
+inline long map(long value, long fromStart, long fromEnd, long toStart, long toEnd) {
+    if (fromEnd == fromStart) {
+        return toStart;
+    }
+    return (value - fromStart) * (toEnd - toStart) / (fromEnd - fromStart) + toStart;
+}
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) {
+    return (value < (T)low) ? (T)low : ((value > (T)high) ? (T)high : value);
+}
+
+void randomSeed(unsigned int seed);
+long random(long howBig);
+long random(long howSmall, long howBig);
+
+// ---------------------------------------------------------
+//-------------------   STRING ------------------------------
+
+class String {
+    public:
+        String() {}
+        String(const char *s) : s_(s) {}
+        String(const std::string &s) : s_(s) {}
+        String(int value) : s_(std::to_string(value)) {}
+        String(unsigned int value) : s_(std::to_string(value)) {}
+        String(long value) : s_(std::to_string(value)) {}
+        String(unsigned long value) : s_(std::to_string(value)) {}
+        String(float value, int decimals = 2);
+        int toInt() const { return atoi(s_.c_str()); }
+        float toFloat() const { return (float)atof(s_.c_str()); }
+        const char *c_str() const { return s_.c_str(); }
+        unsigned int length() const { return s_.length(); }
+        String &operator+=(const String &rhs) { s_ += rhs.s_; return *this; }
+        String &operator+=(const char *rhs) { s_ += rhs; return *this; }
+        friend String operator+(const String &lhs, const String &rhs) { return String(lhs.s_ + rhs.s_); }
+        friend String operator+(const char *lhs, const String &rhs) { return String(lhs + rhs.s_); }
+        friend String operator+(const String &lhs, const char *rhs) { return String(lhs.s_ + rhs); }
+        bool operator==(const char *rhs) const { return s_ == rhs; }
+
+    private:
+        std::string s_;
+};
+
+// ---------------------------------------------------------
+//-------------------   LOGGING -----------------------------
+
+enum LogLevel {
+    LOG_LEVEL_ALL = 1,
+    LOG_LEVEL_TRACE = 1,
+    LOG_LEVEL_INFO = 30,
+    LOG_LEVEL_WARN = 40,
+    LOG_LEVEL_ERROR = 50,
+    LOG_LEVEL_NONE = 70
+};
+
+// Called for every log message at or above simLogLevel. May be replaced by the simulation.
+typedef void (*SimLogHook)(const char *category, LogLevel level, const char *message);
+extern SimLogHook simLogHook;
+extern LogLevel simLogLevel;
+
+class Logger {
+    public:
+        explicit Logger(const char *name) : name_(name) {}
+        void trace(const char *fmt, ...) const;
+        void info(const char *fmt, ...) const;
+        void warn(const char *fmt, ...) const;
+        void error(const char *fmt, ...) const;
+        void operator()(const char *fmt, ...) const;
+        const char *name() const { return name_; }
+
+    private:
+        void log(LogLevel level, const char *fmt, va_list args) const;
+        const char *name_;
+};
+
+typedef std::initializer_list<std::pair<const char *, LogLevel>> LogCategoryFilters;
+
+class SerialLogHandler {
+    public:
+        SerialLogHandler(LogLevel level = LOG_LEVEL_INFO, LogCategoryFilters filters = {}) {}
+};
+
+// ---------------------------------------------------------
+//-------------------   SERIAL ------------------------------
+
+class SimSerial {
+    public:
+        void begin(long) {}
+        size_t print(const char *s) { return 0; }
+        size_t print(const String &s) { return 0; }
+        size_t print(int, int = 10) { return 0; }
+        size_t println(const char *s = "") { return 0; }
+        size_t println(const String &s) { return 0; }
+        size_t println(int, int = 10) { return 0; }
+        int available() { return 0; }
+        int read() { return -1; }
+        size_t write(uint8_t) { return 1; }
+};
+extern SimSerial Serial;
+extern SimSerial Serial1;
+
+// ---------------------------------------------------------
+//-------------------   EEPROM ------------------------------
+
+class SimEEPROM {
+    public:
+        static const int SIZE = 2047;
+        uint8_t data[SIZE];
+        SimEEPROM() { memset(data, 0xFF, sizeof(data)); }
+        template <typename T> T &get(int addr, T &t) { memcpy((void *)&t, data + addr, sizeof(T)); return t; }
+        template <typename T> const T &put(int addr, const T &t) { memcpy(data + addr, (const void *)&t, sizeof(T)); writes++; return t; }
+        uint8_t read(int addr) { return data[addr]; }
+        void write(int addr, uint8_t value) { data[addr] = value; writes++; }
+        size_t length() { return SIZE; }
+        unsigned long writes = 0;    // number of put()/write() calls, for flash wear estimates
+};
+extern SimEEPROM EEPROM;
+
+// ---------------------------------------------------------
+//-------------------   CLOUD -------------------------------
+
+// Called on every Particle.publish(). May be replaced by the simulation.
+typedef void (*SimPublishHook)(const char *eventName, const char *data);
+extern SimPublishHook simPublishHook;
+
+class SimParticle {
+    public:
+        bool publish(const char *eventName, const char *data = "");
+        bool publish(const String &eventName) { return publish(eventName.c_str()); }
+        bool publish(const String &eventName, const String &data) { return publish(eventName.c_str(), data.c_str()); }
+        template <typename T> bool variable(const char *, const T &) { return true; }
+        template <typename F> bool function(const char *, F) { return true; }
+        bool connected() { return false; }
+        void process() {}
+};
+extern SimParticle Particle;
+
+// ---------------------------------------------------------
+//-------------------   NETWORK -----------------------------
+
+struct SimNetwork {
+    bool enabled = false;       // WiFi.ready() and UDP sockets work only when set
+    std::map<int, int> ports;   // firmware port to the port UDP::begin() binds instead,
+                                // so several simulated puppets can run on one PC
+};
+extern SimNetwork simNetwork;
+
+// Called with every packet the firmware sends, as it is sent
+typedef void (*SimUdpSendHook)(const uint8_t *buffer, size_t size);
+extern SimUdpSendHook simUdpSendHook;
+
+class IPAddress {
+    public:
+        IPAddress() {}
+        IPAddress(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) { bytes_[0] = b0; bytes_[1] = b1; bytes_[2] = b2; bytes_[3] = b3; }
+        uint8_t operator[](int index) const { return bytes_[index]; }
+        uint8_t &operator[](int index) { return bytes_[index]; }
+
+    private:
+        uint8_t bytes_[4] = {0};
+};
+
+class SimWiFi {
+    public:
+        bool ready() { return simNetwork.enabled; }
+};
+extern SimWiFi WiFi;
+
+class UDP {
+    public:
+        ~UDP() { stop(); }
+        uint8_t begin(uint16_t port);
+        void stop();
+        int parsePacket();
+        int available() { return length_ - readPos_; }
+        int read();
+        int read(uint8_t *buffer, size_t size);
+        IPAddress remoteIP() { return remoteIP_; }
+        int remotePort() { return remotePort_; }
+        int sendPacket(const uint8_t *buffer, size_t size, IPAddress ip, uint16_t port);
+
+    private:
+        int socket_ = -1;
+        uint8_t packet_[512];
+        int length_ = 0;
+        int readPos_ = 0;
+        IPAddress remoteIP_;
+        int remotePort_ = 0;
+};
+
+#endif
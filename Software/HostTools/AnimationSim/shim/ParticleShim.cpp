@@ -0,0 +1,303 @@
+/*
+ * ParticleShim.cpp  (host simulation shim)
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Globals and out of line pieces of the Particle API stand ins. See Arduino.h
+ * and Wire.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+SimClock simClock;
+SimPins simPins;
+SimEEPROM EEPROM;
+SimSerial Serial;
+SimSerial Serial1;
+SimParticle Particle;
+SimNetwork simNetwork;
+SimWiFi WiFi;
+TwoWire Wire;
+SimPCA9685 simPCA9685;
+SimI2CBus simI2C;
+
+SimLogHook simLogHook = NULL;
+LogLevel simLogLevel = LOG_LEVEL_NONE;
+SimPublishHook simPublishHook = NULL;
+SimPwmHook simPwmHook = NULL;
+SimUdpSendHook simUdpSendHook = NULL;
+
+// ---------------------------------------------------------
+//-------------------   RANDOM ------------------------------
+
+// xorshift, so runs are repeatable for a given seed on every platform
+static uint32_t randomState_ = 1;
+
+void randomSeed(unsigned int seed) {
+
+    randomState_ = (seed ^ (simClock.runSeed * 2654435761u)) | 1;
+
+}
+
+static uint32_t nextRandom() {
+
+    randomState_ ^= randomState_ << 13;
+    randomState_ ^= randomState_ >> 17;
+    randomState_ ^= randomState_ << 5;
+    return randomState_;
+
+}
+
+long random(long howBig) {
+
+    if (howBig <= 0) {
+        return 0;
+    }
+    return nextRandom() % howBig;
+
+}
+
+long random(long howSmall, long howBig) {
+
+    if (howSmall >= howBig) {
+        return howSmall;
+    }
+    return howSmall + random(howBig - howSmall);
+
+}
+
+// ---------------------------------------------------------
+//-------------------   STRING ------------------------------
+
+String::String(float value, int decimals) {
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    s_ = buf;
+
+}
+
+// ---------------------------------------------------------
+//-------------------   LOGGING -----------------------------
+
+void Logger::log(LogLevel level, const char *fmt, va_list args) const {
+
+    if (level < simLogLevel || simLogHook == NULL) {
+        return;
+    }
+    char buf[256];
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    simLogHook(name_, level, buf);
+
+}
+
+#define SIM_LOG_FUNCTION(fn, level) \
+    void Logger::fn(const char *fmt, ...) const { \
+        va_list args; \
+        va_start(args, fmt); \
+        log(level, fmt, args); \
+        va_end(args); \
+    }
+
+SIM_LOG_FUNCTION(trace, LOG_LEVEL_TRACE)
+SIM_LOG_FUNCTION(info, LOG_LEVEL_INFO)
+SIM_LOG_FUNCTION(warn, LOG_LEVEL_WARN)
+SIM_LOG_FUNCTION(error, LOG_LEVEL_ERROR)
+SIM_LOG_FUNCTION(operator(), LOG_LEVEL_INFO)
+
+// ---------------------------------------------------------
+//-------------------   CLOUD -------------------------------
+
+bool SimParticle::publish(const char *eventName, const char *data) {
+
+    if (simPublishHook != NULL) {
+        simPublishHook(eventName, data);
+    }
+    return true;
+
+}
+
+// ---------------------------------------------------------
+//-------------------   I2C / PCA9685 -----------------------
+
+void TwoWire::beginTransmission(uint8_t address) {
+
+    address_ = address;
+    firstByte_ = true;
+    txBytes_ = 0;
+
+}
+
+size_t TwoWire::write(uint8_t data) {
+
+    if (simI2C.hung) {
+        return 0;
+    }
+    txBytes_++;
+    if (firstByte_) {
+        // the first byte of a write sets the register pointer
+        simPCA9685.pointer = data;
+        firstByte_ = false;
+        return 1;
+    }
+
+    uint8_t r = simPCA9685.pointer;
+    simPCA9685.reg[r] = data;
+
+    // the channel output changes when the high byte of LEDn_OFF is written
+    if (r >= 0x06 && r <= 0x45 && ((r - 0x06) % 4) == 3) {
+        int channel = (r - 0x06) / 4;
+        if (simPwmHook != NULL) {
+            simPwmHook(channel, simPCA9685.offCount(channel));
+        }
+    }
+
+    // auto increment
+    if (simPCA9685.reg[0x00] & 0x20) {
+        simPCA9685.pointer++;
+    }
+    return 1;
+
+}
+
+/* ----- transfer -----
+ * The time bytes take on the bus, the address byte too: 9 bits each, with the ack
+ */
+void TwoWire::transfer(int bytes) {
+
+    if (simI2C.clockHz > 0) {
+        simClock.micros += ((uint64_t)(1 + bytes) * 9 * 1000000 + simI2C.clockHz - 1) / simI2C.clockHz;
+    }
+
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+
+    transfer(txBytes_);
+    return simI2C.hung ? 1 : 0;     // 1: busy timeout
+
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t stop) {
+
+    rxLength_ = simI2C.hung ? 0 : min((int)quantity, (int)sizeof(rxBuffer_));
+    rxIndex_ = 0;
+    for (int i = 0; i < rxLength_; i++) {
+        rxBuffer_[i] = simPCA9685.reg[(uint8_t)(simPCA9685.pointer + i)];
+    }
+    if (simPCA9685.reg[0x00] & 0x20) {
+        simPCA9685.pointer += rxLength_;
+    }
+    transfer(rxLength_);
+    return rxLength_;
+
+}
+
+// ---------------------------------------------------------
+//-------------------   UDP ---------------------------------
+
+/* ----- UDP::begin -----
+ * Opens a non blocking socket on port. Returns 1 on success, 0 otherwise,
+ * as on the Photon.
+ */
+uint8_t UDP::begin(uint16_t port) {
+
+    stop();
+    if (!simNetwork.enabled) {
+        return 0;
+    }
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_ < 0) {
+        return 0;
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(simNetwork.ports.count(port) ? simNetwork.ports[port] : port);
+    if (bind(socket_, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        stop();
+        return 0;
+    }
+    fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL) | O_NONBLOCK);
+    return 1;
+
+}
+
+void UDP::stop() {
+
+    if (socket_ >= 0) {
+        close(socket_);
+        socket_ = -1;
+    }
+    length_ = 0;
+    readPos_ = 0;
+
+}
+
+/* ----- UDP::parsePacket -----
+ * Receives the next packet, dropping what is left of the last one.
+ * Returns its size, or 0 if none is waiting.
+ */
+int UDP::parsePacket() {
+
+    length_ = 0;
+    readPos_ = 0;
+    if (socket_ < 0) {
+        return 0;
+    }
+    sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    ssize_t n = recvfrom(socket_, packet_, sizeof(packet_), 0, (sockaddr *)&from, &fromLength);
+    if (n <= 0) {
+        return 0;
+    }
+    uint32_t ip = ntohl(from.sin_addr.s_addr);
+    remoteIP_ = IPAddress(ip >> 24, ip >> 16, ip >> 8, ip);
+    remotePort_ = ntohs(from.sin_port);
+    length_ = (int)n;
+    return length_;
+
+}
+
+int UDP::read() {
+
+    return (readPos_ < length_) ? packet_[readPos_++] : -1;
+
+}
+
+int UDP::read(uint8_t *buffer, size_t size) {
+
+    int n = min((int)size, length_ - readPos_);
+    memcpy(buffer, packet_ + readPos_, n);
+    readPos_ += n;
+    return n;
+
+}
+
+int UDP::sendPacket(const uint8_t *buffer, size_t size, IPAddress ip, uint16_t port) {
+
+    if (socket_ < 0) {
+        return -1;
+    }
+    sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(((uint32_t)ip[0] << 24) | (ip[1] << 16) | (ip[2] << 8) | ip[3]);
+    to.sin_port = htons(port);
+    if (simUdpSendHook != NULL) {
+        simUdpSendHook(buffer, size);
+    }
+    return (int)sendto(socket_, buffer, size, 0, (sockaddr *)&to, sizeof(to));
+
+}
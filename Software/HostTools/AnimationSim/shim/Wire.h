@@ -0,0 +1,87 @@
+/*
+ * Wire.h  (host simulation shim)
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * A TwoWire stand in with a model of the PCA9685 servo driver behind it. Register
+ * writes are decoded the way the chip does it, including auto increment, so the
+ * simulation sees exactly the PWM values the firmware commanded on each channel.
+ *
+ * Set simPwmHook to be told about every change to a channel's OFF count.
+ *
+ * Each transaction takes the time its bytes take on the bus, 9 bits each at
+ * simI2C.clockHz (100 kHz, the Photon's default, until Wire.setSpeed()), on the
+ * virtual clock. Set clockHz to 0 for a bus that takes no time.
+ *
+ * Set simI2C.hung to hang the bus, as servo noise can: every transaction then
+ * times out, and writes are lost, until Wire.reset() frees it.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SIM_WIRE_H
+#define _TPP_SIM_WIRE_H
+
+#include <Arduino.h>
+
+#define SIM_PCA9685_CHANNELS 16
+
+// Called after a channel's LEDn_OFF registers have been written
+typedef void (*SimPwmHook)(int channel, uint16_t offCount);
+extern SimPwmHook simPwmHook;
+
+/*!
+ *  @brief  Register model of one PCA9685
+ */
+struct SimPCA9685 {
+    uint8_t reg[256];           // register file
+    uint8_t pointer = 0;        // register pointer, set by the first byte of a write
+    SimPCA9685() { memset(reg, 0, sizeof(reg)); }
+    uint16_t offCount(int channel) const {
+        return reg[0x08 + 4 * channel] | ((reg[0x09 + 4 * channel] & 0x1F) << 8);
+    }
+};
+extern SimPCA9685 simPCA9685;
+
+/*!
+ *  @brief  Faults on the bus
+ */
+struct SimI2CBus {
+    bool hung = false;          // every transaction times out until reset()
+    uint32_t resets = 0;        // calls to Wire.reset()
+    uint32_t clockHz = 100000;  // SCL rate, for the time a transaction takes
+};
+extern SimI2CBus simI2C;
+
+class TwoWire {
+    public:
+        void begin() {}
+        void end() {}
+        void setSpeed(uint32_t clockHz) { simI2C.clockHz = clockHz; }
+        void setClock(uint32_t clockHz) { simI2C.clockHz = clockHz; }
+        void beginTransmission(uint8_t address);
+        void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+        size_t write(uint8_t data);
+        uint8_t endTransmission(bool stop = true);
+        uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t stop = true);
+        uint8_t requestFrom(int address, int quantity, int stop = true) {
+            return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)stop);
+        }
+        int available() { return rxLength_ - rxIndex_; }
+        int read() { return (rxIndex_ < rxLength_) ? rxBuffer_[rxIndex_++] : -1; }
+        bool isEnabled() { return true; }
+        void reset() { simI2C.hung = false; simI2C.resets++; }
+
+    private:
+        void transfer(int bytes);
+        uint8_t address_ = 0;
+        bool firstByte_ = true;
+        int txBytes_ = 0;           // written since beginTransmission()
+        uint8_t rxBuffer_[32];
+        int rxLength_ = 0;
+        int rxIndex_ = 0;
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * EyesFirmware.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Compiles the AnimatronicEyes sketch for the host. The Particle build adds
+ * prototypes for every function in a .ino file before compiling it; we have
+ * to do that by hand here. Add new sketch functions to this list.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <Arduino.h>
+#include <TPPShowProtocol.h>
+
+int midValue(int value1, int value2);
+void animationTimerCallback();
+void publishIdleOption(const char *option);
+int addSequence(const char *name);
+int playSequence(String command);
+int setMicroMotion(String command);
+int setAttention(String command);
+void registerMetrics();
+void reportStatus(void *context);
+void saveServoWear(void *context);
+int metricsText(const char *argument, char *buffer, int size);
+int metricsBinary(const char *argument, char *buffer, int size);
+void runShowCue(const ShowCuePacket &cue);
+void sequenceGeneralTests();
+void sequenceLookReal();
+void sequenceWakeUpSlowly(int delayAfterMS);
+void sequenceAsleep(int delayAfterMS);
+void sequenceEyesWake(int delayAfterMS);
+void sequenceEyesRoam();
+void sequenceEyesRoamAhead();
+void sequenceEndStandard();
+void sequenceBlinkEyes(int delayAfterMS);
+
+#include "AnimatronicEyes.ino"
@@ -0,0 +1,401 @@
+/*
+ * GoldenTrace.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Golden trace regression check for the animation libraries. Each named sequence
+ * from the sketch is run on the virtual clock from the pose the puppet has after
+ * setup(), and the PWM values sent to every channel are recorded. The recording
+ * is compared to the golden trace stored in the golden folder, so a change to
+ * TPP_AnimateServo::process() or animationList that alters motion or timing is
+ * found before it reaches the puppet.
+ *
+ * When a change in motion is intended, run with --record to replace the golden
+ * traces and commit them with the change.
+ *
+ * The sequences run on a bus that takes no time, as the golden traces were recorded.
+ * One more check starts the firmware on a bus at the Photon's 100 kHz against a
+ * servo board left running, and fails unless every servo warm starts from what the
+ * board is read back to have, with no I2C errors. A last check puts a three axis
+ * neck, a TPP_Mechanism listed in a TPP_PuppetOf, on servos 6 to 8 beside the eyes,
+ * and fails unless it gets to its pose and every neck servo keeps wear counters.
+ *
+ * Usage
+ *      goldentrace [--record] [--dir golden] [--value-tol N] [--time-tol-ms N]
+ *                  [--jobs N] [--list] [sequence names...]
+ *
+ * Exits with 1 if any sequence differs from its golden trace.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SimHarness.h>
+#include <SimTrace.h>
+#include <SequenceCatalog.h>
+#include <TPPAnimateServo.h>
+#include <TPPAnimatePuppet.h>
+#include <TPPMechanism.h>
+
+#include <chrono>
+#include <vector>
+#include <unistd.h>
+
+#define GOLDEN_RUN_SEED 1
+#define MAX_SEQUENCE_MS 600000      // a sequence that runs longer than this is a failure
+#define WARM_START_PWM 300          // what the board left running has on every channel
+#define NECK_SERVOS 3
+#define NECK_FIRST_SERVO 6          // the neck is on the channels after the eyes'
+#define MAX_NECK_MS 10000           // a neck move that takes longer than this is a failure
+
+struct GoldenConfig {
+    bool record = false;
+    const char *dir = "golden";
+    int valueTol = 2;
+    int timeTolMS = 20;
+    int jobs = 0;
+};
+
+// Result for one sequence. Passed back from the child process as raw bytes.
+struct GoldenResult {
+    bool ran;                   // the sequence finished within MAX_SEQUENCE_MS
+    bool goldenFound;           // a golden trace was there to compare against
+    uint32_t events;
+    uint32_t goldenEvents;
+    int32_t durationMS;
+    int32_t goldenDurationMS;
+    SimTraceDiff diff;
+};
+
+// Result of the warm start check
+struct WarmStartResult {
+    bool ran;
+    uint32_t servos;            // servos begun
+    uint32_t warmServos;        // of them, started from the board's PWM
+    PCA9685_I2CHealth health;
+};
+
+// Result of the neck mechanism check
+struct NeckResult {
+    bool ran;                   // the neck stopped moving within MAX_NECK_MS
+    int32_t moveMS;
+    int pwm[NECK_SERVOS];       // last PWM sent to each neck servo
+    bool wear[NECK_SERVOS];     // each neck servo is in the wear report
+};
+
+// a puppet of just the neck, on the channels after the eyes'
+typedef TPP_PuppetOf<TPP_Mechanism<NECK_SERVOS> > NeckPuppet;
+static_assert(TPP_EyesMechanisms::numChannels + NeckPuppet::numChannels <= MAX_SERVOS,
+              "the neck's servos don't keep wear counters");
+
+// the differential neck of the TPPMechanism.h example
+static const TPP_MechanismAxis neckAxes[NECK_SERVOS] = {
+    // speed, accel, home
+    {  60, 120, 50 },       // pan
+    {  30,  60, 50 },       // tilt
+    {  30,  60, 50 }        // roll
+};
+static const TPP_MechanismChannel<NECK_SERVOS> neckChannels[NECK_SERVOS] = {
+    // servo, low, mid, high, mix of pan, tilt, roll
+    { NECK_FIRST_SERVO,     200, 330, 460, {   0, 100,  100 } },
+    { NECK_FIRST_SERVO + 1, 460, 330, 200, {   0, 100, -100 } },
+    { NECK_FIRST_SERVO + 2, 180, 330, 480, { 100,   0,    0 } }
+};
+static const int neckPose[NECK_SERVOS] = {80, 20, 50};
+static const int neckPosePWM[NECK_SERVOS] = {252, 408, 420};   // the mix of neckPose on each channel
+
+struct GoldenJob {
+    const GoldenConfig *cfg;
+    const SimSequence *sequence;
+};
+
+/* ----- runGoldenJob -----
+ * Runs in a child process: runs one sequence and records or compares its trace
+ */
+static void runGoldenJob(void *context, void *resultOut) {
+
+    const GoldenJob *job = (const GoldenJob *)context;
+    GoldenResult *result = (GoldenResult *)resultOut;
+    SimOptions options;
+
+    static SimTraceRecorder recorder;
+    simAddPwmListener(SimTraceRecorder::listener, &recorder);
+
+    simI2C.clockHz = 0;         // the golden traces were recorded on a bus that takes no time
+    simBegin(GOLDEN_RUN_SEED);
+    uint64_t startMicros = 0;
+    if (!simSettle(MAX_SEQUENCE_MS * 1000ULL, options)) {
+        return;
+    }
+    simStopMicroMotion();
+    recorder.start(simClock.micros);
+    result->ran = simRunSequence(job->sequence->addScenes, MAX_SEQUENCE_MS * 1000ULL, options, &startMicros);
+    recorder.stop(simClock.micros);
+
+    result->events = recorder.trace.events.size();
+    result->durationMS = recorder.trace.durationMS;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.trace", job->cfg->dir, job->sequence->name);
+
+    if (job->cfg->record) {
+        if (result->ran && simSaveTrace(path, job->sequence->name, recorder.trace)) {
+            result->goldenFound = true;
+        }
+        return;
+    }
+
+    SimTrace golden;
+    if (!simLoadTrace(path, golden)) {
+        return;
+    }
+    result->goldenFound = true;
+    result->goldenEvents = golden.events.size();
+    result->goldenDurationMS = golden.durationMS;
+    result->diff = simCompareTraces(golden, recorder.trace, job->cfg->valueTol, job->cfg->timeTolMS);
+
+}
+
+static WarmStartResult *warmStartResult_ = NULL;
+
+static void warmStartLog(const char *category, LogLevel level, const char *message) {
+
+    if (strncmp(message, "Begin Servo", 11) == 0) {
+        warmStartResult_->servos++;
+        if (strstr(message, "warm start") != NULL) {
+            warmStartResult_->warmServos++;
+        }
+    }
+
+}
+
+/* ----- runWarmStartJob -----
+ * Runs in a child process: starts the firmware against a servo board that is
+ * already running, as after a reset of the Photon alone
+ */
+static void runWarmStartJob(void *context, void *resultOut) {
+
+    WarmStartResult *result = (WarmStartResult *)resultOut;
+
+    simPCA9685.reg[0x00] = 0x20;    // MODE1: awake, auto increment
+    simPCA9685.reg[0xFE] = (uint8_t)(FREQUENCY_OSCILLATOR / (SERVO_PWM_HZ * 4096.0) + 0.5 - 1);
+    for (int c = 0; c < SIM_PCA9685_CHANNELS; c++) {
+        simPCA9685.reg[0x08 + 4 * c] = WARM_START_PWM & 0xFF;
+        simPCA9685.reg[0x09 + 4 * c] = WARM_START_PWM >> 8;
+    }
+    simI2C.clockHz = 100000;
+
+    warmStartResult_ = result;
+    simLogLevel = LOG_LEVEL_INFO;
+    simLogHook = warmStartLog;
+    simBegin(GOLDEN_RUN_SEED);
+    result->health = TPP_AnimateServo::getI2CHealth();
+    result->ran = true;
+
+}
+
+/* ----- checkWarmStart -----
+ * Runs the warm start check and prints its line. Returns true if it passed.
+ */
+static bool checkWarmStart() {
+
+    WarmStartResult r;
+    memset(&r, 0, sizeof(r));
+    int fd = -1;
+    int pid = simRunForked(runWarmStartJob, NULL, sizeof(r), &fd);
+    bool collected = pid >= 0 && simCollectForked(pid, fd, &r, sizeof(r));
+    bool pass = collected && r.ran && r.servos > 0 && r.warmServos == r.servos && r.health.nacks == 0 &&
+                r.health.timeouts == 0;
+    printf("%-8s %-24s %u of %u servos  i2c %u sent, %u nack, %u timeout, slowest %u us\n",
+           pass ? "PASS" : "FAIL", "warm start", r.warmServos, r.servos, r.health.transactions, r.health.nacks,
+           r.health.timeouts, r.health.slowestMicros);
+    return pass;
+
+}
+
+/* ----- inWearReport -----
+ * True if the wear report has an entry, servoNum:counters; for the servo
+ */
+static bool inWearReport(const char *report, int servoNum) {
+
+    for (const char *entry = report; *entry != 0; entry++) {
+        if (atoi(entry) == servoNum) {
+            return true;
+        }
+        entry = strchr(entry, ';');
+        if (entry == NULL) {
+            break;
+        }
+    }
+    return false;
+
+}
+
+/* ----- runNeckJob -----
+ * Runs in a child process: starts the firmware, then begins the neck and moves
+ * it to neckPose
+ */
+static void runNeckJob(void *context, void *resultOut) {
+
+    NeckResult *result = (NeckResult *)resultOut;
+
+    simI2C.clockHz = 0;
+    simBegin(GOLDEN_RUN_SEED);
+
+    static NeckPuppet neck;
+    neck.get<0>().begin(neckAxes, neckChannels);
+    neck.get<0>().setPose(neckPose, MOVE_SPEED_FAST);
+
+    uint64_t startMicros = simClock.micros;
+    while (neck.isMoving() && simClock.micros - startMicros < MAX_NECK_MS * 1000ULL) {
+        simClock.micros += 1000;
+        neck.process();
+    }
+    result->ran = !neck.isMoving();
+    result->moveMS = (simClock.micros - startMicros) / 1000;
+    for (int ms = 0; ms < MECHANISM_FRAME_MS * 5; ms++) {
+        simClock.micros += 1000;    // the servos finish the last frame
+        neck.process();
+    }
+
+    static char report[1024];
+    TPP_AnimateServo::wearReport(report, sizeof(report));
+    for (int c = 0; c < NECK_SERVOS; c++) {
+        result->pwm[c] = simChannels[NECK_FIRST_SERVO + c].lastValue;
+        result->wear[c] = inWearReport(report, NECK_FIRST_SERVO + c);
+    }
+
+}
+
+/* ----- checkNeck -----
+ * Runs the neck mechanism check and prints its line. Returns true if it passed.
+ */
+static bool checkNeck() {
+
+    NeckResult r;
+    memset(&r, 0, sizeof(r));
+    int fd = -1;
+    int pid = simRunForked(runNeckJob, NULL, sizeof(r), &fd);
+    bool collected = pid >= 0 && simCollectForked(pid, fd, &r, sizeof(r));
+    int arrived = 0;
+    int wearing = 0;
+    for (int c = 0; c < NECK_SERVOS; c++) {
+        arrived += (abs(r.pwm[c] - neckPosePWM[c]) <= 1) ? 1 : 0;
+        wearing += r.wear[c] ? 1 : 0;
+    }
+    bool pass = collected && r.ran && arrived == NECK_SERVOS && wearing == NECK_SERVOS;
+    printf("%-8s %-24s %d of %d servos at the pose in %d ms, %d keep wear counters  pwm %d %d %d\n",
+           pass ? "PASS" : "FAIL", "neck mechanism", arrived, NECK_SERVOS, r.moveMS, wearing,
+           r.pwm[0], r.pwm[1], r.pwm[2]);
+    return pass;
+
+}
+
+/* ----- printResult -----
+ * One line per sequence. Returns true if the sequence passed.
+ */
+static bool printResult(const char *name, const GoldenConfig &cfg, bool collected, const GoldenResult &r) {
+
+    if (!collected || !r.ran) {
+        printf("FAIL     %-24s did not finish\n", name);
+        return false;
+    }
+    if (cfg.record) {
+        printf("%-8s %-24s %6u events %8d ms\n", r.goldenFound ? "RECORDED" : "FAIL", name, r.events, r.durationMS);
+        return r.goldenFound;
+    }
+    if (!r.goldenFound) {
+        printf("MISSING  %-24s no golden trace in %s\n", name, cfg.dir);
+        return false;
+    }
+
+    const SimTraceDiff &d = r.diff;
+    printf("%-8s %-24s %6u events %8d ms (golden %u, %d ms)  moves %d/%d  drift mean %+.1f ms max %d ms\n",
+           d.match ? "PASS" : "FAIL", name, r.events, r.durationMS, r.goldenEvents, r.goldenDurationMS,
+           d.actualMoves, d.goldenMoves, d.meanDriftMS, d.maxDriftMS);
+    if (!d.match) {
+        printf("         first divergence at %d ms on channel %d: expected %d, got %d\n",
+               d.divergeMS, d.divergeChannel, d.expectedValue, d.actualValue);
+    }
+    return d.match;
+
+}
+
+int main(int argc, char **argv) {
+
+    GoldenConfig cfg;
+    std::vector<const SimSequence *> sequences;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+        if (strcmp(arg, "--record") == 0) {
+            cfg.record = true;
+        } else if (strcmp(arg, "--list") == 0) {
+            for (int s = 0; s < simNumSequences; s++) {
+                printf("%s\n", simSequences[s].name);
+            }
+            return 0;
+        } else if (strcmp(arg, "--dir") == 0) {
+            cfg.dir = value;
+            i++;
+        } else if (strcmp(arg, "--value-tol") == 0) {
+            cfg.valueTol = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--time-tol-ms") == 0) {
+            cfg.timeTolMS = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--jobs") == 0) {
+            cfg.jobs = atoi(value);
+            i++;
+        } else if (simFindSequence(arg) != NULL) {
+            sequences.push_back(simFindSequence(arg));
+        } else {
+            fprintf(stderr, "unknown sequence or option %s\n", arg);
+            fprintf(stderr, "usage: goldentrace [--record] [--dir golden] [--value-tol N] [--time-tol-ms N]\n"
+                            "                   [--jobs N] [--list] [sequence names...]\n");
+            return 2;
+        }
+    }
+    if (sequences.empty()) {
+        for (int s = 0; s < simNumSequences; s++) {
+            sequences.push_back(&simSequences[s]);
+        }
+    }
+    if (cfg.jobs <= 0) {
+        cfg.jobs = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    }
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    int n = sequences.size();
+    std::vector<GoldenJob> jobs(n);
+    std::vector<GoldenResult> results(n);
+    std::vector<int> pids(n, -1);
+    std::vector<int> fds(n, -1);
+    int nextToStart = 0;
+    int failures = 0;
+
+    for (int next = 0; next < n; next++) {
+        while (nextToStart < n && nextToStart - next < cfg.jobs) {
+            jobs[nextToStart] = {&cfg, sequences[nextToStart]};
+            pids[nextToStart] = simRunForked(runGoldenJob, &jobs[nextToStart], sizeof(GoldenResult), &fds[nextToStart]);
+            nextToStart++;
+        }
+        bool collected = pids[next] >= 0 && simCollectForked(pids[next], fds[next], &results[next], sizeof(GoldenResult));
+        if (!printResult(sequences[next]->name, cfg, collected, results[next])) {
+            failures++;
+        }
+    }
+
+    bool warmStarted = cfg.record || checkWarmStart();
+    bool neckMoved = cfg.record || checkNeck();
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    printf("\n%d of %d sequences %s%s%s in %.3f s (value tolerance %d ticks, time tolerance %d ms)\n",
+           n - failures, n, cfg.record ? "recorded" : "match", warmStarted ? "" : ", warm start failed",
+           neckMoved ? "" : ", neck failed", wallSeconds, cfg.valueTol, cfg.timeTolMS);
+
+    return (failures == 0 && warmStarted && neckMoved) ? 0 : 1;
+
+}
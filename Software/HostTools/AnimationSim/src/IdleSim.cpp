@@ -0,0 +1,315 @@
+/*
+ * IdleSim.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Long horizon simulation of the AnimatronicEyes firmware. Runs the real setup()
+ * and loop() on a virtual clock for days at a time, with visitors arriving at
+ * random (a Poisson process) and asserting the A5 trigger the way the mouth
+ * processor does. Many seeds are run in parallel, one process per seed, and the
+ * statistics are summarized across them.
+ *
+ * Use this before deploying a new idle mix to see how many sequences run, how far
+ * the servos travel and whether the scene list ever overflows.
+ *
+ * Usage
+ *      idlesim [--days N] [--seeds N] [--jobs N] [--visits-per-hour X]
+ *              [--visit-min-ms N] [--visit-max-ms N] [--tick-ms N] [--verbose]
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SimHarness.h>
+#include <TPPAnimationList.h>
+
+#include <random>
+#include <vector>
+#include <chrono>
+#include <unistd.h>
+
+extern animationList animation1;   // from AnimatronicEyes.ino
+
+#define NUM_IDLE_OPTIONS 4
+#define NUM_EYE_SERVOS 6
+#define REARM_MS 2000   // mouth BUSY_WAIT: time after a visit before the PIR can trigger again
+
+struct IdleSimConfig {
+    double days = 7;
+    int seeds = 8;
+    int jobs = 0;                   // 0: one per core
+    double visitsPerHour = 6;       // mean visitor arrival rate
+    uint32_t visitMinMS = 6000;     // A5 is held for eyes start + clip + eyes complete time
+    uint32_t visitMaxMS = 14000;
+    bool verbose = false;
+    SimOptions sim;
+};
+
+// Results of one seed. Passed back from the child process as raw bytes.
+struct IdleSimResult {
+    uint32_t seed;
+    uint64_t loops;                             // calls to loop()
+    double wallSeconds;                         // real time the run took
+    uint32_t visits;                            // A5 assertions
+    uint32_t visitsMissed;                      // arrivals while a visit was still going on
+    uint32_t idleOptions[NUM_IDLE_OPTIONS];     // idle sequences started, by option
+    uint32_t animationRuns;
+    uint32_t scenesPlayed;
+    uint32_t sceneOverflows;
+    uint64_t travelTicks[NUM_EYE_SERVOS];
+    uint32_t reversals[NUM_EYE_SERVOS];
+    uint32_t eepromWrites;
+};
+
+static IdleSimResult *currentResult_ = NULL;
+
+/* ----- publishHook -----
+ * Counts the "Idle option N" events the firmware publishes
+ */
+static void publishHook(const char *eventName, const char *data) {
+
+    int option = 0;
+    if (currentResult_ != NULL && sscanf(eventName, "Idle option %d", &option) == 1 &&
+        option >= 1 && option <= NUM_IDLE_OPTIONS) {
+        currentResult_->idleOptions[option - 1]++;
+    }
+
+}
+
+// what a child process needs to know to run one seed
+struct SeedJob {
+    const IdleSimConfig *cfg;
+    uint32_t seed;
+};
+
+/* ----- runSeedJob -----
+ * Runs in a child process. Simulates cfg->days of operation for one seed.
+ */
+static void runSeedJob(void *context, void *resultOut) {
+
+    const IdleSimConfig *cfg = ((const SeedJob *)context)->cfg;
+    uint32_t seed = ((const SeedJob *)context)->seed;
+    IdleSimResult *result = (IdleSimResult *)resultOut;
+    result->seed = seed;
+    currentResult_ = result;
+    simPublishHook = publishHook;
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    std::mt19937 rng(seed);
+    std::exponential_distribution<double> arrivalGap(cfg->visitsPerHour / 3600.0e6); // in microseconds
+    std::uniform_int_distribution<uint32_t> visitLength(cfg->visitMinMS, cfg->visitMaxMS);
+
+    simBegin(seed);
+
+    const uint64_t endMicros = simClock.micros + (uint64_t)(cfg->days * 86400.0e6);
+    uint64_t nextArrival = simClock.micros + (uint64_t)arrivalGap(rng);
+    uint64_t visitEnd = 0;          // when the current visit drops A5, 0 if none
+    uint64_t rearmAt = 0;           // no new visit before this
+
+    while (simClock.micros < endMicros) {
+
+        uint64_t nextEvent = min(endMicros, nextArrival);
+        if (visitEnd != 0) {
+            nextEvent = min(nextEvent, visitEnd);
+        }
+        result->loops += simRunUntil(nextEvent, cfg->sim);
+
+        if (visitEnd != 0 && simClock.micros >= visitEnd) {
+            simPins.digital[SIM_TRIGGER_PIN] = LOW;
+            visitEnd = 0;
+            rearmAt = simClock.micros + (uint64_t)REARM_MS * 1000;
+        }
+
+        if (simClock.micros >= nextArrival) {
+            if (visitEnd == 0 && simClock.micros >= rearmAt) {
+                simPins.digital[SIM_TRIGGER_PIN] = HIGH;
+                visitEnd = simClock.micros + (uint64_t)visitLength(rng) * 1000;
+                result->visits++;
+            } else {
+                result->visitsMissed++;
+            }
+            nextArrival = simClock.micros + 1 + (uint64_t)arrivalGap(rng);
+        }
+
+    }
+
+    result->animationRuns = animation1.getRunCount();
+    result->scenesPlayed = animation1.getScenesPlayed();
+    result->sceneOverflows = animation1.getOverflowCount();
+    for (int i = 0; i < NUM_EYE_SERVOS; i++) {
+        result->travelTicks[i] = simChannels[i].travelTicks;
+        result->reversals[i] = simChannels[i].reversals;
+    }
+    result->eepromWrites = EEPROM.writes;
+    result->wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+}
+
+// ---------------------------------------------------------
+//-------------------   SUMMARY -----------------------------
+
+struct Summary {
+    double sum = 0;
+    double lo = 1e300;
+    double hi = -1e300;
+    int n = 0;
+    void add(double v) { sum += v; lo = min(lo, v); hi = max(hi, v); n++; }
+};
+
+static void printSummary(const char *name, const Summary &s, double days) {
+
+    if (s.n == 0) {
+        return;
+    }
+    double mean = s.sum / s.n;
+    printf("  %-24s %14.1f %14.1f %14.1f %14.1f\n", name, mean, mean / days, s.lo, s.hi);
+
+}
+
+static void printResult(const IdleSimResult &r) {
+
+    printf("seed %u: visits %u (missed %u), idle %u/%u/%u/%u, runs %u, scenes %u, overflows %u, "
+           "x travel %llu, loops %llu, %.2fs\n",
+           r.seed, r.visits, r.visitsMissed, r.idleOptions[0], r.idleOptions[1], r.idleOptions[2],
+           r.idleOptions[3], r.animationRuns, r.scenesPlayed, r.sceneOverflows,
+           (unsigned long long)r.travelTicks[0], (unsigned long long)r.loops, r.wallSeconds);
+
+}
+
+static bool parseArgs(int argc, char **argv, IdleSimConfig &cfg) {
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--verbose") == 0) {
+            cfg.verbose = true;
+            continue;
+        }
+        if (value == NULL) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+        if (strcmp(arg, "--days") == 0) cfg.days = atof(value);
+        else if (strcmp(arg, "--seeds") == 0) cfg.seeds = atoi(value);
+        else if (strcmp(arg, "--jobs") == 0) cfg.jobs = atoi(value);
+        else if (strcmp(arg, "--visits-per-hour") == 0) cfg.visitsPerHour = atof(value);
+        else if (strcmp(arg, "--visit-min-ms") == 0) cfg.visitMinMS = atoi(value);
+        else if (strcmp(arg, "--visit-max-ms") == 0) cfg.visitMaxMS = atoi(value);
+        else if (strcmp(arg, "--tick-ms") == 0) cfg.sim.tickMS = max(1, atoi(value));
+        else if (strcmp(arg, "--quiet-step-ms") == 0) cfg.sim.quietStepMS = max(1, atoi(value));
+        else {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    if (cfg.visitMaxMS < cfg.visitMinMS) {
+        cfg.visitMaxMS = cfg.visitMinMS;
+    }
+    return cfg.days > 0 && cfg.seeds > 0 && cfg.visitsPerHour > 0;
+
+}
+
+int main(int argc, char **argv) {
+
+    IdleSimConfig cfg;
+    if (!parseArgs(argc, argv, cfg)) {
+        fprintf(stderr, "usage: idlesim [--days N] [--seeds N] [--jobs N] [--visits-per-hour X]\n"
+                        "               [--visit-min-ms N] [--visit-max-ms N] [--tick-ms N]\n"
+                        "               [--quiet-step-ms N] [--verbose]\n");
+        return 2;
+    }
+    if (cfg.jobs <= 0) {
+        cfg.jobs = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    }
+
+    printf("Simulating %.1f days x %d seeds on %d jobs, %.1f visits/hour\n",
+           cfg.days, cfg.seeds, cfg.jobs, cfg.visitsPerHour);
+    fflush(stdout);
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    std::vector<IdleSimResult> results(cfg.seeds);
+    std::vector<int> pids(cfg.seeds, -1);
+    std::vector<int> fds(cfg.seeds, -1);
+    int nextToStart = 0;
+    int nextToCollect = 0;
+    int failures = 0;
+
+    // keep cfg.jobs children running until every seed is done
+    while (nextToCollect < cfg.seeds) {
+        while (nextToStart < cfg.seeds && nextToStart - nextToCollect < cfg.jobs) {
+            memset(&results[nextToStart], 0, sizeof(IdleSimResult));
+            results[nextToStart].seed = nextToStart + 1;
+            SeedJob job = {&cfg, results[nextToStart].seed};
+            pids[nextToStart] = simRunForked(runSeedJob, &job, sizeof(IdleSimResult), &fds[nextToStart]);
+            nextToStart++;
+        }
+        uint32_t seed = results[nextToCollect].seed;
+        if (pids[nextToCollect] < 0 ||
+            !simCollectForked(pids[nextToCollect], fds[nextToCollect], &results[nextToCollect], sizeof(IdleSimResult))) {
+            fprintf(stderr, "seed %u failed\n", seed);
+            results[nextToCollect].seed = 0;
+            failures++;
+        } else if (cfg.verbose) {
+            printResult(results[nextToCollect]);
+        }
+        nextToCollect++;
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    // summarize across seeds
+    Summary visits, missed, runs, scenes, overflows, eeprom, loops, seconds;
+    Summary idle[NUM_IDLE_OPTIONS], travel[NUM_EYE_SERVOS], reversals[NUM_EYE_SERVOS];
+    for (const IdleSimResult &r : results) {
+        if (r.seed == 0) {
+            continue;
+        }
+        visits.add(r.visits);
+        missed.add(r.visitsMissed);
+        runs.add(r.animationRuns);
+        scenes.add(r.scenesPlayed);
+        overflows.add(r.sceneOverflows);
+        eeprom.add(r.eepromWrites);
+        loops.add((double)r.loops);
+        seconds.add(r.wallSeconds);
+        for (int i = 0; i < NUM_IDLE_OPTIONS; i++) {
+            idle[i].add(r.idleOptions[i]);
+        }
+        for (int i = 0; i < NUM_EYE_SERVOS; i++) {
+            travel[i].add((double)r.travelTicks[i]);
+            reversals[i].add(r.reversals[i]);
+        }
+    }
+
+    printf("\n  %-24s %14s %14s %14s %14s\n", "statistic", "mean", "mean/day", "min", "max");
+    printSummary("visits", visits, cfg.days);
+    printSummary("visits missed", missed, cfg.days);
+    for (int i = 0; i < NUM_IDLE_OPTIONS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "idle option %d", i + 1);
+        printSummary(name, idle[i], cfg.days);
+    }
+    printSummary("animation runs", runs, cfg.days);
+    printSummary("scenes played", scenes, cfg.days);
+    printSummary("scene list overflows", overflows, cfg.days);
+    for (int i = 0; i < NUM_EYE_SERVOS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "servo %d travel ticks", i);
+        printSummary(name, travel[i], cfg.days);
+        snprintf(name, sizeof(name), "servo %d reversals", i);
+        printSummary(name, reversals[i], cfg.days);
+    }
+    printSummary("EEPROM writes", eeprom, cfg.days);
+    printSummary("loop() calls", loops, cfg.days);
+    printSummary("seconds per seed", seconds, cfg.days);
+
+    double simulatedDays = (cfg.seeds - failures) * cfg.days;
+    printf("\n%d seeds x %.1f days in %.2f s wall time (%.2f s per simulated day)\n",
+           cfg.seeds - failures, cfg.days, wallSeconds, simulatedDays > 0 ? wallSeconds / simulatedDays : 0.0);
+
+    return failures == 0 ? 0 : 1;
+
+}
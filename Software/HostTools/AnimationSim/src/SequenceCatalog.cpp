@@ -0,0 +1,52 @@
+/*
+ * SequenceCatalog.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * The named sequences from AnimatronicEyes.ino. See SequenceCatalog.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SequenceCatalog.h>
+#include <string.h>
+
+// from AnimatronicEyes.ino
+void sequenceGeneralTests();
+void sequenceLookReal();
+void sequenceWakeUpSlowly(int delayAfterMS);
+void sequenceAsleep(int delayAfterMS);
+void sequenceEyesWake(int delayAfterMS);
+void sequenceEyesRoam();
+void sequenceEyesRoamAhead();
+void sequenceEndStandard();
+void sequenceBlinkEyes(int delayAfterMS);
+
+const SimSequence simSequences[] = {
+    { "sequenceAsleep",         [] { sequenceAsleep(1000); } },
+    { "sequenceBlinkEyes",      [] { sequenceBlinkEyes(100); } },
+    { "sequenceEndStandard",    [] { sequenceEndStandard(); } },
+    { "sequenceEyesRoam",       [] { sequenceEyesRoam(); } },
+    { "sequenceEyesRoamAhead",  [] { sequenceEyesRoamAhead(); } },
+    { "sequenceEyesWake",       [] { sequenceEyesWake(0); } },
+    { "sequenceGeneralTests",   [] { sequenceGeneralTests(); } },
+    { "sequenceLookReal",       [] { sequenceLookReal(); } },
+    { "sequenceWakeUpSlowly",   [] { sequenceWakeUpSlowly(0); } },
+};
+
+const int simNumSequences = sizeof(simSequences) / sizeof(simSequences[0]);
+
+/* ----- simFindSequence -----
+ * returns the catalog entry with this name, or NULL
+ */
+const SimSequence *simFindSequence(const char *name) {
+
+    for (int i = 0; i < simNumSequences; i++) {
+        if (strcmp(simSequences[i].name, name) == 0) {
+            return &simSequences[i];
+        }
+    }
+    return NULL;
+
+}
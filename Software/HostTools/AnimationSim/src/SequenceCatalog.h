@@ -0,0 +1,28 @@
+/*
+ * SequenceCatalog.h
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * The named sequences from AnimatronicEyes.ino that the host tools can run on
+ * their own. Sequences that take a delay parameter are listed with the value
+ * the sketch normally uses. Add new sketch sequences here (and their prototypes
+ * to EyesFirmware.cpp).
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SIM_SEQUENCE_CATALOG_H
+#define _TPP_SIM_SEQUENCE_CATALOG_H
+
+struct SimSequence {
+    const char *name;
+    void (*addScenes)();
+};
+
+extern const SimSequence simSequences[];
+extern const int simNumSequences;
+
+const SimSequence *simFindSequence(const char *name);
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ * SimHarness.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Runs the real AnimatronicEyes firmware against the shim on a virtual clock.
+ * See SimHarness.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SimHarness.h>
+#include <TPPAnimationList.h>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern animationList animation1;   // from AnimatronicEyes.ino
+
+SimChannelStats simChannels[SIM_PCA9685_CHANNELS];
+
+static SimPwmListener listeners_[SIM_MAX_LISTENERS];
+static void *listenerContexts_[SIM_MAX_LISTENERS];
+static int numListeners_ = 0;
+static SimStepListener stepListeners_[SIM_MAX_LISTENERS];
+static void *stepContexts_[SIM_MAX_LISTENERS];
+static int numStepListeners_ = 0;
+static uint64_t lastPwmMicros_ = 0;
+
+/* ----- pwmHook -----
+ * Called by the PCA9685 model each time a channel is written. Keeps the
+ * channel statistics and passes the value on to the listeners.
+ */
+static void pwmHook(int channel, uint16_t value) {
+
+    SimChannelStats &ch = simChannels[channel];
+    if (ch.lastValue >= 0) {
+        int step = (int)value - ch.lastValue;
+        if (step != 0) {
+            ch.travelTicks += abs(step);
+            int direction = (step > 0) ? 1 : -1;
+            if (ch.lastDirection != 0 && direction != ch.lastDirection) {
+                ch.reversals++;
+            }
+            ch.lastDirection = direction;
+        }
+    }
+    ch.lastValue = value;
+    ch.commands++;
+    lastPwmMicros_ = simClock.micros;
+
+    for (int i = 0; i < numListeners_; i++) {
+        listeners_[i](simClock.micros, channel, value, listenerContexts_[i]);
+    }
+
+}
+
+/* ----- simAddPwmListener -----
+ * listener will be called for every PWM value the firmware writes
+ */
+void simAddPwmListener(SimPwmListener listener, void *context) {
+
+    if (numListeners_ < SIM_MAX_LISTENERS) {
+        listeners_[numListeners_] = listener;
+        listenerContexts_[numListeners_] = context;
+        numListeners_++;
+    }
+
+}
+
+/* ----- simAddStepListener -----
+ * listener will be called after every step of the virtual clock
+ */
+void simAddStepListener(SimStepListener listener, void *context) {
+
+    if (numStepListeners_ < SIM_MAX_LISTENERS) {
+        stepListeners_[numStepListeners_] = listener;
+        stepContexts_[numStepListeners_] = context;
+        numStepListeners_++;
+    }
+
+}
+
+static void stepDone() {
+
+    for (int i = 0; i < numStepListeners_; i++) {
+        stepListeners_[i](simClock.micros, stepContexts_[i]);
+    }
+
+}
+
+/* ----- simBegin -----
+ * Installs the hooks and runs the firmware setup(). runSeed makes the
+ * firmware's random() calls different from run to run.
+ */
+void simBegin(uint32_t runSeed) {
+
+    simClock.runSeed = runSeed;
+    simPwmHook = pwmHook;
+    simPins.digital[SIM_TRIGGER_PIN] = LOW;
+    setup();
+
+}
+
+/* ----- simPuppetIsQuiet -----
+ * true when no animation is running, the eyes are not pursuing or wandering and no
+ * servo has been moved for a while
+ */
+bool simPuppetIsQuiet(const SimOptions &options) {
+
+    return !animation1.isRunning() && !animation1.puppet.isMoving() &&
+           (simClock.micros - lastPwmMicros_ > (uint64_t)options.quietAfterMS * 1000);
+
+}
+
+/* ----- simRunUntil -----
+ * Calls the firmware loop() until the virtual clock reaches untilMicros.
+ * Returns the number of calls made.
+ */
+uint64_t simRunUntil(uint64_t untilMicros, const SimOptions &options) {
+
+    uint64_t loops = 0;
+
+    while (simClock.micros < untilMicros) {
+
+        uint64_t stepMicros = (uint64_t)(simPuppetIsQuiet(options) ? options.quietStepMS : options.tickMS) * 1000;
+        if (simClock.micros + stepMicros > untilMicros) {
+            stepMicros = untilMicros - simClock.micros;
+        }
+        simClock.micros += stepMicros;
+
+        loop();
+        stepDone();
+        loops++;
+
+    }
+
+    return loops;
+
+}
+
+/* ----- simSettle -----
+ * Lets the animation that is running finish, without the rest of loop().
+ * Returns false if it was still going after maxMicros.
+ */
+bool simSettle(uint64_t maxMicros, const SimOptions &options) {
+
+    uint64_t endMicros = simClock.micros + maxMicros;
+
+    while (!simPuppetIsQuiet(options)) {
+        if (simClock.micros >= endMicros) {
+            return false;
+        }
+        simClock.micros += (uint64_t)options.tickMS * 1000;
+        animationTimerCallback();
+        stepDone();
+    }
+    return true;
+
+}
+
+/* ----- simStopMicroMotion -----
+ * Switches micro-motion off and takes its offsets off the servos, and lets the
+ * servos send the clean pose
+ */
+void simStopMicroMotion() {
+
+    animation1.puppet.setMicroMotion(0, 0, 1);
+    animation1.puppet.eyeballs().setOffset(0, 0);
+    animation1.puppet.forEachOf<TPP_Eyelid>([](TPP_Eyelid &lid) { lid.setOffset(0); });
+    animation1.puppet.process();
+
+}
+
+/* ----- simRunSequence -----
+ * Clears the scene list, calls addScenes() to fill it (one of the sketch's
+ * sequence functions), starts it and runs it until the servos are still.
+ * Micro-motion is switched off first, with simStopMicroMotion(): it would keep the
+ * servos from ever being still, and the motion is the sequence's alone, from the
+ * clean pose.
+ * startMicros is set to the virtual time the run started.
+ * Returns false if it was still going after maxMicros.
+ */
+bool simRunSequence(void (*addScenes)(), uint64_t maxMicros, const SimOptions &options, uint64_t *startMicros) {
+
+    simStopMicroMotion();
+    animation1.stopRunning();
+    animation1.clearSceneList();
+    addScenes();
+    *startMicros = simClock.micros;
+    animation1.startRunning();
+    animationTimerCallback();
+    stepDone();
+    return simSettle(maxMicros, options);
+
+}
+
+/* ----- simRunForked -----
+ * Runs fn in a child process so it gets a fresh copy of the firmware globals.
+ * The child passes resultSize bytes back through a pipe.
+ */
+int simRunForked(void (*fn)(void *context, void *result), void *context, size_t resultSize, int *readFd) {
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+
+    int pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        // child
+        close(fds[0]);
+        uint8_t *result = new uint8_t[resultSize]();
+        fn(context, result);
+        size_t written = 0;
+        while (written < resultSize) {
+            ssize_t n = write(fds[1], result + written, resultSize - written);
+            if (n <= 0) {
+                break;
+            }
+            written += n;
+        }
+        close(fds[1]);
+        _exit(written == resultSize ? 0 : 1);
+    }
+
+    close(fds[1]);
+    *readFd = fds[0];
+    return pid;
+
+}
+
+/* ----- simCollectForked -----
+ * Reads the result of a child started by simRunForked and waits for it to exit.
+ * Returns false if the child failed.
+ */
+bool simCollectForked(int pid, int readFd, void *result, size_t resultSize) {
+
+    size_t got = 0;
+    while (got < resultSize) {
+        ssize_t n = read(readFd, (uint8_t *)result + got, resultSize - got);
+        if (n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    close(readFd);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return got == resultSize && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+}
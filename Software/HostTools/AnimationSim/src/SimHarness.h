@@ -0,0 +1,80 @@
+/*
+ * SimHarness.h
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Runs the real AnimatronicEyes firmware (setup(), loop() and the TPP animation
+ * libraries) against the shim in ../shim on a virtual clock.
+ *
+ * Key functions
+ *      simBegin:       installs the hooks and calls the firmware setup()
+ *      simRunUntil:    calls loop() over and over, stepping the virtual clock, until
+ *                      the given time. Quiet stretches are skipped over quickly.
+ *      simRunSequence: runs one named sequence from the sketch on its own, without the
+ *                      idle and trigger logic in loop() or micro-motion, until the
+ *                      servos are still
+ *      simStopMicroMotion: switches micro-motion off and sends the clean pose, as
+ *                      simRunSequence does first. Call it before recording a sequence
+ *                      so the recording starts from that pose.
+ *      simAddPwmListener: be told about every PWM value the firmware sends
+ *      simAddStepListener: be called after every step of the virtual clock
+ *      simRunForked:   runs a function in a child process and returns its result.
+ *                      Firmware state is global, so every independent run needs
+ *                      its own process.
+ *
+ * Statistics for each servo channel are kept in simChannels.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SIM_HARNESS_H
+#define _TPP_SIM_HARNESS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define SIM_MAX_LISTENERS 8
+#define SIM_TRIGGER_PIN A5
+
+// the firmware entry points, from EyesFirmware.cpp
+void setup();
+void loop();
+void animationTimerCallback();
+
+struct SimChannelStats {
+    uint64_t travelTicks = 0;   // total PWM ticks moved
+    uint32_t reversals = 0;     // direction changes
+    uint32_t commands = 0;      // number of PWM values written
+    int lastValue = -1;         // last PWM value written
+    int lastDirection = 0;      // -1, 0, 1
+};
+extern SimChannelStats simChannels[SIM_PCA9685_CHANNELS];
+
+struct SimOptions {
+    uint32_t tickMS = 1;            // virtual time between calls to loop() while things are moving
+    uint32_t quietStepMS = 1000;    // virtual time between calls to loop() while the puppet is still
+    uint32_t quietAfterMS = 50;     // the puppet is still after this long without a PWM write
+};
+
+// Called with the virtual time in microseconds for every PWM value written
+typedef void (*SimPwmListener)(uint64_t timeMicros, int channel, uint16_t value, void *context);
+
+// Called with the virtual time in microseconds after every call to loop() or the animation
+typedef void (*SimStepListener)(uint64_t timeMicros, void *context);
+
+void simAddPwmListener(SimPwmListener listener, void *context);
+void simAddStepListener(SimStepListener listener, void *context);
+void simBegin(uint32_t runSeed);
+bool simPuppetIsQuiet(const SimOptions &options);
+uint64_t simRunUntil(uint64_t untilMicros, const SimOptions &options);
+bool simSettle(uint64_t maxMicros, const SimOptions &options);
+void simStopMicroMotion();
+bool simRunSequence(void (*addScenes)(), uint64_t maxMicros, const SimOptions &options, uint64_t *startMicros);
+
+// Runs fn(context) in a child process; the child writes resultSize bytes of result.
+// Returns the child's pid, or -1. Collect it with simCollectForked().
+int simRunForked(void (*fn)(void *context, void *result), void *context, size_t resultSize, int *readFd);
+bool simCollectForked(int pid, int readFd, void *result, size_t resultSize);
+
+#endif
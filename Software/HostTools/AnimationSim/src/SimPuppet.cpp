@@ -0,0 +1,167 @@
+/*
+ * SimPuppet.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Runs the eyes firmware in real time as a simulated puppet on the network, so the
+ * show controller (Software/HostTools/ShowControl) can be tried against several
+ * puppets without any hardware. The virtual clock follows the PC clock, --clock-offset-ms
+ * ahead of where it would be (as if the puppet had been powered on that much earlier)
+ * and running --drift-ppm fast (or slow, if negative), the way no two Photons agree
+ * on the time. The firmware's UDP sockets are real ones: show cues on --port and
+ * local control requests (Software/HostTools/PuppetControl) on --control-port,
+ * whatever ports the firmware asks for.
+ *
+ * When it ends it prints where its clock really was against the PC's steady clock,
+ * to check the controller's estimate against, and with --verbose the PC time at
+ * which each show cue ran. With --cue-log every cue run is appended to a file as
+ *      cueId puppetMS pcMicros
+ * the PC steady clock in microseconds when the puppet ran it, for the controller to
+ * measure how close together the puppets really were (showcontrol --cue-log).
+ * Several puppets may share the file.
+ *
+ * Usage
+ *      simpuppet [--port 8800] [--control-port 8810] [--clock-offset-ms N] [--drift-ppm N]
+ *                [--seconds N] [--cue-log FILE] [--verbose]
+ *
+ * Runs until killed, or for --seconds. Prints the show cue counts when it ends.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SimHarness.h>
+#include <TPPShowLink.h>
+#include <TPPControlLink.h>
+
+#include <chrono>
+#include <signal.h>
+#include <unistd.h>
+
+extern TPP_ShowLink showLink;   // from AnimatronicEyes.ino
+extern TPP_ControlLink controlLink;
+
+#define LOOP_SLEEP_US 200        // the Photon calls loop() about every ms
+
+static volatile sig_atomic_t stopRequested_ = 0;
+static int port_ = SHOW_DEFAULT_PORT;
+static FILE *cueLog_ = NULL;
+
+static void onSignal(int) {
+    stopRequested_ = 1;
+}
+
+static void printLog(const char *category, LogLevel level, const char *message) {
+
+    printf("[%d] %10lu %-12s %s\n", port_, millis(), category, message);
+    fflush(stdout);
+
+}
+
+/* ----- logCueDone -----
+ * The link tells the controller about each cue as it runs it: log the PC time of that
+ */
+static void logCueDone(const uint8_t *buffer, size_t size) {
+
+    if (showPacketType(buffer, (int)size) != showCueDone) {
+        return;
+    }
+    const ShowCueDonePacket *done = (const ShowCueDonePacket *)buffer;
+    long long pcMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    fprintf(cueLog_, "%u %u %lld\n", done->cueId, done->ranPuppetMS, pcMicros);
+    fflush(cueLog_);
+
+}
+
+int main(int argc, char **argv) {
+
+    long offsetMS = 0;
+    double driftPPM = 0;
+    double seconds = 0;
+    int controlPort = CONTROL_DEFAULT_PORT;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+        if (strcmp(arg, "--port") == 0) {
+            port_ = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--control-port") == 0) {
+            controlPort = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--clock-offset-ms") == 0 && atol(value) >= 0) {
+            offsetMS = atol(value);     // a clock can't start before power on
+            i++;
+        } else if (strcmp(arg, "--drift-ppm") == 0) {
+            driftPPM = atof(value);
+            i++;
+        } else if (strcmp(arg, "--seconds") == 0) {
+            seconds = atof(value);
+            i++;
+        } else if (strcmp(arg, "--cue-log") == 0) {
+            cueLog_ = fopen(value, "a");
+            if (cueLog_ == NULL) {
+                fprintf(stderr, "can't open %s\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            simLogHook = printLog;
+            simLogLevel = LOG_LEVEL_INFO;
+        } else {
+            fprintf(stderr, "usage: simpuppet [--port 8800] [--control-port 8810] [--clock-offset-ms N] "
+                            "[--drift-ppm N] [--seconds N] [--cue-log FILE] [--verbose]\n");
+            return 2;
+        }
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    simNetwork.enabled = true;
+    if (cueLog_ != NULL) {
+        simUdpSendHook = logCueDone;
+    }
+    simNetwork.ports[SHOW_DEFAULT_PORT] = port_;
+    simNetwork.ports[CONTROL_DEFAULT_PORT] = controlPort;
+    simBegin(port_);
+
+    // setup() has moved the virtual clock on by its delays; carry on from there
+    uint64_t baseMicros = simClock.micros + (uint64_t)offsetMS * 1000;
+    simClock.micros = baseMicros;
+    auto wallStart = std::chrono::steady_clock::now();
+    double elapsedMicros = 0;
+    unsigned long cuesRun = 0;
+
+    while (!stopRequested_) {
+
+        elapsedMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wallStart).count();
+        if (seconds > 0 && elapsedMicros > seconds * 1e6) {
+            break;
+        }
+        uint64_t target = baseMicros + (uint64_t)(elapsedMicros * (1.0 + driftPPM / 1e6));
+        if (target > simClock.micros) {
+            simClock.micros = target;   // never backwards, even after a delay() in the firmware
+        }
+
+        loop();
+
+        if (showLink.getCuesRun() != cuesRun && simLogHook != NULL) {
+            cuesRun = showLink.getCuesRun();
+            printf("[%d] show cue ran at millis %lu, PC steady clock %.1f ms\n", port_, millis(),
+                   std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+        usleep(LOOP_SLEEP_US);
+
+    }
+
+    // puppet millis() minus PC steady clock ms, as the controller estimates it
+    double pcMS = std::chrono::duration<double, std::milli>(wallStart.time_since_epoch()).count() + elapsedMicros / 1000.0;
+    double puppetMS = (baseMicros + elapsedMicros * (1.0 + driftPPM / 1e6)) / 1000.0;
+    printf("[%d] show cues run %lu, late %lu, dropped %lu. Clock offset %.1f ms, drift %.1f ppm\n", port_,
+           showLink.getCuesRun(), showLink.getCuesLate(), showLink.getCuesDropped(), puppetMS - pcMS, driftPPM);
+    printf("[%d] control requests %lu, errors %lu\n", port_, controlLink.getRequests(), controlLink.getErrors());
+    return 0;
+
+}
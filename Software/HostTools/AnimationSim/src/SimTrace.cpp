@@ -0,0 +1,242 @@
+/*
+ * SimTrace.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Recording, saving, loading and comparing PWM traces. See SimTrace.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SimTrace.h>
+#include <SimHarness.h>
+
+// ---------------------------------------------------------
+//-------------------   RECORDING ---------------------------
+
+/* ----- start -----
+ * Starts a new trace. The value every channel holds right now is recorded
+ * at time 0 so a trace always starts from a known pose.
+ */
+void SimTraceRecorder::start(uint64_t startMicros) {
+
+    trace = SimTrace();
+    startMicros_ = startMicros;
+    recording_ = true;
+
+    for (int c = 0; c < 16; c++) {
+        lastValue_[c] = simChannels[c].lastValue;
+        if (lastValue_[c] >= 0) {
+            trace.events.push_back({0, (uint8_t)c, (uint16_t)lastValue_[c]});
+        }
+    }
+
+}
+
+/* ----- stop -----
+ * Ends the trace, setting its duration
+ */
+void SimTraceRecorder::stop(uint64_t stopMicros) {
+
+    recording_ = false;
+    trace.durationMS = (int32_t)((stopMicros - startMicros_) / 1000);
+
+}
+
+/* ----- listener -----
+ * Pass to simAddPwmListener with the recorder as the context.
+ * Only changes of value are recorded.
+ */
+void SimTraceRecorder::listener(uint64_t timeMicros, int channel, uint16_t value, void *context) {
+
+    SimTraceRecorder *self = (SimTraceRecorder *)context;
+    if (!self->recording_ || channel < 0 || channel >= 16 || self->lastValue_[channel] == value) {
+        return;
+    }
+    self->lastValue_[channel] = value;
+    int32_t timeMS = (int32_t)((timeMicros - self->startMicros_) / 1000);
+    self->trace.events.push_back({timeMS, (uint8_t)channel, value});
+
+}
+
+// ---------------------------------------------------------
+//-------------------   FILES -------------------------------
+
+/* ----- simSaveTrace -----
+ * Writes a trace as text: comment lines, then one "time_ms channel value" per line
+ */
+bool simSaveTrace(const char *path, const char *name, const SimTrace &trace) {
+
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "# TPP golden trace v1\n");
+    fprintf(f, "# sequence %s\n", name);
+    fprintf(f, "# duration_ms %d\n", trace.durationMS);
+    fprintf(f, "# time_ms channel value\n");
+    for (const SimTraceEvent &e : trace.events) {
+        fprintf(f, "%d %d %d\n", e.timeMS, e.channel, e.value);
+    }
+    return fclose(f) == 0;
+
+}
+
+/* ----- simLoadTrace -----
+ * Reads a trace written by simSaveTrace
+ */
+bool simLoadTrace(const char *path, SimTrace &trace) {
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    trace = SimTrace();
+
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        int timeMS, channel, value;
+        if (line[0] == '#') {
+            sscanf(line, "# duration_ms %d", &trace.durationMS);
+        } else if (sscanf(line, "%d %d %d", &timeMS, &channel, &value) == 3 && channel >= 0 && channel < 16) {
+            trace.events.push_back({timeMS, (uint8_t)channel, (uint16_t)value});
+        }
+    }
+    fclose(f);
+    return true;
+
+}
+
+// ---------------------------------------------------------
+//-------------------   COMPARING ---------------------------
+
+/* ----- denseChannel -----
+ * The value of one channel at every ms from 0 to lengthMS. -1 before the first event.
+ */
+static std::vector<int> denseChannel(const SimTrace &trace, int channel, int32_t lengthMS) {
+
+    std::vector<int> values(lengthMS + 1, -1);
+    int current = -1;
+    int32_t t = 0;
+    for (const SimTraceEvent &e : trace.events) {
+        if (e.channel != channel) {
+            continue;
+        }
+        int32_t until = min(e.timeMS, lengthMS + 1);
+        for (; t < until; t++) {
+            values[t] = current;
+        }
+        current = e.value;
+    }
+    for (; t <= lengthMS; t++) {
+        values[t] = current;
+    }
+    return values;
+
+}
+
+/* ----- firstMismatch -----
+ * First time at which a[] has no value within valueTol anywhere in b[] within
+ * timeTolMS. Returns -1 if there is none.
+ */
+static int32_t firstMismatch(const std::vector<int> &a, const std::vector<int> &b, int valueTol, int timeTolMS) {
+
+    int32_t last = (int32_t)a.size() - 1;
+    for (int32_t t = 0; t <= last; t++) {
+        bool found = false;
+        int32_t from = max(0, t - timeTolMS);
+        int32_t to = min(last, t + timeTolMS);
+        for (int32_t s = from; s <= to && !found; s++) {
+            found = abs(a[t] - b[s]) <= valueTol;
+        }
+        if (!found) {
+            return t;
+        }
+    }
+    return -1;
+
+}
+
+/* ----- moveEnds -----
+ * End times of the moves on one channel
+ */
+static std::vector<int32_t> moveEnds(const SimTrace &trace, int channel) {
+
+    std::vector<int32_t> ends;
+    for (const SimTraceEvent &e : trace.events) {
+        if (e.channel != channel) {
+            continue;
+        }
+        if (!ends.empty() && e.timeMS - ends.back() <= SIM_MOVE_GAP_MS) {
+            ends.back() = e.timeMS;     // still the same move
+        } else {
+            ends.push_back(e.timeMS);   // a new move
+        }
+    }
+    return ends;
+
+}
+
+/* ----- simCompareTraces -----
+ * Compares actual to golden. See SimTrace.h for how.
+ */
+SimTraceDiff simCompareTraces(const SimTrace &golden, const SimTrace &actual, int valueTol, int timeTolMS) {
+
+    SimTraceDiff diff = {true, -1, -1, -1, -1, 0, 0, 0.0, 0};
+
+    int32_t lengthMS = max(golden.durationMS, actual.durationMS);
+    bool used[16] = {false};
+    for (const SimTraceEvent &e : golden.events) {
+        used[e.channel] = true;
+        lengthMS = max(lengthMS, e.timeMS);
+    }
+    for (const SimTraceEvent &e : actual.events) {
+        used[e.channel] = true;
+        lengthMS = max(lengthMS, e.timeMS);
+    }
+
+    double driftSum = 0;
+    int driftCount = 0;
+
+    for (int c = 0; c < 16; c++) {
+
+        if (!used[c]) {
+            continue;
+        }
+
+        // values must agree both ways, so a move missing from either trace is found
+        std::vector<int> g = denseChannel(golden, c, lengthMS);
+        std::vector<int> a = denseChannel(actual, c, lengthMS);
+        int32_t t1 = firstMismatch(a, g, valueTol, timeTolMS);
+        int32_t t2 = firstMismatch(g, a, valueTol, timeTolMS);
+        int32_t t = (t1 < 0) ? t2 : ((t2 < 0) ? t1 : min(t1, t2));
+        if (t >= 0 && (diff.divergeMS < 0 || t < diff.divergeMS)) {
+            diff.match = false;
+            diff.divergeMS = t;
+            diff.divergeChannel = c;
+            diff.expectedValue = g[t];
+            diff.actualValue = a[t];
+        }
+
+        // timing drift of the moves on this channel
+        std::vector<int32_t> gEnds = moveEnds(golden, c);
+        std::vector<int32_t> aEnds = moveEnds(actual, c);
+        diff.goldenMoves += gEnds.size();
+        diff.actualMoves += aEnds.size();
+        size_t pairs = min(gEnds.size(), aEnds.size());
+        for (size_t i = 0; i < pairs; i++) {
+            int32_t drift = aEnds[i] - gEnds[i];
+            driftSum += drift;
+            driftCount++;
+            diff.maxDriftMS = max(diff.maxDriftMS, abs(drift));
+        }
+
+    }
+
+    if (driftCount > 0) {
+        diff.meanDriftMS = driftSum / driftCount;
+    }
+    return diff;
+
+}
@@ -0,0 +1,73 @@
+/*
+ * SimTrace.h
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * A trace is the list of PWM values the firmware sent to the servo board, one
+ * event per change of a channel's value, with the time in ms from the start of
+ * the run. Traces can be saved, loaded and compared.
+ *
+ * Comparing a trace to a golden trace
+ *      Each channel is treated as a value that holds until the next event. At every
+ *      ms the two traces must agree to within valueTol ticks, allowing the other
+ *      trace's value to come from anywhere within timeTolMS of that time. The first
+ *      place that fails is reported as the first divergence.
+ *
+ *      Timing drift is measured on moves: runs of events on a channel with no gap
+ *      longer than SIM_MOVE_GAP_MS. Moves are paired in order and the difference in
+ *      their end times is the drift.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SIM_TRACE_H
+#define _TPP_SIM_TRACE_H
+
+#include <stdint.h>
+#include <vector>
+
+#define SIM_MOVE_GAP_MS 50
+
+struct SimTraceEvent {
+    int32_t timeMS;
+    uint8_t channel;
+    uint16_t value;
+};
+
+struct SimTrace {
+    std::vector<SimTraceEvent> events;
+    int32_t durationMS = 0;         // time from the start of the run until the servos were still
+};
+
+struct SimTraceDiff {
+    bool match;                     // true if the traces agree within tolerance
+    int32_t divergeMS;              // first divergence: time, channel, and the two values there
+    int divergeChannel;
+    int expectedValue;
+    int actualValue;
+    int goldenMoves;                // moves found on all channels
+    int actualMoves;
+    double meanDriftMS;             // mean end time difference of paired moves, actual - golden
+    int32_t maxDriftMS;             // largest absolute end time difference of paired moves
+};
+
+// Records the changes seen by simAddPwmListener into a trace
+class SimTraceRecorder {
+    public:
+        void start(uint64_t startMicros);
+        void stop(uint64_t stopMicros);
+        static void listener(uint64_t timeMicros, int channel, uint16_t value, void *context);
+        SimTrace trace;
+
+    private:
+        bool recording_ = false;
+        uint64_t startMicros_ = 0;
+        int lastValue_[16];
+};
+
+bool simSaveTrace(const char *path, const char *name, const SimTrace &trace);
+bool simLoadTrace(const char *path, SimTrace &trace);
+SimTraceDiff simCompareTraces(const SimTrace &golden, const SimTrace &actual, int valueTol, int timeTolMS);
+
+#endif
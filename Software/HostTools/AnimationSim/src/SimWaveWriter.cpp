@@ -0,0 +1,246 @@
+/*
+ * SimWaveWriter.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * VCD and CSV waveform writers. See SimWaveWriter.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SimWaveWriter.h>
+#include <string.h>
+
+// ---------------------------------------------------------
+//-------------------   BUFFERED WRITER ---------------------
+
+bool SimBufferedWriter::open(const char *path) {
+
+    file_ = fopen(path, "wb");
+    used_ = 0;
+    bytes_ = 0;
+    return file_ != NULL;
+
+}
+
+bool SimBufferedWriter::close() {
+
+    if (file_ == NULL) {
+        return false;
+    }
+    flush();
+    bool ok = fclose(file_) == 0;
+    file_ = NULL;
+    return ok;
+
+}
+
+void SimBufferedWriter::flush() {
+
+    if (file_ != NULL && used_ > 0) {
+        fwrite(buffer_, 1, used_, file_);
+    }
+    bytes_ += used_;
+    used_ = 0;
+
+}
+
+void SimBufferedWriter::put(const char *s) {
+
+    while (*s) {
+        put(*s++);
+    }
+
+}
+
+/* ----- putUnsigned -----
+ * decimal, without printf
+ */
+void SimBufferedWriter::putUnsigned(uint64_t value) {
+
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) {
+        put(digits[--n]);
+    }
+
+}
+
+/* ----- putBinary -----
+ * binary without leading zeros, as VCD vectors are written
+ */
+void SimBufferedWriter::putBinary(uint32_t value) {
+
+    int bit = 31;
+    while (bit > 0 && !(value & (1u << bit))) {
+        bit--;
+    }
+    for (; bit >= 0; bit--) {
+        put((value & (1u << bit)) ? '1' : '0');
+    }
+
+}
+
+// ---------------------------------------------------------
+//-------------------   VCD ---------------------------------
+
+// VCD identifier for a signal: one printable character
+static char vcdId(int signal) {
+    return '!' + signal;
+}
+
+static void putSignalName(SimBufferedWriter &out, int signal, int numChannels) {
+
+    if (signal < numChannels) {
+        out.put("pwm");
+        out.putUnsigned(signal);
+    } else if (signal == numChannels) {
+        out.put("scene");
+    } else {
+        out.put("trigger");
+    }
+
+}
+
+bool SimVcdWriter::begin(const char *path, int numChannels) {
+
+    if (!out_.open(path)) {
+        return false;
+    }
+    numSignals_ = numChannels + 2;
+    timeWritten_ = false;
+
+    out_.put("$comment TPP animatronic simulation: servo PWM off counts, scene number, A5 trigger $end\n");
+    out_.put("$timescale 1 us $end\n");
+    out_.put("$scope module puppet $end\n");
+    for (int s = 0; s < numSignals_; s++) {
+        value_[s] = -1;
+        out_.put("$var ");
+        if (s < numChannels) {
+            out_.put("wire 12 ");
+        } else if (s == numChannels) {
+            out_.put("integer 32 ");
+        } else {
+            out_.put("wire 1 ");
+        }
+        out_.put(vcdId(s));
+        out_.put(' ');
+        putSignalName(out_, s, numChannels);
+        out_.put(" $end\n");
+    }
+    out_.put("$upscope $end\n$enddefinitions $end\n");
+
+    // every signal starts unknown
+    out_.put("#0\n$dumpvars\n");
+    for (int s = 0; s < numSignals_; s++) {
+        out_.put(s == numSignals_ - 1 ? "x" : "bx ");
+        out_.put(vcdId(s));
+        out_.put('\n');
+    }
+    out_.put("$end\n");
+    return true;
+
+}
+
+void SimVcdWriter::signal(uint64_t timeMicros, int signal, int32_t value) {
+
+    if (signal < 0 || signal >= numSignals_ || value_[signal] == value) {
+        return;
+    }
+    value_[signal] = value;
+
+    if (!timeWritten_ || timeMicros != lastTime_) {
+        out_.put('#');
+        out_.putUnsigned(timeMicros);
+        out_.put('\n');
+        lastTime_ = timeMicros;
+        timeWritten_ = true;
+    }
+
+    if (signal == numSignals_ - 1) {
+        out_.put(value ? '1' : '0');
+    } else {
+        out_.put('b');
+        out_.putBinary((uint32_t)value);
+        out_.put(' ');
+    }
+    out_.put(vcdId(signal));
+    out_.put('\n');
+
+}
+
+bool SimVcdWriter::end(uint64_t timeMicros) {
+
+    out_.put('#');
+    out_.putUnsigned(timeMicros);
+    out_.put('\n');
+    return out_.close();
+
+}
+
+// ---------------------------------------------------------
+//-------------------   CSV ---------------------------------
+
+bool SimCsvWriter::begin(const char *path, int numChannels) {
+
+    if (!out_.open(path)) {
+        return false;
+    }
+    numSignals_ = numChannels + 2;
+    rowPending_ = false;
+
+    out_.put("time_us");
+    for (int s = 0; s < numSignals_; s++) {
+        value_[s] = -1;
+        out_.put(',');
+        putSignalName(out_, s, numChannels);
+    }
+    out_.put('\n');
+    return true;
+
+}
+
+void SimCsvWriter::writeRow() {
+
+    out_.putUnsigned(rowTime_);
+    for (int s = 0; s < numSignals_; s++) {
+        out_.put(',');
+        if (value_[s] >= 0) {
+            out_.putUnsigned(value_[s]);
+        }
+    }
+    out_.put('\n');
+    rowPending_ = false;
+
+}
+
+void SimCsvWriter::signal(uint64_t timeMicros, int signal, int32_t value) {
+
+    if (signal < 0 || signal >= numSignals_ || value_[signal] == value) {
+        return;
+    }
+    // changes at the same time go in the same row
+    if (rowPending_ && timeMicros != rowTime_) {
+        writeRow();
+    }
+    value_[signal] = value;
+    rowTime_ = timeMicros;
+    rowPending_ = true;
+
+}
+
+bool SimCsvWriter::end(uint64_t timeMicros) {
+
+    if (rowPending_) {
+        writeRow();
+    }
+    rowTime_ = timeMicros;
+    writeRow();
+    return out_.close();
+
+}
@@ -0,0 +1,87 @@
+/*
+ * SimWaveWriter.h
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Writes simulated signals as waveforms: VCD files for GTKWave, and columnar
+ * CSV files for spreadsheets. Signals are numbered: 0 to numChannels-1 are the
+ * servo channels (PWM off count), then the scene number, then the A5 trigger.
+ *
+ * Output goes through a fixed size buffer with hand written number formatting,
+ * so nothing is allocated while a simulation runs and the files are written in
+ * a few large blocks.
+ *
+ * Classes
+ *      SimBufferedWriter:  the buffer and number formatting
+ *      SimVcdWriter:       value change dump, timescale 1 us
+ *      SimCsvWriter:       one row per time something changed, every signal in every row
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SIM_WAVE_WRITER_H
+#define _TPP_SIM_WAVE_WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SIM_WAVE_BUFFER_SIZE 65536
+#define SIM_WAVE_MAX_SIGNALS 18     // 16 channels + scene + trigger
+
+class SimBufferedWriter {
+    public:
+        bool open(const char *path);
+        bool close();
+        void put(char c) {
+            if (used_ == SIM_WAVE_BUFFER_SIZE) {
+                flush();
+            }
+            buffer_[used_++] = c;
+        }
+        void put(const char *s);
+        void putUnsigned(uint64_t value);
+        void putBinary(uint32_t value);
+        void flush();
+        bool isOpen() { return file_ != NULL; }
+        uint64_t bytesWritten() { return bytes_ + used_; }
+
+    private:
+        FILE *file_ = NULL;
+        char buffer_[SIM_WAVE_BUFFER_SIZE];
+        size_t used_ = 0;
+        uint64_t bytes_ = 0;
+};
+
+class SimVcdWriter {
+    public:
+        bool begin(const char *path, int numChannels);
+        void signal(uint64_t timeMicros, int signal, int32_t value);
+        bool end(uint64_t timeMicros);
+        uint64_t bytesWritten() { return out_.bytesWritten(); }
+
+    private:
+        SimBufferedWriter out_;
+        int numSignals_ = 0;
+        int32_t value_[SIM_WAVE_MAX_SIGNALS];
+        uint64_t lastTime_ = 0;
+        bool timeWritten_ = false;
+};
+
+class SimCsvWriter {
+    public:
+        bool begin(const char *path, int numChannels);
+        void signal(uint64_t timeMicros, int signal, int32_t value);
+        bool end(uint64_t timeMicros);
+        uint64_t bytesWritten() { return out_.bytesWritten(); }
+
+    private:
+        void writeRow();
+        SimBufferedWriter out_;
+        int numSignals_ = 0;
+        int32_t value_[SIM_WAVE_MAX_SIGNALS];
+        uint64_t rowTime_ = 0;
+        bool rowPending_ = false;
+};
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * WaveExport.cpp
+ *
+ * Team Practical Project animatronic host simulation
+ *
+ * Exports simulated servo motion as waveforms, so speeds and delays can be tuned
+ * by looking at the motion instead of the puppet. Every channel's commanded PWM
+ * value, the scene number and the A5 trigger are written with the virtual time
+ * in microseconds to a VCD file (open it in GTKWave) and/or a CSV file.
+ *
+ * Two ways to run
+ *      --sequence NAME   run one sequence from the catalog, starting from the pose
+ *                        the puppet has after setup(). Time 0 is the start of the sequence.
+ *      --run-ms N        run the whole sketch from power on for N ms. --trigger START:LENGTH
+ *                        (ms) holds A5 high for LENGTH ms at START; it can be given many times.
+ *
+ * Usage
+ *      waveexport (--sequence NAME | --run-ms N [--trigger START:LENGTH]...)
+ *                 [--vcd FILE] [--csv FILE] [--channels N]
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SimHarness.h>
+#include <SimWaveWriter.h>
+#include <SequenceCatalog.h>
+#include <TPPAnimationList.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+extern animationList animation1;   // from AnimatronicEyes.ino
+
+#define MAX_SEQUENCE_MS 600000
+
+struct TriggerPulse {
+    uint32_t startMS;
+    uint32_t lengthMS;
+};
+
+// Everything the listeners need. Only one export runs per process.
+static struct {
+    SimVcdWriter vcd;
+    SimCsvWriter csv;
+    bool vcdOpen = false;
+    bool csvOpen = false;
+    bool active = false;
+    uint64_t originMicros = 0;      // virtual time that is written as time 0
+    int numChannels = 6;
+    unsigned long scenesAtOrigin = 0;
+    int32_t value[SIM_WAVE_MAX_SIGNALS];
+    uint64_t events = 0;
+} wave_;
+
+/* ----- emit -----
+ * Sends a signal to the open writers if its value changed
+ */
+static void emit(uint64_t timeMicros, int signal, int32_t value) {
+
+    if (wave_.value[signal] == value) {
+        return;
+    }
+    wave_.value[signal] = value;
+    uint64_t t = timeMicros - wave_.originMicros;
+    if (wave_.vcdOpen) {
+        wave_.vcd.signal(t, signal, value);
+    }
+    if (wave_.csvOpen) {
+        wave_.csv.signal(t, signal, value);
+    }
+    wave_.events++;
+
+}
+
+static void pwmListener(uint64_t timeMicros, int channel, uint16_t value, void *context) {
+
+    if (wave_.active && channel < wave_.numChannels) {
+        emit(timeMicros, channel, value);
+    }
+
+}
+
+/* ----- stepListener -----
+ * Scene changes and trigger edges are seen after each step
+ */
+static void stepListener(uint64_t timeMicros, void *context) {
+
+    if (!wave_.active) {
+        return;
+    }
+    emit(timeMicros, wave_.numChannels, (int32_t)(animation1.getScenesPlayed() - wave_.scenesAtOrigin));
+    emit(timeMicros, wave_.numChannels + 1, simPins.digital[SIM_TRIGGER_PIN]);
+
+}
+
+/* ----- startExport -----
+ * Opens the output files and writes the value every signal has right now.
+ * originMicros is the virtual time written as time 0.
+ */
+static bool startExport(const char *vcdPath, const char *csvPath, uint64_t originMicros) {
+
+    if (vcdPath != NULL) {
+        wave_.vcdOpen = wave_.vcd.begin(vcdPath, wave_.numChannels);
+        if (!wave_.vcdOpen) {
+            fprintf(stderr, "can't write %s\n", vcdPath);
+            return false;
+        }
+    }
+    if (csvPath != NULL) {
+        wave_.csvOpen = wave_.csv.begin(csvPath, wave_.numChannels);
+        if (!wave_.csvOpen) {
+            fprintf(stderr, "can't write %s\n", csvPath);
+            return false;
+        }
+    }
+
+    for (int s = 0; s < SIM_WAVE_MAX_SIGNALS; s++) {
+        wave_.value[s] = -1;
+    }
+    wave_.originMicros = originMicros;
+    wave_.scenesAtOrigin = animation1.getScenesPlayed();
+    wave_.active = true;
+    for (int c = 0; c < wave_.numChannels; c++) {
+        if (simChannels[c].lastValue >= 0) {
+            emit(simClock.micros, c, simChannels[c].lastValue);
+        }
+    }
+    stepListener(simClock.micros, NULL);
+    return true;
+
+}
+
+static bool endExport() {
+
+    uint64_t t = simClock.micros - wave_.originMicros;
+    bool ok = true;
+    if (wave_.vcdOpen) {
+        ok = wave_.vcd.end(t) && ok;
+    }
+    if (wave_.csvOpen) {
+        ok = wave_.csv.end(t) && ok;
+    }
+    wave_.active = false;
+    return ok;
+
+}
+
+static int usage() {
+
+    fprintf(stderr, "usage: waveexport (--sequence NAME | --run-ms N [--trigger START:LENGTH]...)\n"
+                    "                  [--vcd FILE] [--csv FILE] [--channels N]\n");
+    return 2;
+
+}
+
+int main(int argc, char **argv) {
+
+    const SimSequence *sequence = NULL;
+    uint32_t runMS = 0;
+    std::vector<TriggerPulse> triggers;
+    const char *vcdPath = NULL;
+    const char *csvPath = NULL;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *arg = argv[i];
+        const char *value = argv[i + 1];
+        if (strcmp(arg, "--sequence") == 0) {
+            sequence = simFindSequence(value);
+            if (sequence == NULL) {
+                fprintf(stderr, "unknown sequence %s\n", value);
+                return 2;
+            }
+        } else if (strcmp(arg, "--run-ms") == 0) {
+            runMS = atoi(value);
+        } else if (strcmp(arg, "--trigger") == 0) {
+            TriggerPulse pulse;
+            if (sscanf(value, "%u:%u", &pulse.startMS, &pulse.lengthMS) != 2) {
+                return usage();
+            }
+            triggers.push_back(pulse);
+        } else if (strcmp(arg, "--vcd") == 0) {
+            vcdPath = value;
+        } else if (strcmp(arg, "--csv") == 0) {
+            csvPath = value;
+        } else if (strcmp(arg, "--channels") == 0) {
+            wave_.numChannels = constrain(atoi(value), 1, 16);
+        } else {
+            return usage();
+        }
+    }
+    if ((sequence == NULL) == (runMS == 0) || (vcdPath == NULL && csvPath == NULL)) {
+        return usage();
+    }
+
+    SimOptions options;
+    simAddPwmListener(pwmListener, NULL);
+    simAddStepListener(stepListener, NULL);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    bool finished = true;
+
+    if (sequence != NULL) {
+
+        simBegin(1);
+        simSettle(MAX_SEQUENCE_MS * 1000ULL, options);
+        simStopMicroMotion();
+        if (!startExport(vcdPath, csvPath, simClock.micros)) {
+            return 1;
+        }
+        uint64_t startMicros;
+        finished = simRunSequence(sequence->addScenes, MAX_SEQUENCE_MS * 1000ULL, options, &startMicros);
+
+    } else {
+
+        // export from power on, including the moves made while the firmware's
+        // globals are constructed and by setup(), so --trigger times match the output
+        if (!startExport(vcdPath, csvPath, 0)) {
+            return 1;
+        }
+        simBegin(1);
+
+        // the trigger edges, in time order
+        std::vector<std::pair<uint64_t, int>> edges;
+        for (const TriggerPulse &p : triggers) {
+            edges.push_back(std::make_pair((uint64_t)p.startMS * 1000, HIGH));
+            edges.push_back(std::make_pair((uint64_t)(p.startMS + p.lengthMS) * 1000, LOW));
+        }
+        std::sort(edges.begin(), edges.end());
+
+        options.quietStepMS = options.tickMS;   // sample accurate, even when still
+        for (const std::pair<uint64_t, int> &edge : edges) {
+            if (edge.first >= (uint64_t)runMS * 1000) {
+                break;
+            }
+            simRunUntil(edge.first, options);
+            simPins.digital[SIM_TRIGGER_PIN] = edge.second;
+        }
+        simRunUntil((uint64_t)runMS * 1000, options);
+
+    }
+
+    uint64_t simulatedMicros = simClock.micros - wave_.originMicros;
+    uint64_t bytes = (wave_.vcdOpen ? wave_.vcd.bytesWritten() : 0) + (wave_.csvOpen ? wave_.csv.bytesWritten() : 0);
+    if (!endExport()) {
+        fprintf(stderr, "error writing output\n");
+        return 1;
+    }
+    double wallMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printf("%.1f s of animation, %llu signal changes, %llu bytes written in %.1f ms%s\n",
+           simulatedMicros / 1.0e6, (unsigned long long)wave_.events, (unsigned long long)bytes, wallMS,
+           finished ? "" : " (sequence did not finish)");
+    return finished ? 0 : 1;
+
+}
@@ -0,0 +1,413 @@
+/*
+ * AssetPack.cpp
+ *
+ * Team Practical Project asset packer
+ *
+ * Packs the settings, scene sequences and envelope tracks in an asset list into
+ * one asset pack (see TPPAssetFormat.h), written as a C++ source file for the
+ * firmware to compile in, and optionally as a binary file. See the README.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <TPPAssetFormat.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The order of these must be the order of the eScene enumeration in TPPAnimationList.h
+static const char *sceneNames_[] = {
+    "eyesAheadOpen",
+    "eyesAhead",
+    "eyesLeftRight",
+    "eyesUpDown",
+    "eyesOpen",
+    "eyelidsLeft",
+    "eyelidsRight",
+    "blink"
+};
+
+// Names for modifiers and speeds, as defined in TPPAnimatePuppet.h and TPPAnimateServo.h
+static const struct {
+    const char *name;
+    double value;
+} constants_[] = {
+    {"closed", 0},
+    {"slit", 20},
+    {"normal", 50},
+    {"wide", 100},
+    {"slow", 1},
+    {"fast", 10},
+    {"immediate", 100},
+};
+
+struct Asset {
+    std::string name;
+    uint32_t id;
+    eAssetType type;
+    uint16_t count;
+    std::vector<uint8_t> data;
+};
+
+struct AssetList {
+    std::vector<Asset> assets;
+    std::map<std::string, size_t> byName;
+    std::string directory;      // of the asset list, for the envelope files
+};
+
+/* ----- fail -----
+ * Reports an error in the asset list and exits
+ */
+static void fail(const std::string &file, int line, const std::string &message) {
+
+    fprintf(stderr, "%s:%d: %s\n", file.c_str(), line, message.c_str());
+    exit(1);
+
+}
+
+/* ----- parseNumber -----
+ * A number, or one of the names in constants_
+ */
+static bool parseNumber(const std::string &word, double &value) {
+
+    for (size_t c = 0; c < sizeof(constants_) / sizeof(constants_[0]); c++) {
+        if (word == constants_[c].name) {
+            value = constants_[c].value;
+            return true;
+        }
+    }
+    char *end;
+    value = strtod(word.c_str(), &end);
+    return !word.empty() && *end == 0;
+
+}
+
+template <class T> static void append(std::vector<uint8_t> &data, const T &item) {
+
+    const uint8_t *bytes = (const uint8_t *)&item;
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+
+}
+
+/* ----- addAsset -----
+ * Adds an asset, refusing a name used already or one whose id clashes with another's
+ */
+static Asset &addAsset(AssetList &list, const std::string &name, eAssetType type,
+                       const std::string &file, int line) {
+
+    if (list.byName.count(name) != 0) {
+        fail(file, line, "\"" + name + "\" is already in the list");
+    }
+    uint32_t id = assetId(name.c_str());
+    for (const Asset &other : list.assets) {
+        if (other.id == id) {
+            fail(file, line, "\"" + name + "\" has the same id as \"" + other.name + "\"; rename one");
+        }
+    }
+    list.byName[name] = list.assets.size();
+    list.assets.push_back(Asset());
+    Asset &asset = list.assets.back();
+    asset.name = name;
+    asset.id = id;
+    asset.type = type;
+    asset.count = 0;
+    return asset;
+
+}
+
+/* ----- readEnvelope -----
+ * Samples from a text file: numbers separated by commas, spaces or new lines, as
+ * in a spreadsheet column or a C array initializer. Braces are skipped.
+ */
+static bool readEnvelope(const std::string &path, std::vector<uint16_t> &samples) {
+
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    for (char &c : text) {
+        if (c == ',' || c == '{' || c == '}' || c == ';') {
+            c = ' ';
+        }
+    }
+    std::stringstream words(text);
+    std::string word;
+    while (words >> word) {
+        char *end;
+        long value = strtol(word.c_str(), &end, 10);
+        if (*end != 0 || value < 0 || value > 4095) {
+            return false;
+        }
+        samples.push_back((uint16_t)value);
+    }
+    return !samples.empty();
+
+}
+
+/* ----- readList -----
+ * Reads the asset list:
+ *      setting NAME VALUE [VALUE ...]
+ *      sequence NAME
+ *          SCENE MODIFIER SPEED DELAY_MS
+ *          call OTHER_SEQUENCE
+ *      end
+ *      envelope NAME INTERVAL_MS FILE
+ * # starts a comment.
+ */
+static void readList(const std::string &path, AssetList &list) {
+
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "can't read %s\n", path.c_str());
+        exit(1);
+    }
+    size_t slash = path.find_last_of('/');
+    list.directory = (slash == std::string::npos) ? "" : path.substr(0, slash + 1);
+
+    std::string text;
+    int line = 0;
+    Asset *sequence = NULL;     // the sequence being read
+    while (std::getline(in, text)) {
+        line++;
+        text = text.substr(0, text.find('#'));
+        std::stringstream words(text);
+        std::vector<std::string> word;
+        std::string w;
+        while (words >> w) {
+            word.push_back(w);
+        }
+        if (word.empty()) {
+            continue;
+        }
+
+        if (sequence != NULL) {
+            if (word[0] == "end") {
+                if (sequence->count == 0) {
+                    fail(path, line, "sequence " + sequence->name + " has no scenes");
+                }
+                sequence = NULL;
+                continue;
+            }
+            if (word[0] == "call") {
+                if (word.size() != 2 || list.byName.count(word[1]) == 0 ||
+                    list.assets[list.byName[word[1]]].type != assetSequence) {
+                    fail(path, line, "call needs the name of a sequence listed before this one");
+                }
+                const Asset &other = list.assets[list.byName[word[1]]];
+                sequence->data.insert(sequence->data.end(), other.data.begin(), other.data.end());
+                sequence->count += other.count;
+                continue;
+            }
+            int scene = -1;
+            for (size_t s = 0; s < sizeof(sceneNames_) / sizeof(sceneNames_[0]); s++) {
+                if (word[0] == sceneNames_[s]) {
+                    scene = s;
+                }
+            }
+            double modifier, speed, delay;
+            if (scene < 0 || word.size() != 4 || !parseNumber(word[1], modifier) ||
+                !parseNumber(word[2], speed) || !parseNumber(word[3], delay) || speed < 0 || speed > 655) {
+                fail(path, line, "expected SCENE MODIFIER SPEED DELAY_MS, call NAME or end");
+            }
+            AssetScene item;
+            item.scene = scene;
+            item.reserved = 0;
+            item.modifier = (int16_t)modifier;
+            item.speedX100 = (uint16_t)(speed * 100 + 0.5);
+            item.delayAfterMS = (int16_t)delay;
+            append(sequence->data, item);
+            sequence->count++;
+            continue;
+        }
+
+        if (word[0] == "setting" && word.size() >= 3) {
+            Asset &asset = addAsset(list, word[1], assetSetting, path, line);
+            for (size_t v = 2; v < word.size(); v++) {
+                double value;
+                if (!parseNumber(word[v], value)) {
+                    fail(path, line, "\"" + word[v] + "\" is not a number");
+                }
+                append(asset.data, (int32_t)value);
+                asset.count++;
+            }
+        } else if (word[0] == "sequence" && word.size() == 2) {
+            sequence = &addAsset(list, word[1], assetSequence, path, line);
+        } else if (word[0] == "envelope" && word.size() == 4) {
+            Asset &asset = addAsset(list, word[1], assetEnvelope, path, line);
+            std::vector<uint16_t> samples;
+            int intervalMS = atoi(word[2].c_str());
+            if (intervalMS <= 0 || intervalMS > 65535) {
+                fail(path, line, "the interval must be 1 to 65535 ms");
+            }
+            if (!readEnvelope(list.directory + word[3], samples) || samples.size() > 65535) {
+                fail(path, line, "can't read samples 0 - 4095 from " + word[3]);
+            }
+            AssetEnvelopeHeader header;
+            header.intervalMS = intervalMS;
+            header.reserved = 0;
+            append(asset.data, header);
+            for (uint16_t sample : samples) {
+                append(asset.data, sample);
+            }
+            asset.count = samples.size();
+        } else {
+            fail(path, line, "expected setting, sequence or envelope");
+        }
+    }
+    if (sequence != NULL) {
+        fail(path, line, "sequence " + sequence->name + " has no end");
+    }
+
+}
+
+/* ----- makePack -----
+ * The header, the index sorted by id, then the data of each asset, aligned
+ */
+static std::vector<uint8_t> makePack(AssetList &list) {
+
+    std::vector<Asset *> sorted;
+    for (Asset &asset : list.assets) {
+        sorted.push_back(&asset);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Asset *a, const Asset *b) { return a->id < b->id; });
+
+    std::vector<uint8_t> pack(sizeof(AssetPackHeader) + sorted.size() * sizeof(AssetIndexEntry), 0);
+    for (size_t i = 0; i < sorted.size(); i++) {
+        while (pack.size() % ASSET_ALIGN != 0) {
+            pack.push_back(0);
+        }
+        AssetIndexEntry entry;
+        entry.id = sorted[i]->id;
+        entry.type = sorted[i]->type;
+        entry.reserved = 0;
+        entry.count = sorted[i]->count;
+        entry.offset = pack.size();
+        entry.length = sorted[i]->data.size();
+        memcpy(&pack[sizeof(AssetPackHeader) + i * sizeof(AssetIndexEntry)], &entry, sizeof(entry));
+        pack.insert(pack.end(), sorted[i]->data.begin(), sorted[i]->data.end());
+    }
+
+    AssetPackHeader header;
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.reserved = 0;
+    header.count = sorted.size();
+    header.size = pack.size();
+    header.checksum = assetChecksum(&pack[sizeof(AssetPackHeader)], pack.size() - sizeof(AssetPackHeader));
+    memcpy(&pack[0], &header, sizeof(header));
+    return pack;
+
+}
+
+/* ----- writeSource -----
+ * The pack as a const array, for the firmware to compile in. The compiler keeps
+ * const data in flash.
+ */
+static bool writeSource(const std::string &path, const std::string &listPath, const std::vector<uint8_t> &pack,
+                        const AssetList &list) {
+
+    FILE *out = fopen(path.c_str(), "w");
+    if (out == NULL) {
+        return false;
+    }
+    size_t slash = path.find_last_of('/');
+    std::string fileName = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    fprintf(out, "/*\n * %s\n *\n * Team Practical Project asset pack\n *\n", fileName.c_str());
+    fprintf(out, " * Made by assetpack (Software/HostTools/AssetPack) from %s.\n", listPath.c_str());
+    fprintf(out, " * Do not edit; change the asset list and run the packer again.\n *\n");
+    for (const Asset &asset : list.assets) {
+        static const char *types[] = {"", "setting", "sequence", "envelope"};
+        fprintf(out, " *      %-9s %-22s %5u bytes\n", types[asset.type], asset.name.c_str(),
+                (unsigned)asset.data.size());
+    }
+    fprintf(out, " *\n */\n\n#include <stdint.h>\n\n");
+    fprintf(out, "extern const uint8_t assetPackData[];\nextern const uint32_t assetPackSize;\n\n");
+    fprintf(out, "__attribute__((aligned(%d))) const uint8_t assetPackData[] = {", ASSET_ALIGN);
+    for (size_t i = 0; i < pack.size(); i++) {
+        fprintf(out, "%s0x%02x,", (i % 16 == 0) ? "\n    " : " ", pack[i]);
+    }
+    fprintf(out, "\n};\n\nconst uint32_t assetPackSize = %u;\n", (unsigned)pack.size());
+    return fclose(out) == 0;
+
+}
+
+/* ----- listPack -----
+ * Checks a binary pack and prints its index
+ */
+static int listPack(const std::string &path) {
+
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> pack((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (pack.size() < sizeof(AssetPackHeader)) {
+        fprintf(stderr, "%s is not an asset pack\n", path.c_str());
+        return 1;
+    }
+    AssetPackHeader header;
+    memcpy(&header, &pack[0], sizeof(header));
+    bool good = header.magic == ASSET_PACK_MAGIC && header.version == ASSET_PACK_VERSION &&
+                header.size == pack.size() &&
+                header.checksum == assetChecksum(&pack[sizeof(header)], pack.size() - sizeof(header));
+    printf("%s: %u assets, %u bytes, %s\n", path.c_str(), header.count, header.size, good ? "good" : "BAD");
+    for (int i = 0; good && i < header.count; i++) {
+        AssetIndexEntry entry;
+        memcpy(&entry, &pack[sizeof(header) + i * sizeof(entry)], sizeof(entry));
+        printf("  id %08x  type %u  %5u items  %5u bytes at %u\n", entry.id, entry.type, entry.count,
+               entry.length, entry.offset);
+    }
+    return good ? 0 : 1;
+
+}
+
+int main(int argc, char *argv[]) {
+
+    std::string sourcePath, packPath, listPath;
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        if (arg == "--list" && a + 1 < argc) {
+            return listPack(argv[++a]);
+        } else if (arg == "--source" && a + 1 < argc) {
+            sourcePath = argv[++a];
+        } else if (arg == "--pack" && a + 1 < argc) {
+            packPath = argv[++a];
+        } else if (arg[0] != '-' && listPath.empty()) {
+            listPath = arg;
+        } else {
+            listPath.clear();
+            break;
+        }
+    }
+    if (listPath.empty() || (sourcePath.empty() && packPath.empty())) {
+        fprintf(stderr, "usage: assetpack [--source FILE.cpp] [--pack FILE.pak] ASSET_LIST\n"
+                        "       assetpack --list FILE.pak\n");
+        return 2;
+    }
+
+    AssetList list;
+    readList(listPath, list);
+    std::vector<uint8_t> pack = makePack(list);
+
+    if (!sourcePath.empty() && !writeSource(sourcePath, listPath, pack, list)) {
+        fprintf(stderr, "can't write %s\n", sourcePath.c_str());
+        return 1;
+    }
+    if (!packPath.empty()) {
+        std::ofstream out(packPath, std::ios::binary);
+        out.write((const char *)&pack[0], pack.size());
+        if (!out) {
+            fprintf(stderr, "can't write %s\n", packPath.c_str());
+            return 1;
+        }
+    }
+    printf("%u assets, %u bytes\n", (unsigned)list.assets.size(), (unsigned)pack.size());
+    return 0;
+
+}
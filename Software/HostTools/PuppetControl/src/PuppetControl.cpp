@@ -0,0 +1,299 @@
+/*
+ * PuppetControl.cpp
+ *
+ * Team Practical Project local control client
+ *
+ * Calls a puppet's functions and reads its variables over the local network, the
+ * ones the sketch gives the Particle cloud and more, without the cloud. The
+ * protocol is in TPPControlProtocol.h, in the eyes firmware. Each request is sent
+ * again every --timeout-ms until it is answered, up to --tries times, and the round
+ * trip is printed with the answer. --repeat sends the request that many times and
+ * prints the spread of round trips instead.
+ *
+ * "metrics" reads the puppet's metrics registry as compact binary pages (see
+ * TPPMetricsFormat.h) and prints it as Prometheus text.
+ *
+ * Try it without hardware against a simulated puppet (HostTools/AnimationSim simpuppet):
+ *      puppetcontrol --puppet 127.0.0.1:8810 list
+ *
+ * Usage
+ *      puppetcontrol [--puppet HOST:PORT] [--timeout-ms 250] [--tries 4] [--repeat N]
+ *                    list | get NAME [ARGUMENT] | call NAME [ARGUMENT] | metrics
+ *
+ * Exits with 1 if the puppet did not answer, or answered with an error.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <TPPControlProtocol.h>
+#include <TPPMetricsFormat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct ControlConfig {
+    std::string puppet = "127.0.0.1:8810";
+    int timeoutMS = 250;
+    int tries = 4;
+    int repeat = 1;
+};
+
+static ControlConfig cfg_;
+static int socket_ = -1;
+static sockaddr_in puppetAddress_;
+static uint16_t nextSeq_ = 1;
+
+static double nowMS() {
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
+
+static bool parseAddress(const char *hostPort, sockaddr_in &address) {
+
+    std::string text(hostPort);
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    std::string host = text.substr(0, colon);
+    int port = atoi(text.c_str() + colon + 1);
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *found = NULL;
+    if (port <= 0 || port > 65535 || getaddrinfo(host.c_str(), NULL, &hints, &found) != 0) {
+        return false;
+    }
+    address = *(sockaddr_in *)found->ai_addr;
+    address.sin_port = htons(port);
+    freeaddrinfo(found);
+    return true;
+
+}
+
+/* ----- exchange -----
+ * Sends request and waits for the reply with its seq, sending again every
+ * --timeout-ms. Returns false if none came. reply's text points into buffer.
+ */
+static bool exchange(ControlMessage &request, uint8_t (&buffer)[CONTROL_MAX_PACKET], ControlMessage &reply,
+                     double &roundTripMS) {
+
+    uint8_t packet[CONTROL_MAX_PACKET];
+    request.seq = nextSeq_++;
+    int length = controlEncode(request, packet, sizeof(packet));
+    if (length == 0) {
+        fprintf(stderr, "request too long\n");
+        return false;
+    }
+
+    for (int attempt = 0; attempt < cfg_.tries; attempt++) {
+        double sentMS = nowMS();
+        sendto(socket_, packet, length, 0, (const sockaddr *)&puppetAddress_, sizeof(puppetAddress_));
+        while (nowMS() - sentMS < cfg_.timeoutMS) {
+            ssize_t n = recv(socket_, buffer, sizeof(buffer), 0);
+            if (n > 0 && controlDecode(buffer, (int)n, reply) && reply.type == controlReply &&
+                reply.seq == request.seq) {
+                roundTripMS = nowMS() - sentMS;
+                return true;
+            }
+        }
+    }
+    return false;
+
+}
+
+static const char *statusName(int status) {
+
+    switch (status) {
+        case controlOK:             return "ok";
+        case controlUnknownName:    return "unknown name";
+        case controlBadRequest:     return "bad request";
+    }
+    return "unknown status";
+
+}
+
+static int usage() {
+
+    fprintf(stderr, "usage: puppetcontrol [--puppet HOST:PORT] [--timeout-ms 250] [--tries 4] [--repeat N]\n"
+                    "                     list | get NAME [ARGUMENT] | call NAME [ARGUMENT] | metrics\n");
+    return 2;
+
+}
+
+/* ----- printMetrics -----
+ * Gets the "metricsBinary" variable a page at a time and prints every metric
+ * as Prometheus text. Returns false if a page did not come or did not make sense.
+ */
+static bool printMetrics(double &roundTripMS, int &bytes) {
+
+    uint8_t buffer[CONTROL_MAX_PACKET];
+    char text[4096];
+    char page[8];
+    int first = 0;
+    int total = 1;
+    roundTripMS = 0;
+    bytes = 0;
+
+    while (first < total) {
+        ControlMessage request, reply;
+        controlSetMessage(request, controlGet, 0, "metricsBinary");
+        snprintf(page, sizeof(page), "%d", first);
+        request.text = page;
+        request.textLength = strlen(page);
+        double pageMS;
+        if (!exchange(request, buffer, reply, pageMS)) {
+            fprintf(stderr, "no answer from %s\n", cfg_.puppet.c_str());
+            return false;
+        }
+        roundTripMS += pageMS;
+        bytes += reply.textLength;
+
+        MetricsSnapshotHeader header;
+        const uint8_t *p = (const uint8_t *)reply.text;
+        const uint8_t *end = p + reply.textLength;
+        if (reply.status != controlOK || reply.textLength < (int)sizeof(header)) {
+            fprintf(stderr, "metricsBinary: %s\n", reply.status != controlOK ? statusName(reply.status) : "too short");
+            return false;
+        }
+        memcpy(&header, p, sizeof(header));
+        p += sizeof(header);
+        if (header.magic != METRICS_FORMAT_MAGIC || header.version != METRICS_FORMAT_VERSION ||
+            header.first != first || header.count == 0) {
+            fprintf(stderr, "metricsBinary: not a snapshot page from %d\n", first);
+            return false;
+        }
+        if (first == 0) {
+            printf("# puppet uptime %lu ms\n", (unsigned long)header.uptimeMS);
+        }
+        for (int m = 0; m < header.count; m++) {
+            MetricsRecord record;
+            int n = metricsDecodeRecord(p, (int)(end - p), record);
+            if (n == 0 || metricsFormatText(record, text, sizeof(text)) == 0) {
+                fprintf(stderr, "metricsBinary: bad record %d\n", first + m);
+                return false;
+            }
+            fputs(text, stdout);
+            p += n;
+        }
+        first += header.count;
+        total = header.total;
+    }
+    return true;
+
+}
+
+int main(int argc, char **argv) {
+
+    int i = 1;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+        if (strcmp(arg, "--puppet") == 0) {
+            cfg_.puppet = value;
+        } else if (strcmp(arg, "--timeout-ms") == 0 && atoi(value) > 0) {
+            cfg_.timeoutMS = atoi(value);
+        } else if (strcmp(arg, "--tries") == 0 && atoi(value) > 0) {
+            cfg_.tries = atoi(value);
+        } else if (strcmp(arg, "--repeat") == 0 && atoi(value) > 0) {
+            cfg_.repeat = atoi(value);
+        } else {
+            return usage();
+        }
+        i++;
+    }
+    if (i >= argc) {
+        return usage();
+    }
+
+    ControlMessage request;
+    std::string command = argv[i];
+    std::string argument = (i + 3 == argc) ? argv[i + 2] : "";
+    if (command == "list" && i + 1 == argc) {
+        controlSetMessage(request, controlList, 0);
+    } else if (command == "metrics" && i + 1 == argc) {
+        controlSetMessage(request, controlGet, 0, "metricsBinary");
+    } else if ((command == "get" || command == "call") && (i + 2 == argc || i + 3 == argc)) {
+        controlSetMessage(request, command == "get" ? controlGet : controlCall, 0, argv[i + 1]);
+        request.text = argument.c_str();
+        request.textLength = argument.size();
+    } else {
+        return usage();
+    }
+    if (i + 1 < argc && strlen(argv[i + 1]) >= CONTROL_NAME_SIZE) {
+        fprintf(stderr, "names are at most %d characters\n", CONTROL_NAME_SIZE - 1);
+        return 2;
+    }
+
+    if (!parseAddress(cfg_.puppet.c_str(), puppetAddress_)) {
+        fprintf(stderr, "bad puppet address %s\n", cfg_.puppet.c_str());
+        return 2;
+    }
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    timeval timeout = {0, 10000};
+    if (socket_ < 0 || setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+        perror("socket");
+        return 1;
+    }
+
+    if (command == "metrics") {
+        double roundTripMS;
+        int bytes;
+        bool ok = printMetrics(roundTripMS, bytes);
+        close(socket_);
+        if (ok) {
+            printf("# %d bytes, round trips %.2f ms\n", bytes, roundTripMS);
+        }
+        return ok ? 0 : 1;
+    }
+
+    uint8_t buffer[CONTROL_MAX_PACKET];
+    ControlMessage reply;
+    std::vector<double> roundTrips;
+    for (int r = 0; r < cfg_.repeat; r++) {
+        double roundTripMS;
+        if (!exchange(request, buffer, reply, roundTripMS)) {
+            fprintf(stderr, "no answer from %s\n", cfg_.puppet.c_str());
+            close(socket_);
+            return 1;
+        }
+        roundTrips.push_back(roundTripMS);
+    }
+    close(socket_);
+
+    if (reply.status != controlOK) {
+        fprintf(stderr, "%s: %s\n", reply.name, statusName(reply.status));
+        return 1;
+    }
+    if (request.type == controlCall) {
+        printf("%s returned %d\n", reply.name, (int)reply.result);
+    } else {
+        printf("%.*s%s", reply.textLength, reply.text,
+               (reply.textLength > 0 && reply.text[reply.textLength - 1] == '\n') ? "" : "\n");
+    }
+
+    std::sort(roundTrips.begin(), roundTrips.end());
+    if (roundTrips.size() == 1) {
+        printf("round trip %.2f ms\n", roundTrips[0]);
+    } else {
+        printf("%zu round trips: min %.2f ms, median %.2f ms, max %.2f ms\n", roundTrips.size(),
+               roundTrips.front(), roundTrips[roundTrips.size() / 2], roundTrips.back());
+    }
+    return 0;
+
+}
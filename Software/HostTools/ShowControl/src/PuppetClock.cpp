@@ -0,0 +1,123 @@
+/*
+ * PuppetClock.cpp
+ *
+ * Team Practical Project show controller
+ *
+ * Clock offset and drift estimate for one puppet. See PuppetClock.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <PuppetClock.h>
+
+#include <math.h>
+
+/* ----- addSample -----
+ * One sync reply: when the request was sent and the reply received on the PC,
+ * and the puppet's millis() in the reply
+ */
+void PuppetClock::addSample(int64_t sendMicros, int64_t receiveMicros, uint32_t puppetMS) {
+
+    int64_t roundTrip = receiveMicros - sendMicros;
+    if (roundTrip < 0 || (haveSample_ && roundTrip >= sampleRoundTrip_)) {
+        return;
+    }
+
+    int64_t midMicros = sendMicros + roundTrip / 2;
+
+    // millis() wraps after 49 days. Once synced, take the value nearest the prediction.
+    double puppet = puppetMS;
+    if (isSynced()) {
+        double predicted = floor(puppetAt(midMicros));
+        puppet = predicted + (int32_t)(puppetMS - (uint32_t)(int64_t)predicted);
+    }
+
+    haveSample_ = true;
+    sampleRoundTrip_ = roundTrip;
+    sample_.hostMS = midMicros / 1000.0;
+    sample_.offsetMS = puppet + 0.5 - sample_.hostMS;   // millis() truncates, so +0.5 on average
+
+}
+
+/* ----- endRound -----
+ * Takes the best sample of the round into the estimate. Returns false if no
+ * reply came back this round.
+ */
+bool PuppetClock::endRound() {
+
+    if (!haveSample_) {
+        return false;
+    }
+    rounds_.push_back(sample_);
+    if (rounds_.size() > SYNC_WINDOW) {
+        rounds_.pop_front();
+    }
+    bestRoundTrip_ = sampleRoundTrip_;
+    haveSample_ = false;
+    fit();
+    return true;
+
+}
+
+/* ----- fit -----
+ * Least squares line through the offsets of the rounds in the window
+ */
+void PuppetClock::fit() {
+
+    double n = rounds_.size();
+    double meanHost = 0;
+    double meanOffset = 0;
+    for (const Round &r : rounds_) {
+        meanHost += r.hostMS;
+        meanOffset += r.offsetMS;
+    }
+    meanHost /= n;
+    meanOffset /= n;
+
+    double sxy = 0;
+    double sxx = 0;
+    for (const Round &r : rounds_) {
+        sxy += (r.hostMS - meanHost) * (r.offsetMS - meanOffset);
+        sxx += (r.hostMS - meanHost) * (r.hostMS - meanHost);
+    }
+
+    refHostMS_ = meanHost;
+    offsetMS_ = meanOffset;
+    if (rounds_.back().hostMS - rounds_.front().hostMS >= SYNC_MIN_DRIFT_SPAN_MS && sxx > 0) {
+        driftRate_ = sxy / sxx;
+    } else {
+        // not enough baseline to see drift: just follow the latest round
+        driftRate_ = 0;
+        refHostMS_ = rounds_.back().hostMS;
+        offsetMS_ = rounds_.back().offsetMS;
+    }
+
+}
+
+double PuppetClock::puppetAt(int64_t hostMicros) const {
+
+    double hostMS = hostMicros / 1000.0;
+    return hostMS + offsetMS_ + driftRate_ * (hostMS - refHostMS_);
+
+}
+
+/* ----- toPuppet -----
+ * The puppet's millis() at a PC time
+ */
+uint32_t PuppetClock::toPuppet(int64_t hostMicros) const {
+
+    return (uint32_t)(int64_t)llround(puppetAt(hostMicros));
+
+}
+
+/* ----- toHost -----
+ * The PC time of a puppet millis() value, taking the wrap of millis() nearest
+ * to nearHostMicros
+ */
+int64_t PuppetClock::toHost(uint32_t puppetMS, int64_t nearHostMicros) const {
+
+    int32_t fromNearMS = (int32_t)(puppetMS - toPuppet(nearHostMicros));
+    return nearHostMicros + (int64_t)llround(fromNearMS * 1000.0 / (1.0 + driftRate_));
+
+}
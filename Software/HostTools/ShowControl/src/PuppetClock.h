@@ -0,0 +1,64 @@
+/*
+ * PuppetClock.h
+ *
+ * Team Practical Project show controller
+ *
+ * What the controller knows about one puppet's clock: how far its millis() is from
+ * the PC clock, and how fast it drifts. Built from time sync exchanges as described
+ * in TPPShowProtocol.h.
+ *
+ * Each sync round sends a few requests. Of the replies, the one with the shortest
+ * round trip is kept, as it was delayed least; the puppet read its millis() about
+ * halfway through the round trip. The offsets from the last SYNC_WINDOW rounds are
+ * fitted to a straight line, whose slope is the drift. Until the rounds span
+ * SYNC_MIN_DRIFT_SPAN_MS there is not enough baseline to see drift, and it is taken as 0.
+ *
+ * Times on the PC are steady clock microseconds. Not thread safe; the caller locks.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_PUPPET_CLOCK_H
+#define _TPP_PUPPET_CLOCK_H
+
+#include <stdint.h>
+#include <deque>
+
+#define SYNC_WINDOW 16
+#define SYNC_MIN_DRIFT_SPAN_MS 8000
+
+class PuppetClock {
+
+    public:
+        void addSample(int64_t sendMicros, int64_t receiveMicros, uint32_t puppetMS);
+        bool endRound();
+        bool isSynced() const { return !rounds_.empty(); }
+        uint32_t toPuppet(int64_t hostMicros) const;
+        int64_t toHost(uint32_t puppetMS, int64_t nearHostMicros) const;
+        int64_t getBestRoundTripMicros() const { return bestRoundTrip_; }
+        double getOffsetMS() const { return offsetMS_; }
+        double getDriftPPM() const { return driftRate_ * 1e6; }
+
+    private:
+        struct Round {
+            double hostMS;          // PC time of the sample
+            double offsetMS;        // puppet millis() minus PC ms
+        };
+        double puppetAt(int64_t hostMicros) const;
+        void fit();
+
+        bool haveSample_ = false;
+        int64_t sampleRoundTrip_ = 0;
+        Round sample_;
+        std::deque<Round> rounds_;
+        int64_t bestRoundTrip_ = 0;
+
+        // the fitted line: offset = offsetMS_ + driftRate_ * (hostMS - refHostMS_)
+        double refHostMS_ = 0;
+        double offsetMS_ = 0;
+        double driftRate_ = 0;
+
+};
+
+#endif
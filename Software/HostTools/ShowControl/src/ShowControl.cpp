@@ -0,0 +1,569 @@
+/*
+ * ShowControl.cpp
+ *
+ * Team Practical Project show controller
+ *
+ * Runs a show: coordinated routines on several puppets, e.g. one speaking while
+ * the others glance at it. The cues in a show script (see ShowScript.h) are sent
+ * over UDP to each puppet running the eyes firmware, stamped with the time on
+ * that puppet's clock at which to run them, so the puppets move at the same time.
+ * The protocol is in TPPShowProtocol.h, in the eyes firmware.
+ *
+ * Before the show, and every --sync-interval-ms during it, each puppet's clock is
+ * measured (see PuppetClock.h). Each cue is sent --lead-ms before it is due, and
+ * again halfway there in case a packet is lost. The puppets report when they ran
+ * each cue, on their own clock. Mapped back through the same clock estimate that
+ * scheduled the cue, that shows only how late each puppet's loop() was, not how far
+ * apart the puppets really were: at the end it is reported for every line of the
+ * script as puppet-side lateness.
+ *
+ * The real spread needs a clock that every puppet and the controller share. The
+ * simulated puppets have one, the PC's steady clock: with --cue-log, each simpuppet
+ * logs the PC time it ran every cue, and the controller reads the log at the end and
+ * reports the true spread between puppets and the true error from the cue's time.
+ *
+ * Try it without hardware against simulated puppets (HostTools/AnimationSim simpuppet),
+ * one per port from --base-port:
+ *      showcontrol --local 3 shows/glance.show
+ *
+ * Usage
+ *      showcontrol [--puppet HOST:PORT]... [--local N] [--base-port 8800] [--lead-ms 200]
+ *                  [--sync-interval-ms 2000] [--workers 4] [--cue-log FILE] [--verbose] SCRIPT
+ *
+ * Exits with 1 if any cue was not reported as run.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <ShowScheduler.h>
+#include <PuppetClock.h>
+#include <ShowScript.h>
+#include <TPPShowProtocol.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define SYNC_REQUESTS_PER_ROUND 4
+#define SYNC_SPACING_MS 10
+#define SYNC_ROUND_MS 250           // replies later than this are ignored
+#define SYNC_ROUNDS_BEFORE_SHOW 3
+#define SYNC_TIMEOUT_MS 10000
+#define SHOW_START_DELAY_MS 500     // from the end of the first sync to show time 0
+#define SHOW_TAIL_MS 1000           // wait this long after the last cue for reports
+
+struct ShowConfig {
+    int leadMS = 200;
+    int syncIntervalMS = 2000;
+    int workers = 4;
+    const char *cueLog = NULL;  // simpuppet --cue-log file, for the true run times
+    bool verbose = false;
+};
+
+struct Puppet {
+    std::string name;
+    sockaddr_in address;
+    PuppetClock clock;
+    int roundsSynced = 0;
+    int roundsMissed = 0;
+    std::map<uint32_t, int64_t> syncSent;   // sync request sequence number -> PC time sent
+};
+
+// One cue sent to one puppet. cueId is the index in runs_ + 1.
+struct CueRun {
+    int scriptIndex;
+    int puppet;
+    int64_t targetMicros;       // PC time the cue should run
+    uint32_t atPuppetMS;        // that time on the puppet's clock, as last sent
+    bool ran = false;
+    int64_t ranMicros = 0;      // PC time the puppet says it ran
+    bool logged = false;
+    int64_t loggedMicros = 0;   // PC time it really ran, from the cue log
+};
+
+static ShowConfig cfg_;
+static std::vector<Puppet> puppets_;
+static std::vector<ShowScriptCue> script_;
+static std::vector<CueRun> runs_;
+static std::mutex mutex_;           // guards puppets_ and runs_
+static ShowScheduler scheduler_;
+static int socket_ = -1;
+static std::atomic<bool> running_(true);
+static uint32_t nextSyncSeq_ = 1;
+
+// ---------------------------------------------------------
+//-------------------   NETWORK -----------------------------
+
+static bool parseAddress(const char *hostPort, sockaddr_in &address) {
+
+    std::string text(hostPort);
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    std::string host = text.substr(0, colon);
+    int port = atoi(text.c_str() + colon + 1);
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *found = NULL;
+    if (port <= 0 || port > 65535 || getaddrinfo(host.c_str(), NULL, &hints, &found) != 0) {
+        return false;
+    }
+    address = *(sockaddr_in *)found->ai_addr;
+    address.sin_port = htons(port);
+    freeaddrinfo(found);
+    return true;
+
+}
+
+static void sendTo(const Puppet &puppet, const void *packet, size_t size) {
+
+    sendto(socket_, packet, size, 0, (const sockaddr *)&puppet.address, sizeof(puppet.address));
+
+}
+
+/* ----- receiveThread -----
+ * Handles sync replies and cue reports from every puppet
+ */
+static void receiveThread() {
+
+    uint8_t buffer[512];
+    while (running_) {
+
+        sockaddr_in from;
+        socklen_t fromLength = sizeof(from);
+        ssize_t length = recvfrom(socket_, buffer, sizeof(buffer), 0, (sockaddr *)&from, &fromLength);
+        int64_t now = ShowScheduler::nowMicros();
+        int type = (length > 0) ? showPacketType(buffer, (int)length) : 0;
+        if (type == 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Puppet *puppet = NULL;
+        for (Puppet &p : puppets_) {
+            if (p.address.sin_addr.s_addr == from.sin_addr.s_addr && p.address.sin_port == from.sin_port) {
+                puppet = &p;
+            }
+        }
+        if (puppet == NULL) {
+            continue;
+        }
+
+        if (type == showSyncReply) {
+            const ShowSyncReplyPacket *reply = (const ShowSyncReplyPacket *)buffer;
+            auto sent = puppet->syncSent.find(reply->syncSeq);
+            if (sent != puppet->syncSent.end()) {
+                puppet->clock.addSample(sent->second, now, reply->puppetMS);
+                puppet->syncSent.erase(sent);
+            }
+        } else if (type == showCueDone) {
+            const ShowCueDonePacket *done = (const ShowCueDonePacket *)buffer;
+            if (done->cueId == 0 || done->cueId > runs_.size()) {
+                continue;
+            }
+            CueRun &run = runs_[done->cueId - 1];
+            run.ran = true;
+            run.ranMicros = puppet->clock.toHost(done->ranPuppetMS, run.targetMicros);
+            if (cfg_.verbose) {
+                printf("%-10s ran line %-3d %+7.1f ms  %s\n", puppet->name.c_str(), script_[run.scriptIndex].line,
+                       (run.ranMicros - run.targetMicros) / 1000.0, script_[run.scriptIndex].text.c_str());
+            }
+        }
+
+    }
+
+}
+
+// ---------------------------------------------------------
+//-------------------   TIME SYNC ---------------------------
+
+static void sendSyncRequest(int p) {
+
+    ShowSyncRequestPacket request;
+    showSetHeader(request.header, showSyncRequest);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        request.syncSeq = nextSyncSeq_++;
+        puppets_[p].syncSent[request.syncSeq] = ShowScheduler::nowMicros();
+    }
+    sendTo(puppets_[p], &request, sizeof(request));
+
+}
+
+/* ----- syncRound -----
+ * Schedules one round of sync requests to a puppet starting at startMicros, the
+ * end of the round, and the next round after that
+ */
+static void syncRound(int p, int64_t startMicros) {
+
+    for (int i = 0; i < SYNC_REQUESTS_PER_ROUND; i++) {
+        scheduler_.at(startMicros + i * SYNC_SPACING_MS * 1000LL, [p] { sendSyncRequest(p); });
+    }
+    scheduler_.at(startMicros + SYNC_ROUND_MS * 1000LL, [p, startMicros] {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Puppet &puppet = puppets_[p];
+        puppet.syncSent.clear();
+        if (puppet.clock.endRound()) {
+            puppet.roundsSynced++;
+        } else {
+            puppet.roundsMissed++;
+        }
+        if (running_) {
+            syncRound(p, startMicros + cfg_.syncIntervalMS * 1000LL);
+        }
+    });
+
+}
+
+/* ----- waitForSync -----
+ * Waits for every puppet to answer enough sync rounds to run a show
+ */
+static bool waitForSync() {
+
+    int64_t giveUp = ShowScheduler::nowMicros() + SYNC_TIMEOUT_MS * 1000LL;
+    while (ShowScheduler::nowMicros() < giveUp) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bool ready = true;
+            for (const Puppet &p : puppets_) {
+                ready = ready && p.roundsSynced >= SYNC_ROUNDS_BEFORE_SHOW;
+            }
+            if (ready) {
+                return true;
+            }
+        }
+        usleep(20000);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Puppet &p : puppets_) {
+        if (p.roundsSynced < SYNC_ROUNDS_BEFORE_SHOW) {
+            fprintf(stderr, "%s is not answering\n", p.name.c_str());
+        }
+    }
+    return false;
+
+}
+
+// ---------------------------------------------------------
+//-------------------   CUES --------------------------------
+
+/* ----- sendCue -----
+ * Sends one cue, with its time converted to the puppet's clock as now estimated
+ */
+static void sendCue(uint32_t cueId) {
+
+    ShowCuePacket packet;
+    showSetHeader(packet.header, showCue);
+    int p;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CueRun &run = runs_[cueId - 1];
+        const ShowScriptCue &cue = script_[run.scriptIndex];
+        p = run.puppet;
+        run.atPuppetMS = puppets_[p].clock.toPuppet(run.targetMicros);
+        packet.cueId = cueId;
+        packet.atPuppetMS = run.atPuppetMS;
+        packet.action = cue.action;
+        packet.reserved = 0;
+        memcpy(packet.param, cue.param, sizeof(packet.param));
+    }
+    sendTo(puppets_[p], &packet, sizeof(packet));
+
+}
+
+/* ----- scheduleShow -----
+ * Queues the sends of every cue, for a show starting at startMicros
+ */
+static void scheduleShow(int64_t startMicros) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int s = 0; s < (int)script_.size(); s++) {
+        for (int p : script_[s].puppets) {
+            CueRun run;
+            run.scriptIndex = s;
+            run.puppet = p;
+            run.targetMicros = startMicros + script_[s].timeMS * 1000LL;
+            runs_.push_back(run);
+            uint32_t cueId = runs_.size();
+            scheduler_.at(run.targetMicros - cfg_.leadMS * 1000LL, [cueId] { sendCue(cueId); });
+            scheduler_.at(run.targetMicros - cfg_.leadMS * 500LL, [cueId] { sendCue(cueId); });
+        }
+    }
+
+}
+
+/* ----- readCueLog -----
+ * Takes the PC time every cue really ran from the simpuppet cue log: lines of
+ * cueId puppetMS pcMicros. Returns the number of cues found in it.
+ */
+static int readCueLog(const char *path) {
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return 0;
+    }
+    int found = 0;
+    unsigned cueId, puppetMS;
+    long long pcMicros;
+    while (fscanf(file, "%u %u %lld", &cueId, &puppetMS, &pcMicros) == 3) {
+        if (cueId > 0 && cueId <= runs_.size() && !runs_[cueId - 1].logged) {
+            runs_[cueId - 1].logged = true;
+            runs_[cueId - 1].loggedMicros = pcMicros;
+            found++;
+        }
+    }
+    fclose(file);
+    return found;
+
+}
+
+// How far apart the puppets ran one line of the script, and the furthest any was
+// from its time
+struct LineSpread {
+    int count = 0;
+    int64_t first = 0;
+    int64_t last = 0;
+    double worstMS = 0;
+
+    void add(int64_t micros, int64_t targetMicros) {
+        first = (count == 0) ? micros : std::min(first, micros);
+        last = (count == 0) ? micros : std::max(last, micros);
+        worstMS = std::max(worstMS, fabs((micros - targetMicros) / 1000.0));
+        count++;
+    }
+    double spreadMS() const { return (last - first) / 1000.0; }
+};
+
+// The spreads of every line, summed up
+struct ShowSpread {
+    int lines = 0;
+    double spreadSum = 0;
+    double spreadMax = 0;
+    double worstMax = 0;
+
+    void add(const LineSpread &line) {
+        if (line.count > 1) {
+            spreadSum += line.spreadMS();
+            spreadMax = std::max(spreadMax, line.spreadMS());
+            lines++;
+        }
+        worstMax = std::max(worstMax, line.worstMS);
+    }
+    double spreadMean() const { return lines > 0 ? spreadSum / lines : 0.0; }
+};
+
+/* ----- report -----
+ * For every line of the script: the puppet-side lateness, how far apart the puppets
+ * ran it and how far from its time as they report it through the clock estimates,
+ * and with a cue log the same really, on the PC's clock. Returns the number of cues
+ * not reported as run.
+ */
+static int report() {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    int logged = (cfg_.cueLog != NULL) ? readCueLog(cfg_.cueLog) : 0;
+
+    printf("\n                 puppet-side lateness   true, from the cue log\n");
+    printf(" line  puppets  spread_ms  worst_ms     spread_ms  worst_ms  cue\n");
+    int missing = 0;
+    ShowSpread late, real;
+
+    for (int s = 0; s < (int)script_.size(); s++) {
+        LineSpread lineLate, lineReal;
+        int sent = 0;
+        for (const CueRun &run : runs_) {
+            if (run.scriptIndex != s) {
+                continue;
+            }
+            sent++;
+            if (!run.ran) {
+                missing++;
+                continue;
+            }
+            lineLate.add(run.ranMicros, run.targetMicros);
+            if (run.logged) {
+                lineReal.add(run.loggedMicros, run.targetMicros);
+            }
+        }
+        printf("%5d  %3d/%-3d  %9.1f  %8.1f  ", script_[s].line, lineLate.count, sent, lineLate.spreadMS(),
+               lineLate.worstMS);
+        if (lineReal.count == lineLate.count && lineReal.count > 0) {
+            printf("   %9.1f  %8.1f  %s\n", lineReal.spreadMS(), lineReal.worstMS, script_[s].text.c_str());
+        } else {
+            printf("   %9s  %8s  %s\n", "-", "-", script_[s].text.c_str());
+        }
+        late.add(lineLate);
+        if (lineReal.count == lineLate.count) {
+            real.add(lineReal);
+        }
+    }
+
+    printf("\n puppet            round_trip_ms  offset_ms       drift_ppm  rounds  missed\n");
+    for (const Puppet &p : puppets_) {
+        printf(" %-18s %12.2f  %14.1f  %9.1f  %6d  %6d\n", p.name.c_str(), p.clock.getBestRoundTripMicros() / 1000.0,
+               p.clock.getOffsetMS(), p.clock.getDriftPPM(), p.roundsSynced, p.roundsMissed);
+    }
+
+    printf("\n%zu cues sent, %d not reported. Puppet-side lateness: spread mean %.1f ms, max %.1f ms, "
+           "worst %.1f ms. Scheduler late by up to %.2f ms.\n",
+           runs_.size(), missing, late.spreadMean(), late.spreadMax, late.worstMax,
+           scheduler_.getMaxLateMicros() / 1000.0);
+    if (logged > 0) {
+        printf("True, %d cues in the cue log: spread between puppets mean %.1f ms, max %.1f ms. "
+               "Worst cue %.1f ms from its time.\n", logged, real.spreadMean(), real.spreadMax, real.worstMax);
+    } else {
+        printf("No cue log, so how far apart the puppets really were is not measured.\n");
+    }
+    return missing;
+
+}
+
+// ---------------------------------------------------------
+
+static int usage() {
+
+    fprintf(stderr, "usage: showcontrol [--puppet HOST:PORT]... [--local N] [--base-port 8800] [--lead-ms 200]\n"
+                    "                   [--sync-interval-ms 2000] [--workers 4] [--cue-log FILE] [--verbose] SCRIPT\n");
+    return 2;
+
+}
+
+int main(int argc, char **argv) {
+
+    const char *scriptPath = NULL;
+    int local = 0;
+    int basePort = SHOW_DEFAULT_PORT;
+    std::vector<const char *> addresses;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+        if (strcmp(arg, "--puppet") == 0) {
+            addresses.push_back(value);
+            i++;
+        } else if (strcmp(arg, "--local") == 0) {
+            local = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--base-port") == 0) {
+            basePort = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--lead-ms") == 0) {
+            cfg_.leadMS = std::max(20, atoi(value));
+            i++;
+        } else if (strcmp(arg, "--sync-interval-ms") == 0) {
+            cfg_.syncIntervalMS = std::max(SYNC_ROUND_MS * 2, atoi(value));
+            i++;
+        } else if (strcmp(arg, "--workers") == 0) {
+            cfg_.workers = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--cue-log") == 0) {
+            cfg_.cueLog = value;
+            i++;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            cfg_.verbose = true;
+        } else if (arg[0] != '-' && scriptPath == NULL) {
+            scriptPath = arg;
+        } else {
+            return usage();
+        }
+    }
+
+    std::vector<std::string> names;
+    for (const char *a : addresses) {
+        names.push_back(a);
+    }
+    for (int i = 0; i < local; i++) {
+        names.push_back("127.0.0.1:" + std::to_string(basePort + i));
+    }
+    if (scriptPath == NULL || names.empty()) {
+        return usage();
+    }
+
+    puppets_.resize(names.size());
+    for (size_t p = 0; p < names.size(); p++) {
+        puppets_[p].name = names[p];
+        if (!parseAddress(names[p].c_str(), puppets_[p].address)) {
+            fprintf(stderr, "bad puppet address %s\n", names[p].c_str());
+            return 2;
+        }
+    }
+
+    std::string error;
+    if (!showLoadScript(scriptPath, puppets_.size(), script_, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    if (script_.empty()) {
+        fprintf(stderr, "%s has no cues\n", scriptPath);
+        return 2;
+    }
+
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in any;
+    memset(&any, 0, sizeof(any));
+    any.sin_family = AF_INET;
+    timeval timeout = {0, 100000};
+    if (socket_ < 0 || bind(socket_, (sockaddr *)&any, sizeof(any)) != 0 ||
+        setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+        perror("socket");
+        return 1;
+    }
+
+    // the cue ids start again from 1, so what an earlier show left in the log goes
+    if (cfg_.cueLog != NULL) {
+        FILE *file = fopen(cfg_.cueLog, "w");
+        if (file == NULL) {
+            perror(cfg_.cueLog);
+            return 1;
+        }
+        fclose(file);
+    }
+
+    std::thread receiver(receiveThread);
+    scheduler_.start(cfg_.workers);
+
+    int64_t now = ShowScheduler::nowMicros();
+    for (int p = 0; p < (int)puppets_.size(); p++) {
+        syncRound(p, now + p * 1000LL);     // spread the puppets' sync traffic a little
+    }
+    printf("syncing %zu puppets\n", puppets_.size());
+
+    int missing = -1;
+    if (waitForSync()) {
+
+        int64_t startMicros = ShowScheduler::nowMicros() + std::max(SHOW_START_DELAY_MS, cfg_.leadMS) * 1000LL;
+        scheduleShow(startMicros);
+        printf("show of %zu cues on %zu puppets starts\n", script_.size(), puppets_.size());
+
+        int64_t endMicros = startMicros + (script_.back().timeMS + SHOW_TAIL_MS) * 1000LL;
+        while (ShowScheduler::nowMicros() < endMicros) {
+            usleep(50000);
+        }
+        missing = report();
+
+    }
+
+    running_ = false;
+    scheduler_.stop();
+    receiver.join();
+    close(socket_);
+    return missing == 0 ? 0 : 1;
+
+}
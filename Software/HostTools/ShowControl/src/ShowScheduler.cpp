@@ -0,0 +1,123 @@
+/*
+ * ShowScheduler.cpp
+ *
+ * Team Practical Project show controller
+ *
+ * Timed event scheduler. See ShowScheduler.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <ShowScheduler.h>
+
+#include <algorithm>
+#include <chrono>
+
+int64_t ShowScheduler::nowMicros() {
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
+
+void ShowScheduler::start(int numWorkers) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = true;
+    timer_ = std::thread(&ShowScheduler::timerThread, this);
+    for (int i = 0; i < std::max(1, numWorkers); i++) {
+        workers_.push_back(std::thread(&ShowScheduler::workerThread, this));
+    }
+
+}
+
+/* ----- stop -----
+ * Waits for tasks already running to finish. Queued tasks are dropped.
+ */
+void ShowScheduler::stop() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    timerWake_.notify_all();
+    workWake_.notify_all();
+    timer_.join();
+    for (std::thread &worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+
+}
+
+void ShowScheduler::at(int64_t timeMicros, Task task) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timed_.push({timeMicros, nextOrder_++, std::move(task)});
+    }
+    timerWake_.notify_one();    // it may be sooner than what the timer is waiting for
+
+}
+
+int64_t ShowScheduler::getMaxLateMicros() {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxLateMicros_;
+
+}
+
+/* ----- timerThread -----
+ * Sleeps until the earliest task is due, then moves every due task to the workers
+ */
+void ShowScheduler::timerThread() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+
+        if (timed_.empty()) {
+            timerWake_.wait(lock);
+            continue;
+        }
+
+        int64_t now = nowMicros();
+        int64_t next = timed_.top().timeMicros;
+        if (next > now) {
+            timerWake_.wait_for(lock, std::chrono::microseconds(next - now));
+            continue;
+        }
+
+        while (!timed_.empty() && timed_.top().timeMicros <= now) {
+            maxLateMicros_ = std::max(maxLateMicros_, now - timed_.top().timeMicros);
+            ready_.push_back(std::move(const_cast<Event &>(timed_.top()).task));
+            timed_.pop();
+        }
+        workWake_.notify_all();
+
+    }
+
+}
+
+void ShowScheduler::workerThread() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+
+        workWake_.wait(lock, [this] { return !running_ || !ready_.empty(); });
+        if (!running_) {
+            return;
+        }
+        Task task = std::move(ready_.front());
+        ready_.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+    }
+
+}
@@ -0,0 +1,73 @@
+/*
+ * ShowScheduler.h
+ *
+ * Team Practical Project show controller
+ *
+ * A timed event scheduler. Tasks are queued with the PC clock time they should run
+ * at. One timer thread sleeps until the earliest is due and hands it to a pool of
+ * worker threads, so a slow task (a send to a puppet that is not answering) does
+ * not hold up the tasks for the other puppets due at the same moment.
+ *
+ * Times are steady clock microseconds, from nowMicros().
+ *
+ * Key methods
+ *      .start()        starts the timer thread and the workers
+ *      .at()           queues a task. Safe to call from any thread, including from a task.
+ *      .stop()         stops the threads. Tasks still queued are dropped.
+ *      .getMaxLateMicros()  the latest any task has been handed to a worker after its time
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SHOW_SCHEDULER_H
+#define _TPP_SHOW_SCHEDULER_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ShowScheduler {
+
+    public:
+        typedef std::function<void()> Task;
+
+        static int64_t nowMicros();
+
+        void start(int numWorkers);
+        void stop();
+        void at(int64_t timeMicros, Task task);
+        int64_t getMaxLateMicros();
+
+    private:
+        struct Event {
+            int64_t timeMicros;
+            uint64_t order;         // tasks due at the same time run in the order queued
+            Task task;
+            bool operator>(const Event &rhs) const {
+                return timeMicros != rhs.timeMicros ? timeMicros > rhs.timeMicros : order > rhs.order;
+            }
+        };
+
+        void timerThread();
+        void workerThread();
+
+        std::mutex mutex_;
+        std::condition_variable timerWake_;
+        std::condition_variable workWake_;
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> timed_;
+        std::deque<Task> ready_;
+        std::thread timer_;
+        std::vector<std::thread> workers_;
+        uint64_t nextOrder_ = 0;
+        int64_t maxLateMicros_ = 0;
+        bool running_ = false;
+
+};
+
+#endif
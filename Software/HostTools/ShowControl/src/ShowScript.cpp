@@ -0,0 +1,196 @@
+/*
+ * ShowScript.cpp
+ *
+ * Team Practical Project show controller
+ *
+ * Show script reader. See ShowScript.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <ShowScript.h>
+#include <TPPShowProtocol.h>
+
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <string.h>
+#include <stdlib.h>
+
+static const struct {
+    const char *name;
+    eShowSequence sequence;
+} sequenceNames_[] = {
+    {"asleep", showSequenceAsleep},
+    {"wake", showSequenceWake},
+    {"roam", showSequenceRoam},
+    {"roamahead", showSequenceRoamAhead},
+    {"blink", showSequenceBlink},
+    {"endstandard", showSequenceEndStandard},
+};
+
+/* ----- parsePuppets -----
+ * "all" or a comma separated list of puppet numbers
+ */
+static bool parsePuppets(const std::string &word, int numPuppets, std::vector<int> &puppets) {
+
+    if (word == "all") {
+        for (int p = 0; p < numPuppets; p++) {
+            puppets.push_back(p);
+        }
+        return true;
+    }
+    std::stringstream list(word);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        char *end;
+        long p = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != 0 || p < 0 || p >= numPuppets) {
+            return false;
+        }
+        puppets.push_back((int)p);
+    }
+    return !puppets.empty();
+
+}
+
+/* ----- parseAction -----
+ * The action and its arguments, the rest of the line after the puppets
+ */
+static bool parseAction(std::istringstream &in, ShowScriptCue &cue, std::string &error) {
+
+    std::string action;
+    in >> action;
+    cue.param[0] = cue.param[1] = cue.param[2] = 0;
+
+    if (action == "sequence") {
+        std::string name;
+        in >> name;
+        for (const auto &s : sequenceNames_) {
+            if (name == s.name) {
+                cue.action = showActionSequence;
+                cue.param[0] = s.sequence;
+                return true;
+            }
+        }
+        error = "unknown sequence '" + name + "'";
+        return false;
+    }
+
+    if (action == "look") {
+        int x = -1, y = -1, speed = 10;
+        in >> x >> y;
+        if (in.fail() || x < 0 || x > 100 || y < 0 || y > 100) {
+            error = "look needs X and Y from 0 to 100";
+            return false;
+        }
+        if (!(in >> speed)) {
+            speed = 10;
+        }
+        cue.action = showActionLook;
+        cue.param[0] = x;
+        cue.param[1] = y;
+        cue.param[2] = std::max(1, std::min(speed, 1000));
+        return true;
+    }
+
+    if (action == "pursue") {
+        std::string first;
+        in >> first;
+        if (first == "off") {
+            cue.action = showActionPursue;
+            cue.param[0] = -1;
+            return true;
+        }
+        char *end;
+        long x = strtol(first.c_str(), &end, 10);
+        int y = -1;
+        in >> y;
+        if (first.empty() || *end != 0 || in.fail() || x < 0 || x > 100 || y < 0 || y > 100) {
+            error = "pursue needs X and Y from 0 to 100, or off";
+            return false;
+        }
+        cue.action = showActionPursue;
+        cue.param[0] = (int16_t)x;
+        cue.param[1] = y;
+        return true;
+    }
+
+    if (action == "attention") {
+        std::string state;
+        in >> state;
+        if (state != "on" && state != "off") {
+            error = "attention needs on or off";
+            return false;
+        }
+        cue.action = showActionAttention;
+        cue.param[0] = (state == "on") ? 1 : 0;
+        return true;
+    }
+
+    if (action == "blink") {
+        cue.action = showActionBlink;
+        return true;
+    }
+
+    error = "unknown action '" + action + "'";
+    return false;
+
+}
+
+/* ----- showLoadScript -----
+ * Reads the script into cues, sorted by time. On a mistake, returns false with
+ * error saying where.
+ */
+bool showLoadScript(const char *path, int numPuppets, std::vector<ShowScriptCue> &cues, std::string &error) {
+
+    std::ifstream file(path);
+    if (!file) {
+        error = std::string("can't read ") + path;
+        return false;
+    }
+
+    std::string text;
+    int lineNumber = 0;
+    while (std::getline(file, text)) {
+
+        lineNumber++;
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos || text[first] == '#') {
+            continue;
+        }
+
+        ShowScriptCue cue;
+        cue.line = lineNumber;
+        cue.text = text.substr(first);
+        while (!cue.text.empty() && (cue.text.back() == '\r' || cue.text.back() == ' ')) {
+            cue.text.pop_back();
+        }
+
+        std::istringstream in(text);
+        std::string puppets;
+        long timeMS = -1;
+        in >> timeMS >> puppets;
+        std::string why;
+        if (in.fail() || timeMS < 0) {
+            why = "expected time_ms puppets action";
+        } else if (!parsePuppets(puppets, numPuppets, cue.puppets)) {
+            why = "puppets must be 'all' or numbers from 0 to " + std::to_string(numPuppets - 1);
+        } else {
+            parseAction(in, cue, why);
+        }
+        if (!why.empty()) {
+            error = std::string(path) + ":" + std::to_string(lineNumber) + ": " + why;
+            return false;
+        }
+        cue.timeMS = (int32_t)timeMS;
+        cues.push_back(cue);
+
+    }
+
+    std::stable_sort(cues.begin(), cues.end(),
+                     [](const ShowScriptCue &a, const ShowScriptCue &b) { return a.timeMS < b.timeMS; });
+    return true;
+
+}
@@ -0,0 +1,41 @@
+/*
+ * ShowScript.h
+ *
+ * Team Practical Project show controller
+ *
+ * Reads a show script: a text file with one cue per line,
+ *
+ *      time_ms  puppets  action  [arguments]
+ *
+ * time_ms is from the start of the show. puppets is "all", or puppet numbers
+ * separated by commas ("0" or "1,2"), numbered in the order given to showcontrol.
+ * Actions:
+ *      sequence NAME       asleep, wake, roam, roamahead, blink or endstandard
+ *      look X Y [SPEED]    X left/right 0-100, Y up/down 0-100, SPEED x 10 (default 10)
+ *      attention on|off    acts like the A5 trigger from the mouth
+ *      blink
+ * Blank lines and lines starting with # are ignored.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SHOW_SCRIPT_H
+#define _TPP_SHOW_SCRIPT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct ShowScriptCue {
+    int line;                   // line number in the script, for messages
+    int32_t timeMS;
+    std::vector<int> puppets;
+    uint8_t action;             // eShowAction
+    int16_t param[3];
+    std::string text;           // the line as written
+};
+
+bool showLoadScript(const char *path, int numPuppets, std::vector<ShowScriptCue> &cues, std::string &error);
+
+#endif
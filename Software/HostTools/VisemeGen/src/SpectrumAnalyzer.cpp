@@ -0,0 +1,154 @@
+/*
+ * SpectrumAnalyzer.cpp
+ *
+ * Team Practical Project viseme track generator
+ *
+ * Per frame level and band energies. See SpectrumAnalyzer.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SpectrumAnalyzer.h>
+
+#include <algorithm>
+#include <math.h>
+
+#define BAND_LOW_HZ 80
+#define BAND_F1_HZ 300
+#define BAND_F2_HZ 1000
+#define BAND_HIGH_HZ 2500
+#define BAND_TOP_HZ 8000
+
+int SpectrumAnalyzer::fftSizeFor(int sampleRate) {
+
+    int size = 64;
+    while (size * 2 <= sampleRate * FRAME_WINDOW_MS / 1000) {
+        size *= 2;
+    }
+    return size;
+
+}
+
+/* ----- planFor -----
+ * The bit reversal, twiddle factors and window for one FFT size, made the first time
+ */
+const SpectrumAnalyzer::Plan &SpectrumAnalyzer::planFor(int size) {
+
+    auto found = plans_.find(size);
+    if (found != plans_.end()) {
+        return found->second;
+    }
+    Plan &plan = plans_[size];
+    int bits = 0;
+    while ((1 << bits) < size) {
+        bits++;
+    }
+    plan.reversed.resize(size);
+    for (int i = 0; i < size; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        plan.reversed[i] = r;
+    }
+    plan.twiddle.resize(size / 2);
+    for (int k = 0; k < size / 2; k++) {
+        plan.twiddle[k] = std::polar(1.0f, (float)(-2.0 * M_PI * k / size));
+    }
+    plan.window.resize(size);
+    for (int i = 0; i < size; i++) {
+        plan.window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / size));
+    }
+    return plan;
+
+}
+
+/* ----- fft -----
+ * In place radix 2, decimation in time
+ */
+void SpectrumAnalyzer::fft(const Plan &plan, std::vector<std::complex<float>> &data) {
+
+    const int size = (int)data.size();
+    for (int i = 0; i < size; i++) {
+        if (i < plan.reversed[i]) {
+            std::swap(data[i], data[plan.reversed[i]]);
+        }
+    }
+    for (int span = 2; span <= size; span *= 2) {
+        const int half = span / 2;
+        const int step = size / span;
+        for (int start = 0; start < size; start += span) {
+            for (int k = 0; k < half; k++) {
+                std::complex<float> t = plan.twiddle[k * step] * data[start + k + half];
+                data[start + k + half] = data[start + k] - t;
+                data[start + k] += t;
+            }
+        }
+    }
+
+}
+
+/* ----- analyze -----
+ * Fills out[0 .. numFrames - 1] for frames firstFrame onwards. Frame k covers the hop
+ * starting at sample k * hopSamples.
+ */
+void SpectrumAnalyzer::analyze(const std::vector<float> &samples, int sampleRate, int hopSamples,
+                               size_t firstFrame, size_t numFrames, FrameFeatures *out) {
+
+    const int size = fftSizeFor(sampleRate);
+    const Plan &plan = planFor(size);
+    buffer_.resize(size);
+    const float binHz = (float)sampleRate / size;
+    const long total = (long)samples.size();
+
+    for (size_t n = 0; n < numFrames; n++) {
+
+        FrameFeatures &frame = out[n];
+        long start = (long)(firstFrame + n) * hopSamples;
+
+        // level: the rectified average over the hop
+        double sum = 0;
+        long end = std::min(start + hopSamples, total);
+        for (long i = start; i < end; i++) {
+            sum += fabsf(samples[i]);
+        }
+        frame.level = (end > start) ? (float)(sum / (end - start)) : 0;
+
+        // spectrum: a window centered on the hop, zeros past either end of the clip
+        long from = start + hopSamples / 2 - size / 2;
+        for (int i = 0; i < size; i++) {
+            long at = from + i;
+            float value = (at >= 0 && at < total) ? samples[at] : 0;
+            buffer_[i] = std::complex<float>(value * plan.window[i], 0);
+        }
+        fft(plan, buffer_);
+
+        frame.low = frame.f1 = frame.f2 = frame.high = 0;
+        double weighted = 0;
+        double voiced = 0;
+        for (int b = 1; b < size / 2; b++) {
+            float hz = b * binHz;
+            float power = std::norm(buffer_[b]);
+            if (hz < BAND_LOW_HZ || hz >= BAND_TOP_HZ) {
+                continue;
+            }
+            if (hz < BAND_F1_HZ) {
+                frame.low += power;
+            } else if (hz < BAND_F2_HZ) {
+                frame.f1 += power;
+            } else if (hz < BAND_HIGH_HZ) {
+                frame.f2 += power;
+            } else {
+                frame.high += power;
+            }
+            if (hz < BAND_HIGH_HZ) {
+                weighted += hz * power;
+                voiced += power;
+            }
+        }
+        frame.centroidHz = (voiced > 0) ? (float)(weighted / voiced) : 0;
+
+    }
+
+}
@@ -0,0 +1,61 @@
+/*
+ * SpectrumAnalyzer.h
+ *
+ * Team Practical Project viseme track generator
+ *
+ * Cuts a clip into frames one hop apart (10 ms, the rate speak() samples the envelope
+ * at) and measures each: the rectified average level over the hop, which is what the
+ * hardware envelope detector follows, and the energy in four bands from a Hann windowed
+ * FFT about 30 ms long centered on the hop:
+ *
+ *      low     80 - 300 Hz         voicing
+ *      f1      300 - 1000 Hz       first formant: high for open vowels
+ *      f2      1000 - 2500 Hz      second formant: high for spread vowels, low for round ones
+ *      high    2500 - 8000 Hz      fricatives
+ *
+ * and the spectral centroid below 2500 Hz.
+ *
+ * Frames are independent, so a clip can be split into runs of frames analyzed on
+ * different threads. Each thread needs its own SpectrumAnalyzer.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SPECTRUM_ANALYZER_H
+#define _TPP_SPECTRUM_ANALYZER_H
+
+#include <complex>
+#include <map>
+#include <vector>
+
+#define FRAME_WINDOW_MS 32              // the FFT is the largest power of 2 up to this long
+
+struct FrameFeatures {
+    float level;                        // rectified average over the hop, full scale = 1
+    float low, f1, f2, high;            // band energies
+    float centroidHz;
+};
+
+class SpectrumAnalyzer {
+
+    public:
+        static int fftSizeFor(int sampleRate);
+        void analyze(const std::vector<float> &samples, int sampleRate, int hopSamples,
+                     size_t firstFrame, size_t numFrames, FrameFeatures *out);
+
+    private:
+        struct Plan {
+            std::vector<int> reversed;              // bit reversed index
+            std::vector<std::complex<float>> twiddle;
+            std::vector<float> window;
+        };
+        const Plan &planFor(int size);
+        void fft(const Plan &plan, std::vector<std::complex<float>> &data);
+
+        std::map<int, Plan> plans_;
+        std::vector<std::complex<float>> buffer_;
+
+};
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * VisemeGen.cpp
+ *
+ * Team Practical Project viseme track generator
+ *
+ * Makes the envelope track and the viseme (mouth shape) track for each clip in a
+ * library of .wav files, for the firmware to play with the clip: the envelope on the
+ * jaw as now, and the visemes on spare PCA9685 channels for the lips. See VisemeTrack.h
+ * for the shapes and SpectrumAnalyzer.h for the analysis.
+ *
+ * The work is spread over all the cores. Each clip is cut into blocks of FRAMES_PER_JOB
+ * frames, and worker threads take blocks from every clip in turn, so one long clip
+ * doesn't leave the other cores idle. The thread that finishes the last block of a clip
+ * builds and writes its tracks. At the end the throughput is reported: seconds of audio
+ * analyzed per second, and how busy each thread was.
+ *
+ * Usage
+ *      visemegen [--out DIR] [--threads N] [--hop-ms 10] [--env-gain 4] [--silence-db 45]
+ *                [--verbose] FILE.wav|DIR...
+ *
+ * A folder means every .wav file in it. Writes DIR/NAME_tracks.h for each clip, by
+ * default next to the .wav. Exits with 1 if any clip couldn't be read or written.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <SpectrumAnalyzer.h>
+#include <VisemeTrack.h>
+#include <WavFile.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define FRAMES_PER_JOB 256
+
+struct Clip {
+    std::string path;
+    std::string name;               // file name less .wav
+    WavFile wav;
+    int hopSamples = 0;
+    std::vector<FrameFeatures> frames;
+    std::atomic<int> jobsLeft{0};
+    ClipTracks tracks;
+    bool written = false;
+};
+
+struct Job {
+    Clip *clip;
+    size_t firstFrame;
+    size_t numFrames;
+};
+
+struct Worker {
+    std::thread thread;
+    double busySeconds = 0;
+    size_t frames = 0;
+};
+
+static TrackSettings settings_;
+static std::string outDir_;
+static bool verbose_ = false;
+static std::mutex printMutex_;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool endsWith(const std::string &text, const std::string &end) {
+    return text.size() >= end.size() && strcasecmp(text.c_str() + text.size() - end.size(), end.c_str()) == 0;
+}
+
+/* ----- addPath -----
+ * A .wav file, or every .wav file in a folder, sorted
+ */
+static bool addPath(const std::string &path, std::vector<std::string> &files) {
+
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        fprintf(stderr, "can't find %s\n", path.c_str());
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        files.push_back(path);
+        return true;
+    }
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL) {
+        fprintf(stderr, "can't read %s\n", path.c_str());
+        return false;
+    }
+    std::vector<std::string> found;
+    while (struct dirent *entry = readdir(dir)) {
+        if (endsWith(entry->d_name, ".wav")) {
+            found.push_back(path + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+    return true;
+
+}
+
+/* ----- finishClip -----
+ * Builds and writes the tracks of a clip whose frames are all analyzed
+ */
+static void finishClip(Clip &clip) {
+
+    buildTracks(clip.frames, settings_, clip.tracks);
+    std::string dir = outDir_;
+    if (dir.empty()) {
+        size_t slash = clip.path.find_last_of('/');
+        dir = (slash == std::string::npos) ? "." : clip.path.substr(0, slash);
+    }
+    std::string out = dir + "/" + clip.name + "_tracks.h";
+    clip.written = writeTracks(clip.tracks, clip.name, clip.path.substr(clip.path.find_last_of('/') + 1),
+                               clip.wav.getSeconds(), out);
+
+    std::lock_guard<std::mutex> lock(printMutex_);
+    if (!clip.written) {
+        fprintf(stderr, "can't write %s\n", out.c_str());
+    } else if (verbose_) {
+        printf("%s: %zu visemes\n", out.c_str(), clip.tracks.visemes.size());
+        for (const VisemeChange &change : clip.tracks.visemes) {
+            printf("    %7u ms  %s\n", change.startMS, visemeName(change.shape));
+        }
+    }
+
+}
+
+static void workerThread(Worker *worker, std::vector<Job> *jobs, std::atomic<size_t> *nextJob) {
+
+    SpectrumAnalyzer analyzer;
+    for (;;) {
+        size_t index = (*nextJob)++;
+        if (index >= jobs->size()) {
+            return;
+        }
+        const Job &job = (*jobs)[index];
+        auto start = std::chrono::steady_clock::now();
+        Clip &clip = *job.clip;
+        analyzer.analyze(clip.wav.samples, clip.wav.sampleRate, clip.hopSamples,
+                         job.firstFrame, job.numFrames, &clip.frames[job.firstFrame]);
+        worker->frames += job.numFrames;
+        if (--clip.jobsLeft == 0) {
+            finishClip(clip);
+        }
+        worker->busySeconds += secondsSince(start);
+    }
+
+}
+
+static int usage() {
+
+    fprintf(stderr, "usage: visemegen [--out DIR] [--threads N] [--hop-ms 10] [--env-gain 4] [--silence-db 45]\n"
+                    "                 [--verbose] FILE.wav|DIR...\n");
+    return 2;
+
+}
+
+int main(int argc, char **argv) {
+
+    int numThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+        if (strcmp(arg, "--out") == 0) {
+            outDir_ = value;
+            i++;
+        } else if (strcmp(arg, "--threads") == 0 && atoi(value) > 0) {
+            numThreads = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--hop-ms") == 0 && atoi(value) > 0) {
+            settings_.hopMS = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--env-gain") == 0 && atof(value) > 0) {
+            settings_.envelopeGain = (float)atof(value);
+            i++;
+        } else if (strcmp(arg, "--silence-db") == 0 && atof(value) > 0) {
+            settings_.silenceDB = (float)atof(value);
+            i++;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            verbose_ = true;
+        } else if (arg[0] == '-') {
+            return usage();
+        } else if (!addPath(arg, files)) {
+            return 1;
+        }
+    }
+    if (files.empty()) {
+        return usage();
+    }
+
+    // read the library
+    auto readStart = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Clip>> clips;
+    int failed = 0;
+    double audioSeconds = 0;
+    for (const std::string &path : files) {
+        std::unique_ptr<Clip> clip(new Clip);
+        std::string error;
+        if (!wavRead(path, clip->wav, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            failed++;
+            continue;
+        }
+        clip->path = path;
+        std::string file = path.substr(path.find_last_of('/') + 1);
+        clip->name = endsWith(file, ".wav") ? file.substr(0, file.size() - 4) : file;
+        clip->hopSamples = std::max(1, clip->wav.sampleRate * settings_.hopMS / 1000);
+        clip->frames.resize((clip->wav.samples.size() + clip->hopSamples - 1) / clip->hopSamples);
+        audioSeconds += clip->wav.getSeconds();
+        clips.push_back(std::move(clip));
+    }
+    double readSeconds = secondsSince(readStart);
+
+    // blocks of frames, taken from each clip in turn
+    std::vector<Job> jobs;
+    for (size_t first = 0; ; first += FRAMES_PER_JOB) {
+        bool any = false;
+        for (auto &clip : clips) {
+            if (first < clip->frames.size()) {
+                jobs.push_back({clip.get(), first, std::min((size_t)FRAMES_PER_JOB, clip->frames.size() - first)});
+                clip->jobsLeft++;
+                any = true;
+            }
+        }
+        if (!any) {
+            break;
+        }
+    }
+    for (auto &clip : clips) {
+        if (clip->frames.empty()) {
+            finishClip(*clip);     // an empty clip still gets (empty) tracks
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> nextJob(0);
+    std::vector<Worker> workers(numThreads);
+    for (Worker &worker : workers) {
+        worker.thread = std::thread(workerThread, &worker, &jobs, &nextJob);
+    }
+    for (Worker &worker : workers) {
+        worker.thread.join();
+    }
+    double wallSeconds = secondsSince(start);
+
+    // report
+    printf("%-32s %6s %5s %8s  %s\n", "clip", "rate", "sec", "visemes", "time in each shape (%)");
+    size_t totalFrames = 0;
+    for (auto &clip : clips) {
+        totalFrames += clip->frames.size();
+        if (!clip->written) {
+            failed++;
+        }
+        int clipMS = std::max(1, (int)clip->frames.size() * settings_.hopMS);
+        printf("%-32s %6d %5.1f %8zu ", clip->name.c_str(), clip->wav.sampleRate, clip->wav.getSeconds(),
+               clip->tracks.visemes.size());
+        for (int s = 0; s < visemeCount; s++) {
+            printf(" %s %d", visemeName((eViseme)s), clip->tracks.shapeMS[s] * 100 / clipMS);
+        }
+        printf("\n");
+    }
+    printf("\n%zu clips, %.1f s of audio, %zu frames of %d ms in %zu jobs\n", clips.size(), audioSeconds,
+           totalFrames, settings_.hopMS, jobs.size());
+    printf("read %.3f s, analyzed in %.3f s on %d threads: %.0f x real time, %.0f frames/s\n", readSeconds,
+           wallSeconds, numThreads, audioSeconds / std::max(wallSeconds, 1e-9), totalFrames / std::max(wallSeconds, 1e-9));
+    for (size_t w = 0; w < workers.size(); w++) {
+        printf("    thread %2zu: %6zu frames, busy %3.0f%%\n", w, workers[w].frames,
+               100.0 * workers[w].busySeconds / std::max(wallSeconds, 1e-9));
+    }
+    return failed > 0 ? 1 : 0;
+
+}
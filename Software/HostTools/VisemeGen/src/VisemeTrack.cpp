@@ -0,0 +1,201 @@
+/*
+ * VisemeTrack.cpp
+ *
+ * Team Practical Project viseme track generator
+ *
+ * Envelope and viseme tracks from the frame features. See VisemeTrack.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <VisemeTrack.h>
+
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+
+#define FRICATIVE_SHARE 0.45f           // of the energy above 2500 Hz, for FV
+#define ROUND_CENTROID_HZ 450           // O has its energy below this ...
+#define ROUND_F2_RATIO 0.05f            // ... and f2 / f1 under this
+#define SPREAD_F2_RATIO 0.6f            // E has f2 / f1 over this
+
+static const char *visemeNames_[visemeCount] = {"REST", "MBP", "AI", "E", "O", "FV"};
+
+const char *visemeName(eViseme shape) {
+
+    return (shape >= 0 && shape < visemeCount) ? visemeNames_[shape] : "?";
+
+}
+
+/* ----- classify -----
+ * The shape of one frame, from its band energies
+ */
+static eViseme classify(const FrameFeatures &frame, float silence) {
+
+    float total = frame.low + frame.f1 + frame.f2 + frame.high;
+    if (total <= silence) {
+        return visemeRest;
+    }
+    if (frame.high > FRICATIVE_SHARE * total) {
+        return visemeFV;
+    }
+    float ratio = frame.f2 / (frame.f1 + 1e-12f);
+    if (frame.centroidHz < ROUND_CENTROID_HZ && ratio < ROUND_F2_RATIO) {
+        return visemeO;
+    }
+    if (ratio > SPREAD_F2_RATIO) {
+        return visemeE;
+    }
+    return visemeAI;
+
+}
+
+struct Run {
+    eViseme shape;
+    size_t frames;
+};
+
+/* ----- mergeShortRuns -----
+ * Folds runs shorter than minFrames into the run before (the one after, at the start)
+ * until none are left. MBP is short by nature and stays.
+ */
+static void mergeShortRuns(std::vector<Run> &runs, size_t minFrames) {
+
+    bool changed = true;
+    while (changed && runs.size() > 1) {
+        changed = false;
+        for (size_t i = 0; i < runs.size(); i++) {
+            if (runs[i].frames >= minFrames || runs[i].shape == visemeMBP) {
+                continue;
+            }
+            size_t into = (i > 0) ? i - 1 : i + 1;
+            runs[into].frames += runs[i].frames;
+            runs.erase(runs.begin() + i);
+            changed = true;
+            break;
+        }
+        // neighbours that now have the same shape become one run
+        for (size_t i = 1; i < runs.size(); i++) {
+            if (runs[i].shape == runs[i - 1].shape) {
+                runs[i - 1].frames += runs[i].frames;
+                runs.erase(runs.begin() + i);
+                i--;
+                changed = true;
+            }
+        }
+    }
+
+}
+
+void buildTracks(const std::vector<FrameFeatures> &frames, const TrackSettings &settings, ClipTracks &tracks) {
+
+    tracks.hopMS = settings.hopMS;
+    tracks.envelope.clear();
+    tracks.visemes.clear();
+    std::fill(tracks.shapeMS, tracks.shapeMS + visemeCount, 0);
+
+    // envelope, through the analog board's low-pass
+    float alpha = 1.0f - expf(-2.0f * (float)M_PI * ENVELOPE_CUTOFF_HZ * settings.hopMS / 1000.0f);
+    float filtered = 0;
+    float peak = 0;
+    for (const FrameFeatures &frame : frames) {
+        filtered += alpha * (frame.level - filtered);
+        tracks.envelope.push_back((uint16_t)std::min(4095.0f, filtered * 4095.0f * settings.envelopeGain + 0.5f));
+        peak = std::max(peak, frame.low + frame.f1 + frame.f2 + frame.high);
+    }
+
+    // a shape for each frame, as runs
+    float silence = peak * powf(10.0f, -settings.silenceDB / 10.0f);
+    std::vector<Run> runs;
+    for (const FrameFeatures &frame : frames) {
+        eViseme shape = classify(frame, silence);
+        if (!runs.empty() && runs.back().shape == shape) {
+            runs.back().frames++;
+        } else {
+            runs.push_back({shape, 1});
+        }
+    }
+
+    // short gaps between sounds are the lips closing
+    size_t mbpFrames = std::max(1, MBP_MAX_MS / settings.hopMS);
+    for (size_t i = 1; i + 1 < runs.size(); i++) {
+        if (runs[i].shape == visemeRest && runs[i].frames <= mbpFrames) {
+            runs[i].shape = visemeMBP;
+        }
+    }
+
+    mergeShortRuns(runs, std::max(1, VISEME_MIN_MS / settings.hopMS));
+
+    uint32_t startFrame = 0;
+    for (const Run &run : runs) {
+        tracks.visemes.push_back({startFrame * (uint32_t)settings.hopMS, run.shape});
+        tracks.shapeMS[run.shape] += (int)run.frames * settings.hopMS;
+        startFrame += (uint32_t)run.frames;
+    }
+
+}
+
+/* ----- identifier -----
+ * name made into a C identifier
+ */
+static std::string identifier(const std::string &name) {
+
+    std::string id;
+    for (char c : name) {
+        id += isalnum((unsigned char)c) ? c : '_';
+    }
+    if (id.empty() || isdigit((unsigned char)id[0])) {
+        id = "clip_" + id;
+    }
+    return id;
+
+}
+
+/* ----- writeTracks -----
+ * Writes both tracks as a C header, like env_data in AnimatronicMouthTest, ready to
+ * include in a sketch.
+ */
+bool writeTracks(const ClipTracks &tracks, const std::string &name, const std::string &source,
+                 double seconds, const std::string &path) {
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == NULL) {
+        return false;
+    }
+    std::string id = identifier(name);
+
+    fprintf(file, "// Made by visemegen from %s, %.2f s\n", source.c_str(), seconds);
+    fprintf(file, "//\n");
+    fprintf(file, "// %s_env: the envelope, one value every %d ms, scaled like analogRead() of A0.\n",
+            id.c_str(), tracks.hopMS);
+    fprintf(file, "// %s_visemes: mouth shape changes, {start ms, shape}. Shapes:\n", id.c_str());
+    fprintf(file, "//  ");
+    for (int s = 0; s < visemeCount; s++) {
+        fprintf(file, " %d %s%s", s, visemeName((eViseme)s), (s + 1 < visemeCount) ? "," : "\n");
+    }
+    fprintf(file, "\n");
+
+    fprintf(file, "const int %s_env_interval_ms = %d;\n", id.c_str(), tracks.hopMS);
+    fprintf(file, "const int %s_env_size = %d;\n", id.c_str(), (int)tracks.envelope.size());
+    fprintf(file, "const uint16_t %s_env[] =\n\t{", id.c_str());
+    for (size_t i = 0; i < tracks.envelope.size(); i++) {
+        bool lineEnd = (i % 20 == 19) && (i + 1 < tracks.envelope.size());
+        fprintf(file, "%u%s%s", tracks.envelope[i], (i + 1 < tracks.envelope.size()) ? "," : "",
+                lineEnd ? "\n\t" : "");
+    }
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "const int %s_visemes_size = %d;\n", id.c_str(), (int)tracks.visemes.size());
+    fprintf(file, "const uint32_t %s_visemes[][2] =\n\t{", id.c_str());
+    for (size_t i = 0; i < tracks.visemes.size(); i++) {
+        bool lineEnd = (i % 8 == 7) && (i + 1 < tracks.visemes.size());
+        fprintf(file, "{%u,%d}%s%s", tracks.visemes[i].startMS, tracks.visemes[i].shape,
+                (i + 1 < tracks.visemes.size()) ? "," : "", lineEnd ? "\n\t" : "");
+    }
+    fprintf(file, "};\n");
+
+    return fclose(file) == 0;
+
+}
@@ -0,0 +1,76 @@
+/*
+ * VisemeTrack.h
+ *
+ * Team Practical Project viseme track generator
+ *
+ * Turns the per frame features of a clip (see SpectrumAnalyzer.h) into the two tracks
+ * the firmware can play:
+ *
+ *  - the envelope track: one value per hop, 0 - 4095 like analogRead() of the hardware
+ *    envelope on A0. The rectified level is filtered with the same one pole low-pass
+ *    as the analog board, ENVELOPE_CUTOFF_HZ.
+ *  - the viseme track: the mouth shape, as a list of changes {start ms, shape}.
+ *
+ * Shapes, from the band energies of each frame:
+ *
+ *      REST    silence, more than silenceDB below the loudest frame of the clip
+ *      MBP     lips closed: a gap in the sound no longer than MBP_MAX_MS between sounds
+ *      AI      open: first formant strong
+ *      E       spread: second formant strong against the first
+ *      O       round: the energy low, second formant weak
+ *      FV      teeth on lip: mostly energy above 2500 Hz (f, v, s, sh)
+ *
+ * A shape has to last VISEME_MIN_MS; shorter ones are merged into the one before, as
+ * a servo can't show them anyway.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_VISEME_TRACK_H
+#define _TPP_VISEME_TRACK_H
+
+#include <SpectrumAnalyzer.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define ENVELOPE_CUTOFF_HZ 15           // about what the analog board's filter passes
+#define MBP_MAX_MS 80
+#define VISEME_MIN_MS 40
+
+enum eViseme {
+    visemeRest = 0,
+    visemeMBP,
+    visemeAI,
+    visemeE,
+    visemeO,
+    visemeFV,
+    visemeCount
+};
+
+struct VisemeChange {
+    uint32_t startMS;
+    eViseme shape;
+};
+
+struct ClipTracks {
+    int hopMS = 10;
+    std::vector<uint16_t> envelope;
+    std::vector<VisemeChange> visemes;
+    int shapeMS[visemeCount] = {0};     // time spent in each shape
+};
+
+struct TrackSettings {
+    int hopMS = 10;
+    float envelopeGain = 4;             // full scale rectified level -> 4095 * gain
+    float silenceDB = 45;
+};
+
+const char *visemeName(eViseme shape);
+void buildTracks(const std::vector<FrameFeatures> &frames, const TrackSettings &settings, ClipTracks &tracks);
+bool writeTracks(const ClipTracks &tracks, const std::string &name, const std::string &source,
+                 double seconds, const std::string &path);
+
+#endif
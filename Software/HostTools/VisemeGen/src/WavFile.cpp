@@ -0,0 +1,122 @@
+/*
+ * WavFile.cpp
+ *
+ * Team Practical Project viseme track generator
+ *
+ * .wav reader. See WavFile.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <WavFile.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdint.h>
+#include <string.h>
+
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IEEE_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+static uint32_t le32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+/* ----- sampleAt -----
+ * One sample of the given format as -1 to 1
+ */
+static float sampleAt(const uint8_t *p, int format, int bits) {
+
+    if (format == WAVE_FORMAT_IEEE_FLOAT) {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    switch (bits) {
+        case 8:
+            return (p[0] - 128) / 128.0f;          // 8 bit is unsigned
+        case 16:
+            return (int16_t)le16(p) / 32768.0f;
+        case 24:
+            return (int32_t)((p[0] << 8) | (p[1] << 16) | ((uint32_t)p[2] << 24)) / 2147483648.0f;
+        default:
+            return (int32_t)le32(p) / 2147483648.0f;
+    }
+
+}
+
+bool wavRead(const std::string &path, WavFile &wav, std::string &error) {
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "can't read " + path;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) != 0 || memcmp(&data[8], "WAVE", 4) != 0) {
+        error = path + " is not a .wav file";
+        return false;
+    }
+
+    int format = 0;
+    int blockAlign = 0;
+    const uint8_t *audio = NULL;
+    size_t audioBytes = 0;
+
+    size_t at = 12;
+    while (at + 8 <= data.size()) {
+        const uint8_t *chunk = &data[at];
+        size_t size = le32(chunk + 4);
+        size_t available = std::min(size, data.size() - at - 8);    // a truncated file keeps what it has
+        if (memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            format = le16(chunk + 8);
+            wav.channels = le16(chunk + 10);
+            wav.sampleRate = le32(chunk + 12);
+            blockAlign = le16(chunk + 20);
+            wav.bitsPerSample = le16(chunk + 22);
+            if (format == WAVE_FORMAT_EXTENSIBLE && available >= 26) {
+                format = le16(chunk + 32);      // the first two bytes of the subformat GUID
+            }
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            audio = chunk + 8;
+            audioBytes = available;
+        }
+        at += 8 + size + (size & 1);    // chunks are padded to an even size
+    }
+
+    if (format != WAVE_FORMAT_PCM && format != WAVE_FORMAT_IEEE_FLOAT) {
+        error = path + ": only PCM and float .wav files are supported";
+        return false;
+    }
+    int bytesPerSample = wav.bitsPerSample / 8;
+    bool supported = (format == WAVE_FORMAT_PCM) ? (bytesPerSample >= 1 && bytesPerSample <= 4)
+                                                 : (wav.bitsPerSample == 32);
+    if (!supported || wav.channels < 1 || wav.sampleRate <= 0 || blockAlign < wav.channels * bytesPerSample) {
+        error = path + ": unsupported sample format";
+        return false;
+    }
+    if (audio == NULL) {
+        error = path + " has no audio";
+        return false;
+    }
+
+    size_t frames = audioBytes / blockAlign;
+    wav.samples.resize(frames);
+    for (size_t i = 0; i < frames; i++) {
+        const uint8_t *frame = audio + i * blockAlign;
+        float sum = 0;
+        for (int c = 0; c < wav.channels; c++) {
+            sum += sampleAt(frame + c * bytesPerSample, format, wav.bitsPerSample);
+        }
+        wav.samples[i] = sum / wav.channels;
+    }
+    return true;
+
+}
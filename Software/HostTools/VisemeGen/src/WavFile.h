@@ -0,0 +1,31 @@
+/*
+ * WavFile.h
+ *
+ * Team Practical Project viseme track generator
+ *
+ * Reads a .wav file into mono floating point samples, -1 to 1. Takes PCM at 8, 16, 24
+ * or 32 bits and 32 bit float, plain or WAVE_FORMAT_EXTENSIBLE, any number of channels;
+ * the channels are averaged.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_WAV_FILE_H
+#define _TPP_WAV_FILE_H
+
+#include <string>
+#include <vector>
+
+struct WavFile {
+    int sampleRate = 0;
+    int channels = 0;
+    int bitsPerSample = 0;
+    std::vector<float> samples;     // mono
+
+    double getSeconds() const { return sampleRate > 0 ? (double)samples.size() / sampleRate : 0; }
+};
+
+bool wavRead(const std::string &path, WavFile &wav, std::string &error);
+
+#endif
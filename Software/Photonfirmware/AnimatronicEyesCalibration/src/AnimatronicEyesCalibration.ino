@@ -22,6 +22,8 @@
  * (cc) Share Alike - Non Commercial - Attibution
  * 2020 Bob Glicksman and Jim Schrempp
  * 
+ * v1.1 No heap. The results are printed a line at a time through strBuf instead of
+ *    building a String each loop, and version is a plain C string.
  * v1.0
  *    
  */ 
@@ -29,7 +31,7 @@
 // Original Source from:
 //  Nilheim Mechatronics Simplified Eye Mechanism Code
 
-const String version = "1.0";
+const char *version = "1.1";
  
 #include <Wire.h>
 #include <Adafruit_PWMServoDriver.h>
@@ -165,7 +167,6 @@ void loop() {
     const int TEST_MAX = 14;  // last test case in the main switch statement
     static int testNumber = TEST_MIN - 1;  // set to one less than the first test number in the switch statement
     static bool needTestSetup = false; // tells a test case to print information and initialize any servos
-    String finalOutput = "";
     int trimInput = 0; // value from the trim potentiometer
     int currentServoPosition = 0; // the position of the servo under calibration (includes trim)
 
@@ -499,24 +500,23 @@ void loop() {
           
           needTestSetup = false;
           
-          finalOutput =  "\n\nRESULTS to paste into the code:\n ";
-          finalOutput += "\n  #define X_POS_MID " + String(vX_POS_MID);
-          finalOutput += "\n  #define X_POS_LEFT_OFFSET " + String(vX_POS_LEFT_OFFSET);
-          finalOutput += "\n  #define X_POS_RIGHT_OFFSET " + String(vX_POS_RIGHT_OFFSET);
-          finalOutput += "\n";
-          finalOutput += "\n  #define Y_POS_MID " + String(vY_POS_MID);
-          finalOutput += "\n  #define Y_POS_UP_OFFSET " + String(vY_POS_UP_OFFSET);
-          finalOutput += "\n  #define Y_POS_DOWN_OFFSET " + String(vY_POS_DOWN_OFFSET);
-          finalOutput += "\n";
-          finalOutput += "\n  #define LEFT_UPPER_CLOSED " + String(vLEFT_UPPER_CLOSED);
-          finalOutput += "\n  #define LEFT_UPPER_OPEN " + String(vLEFT_UPPER_OPEN);
-          finalOutput += "\n";
-          finalOutput += "\n  #define LEFT_LOWER_CLOSED " + String(vLEFT_LOWER_CLOSED);
-          finalOutput += "\n  #define LEFT_LOWER_OPEN " + String(vLEFT_LOWER_OPEN);
-          finalOutput += "\n";
-          finalOutput += "\n  #define RIGHT_UPPER_OFFSET " + String(vRIGHT_UPPER_OFFSET);
-          finalOutput += "\n  #define RIGHT_LOWER_OFFSET " + String(vRIGHT_LOWER_OFFSET);
-          Serial.println(finalOutput);
+          Serial.println("\n\nRESULTS to paste into the code:\n ");
+          printDefine("X_POS_MID", vX_POS_MID);
+          printDefine("X_POS_LEFT_OFFSET", vX_POS_LEFT_OFFSET);
+          printDefine("X_POS_RIGHT_OFFSET", vX_POS_RIGHT_OFFSET);
+          Serial.println();
+          printDefine("Y_POS_MID", vY_POS_MID);
+          printDefine("Y_POS_UP_OFFSET", vY_POS_UP_OFFSET);
+          printDefine("Y_POS_DOWN_OFFSET", vY_POS_DOWN_OFFSET);
+          Serial.println();
+          printDefine("LEFT_UPPER_CLOSED", vLEFT_UPPER_CLOSED);
+          printDefine("LEFT_UPPER_OPEN", vLEFT_UPPER_OPEN);
+          Serial.println();
+          printDefine("LEFT_LOWER_CLOSED", vLEFT_LOWER_CLOSED);
+          printDefine("LEFT_LOWER_OPEN", vLEFT_LOWER_OPEN);
+          Serial.println();
+          printDefine("RIGHT_UPPER_OFFSET", vRIGHT_UPPER_OFFSET);
+          printDefine("RIGHT_LOWER_OFFSET", vRIGHT_LOWER_OFFSET);
 
         }
         pwm.setPWM(R_UPPERLID_SERVO, 0, currentServoPosition);
@@ -543,6 +543,15 @@ bool testHeaderPrint (const char* description, int testNumber, int trimInput) {
 
 }
 
+//---------- printDefine
+// Prints one line of the results, "  #define NAME value"
+void printDefine(const char* name, int value) {
+
+    snprintf(g.strBuf, sizeof(g.strBuf), "  #define %s %d", name, value);
+    Serial.println(g.strBuf);
+
+}
+
 //---------- buttonWasPushedBUTTON_PIN 
 // Returns true if BUTTON_PIN goes HIGH to LOW
 bool buttonWasPushedBUTTON_PIN() {
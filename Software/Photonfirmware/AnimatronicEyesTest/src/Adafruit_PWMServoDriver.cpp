@@ -32,6 +32,8 @@
 
 //#define ENABLE_DEBUG_OUTPUT
 
+Logger logI2C("app.i2c");
+
 /*!
  *  @brief  Instantiates a new PCA9685 PWM driver chip with the I2C address on a
  * TwoWire interface
@@ -76,6 +78,38 @@ void Adafruit_PWMServoDriver::begin(uint8_t prescale) {
   setOscillatorFrequency(FREQUENCY_OSCILLATOR);
 }
 
+/*!
+ *  @brief  Setups the I2C interface, and the chip only if it isn't already
+ * running at freq. After a reset of the processor the PCA9685 keeps running
+ * with the PWM it was last given, so the servos hold still; reset() and
+ * setPWMFreq() would stop every output for a moment, and take 15 ms.
+ *  @param  freq PWM frequency
+ *  @return true if the chip was already running, and its PWM registers can be
+ * read back with readPWMs()
+ */
+bool Adafruit_PWMServoDriver::warmBegin(float freq) {
+  _i2c->begin();
+  setOscillatorFrequency(FREQUENCY_OSCILLATOR);
+  if (isRunningAt(freq)) {
+    _freq = freq;
+    return true;
+  }
+  begin();
+  setPWMFreq(freq);
+  return false;
+}
+
+/*!
+ *  @brief  Whether the chip is awake, auto incrementing, and running at freq
+ *  @param  freq PWM frequency
+ *  @return true if it is
+ */
+bool Adafruit_PWMServoDriver::isRunningAt(float freq) {
+  uint8_t mode = read8(PCA9685_MODE1);
+  return (mode & (MODE1_SLEEP | MODE1_AI)) == MODE1_AI &&
+         readPrescale() == prescaleFor(freq);
+}
+
 /*!
  *  @brief  Sends a reset command to the PCA9685 chip over I2C
  */
@@ -138,18 +172,8 @@ void Adafruit_PWMServoDriver::setPWMFreq(float freq) {
   Serial.print("Attempting to set freq ");
   Serial.println(freq);
 #endif
-  // Range output modulation frequency is dependant on oscillator
-  if (freq < 1)
-    freq = 1;
-  if (freq > 3500)
-    freq = 3500; // Datasheet limit is 3052=50MHz/(4*4096)
-
-  float prescaleval = ((_oscillator_freq / (freq * 4096.0)) + 0.5) - 1;
-  if (prescaleval < PCA9685_PRESCALE_MIN)
-    prescaleval = PCA9685_PRESCALE_MIN;
-  if (prescaleval > PCA9685_PRESCALE_MAX)
-    prescaleval = PCA9685_PRESCALE_MAX;
-  uint8_t prescale = (uint8_t)prescaleval;
+  uint8_t prescale = prescaleFor(freq);
+  _freq = freq;
 
 #ifdef ENABLE_DEBUG_OUTPUT
   Serial.print("Final pre-scale: ");
@@ -206,11 +230,67 @@ uint8_t Adafruit_PWMServoDriver::readPrescale(void) {
 /*!
  *  @brief  Gets the PWM output of one of the PCA9685 pins
  *  @param  num One of the PWM output pins, from 0 to 15
- *  @return requested PWM output value
+ *  @param  off false for the ON tick, true for the OFF tick
+ *  @return requested PWM output value, with PCA9685_FULL if the output is
+ * fully on (or off). 0 if it couldn't be read.
  */
-uint8_t Adafruit_PWMServoDriver::getPWM(uint8_t num) {
-  _i2c->requestFrom((int)_i2caddr, PCA9685_LED0_ON_L + 4 * num, (int)4);
-  return _i2c->read();
+uint16_t Adafruit_PWMServoDriver::getPWM(uint8_t num, bool off) {
+  uint16_t onTick = 0;
+  uint16_t offTick = 0;
+  readPWMs(num, 1, &onTick, &offTick);
+  return off ? offTick : onTick;
+}
+
+/*!
+ *  @brief  Reads the PWM registers of count channels from first, in bursts of
+ * PCA9685_READ_CHANNELS with auto increment
+ *  @param  first The first PWM output pin, from 0 to 15
+ *  @param  count How many
+ *  @param  on Where to put the ON ticks, or NULL
+ *  @param  off Where to put the OFF ticks, or NULL
+ *  @return false if the I2C bus failed; the ticks not read are 0
+ */
+bool Adafruit_PWMServoDriver::readPWMs(uint8_t first, uint8_t count,
+                                       uint16_t *on, uint16_t *off) {
+  count = min(count, (uint8_t)(PCA9685_CHANNELS - min(first, (uint8_t)PCA9685_CHANNELS)));
+  for (uint8_t c = 0; c < count; c++) {
+    if (on != NULL)
+      on[c] = 0;
+    if (off != NULL)
+      off[c] = 0;
+  }
+
+  for (uint8_t done = 0; done < count;) {
+    uint8_t channels = min((uint8_t)(count - done), (uint8_t)PCA9685_READ_CHANNELS);
+    if (!busReady()) {
+      return false;
+    }
+    uint32_t start = micros();
+    _i2c->beginTransmission(_i2caddr);
+    _i2c->write(PCA9685_LED0_ON_L + 4 * (first + done));
+    if (!transactionDone(_i2c->endTransmission(), start, 2)) {
+      return false;
+    }
+    start = micros();
+    uint8_t bytes = 4 * channels;
+    uint8_t got = _i2c->requestFrom((uint8_t)_i2caddr, bytes);
+    if (!transactionDone((got == bytes) ? 0 : PCA9685_I2C_NACK, start,
+                         1 + bytes)) {
+      return false;
+    }
+    for (uint8_t c = done; c < done + channels; c++) {
+      uint16_t onTick = _i2c->read();
+      onTick |= _i2c->read() << 8;
+      uint16_t offTick = _i2c->read();
+      offTick |= _i2c->read() << 8;
+      if (on != NULL)
+        on[c] = onTick & 0x1FFF;
+      if (off != NULL)
+        off[c] = offTick & 0x1FFF;
+    }
+    done += channels;
+  }
+  return true;
 }
 
 /*!
@@ -229,13 +309,23 @@ void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
   Serial.println(off);
 #endif
 
+  if (num < PCA9685_CHANNELS) {
+    _shadowOn[num] = on;
+    _shadowOff[num] = off;
+    _shadowSet |= 1 << num;
+  }
+  if (!busReady()) {
+    return;
+  }
+
+  uint32_t start = micros();
   _i2c->beginTransmission(_i2caddr);
   _i2c->write(PCA9685_LED0_ON_L + 4 * num);
   _i2c->write(on);
   _i2c->write(on >> 8);
   _i2c->write(off);
   _i2c->write(off >> 8);
-  _i2c->endTransmission();
+  transactionDone(_i2c->endTransmission(), start, 6);
 }
 
 /*!
@@ -342,19 +432,170 @@ void Adafruit_PWMServoDriver::setOscillatorFrequency(uint32_t freq) {
   _oscillator_freq = freq;
 }
 
+/*!
+ *  @brief  Formats the I2C error counters for a cloud variable
+ *  @param  buffer Where to put them
+ *  @param  bufferSize Size of buffer
+ *  @return The length of the string
+ */
+int Adafruit_PWMServoDriver::healthReport(char *buffer, int bufferSize) {
+  int len = snprintf(
+      buffer, bufferSize,
+      "i2c 0x%02x%s: %lu sent, %lu nack, %lu timeout, %lu skipped, %lu "
+      "recovered (last %lu us), slowest %lu us",
+      _i2caddr, _busDown ? " down" : "", (unsigned long)_health.transactions,
+      (unsigned long)_health.nacks, (unsigned long)_health.timeouts,
+      (unsigned long)_health.skipped, (unsigned long)_health.recoveries,
+      (unsigned long)_health.recoveryMicros,
+      (unsigned long)_health.slowestMicros);
+  return min(len, bufferSize - 1);
+}
+
+/******************* Bus health */
+
+/*!
+ *  @brief  Whether a transaction may be sent. While the bus is down, runs a
+ * recovery once every PCA9685_I2C_RECOVERY_BACKOFF_MS and skips transactions
+ * in between, so a dead bus costs no time.
+ *  @return true if the bus is up
+ */
+bool Adafruit_PWMServoDriver::busReady() {
+  if (!_busDown || _recovering) {
+    return true;
+  }
+  if (millis() - _lastRecoveryMS >= PCA9685_I2C_RECOVERY_BACKOFF_MS ||
+      _health.recoveries == 0) {
+    recover();
+  }
+  if (_busDown) {
+    _health.skipped++;
+    return false;
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Counts a finished transaction. After PCA9685_I2C_FAILS_TO_RECOVER
+ * failures in a row the bus is taken down, to be recovered as soon as the
+ * backoff allows.
+ *  @param  error What endTransmission() returned, or PCA9685_I2C_NACK if too
+ * few bytes were read
+ *  @param  startMicros micros() when the transaction began
+ *  @param  bytes Bytes on the bus, the address byte too. The time allowed is
+ * PCA9685_I2C_SLOW_US plus PCA9685_I2C_BYTE_US for each.
+ *  @return true if it succeeded
+ */
+bool Adafruit_PWMServoDriver::transactionDone(uint8_t error,
+                                              uint32_t startMicros,
+                                              uint8_t bytes) {
+  uint32_t took = micros() - startMicros;
+  _health.transactions++;
+  if (took > _health.slowestMicros) {
+    _health.slowestMicros = took;
+  }
+  if (error == 0 &&
+      took > PCA9685_I2C_SLOW_US + (uint32_t)bytes * PCA9685_I2C_BYTE_US) {
+    error = PCA9685_I2C_SLOW;
+  }
+  if (error == 0) {
+    _failsInARow = 0;
+    return true;
+  }
+
+  if (error == PCA9685_I2C_NACK) {
+    _health.nacks++;
+  } else {
+    _health.timeouts++;
+  }
+  if (_failsInARow < 255) {
+    _failsInARow++;
+  }
+  if (_failsInARow == PCA9685_I2C_FAILS_TO_RECOVER && !_recovering) {
+    logI2C.error("i2c 0x%02x failing, error %d", _i2caddr, error);
+    _busDown = true;
+    busReady();
+  }
+  return false;
+}
+
+/*!
+ *  @brief  Frees and restarts the bus, then puts the PCA9685 back as it was:
+ * restarted at the last PWM frequency (PCA9685_SERVO_FREQ if none was set, as
+ * the reset prescale would put every pulse width out), and every channel set
+ * from the shadow copy. Wire.reset() clocks SCL until a device holding SDA low
+ * lets go, and restarts the I2C peripheral. Takes about 16 ms, most of it the
+ * PCA9685 restart.
+ */
+void Adafruit_PWMServoDriver::recover() {
+  uint32_t start = micros();
+  _recovering = true;
+  _lastRecoveryMS = millis();
+  _health.recoveries++;
+
+  _i2c->reset();
+  _failsInARow = 0;
+  reset();
+  setPWMFreq((_freq > 0) ? _freq : PCA9685_SERVO_FREQ);
+  for (int num = 0; num < PCA9685_CHANNELS; num++) {
+    if (_shadowSet & (1 << num)) {
+      setPWM(num, _shadowOn[num], _shadowOff[num]);
+    }
+  }
+
+  _busDown = (_failsInARow > 0);
+  _recovering = false;
+  _health.recoveryMicros = micros() - start;
+  if (_busDown) {
+    logI2C.error("i2c 0x%02x recovery failed, next in %d ms", _i2caddr,
+                 PCA9685_I2C_RECOVERY_BACKOFF_MS);
+  } else {
+    logI2C.warn("i2c 0x%02x recovered in %lu us", _i2caddr,
+                (unsigned long)_health.recoveryMicros);
+  }
+}
+
 /******************* Low level I2C interface */
+uint8_t Adafruit_PWMServoDriver::prescaleFor(float freq) {
+  // Range output modulation frequency is dependant on oscillator
+  if (freq < 1)
+    freq = 1;
+  if (freq > 3500)
+    freq = 3500; // Datasheet limit is 3052=50MHz/(4*4096)
+
+  float prescaleval = ((_oscillator_freq / (freq * 4096.0)) + 0.5) - 1;
+  if (prescaleval < PCA9685_PRESCALE_MIN)
+    prescaleval = PCA9685_PRESCALE_MIN;
+  if (prescaleval > PCA9685_PRESCALE_MAX)
+    prescaleval = PCA9685_PRESCALE_MAX;
+  return (uint8_t)prescaleval;
+}
+
 uint8_t Adafruit_PWMServoDriver::read8(uint8_t addr) {
+  if (!busReady()) {
+    return 0;
+  }
+  uint32_t start = micros();
   _i2c->beginTransmission(_i2caddr);
   _i2c->write(addr);
-  _i2c->endTransmission();
+  if (!transactionDone(_i2c->endTransmission(), start, 2)) {
+    return 0;
+  }
 
-  _i2c->requestFrom((uint8_t)_i2caddr, (uint8_t)1);
+  start = micros();
+  uint8_t got = _i2c->requestFrom((uint8_t)_i2caddr, (uint8_t)1);
+  if (!transactionDone((got == 1) ? 0 : PCA9685_I2C_NACK, start, 2)) {
+    return 0;
+  }
   return _i2c->read();
 }
 
 void Adafruit_PWMServoDriver::write8(uint8_t addr, uint8_t d) {
+  if (!busReady()) {
+    return;
+  }
+  uint32_t start = micros();
   _i2c->beginTransmission(_i2caddr);
   _i2c->write(addr);
   _i2c->write(d);
-  _i2c->endTransmission();
-}
\ No newline at end of file
+  transactionDone(_i2c->endTransmission(), start, 3);
+}
@@ -68,9 +68,46 @@
 #define PCA9685_PRESCALE_MIN 3   /**< minimum prescale value */
 #define PCA9685_PRESCALE_MAX 255 /**< maximum prescale value */
 
+#define PCA9685_CHANNELS 16 /**< PWM outputs */
+#define PCA9685_SERVO_FREQ                                                     \
+  60 /**< analog servo PWM frequency, restored by recover() if none was set */
+#define PCA9685_FULL 0x1000   /**< LEDn_ON/OFF bit 12: output fully on/off */
+#define PCA9685_READ_CHANNELS                                                  \
+  8 /**< channels read in one burst, 32 bytes: the Wire receive buffer */
+
+// I2C health
+#define PCA9685_I2C_SLOW_US                                                    \
+  2000 /**< a transaction longer than this, plus PCA9685_I2C_BYTE_US a byte,   \
+          counts as a timeout */
+#define PCA9685_I2C_BYTE_US                                                    \
+  100 /**< time allowed per byte: 9 bits at 100 kHz, the Photon's default */
+#define PCA9685_I2C_FAILS_TO_RECOVER                                           \
+  3 /**< transactions failed in a row before the bus is recovered */
+#define PCA9685_I2C_RECOVERY_BACKOFF_MS                                        \
+  1000 /**< least time between recoveries; transactions are skipped between */
+#define PCA9685_I2C_NACK                                                       \
+  3 /**< endTransmission(): end of address timeout, the device didn't answer */
+#define PCA9685_I2C_SLOW 0xFF /**< succeeded, but slower than allowed */
+
+/*!
+ *  @brief  I2C error counters for one PCA9685
+ */
+struct PCA9685_I2CHealth {
+  uint32_t transactions;  ///< I2C transactions attempted
+  uint32_t nacks;         ///< not answered, or fewer bytes read than asked for
+  uint32_t timeouts;      ///< bus timeouts, or slower than PCA9685_I2C_SLOW_US
+  uint32_t skipped;       ///< not sent, the bus was down waiting for recovery
+  uint32_t recoveries;    ///< bus recoveries run
+  uint32_t slowestMicros; ///< the longest transaction
+  uint32_t recoveryMicros; ///< how long the last recovery took
+};
+
 /*!
  *  @brief  Class that stores state and functions for interacting with PCA9685
- * PWM chip
+ * PWM chip. Every I2C transaction is checked and timed, and the errors counted
+ * (getHealth(), healthReport()). When transactions keep failing the bus is
+ * recovered: freed, the PCA9685 restarted and every channel set again from a
+ * shadow copy of what it was last set to.
  */
 class Adafruit_PWMServoDriver {
 public:
@@ -78,13 +115,16 @@ public:
   Adafruit_PWMServoDriver(const uint8_t addr);
   Adafruit_PWMServoDriver(const uint8_t addr, TwoWire &i2c);
   void begin(uint8_t prescale = 0);
+  bool warmBegin(float freq);
+  bool isRunningAt(float freq);
   void reset();
   void sleep();
   void wakeup();
   void setExtClk(uint8_t prescale);
   void setPWMFreq(float freq);
   void setOutputMode(bool totempole);
-  uint8_t getPWM(uint8_t num);
+  uint16_t getPWM(uint8_t num, bool off = false);
+  bool readPWMs(uint8_t first, uint8_t count, uint16_t *on, uint16_t *off);
   void setPWM(uint8_t num, uint16_t on, uint16_t off);
   void setPin(uint8_t num, uint16_t val, bool invert = false);
   uint8_t readPrescale(void);
@@ -93,6 +133,10 @@ public:
   void setOscillatorFrequency(uint32_t freq);
   uint32_t getOscillatorFrequency(void);
 
+  PCA9685_I2CHealth getHealth() { return _health; }
+  bool isBusDown() { return _busDown; }
+  int healthReport(char *buffer, int bufferSize);
+
 private:
   uint8_t _i2caddr;
   TwoWire *_i2c;
@@ -100,6 +144,23 @@ private:
   uint32_t _oscillator_freq;
   uint8_t read8(uint8_t addr);
   void write8(uint8_t addr, uint8_t d);
+  uint8_t prescaleFor(float freq);
+
+  bool busReady();
+  bool transactionDone(uint8_t error, uint32_t startMicros, uint8_t bytes);
+  void recover();
+
+  PCA9685_I2CHealth _health = {0, 0, 0, 0, 0, 0, 0};
+  uint8_t _failsInARow = 0;
+  bool _busDown = false;    // waiting to be recovered
+  bool _recovering = false; // in recover()
+  uint32_t _lastRecoveryMS = 0;
+  float _freq = 0; // last setPWMFreq(), restored by recover(); 0 for none
+
+  // shadow copy of what each channel was last set to, restored by recover()
+  uint16_t _shadowOn[PCA9685_CHANNELS];
+  uint16_t _shadowOff[PCA9685_CHANNELS];
+  uint16_t _shadowSet = 0; // bit n: channel n has been set
 };
 
 #endif
\ No newline at end of file
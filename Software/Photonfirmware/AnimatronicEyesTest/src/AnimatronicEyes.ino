@@ -14,6 +14,41 @@
  * (cc) Share Alike - Non Commercial - Attibution
  * 2020 Bob Glicksman and Jim Schrempp
  * 
+ * v1.13 Timer wheel. What happens later (the next scene, the end of the idle wait,
+ *      the wear report and save) is a timer on one TPP_TimerWheel that calls back
+ *      when it is due, instead of a millis() compared every loop, and none of them
+ *      go wrong when millis() wraps.
+ * v1.12 Metrics. Counters, gauges and histograms from the libraries and the sketch (servo
+ *      moves, scene lateness, frame times, I2C errors, show cues ...) in one registry.
+ *      The "metrics" control variable has them as Prometheus text, "metricsBinary" as
+ *      compact binary; pass the page to start at.
+ * v1.11 Local control. The cloud functions and variables, and a few more, can be called
+ *      and read over UDP on CONTROL_PORT from a PC on the same network
+ *      (HostTools/PuppetControl), in a few ms and with no internet. The "attention"
+ *      function acts like A5.
+ * v1.10 I2C health. The servo board driver checks and times every I2C transaction,
+ *      and recovers a hung bus: frees it, restarts the PCA9685 and sets every servo
+ *      again. The "i2c" cloud variable has the error counters, and each recovery is
+ *      published as "i2c recovered".
+ * v1.9 Asset pack. Servo settings come from the asset pack (assetpack.cpp, made by
+ *      HostTools/AssetPack) when it has them, and eyeservosettings.h when it doesn't.
+ *      The "sequence" cloud function runs a sequence from the pack by name.
+ * v1.8 Static arena. The scene list and the show cue queue are reserved from one arena
+ *      of ARENA_BYTES during setup(), and nothing is allocated after it. The "memory"
+ *      cloud variable reports each block's size, use and high-water mark.
+ * v1.7 Frame budget. When loop() runs over FRAME_BUDGET_US, optional work is given up in
+ *      order (wear statistics, telemetry, micro-motion, servo trace logging) until it
+ *      fits again, so the servos keep stepping on time. See the "frameBudget" cloud variable.
+ * v1.6 Micro-motion. While open, the eyes and lids wander a little all the time on top of
+ *      the sequences. Set with the "microMotion" cloud function: "EYE% LID% HZ", or "off".
+ * v1.5 Smooth pursuit. A stream of pursue cues from the show controller makes the eyes
+ *      follow a moving target instead of moving point to point. Servo moves keep their
+ *      velocity when a new move is given before the last one finished.
+ * v1.4 Show control. Cues from the show controller on a PC (HostTools/ShowControl) arrive
+ *      over UDP on SHOW_PORT and run at a time synced with the other puppets in the show.
+ *      An attention cue acts like A5.
+ * v1.3 Servo wear counters. Reported in the "servoWear" cloud variable and saved to
+ *      EEPROM every WEAR_SAVE_INTERVAL_MS.
  * v1.2 Added control on pin A5. A5 going HIGH terminates current sequence and starts a more
  *      attentive sequence. When A5 going LOW should sleep the eyes for five seconds, then return
  *      to normal activity.
@@ -23,7 +58,7 @@
  */ 
 
 
-const String version = "1.2";
+const char *version = "1.13";
  
 //SYSTEM_MODE(MANUAL);
 SYSTEM_THREAD(ENABLED);  // added this in an attempt to get the software timer to work. didn't help
@@ -31,28 +66,86 @@ SYSTEM_THREAD(ENABLED);  // added this in an attempt to get the software timer t
 #include <Wire.h>
 #include <TPPAnimationList.h>
 #include <TPPAnimatePuppet.h>
+#include <TPPShowLink.h>
+#include <TPPControlLink.h>
+#include <TPPMetrics.h>
+#include <TPPTimerWheel.h>
+#include <TPPFrameBudget.h>
+#include <TPPArena.h>
+#include <TPPAssetPack.h>
 #include <eyeservosettings.h>
 
 #define CALLIBRATION_TEST 
 #define DEBUGON
 #define TRIGGER_PIN A5
-
-const long IDLE_SEQUENCE_MIN_WAIT_MS = 120000; //2 min // during idle times, random activity will happen longer than this
+#define SHOW_PORT SHOW_DEFAULT_PORT
+#define CONTROL_PORT CONTROL_DEFAULT_PORT
+
+const unsigned long IDLE_SEQUENCE_MIN_WAIT_MS = 120000; //2 min // during idle times, random activity will happen longer than this
+const unsigned long WEAR_REPORT_INTERVAL_MS = 10000;  // how often the servoWear cloud variable is refreshed
+const unsigned long WEAR_SAVE_INTERVAL_MS = 1800000;  // 30 min // how often servo wear counters are saved to EEPROM
+const unsigned long WEAR_SAVE_RETRY_MS = 1000;  // when loop() was too busy to save them
+const float MICRO_EYE_PERCENT = 4.0;    // how far the eyeballs wander, % of their travel
+const float MICRO_LID_PERCENT = 6.0;    // how far the lids wander, % of their travel
+const float MICRO_HZ = 0.5;             // how fast they wander
+const unsigned long FRAME_BUDGET_US = 5000;   // longest loop() before optional work is shed
+
+// optional work, in the order it is given up when loop() runs over FRAME_BUDGET_US
+enum eOptionalJob {
+    jobStatistics = 1,      // servo wear report and saving
+    jobTelemetry,           // publishing the idle options
+    jobMicroMotion,
+    jobTracing,             // trace logging of every servo move
+    numOptionalJobs = jobTracing
+};
+
+char wearReport[622];  // cloud variable holding the servo wear counters, the most a string variable holds
+char budgetReport[200];  // cloud variable holding the frame budget counters
+char memoryReport[200];  // cloud variable holding the arena blocks and high-water marks
+char i2cReport[160];  // cloud variable holding the servo board's I2C error counters
 
 SerialLogHandler logHandler1(LOG_LEVEL_INFO, {  // Logging level for non-application messages LOG_LEVEL_ALL or _INFO
     { "app.main", LOG_LEVEL_ALL }               // Logging for main loop
     ,{ "app.puppet", LOG_LEVEL_INFO }               // Logging for Animate puppet methods
     ,{ "app.anilist", LOG_LEVEL_ERROR }               // Logging for Animation List methods
     ,{ "app.aniservo", LOG_LEVEL_INFO }          // Logging for Animate Servo details
+    ,{ "app.show", LOG_LEVEL_INFO }              // Logging for show control cues
+    ,{ "app.control", LOG_LEVEL_INFO }           // Logging for local control requests
+    ,{ "app.metrics", LOG_LEVEL_INFO }           // Logging for the metrics registry
+    ,{ "app.i2c", LOG_LEVEL_INFO }               // Logging for I2C errors and recoveries
+    ,{ "app.budget", LOG_LEVEL_INFO }            // Logging for frame budget levels
+    ,{ "app.arena", LOG_LEVEL_INFO }             // Logging for memory reserved at startup
+    ,{ "app.assets", LOG_LEVEL_INFO }            // Logging for the asset pack
     ,{"comm.protocol", LOG_LEVEL_WARN}          // particle communication system 
 });
 
 Logger mainLog("app.main");
 
+TPP_Arena arena;           // all the memory the libraries use, reserved in setup()
+TPP_AssetPack assets;      // settings and sequences, read in place from flash
+
+extern const uint8_t assetPackData[];   // from assetpack.cpp
+extern const uint32_t assetPackSize;
+
+// a servo setting from the asset pack, or the #define in eyeservosettings.h
+#define SETTING(name) assets.getSetting(#name, name)
+
 // This is the master class that holds all the objects to be controlled
 animationList animation1;  // When doing a programmed animation, this is the list of
                            // scenes and when they are to be played
 
+TPP_ShowLink showLink;     // cues from the show controller
+TPP_ControlLink controlLink;  // cloud functions and variables, on the local network
+TPP_Metrics metrics;       // counters, gauges and histograms for the control client
+TPP_Counter triggerMetric;     // A5 or show attention triggers
+TPP_Counter idleMetric;        // idle sequences started
+TPP_FrameBudget frameBudget;  // sheds optional work when loop() runs long
+TPP_TimerWheel timers;     // everything that is to happen later
+TPP_Timer idleTimer;       // runs out when an idle sequence may start
+TPP_Timer reportTimer;     // refreshes the report cloud variables
+TPP_Timer wearSaveTimer;   // saves the servo wear counters
+bool showAttention = false;  // set by a show cue, acts like A5 being high
+
 
 // Servo Numbers for the Servo Driver board
 #define X_SERVO 0
@@ -93,10 +186,12 @@ int midValue(int value1, int value2) {
 // when called from a timer it crashes
 void animationTimerCallback() {
 
-    // now have animation pass this on to all the servos it manages
+    // now have animation pass this on to all the servos it manages, after
+    // running what is due on the timer wheel, the next scene among them
     volatile static bool inCall = false;
     if (!inCall) {
         inCall = true;
+        timers.process();
         animation1.process();
         inCall = false;
     }
@@ -107,19 +202,53 @@ void setup() {
 
     pinMode(TRIGGER_PIN, INPUT);
 
+    Particle.variable("servoWear", wearReport);
+    Particle.variable("frameBudget", budgetReport);
+    Particle.variable("memory", memoryReport);
+    Particle.variable("i2c", i2cReport);
+    Particle.function("microMotion", setMicroMotion);
+    Particle.function("sequence", playSequence);
+
+    animation1.begin(arena, timers);
+    showLink.begin(SHOW_PORT, arena);
+    controlLink.begin(CONTROL_PORT, arena);
+
+    // the same, and what there is no room for in the cloud, on the local network
+    controlLink.variable("servoWear", wearReport);
+    controlLink.variable("frameBudget", budgetReport);
+    controlLink.variable("memory", memoryReport);
+    controlLink.variable("i2c", i2cReport);
+    controlLink.function("microMotion", setMicroMotion);
+    controlLink.function("sequence", playSequence);
+    controlLink.function("attention", setAttention);
+    controlLink.variable("metrics", metricsText);
+    controlLink.variable("metricsBinary", metricsBinary);
+
+    // what the libraries and the sketch count
+    TPP_AnimateServo::registerMetrics(metrics);
+    animation1.registerMetrics(metrics);
+    frameBudget.registerMetrics(metrics);
+    registerMetrics();
+    frameBudget.begin(FRAME_BUDGET_US, numOptionalJobs);
+
     delay(1000);
     mainLog.info("===========================================");
     mainLog.info("===========================================");
     mainLog.info("Animate Eye Mechanism");
     
-    animation1.puppet.eyeballs.init(X_SERVO,X_POS_MID,X_POS_LEFT_OFFSET,X_POS_RIGHT_OFFSET,
-            Y_SERVO, Y_POS_MID, Y_POS_UP_OFFSET, Y_POS_DOWN_OFFSET);
+    assets.begin(assetPackData, assetPackSize);
 
-    animation1.puppet.eyelidLeftUpper.init(L_UPPERLID_SERVO, LEFT_UPPER_OPEN, LEFT_UPPER_CLOSED);
-    animation1.puppet.eyelidLeftLower.init(L_LOWERLID_SERVO, LEFT_LOWER_OPEN, LEFT_LOWER_CLOSED);
-    animation1.puppet.eyelidRightUpper.init(R_UPPERLID_SERVO, RIGHT_UPPER_OFFSET - LEFT_UPPER_OPEN, RIGHT_UPPER_OFFSET - LEFT_UPPER_CLOSED);
-    animation1.puppet.eyelidRightLower.init(R_LOWERLID_SERVO, RIGHT_LOWER_OFFSET - LEFT_LOWER_OPEN, RIGHT_LOWER_OFFSET - LEFT_LOWER_CLOSED);
+    animation1.puppet.eyeballs().init(X_SERVO, SETTING(X_POS_MID), SETTING(X_POS_LEFT_OFFSET), SETTING(X_POS_RIGHT_OFFSET),
+            Y_SERVO, SETTING(Y_POS_MID), SETTING(Y_POS_UP_OFFSET), SETTING(Y_POS_DOWN_OFFSET));
 
+    animation1.puppet.eyelidLeftUpper().init(L_UPPERLID_SERVO, SETTING(LEFT_UPPER_OPEN), SETTING(LEFT_UPPER_CLOSED));
+    animation1.puppet.eyelidLeftLower().init(L_LOWERLID_SERVO, SETTING(LEFT_LOWER_OPEN), SETTING(LEFT_LOWER_CLOSED));
+    animation1.puppet.eyelidRightUpper().init(R_UPPERLID_SERVO, SETTING(RIGHT_UPPER_OFFSET) - SETTING(LEFT_UPPER_OPEN),
+            SETTING(RIGHT_UPPER_OFFSET) - SETTING(LEFT_UPPER_CLOSED));
+    animation1.puppet.eyelidRightLower().init(R_LOWERLID_SERVO, SETTING(RIGHT_LOWER_OFFSET) - SETTING(LEFT_LOWER_OPEN),
+            SETTING(RIGHT_LOWER_OFFSET) - SETTING(LEFT_LOWER_CLOSED));
+
+    animation1.puppet.setMicroMotion(MICRO_EYE_PERCENT, MICRO_LID_PERCENT, MICRO_HZ);
 
     // Establish Animation List
 
@@ -136,6 +265,17 @@ void setup() {
     //sequenceGeneralTests();
     sequenceLookReal();
     sequenceAsleep(1000);
+
+    // everything is reserved; nothing is allocated from here on
+    arena.seal();
+    arena.report(memoryReport, sizeof(memoryReport));
+    frameBudget.report(budgetReport, sizeof(budgetReport));
+    TPP_AnimateServo::i2cReport(i2cReport, sizeof(i2cReport));
+
+    // what happens later
+    timers.schedule(idleTimer, IDLE_SEQUENCE_MIN_WAIT_MS);
+    timers.schedule(reportTimer, WEAR_REPORT_INTERVAL_MS, reportStatus);
+    timers.schedule(wearSaveTimer, WEAR_SAVE_INTERVAL_MS, saveServoWear);
     
 }
 
@@ -144,7 +284,6 @@ void loop() {
 
     static bool firstLoop = true;
     static bool mouthTriggered = false;
-    static long lastIdleSequenceStartTime = 0;
 
     if (firstLoop){
 
@@ -153,8 +292,23 @@ void loop() {
 
     }
 
-    // have we been triggered by the mouth?
-    if (digitalRead(TRIGGER_PIN) == HIGH) {
+    // give up optional work while loop() is running long
+    frameBudget.frameStart();
+    animation1.puppet.pauseMicroMotion(!frameBudget.allows(jobMicroMotion));
+    TPP_AnimateServo::setTracing(frameBudget.allows(jobTracing));
+
+    // cues from the show controller. While a show is on, no idle sequences.
+    ShowCuePacket cue;
+    while (showLink.process(cue)) {
+        runShowCue(cue);
+        timers.schedule(idleTimer, IDLE_SEQUENCE_MIN_WAIT_MS);
+    }
+
+    // requests from a control client on the local network
+    controlLink.process();
+
+    // have we been triggered by the mouth, or by the show?
+    if (digitalRead(TRIGGER_PIN) == HIGH || showAttention) {
         
         if (mouthTriggered) {
             // we are already running, refresh the sequence if needed
@@ -168,6 +322,7 @@ void loop() {
         } else {
             // we have been triggered, start the sequence
             mouthTriggered = true;
+            triggerMetric.add();
             //start the appropriate sequence
             mainLog.info("eyes triggered");
             animation1.stopRunning();
@@ -199,26 +354,25 @@ void loop() {
     // the puppet do some random thing
     if (!mouthTriggered) {
         
-        if (!animation1.isRunning() && 
-            (millis() - lastIdleSequenceStartTime > IDLE_SEQUENCE_MIN_WAIT_MS)) {
+        if (!animation1.isRunning() && !idleTimer.isPending()) {
             // there is no animation running, and we haven't done any random
-            // thing for at least IDLE_SEQUENCE_MIN_WAIT_TS
+            // thing for at least IDLE_SEQUENCE_MIN_WAIT_MS
 
             animation1.clearSceneList();
-            lastIdleSequenceStartTime = millis();
+            timers.schedule(idleTimer, IDLE_SEQUENCE_MIN_WAIT_MS);
 
             int thisRandom = random(100);
             if (thisRandom > 80) {
                 //20%
                 sequenceWakeUpSlowly(0);
                 sequenceAsleep(5000);
-                Particle.publish("Idle option 1");
+                publishIdleOption("Idle option 1");
             } else if (thisRandom > 60){
                 //20%
                 sequenceWakeUpSlowly(0);
                 sequenceEyesRoam();
                 sequenceAsleep(5000);
-                Particle.publish("Idle option 2");
+                publishIdleOption("Idle option 2");
             } else if (thisRandom > 20){
                 //20%
                 sequenceEyesRoamAhead();
@@ -226,7 +380,7 @@ void loop() {
                 sequenceEyesRoamAhead();
                 sequenceEyesRoamAhead();
                 sequenceAsleep(5000);
-                Particle.publish("Idle option 3");
+                publishIdleOption("Idle option 3");
             } else if (thisRandom > 0){
                 //20%
                 sequenceBlinkEyes(1000);
@@ -234,16 +388,248 @@ void loop() {
                 sequenceBlinkEyes(100);
                 sequenceBlinkEyes(100);
                 sequenceAsleep(5000);
-                Particle.publish("Idle option 4");
+                publishIdleOption("Idle option 4");
             }
 
             animation1.startRunning();
         }
     }
+
     animationTimerCallback();
 
+    frameBudget.frameEnd();
+
+}
+
+
+//------- reportStatus --------
+// Timer callback. Refreshes the report cloud variables, the servo wear counters
+// when there is time, and publishes an I2C bus recovery.
+void reportStatus(void *context) {
+
+    static unsigned long i2cRecoveries = 0;
+
+    frameBudget.report(budgetReport, sizeof(budgetReport));
+    arena.report(memoryReport, sizeof(memoryReport));
+    TPP_AnimateServo::i2cReport(i2cReport, sizeof(i2cReport));
+    PCA9685_I2CHealth i2c = TPP_AnimateServo::getI2CHealth();
+    if (i2c.recoveries != i2cRecoveries && frameBudget.allows(jobTelemetry)) {
+        i2cRecoveries = i2c.recoveries;
+        Particle.publish("i2c recovered", i2cReport);
+    }
+    if (frameBudget.allows(jobStatistics)) {
+        TPP_AnimateServo::wearReport(wearReport, sizeof(wearReport));
+    }
+    timers.schedule(reportTimer, WEAR_REPORT_INTERVAL_MS, reportStatus);
+
+}
+
+//------- saveServoWear --------
+// Timer callback. Saves the servo wear counters to EEPROM, or tries again soon
+// if loop() is short of time.
+void saveServoWear(void *context) {
+
+    if (!frameBudget.allows(jobStatistics)) {
+        timers.schedule(wearSaveTimer, WEAR_SAVE_RETRY_MS, saveServoWear);
+        return;
+    }
+    TPP_AnimateServo::saveWear();
+    mainLog.info("servo wear saved");
+    timers.schedule(wearSaveTimer, WEAR_SAVE_INTERVAL_MS, saveServoWear);
+
+}
+
+//------- publishIdleOption --------
+// Counts an idle sequence, and publishes which idle option was picked, unless
+// loop() is short of time
+void publishIdleOption(const char *option) {
+
+    idleMetric.add();
+
+    if (frameBudget.allows(jobTelemetry)) {
+        Particle.publish(option);
+    }
+
+}
+
+//------- addSequence --------
+// Adds the scenes of a sequence in the asset pack to the animation list.
+// Returns the number of scenes, 0 if the pack doesn't have it.
+int addSequence(const char *name) {
+
+    const AssetScene *scenes;
+    int count = assets.getSequence(name, scenes);
+    for (int s = 0; s < count; s++) {
+        if (scenes[s].scene <= sceneBlink) {
+            animation1.addScene((eScene)scenes[s].scene, scenes[s].modifier, scenes[s].speedX100 / 100.0,
+                                scenes[s].delayAfterMS);
+        }
+    }
+    return count;
+
 }
 
+//------- playSequence --------
+// Cloud function. Runs the sequence in the asset pack named, in place of whatever
+// is running. Returns the number of scenes, or -1 if the pack doesn't have it.
+int playSequence(String name) {
+
+    const AssetScene *scenes;
+    if (assets.getSequence(name.c_str(), scenes) == 0) {
+        return -1;
+    }
+    animation1.stopRunning();
+    animation1.clearSceneList();
+    int count = addSequence(name.c_str());
+    animation1.startRunning();
+    return count;
+
+}
+
+//------- setMicroMotion --------
+// Cloud function. "EYE% LID% HZ" sets how far and how fast the eyes and lids
+// wander, e.g. "4 6 0.5". "off" stops them. Returns 0, or -1 if not understood.
+int setMicroMotion(String command) {
+
+    float eyePercent, lidPercent, hz;
+
+    if (command == "off") {
+        animation1.puppet.setMicroMotion(0, 0, MICRO_HZ);
+        return 0;
+    }
+    if (sscanf(command.c_str(), "%f %f %f", &eyePercent, &lidPercent, &hz) != 3 ||
+        eyePercent < 0 || eyePercent > 10 || lidPercent < 0 || lidPercent > 10 || hz <= 0) {
+        return -1;
+    }
+    animation1.puppet.setMicroMotion(eyePercent, lidPercent, hz);
+    return 0;
+
+}
+
+//------- registerMetrics --------
+// Adds the sketch's own metrics, and the statistics the libraries already keep
+// read when a snapshot is taken
+void registerMetrics() {
+
+    triggerMetric = metrics.counter("eyes_triggers_total");
+    idleMetric = metrics.counter("eyes_idle_sequences_total");
+    metrics.counter("anim_runs_total", []() { return (int32_t)animation1.getRunCount(); });
+    metrics.counter("anim_scenes_total", []() { return (int32_t)animation1.getScenesPlayed(); });
+    metrics.counter("anim_overflows_total", []() { return (int32_t)animation1.getOverflowCount(); });
+    metrics.counter("budget_overruns_total", []() { return (int32_t)frameBudget.getOverruns(); });
+    metrics.counter("i2c_transactions_total", []() { return (int32_t)TPP_AnimateServo::getI2CHealth().transactions; });
+    metrics.counter("i2c_errors_total", []() -> int32_t {
+        PCA9685_I2CHealth i2c = TPP_AnimateServo::getI2CHealth();
+        return (int32_t)(i2c.nacks + i2c.timeouts);
+    });
+    metrics.counter("i2c_recoveries_total", []() { return (int32_t)TPP_AnimateServo::getI2CHealth().recoveries; });
+    metrics.gauge("i2c_slowest_us", []() { return (int32_t)TPP_AnimateServo::getI2CHealth().slowestMicros; });
+    metrics.counter("show_cues_total", []() { return (int32_t)showLink.getCuesRun(); });
+    metrics.counter("show_cues_late_total", []() { return (int32_t)showLink.getCuesLate(); });
+    metrics.counter("show_cues_dropped_total", []() { return (int32_t)showLink.getCuesDropped(); });
+    metrics.counter("control_requests_total", []() { return (int32_t)controlLink.getRequests(); });
+    metrics.counter("control_errors_total", []() { return (int32_t)controlLink.getErrors(); });
+    metrics.counter("timers_expired_total", []() { return (int32_t)timers.getExpired(); });
+    metrics.gauge("timers_pending", []() { return (int32_t)timers.getPending(); });
+
+}
+
+//------- metricsText --------
+// Control variable. The metrics as Prometheus text, from the one numbered in
+// argument on, as many as fit. Ends with "# next N" if there are more.
+int metricsText(const char *argument, char *buffer, int size) {
+
+    int first = atoi(argument);
+    return metrics.writeText(buffer, size, first);
+
+}
+
+//------- metricsBinary --------
+// Control variable. The metrics as binary records, see TPPMetricsFormat.h, from
+// the one numbered in argument on, as many as fit.
+int metricsBinary(const char *argument, char *buffer, int size) {
+
+    int first = atoi(argument);
+    return metrics.writeBinary((uint8_t *)buffer, size, first);
+
+}
+
+//------- setAttention --------
+// Control function. "1" acts as if A5 were high, like a show attention cue, "0"
+// releases it. Returns 0, or -1 if not understood.
+int setAttention(String command) {
+
+    if (command == "1") {
+        showAttention = true;
+    } else if (command == "0") {
+        showAttention = false;
+    } else {
+        return -1;
+    }
+    mainLog.info("control attention %d", showAttention);
+    return 0;
+
+}
+
+//------- runShowCue --------
+// Does what a cue from the show controller asks for. See TPPShowProtocol.h.
+void runShowCue(const ShowCuePacket &cue) {
+
+    if (cue.action == showActionAttention) {
+        showAttention = cue.param[0] != 0;
+        mainLog.info("show attention %d", showAttention);
+        return;
+    }
+
+    // a stream of these moves the eyes directly, the scene list is left alone
+    if (cue.action == showActionPursue) {
+        if (cue.param[0] < 0) {
+            animation1.puppet.eyeballs().stopPursuit();
+        } else {
+            animation1.puppet.eyeballs().pursue(cue.param[0], cue.param[1], cue.atPuppetMS);
+        }
+        return;
+    }
+
+    animation1.stopRunning();
+    animation1.clearSceneList();
+
+    switch (cue.action) {
+
+        case showActionSequence:
+            switch (cue.param[0]) {
+                case showSequenceAsleep:        sequenceAsleep(0); break;
+                case showSequenceWake:          sequenceEyesWake(0); break;
+                case showSequenceRoam:          sequenceEyesRoam(); break;
+                case showSequenceRoamAhead:     sequenceEyesRoamAhead(); break;
+                case showSequenceBlink:         sequenceBlinkEyes(0); break;
+                case showSequenceEndStandard:   sequenceEndStandard(); break;
+                default:
+                    mainLog.warn("show cue with unknown sequence %d", cue.param[0]);
+                    break;
+            }
+            break;
+
+        case showActionLook: {
+            float speed = max(1, cue.param[2]) / 10.0;
+            animation1.addScene(sceneEyesLeftRight, constrain(cue.param[0], 0, 100), speed, -1);
+            animation1.addScene(sceneEyesUpDown, constrain(cue.param[1], 0, 100), speed, 0);
+            break;
+        }
+
+        case showActionBlink:
+            sequenceBlinkEyes(0);
+            break;
+
+        default:
+            mainLog.warn("show cue with unknown action %d", cue.action);
+            break;
+
+    }
+
+    animation1.startRunning();
+
+}
 
 void sequenceGeneralTests () {
 
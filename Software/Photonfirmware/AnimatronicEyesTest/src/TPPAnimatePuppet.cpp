@@ -26,6 +26,7 @@
  *          .init()  sets all the parameters needed to control the eyeball mechanism
  *          .positionX/Y() used to set the position of the eyeballs
  *          .lookCenter()  one of several other convenience functions
+ *          .pursue()  follow a moving target, see TPPAnimatePuppet.h
  *      eyelid
  *          .init() sets parameters needed to control one eyelid
  *          .position()  moves eyelid with a % open parameter
@@ -51,11 +52,71 @@ Logger logPuppet("app.puppet");
 */
 void TPP_Puppet::process()  {
     
-    eyeballs.process();
-    eyelidLeftUpper.process();
-    eyelidLeftLower.process();
-    eyelidRightUpper.process();
-    eyelidRightLower.process();
+    if (!microMotionPaused && microMotion.update()) {
+        applyMicroMotion();
+    }
+
+    TPP_EyesMechanisms::process();
+}
+
+/*----- isMoving -----
+ * true if the servos need process() to be called even when no animation
+ * is running: the eyes are pursuing something or wandering
+*/
+bool TPP_Puppet::isMoving() {
+
+    return TPP_EyesMechanisms::isMoving() || microMotionAwake;
+
+}
+
+/*----- setMicroMotion -----
+ * How far the eyeballs and lids wander, in percent of their travel, and how
+ * fast, in Hz. 0 percent stops them wandering.
+*/
+void TPP_Puppet::setMicroMotion(float eyePercent, float lidPercent, float hz) {
+
+    if (!microMotionStarted) {
+        microMotionStarted = true;
+        microMotion.begin(microChannels, random(0x7FFFFFFF));
+    }
+    logPuppet.info("micro-motion eyes %.1f%%, lids %.1f%%, %.2f Hz", eyePercent, lidPercent, hz);
+    microMotion.setAmplitude(microEyeX, eyePercent * 10);
+    microMotion.setAmplitude(microEyeY, eyePercent * 10);
+    microMotion.setAmplitude(microLidsUpper, lidPercent * 10);
+    microMotion.setAmplitude(microLidsLower, lidPercent * 10);
+    microMotion.setFrequency(hz);
+
+}
+
+/*----- pauseMicroMotion -----
+ * While paused the eyes and lids hold their micro-motion offsets, and the
+ * noise isn't worked out
+*/
+void TPP_Puppet::pauseMicroMotion(bool pause) {
+
+    microMotionPaused = pause;
+
+}
+
+/*----- applyMicroMotion -----
+ * Hands the micro-motion offsets to the servos. Nothing wanders while all the
+ * lids are closed.
+*/
+void TPP_Puppet::applyMicroMotion() {
+
+    bool awake = false;
+    forEachOf<TPP_Eyelid>([&awake](TPP_Eyelid &lid) { awake = awake || !lid.isClosed(); });
+    microMotionAwake = awake && microMotion.isOn();
+    int upper = awake ? microMotion.getOffset(microLidsUpper) : 0;
+    int lower = awake ? microMotion.getOffset(microLidsLower) : 0;
+
+    eyeballs().setOffset(awake ? microMotion.getOffset(microEyeX) : 0, 
+                         awake ? microMotion.getOffset(microEyeY) : 0);
+    eyelidLeftUpper().setOffset(upper);
+    eyelidRightUpper().setOffset(upper);
+    eyelidLeftLower().setOffset(lower);
+    eyelidRightLower().setOffset(lower);
+
 }
 
 /*----- eyesOpen -----
@@ -63,13 +124,10 @@ void TPP_Puppet::process()  {
 */
 int TPP_Puppet::eyesOpen(int position, float speed){
     logPuppet.info("eyesOpen %d%%",  position);
-    int time1 = eyelidLeftLower.position(position,speed);
-    int time2 = eyelidLeftUpper.position(position,speed);
-    int time3 = eyelidRightLower.position(position,speed);
-    int time4 = eyelidRightUpper.position(position,speed);
-    int estMS = max(time1,time2);
-    estMS = max(estMS,time3);
-    estMS = max(estMS,time4);
+    int estMS = 0;
+    forEachOf<TPP_Eyelid>([&estMS, position, speed](TPP_Eyelid &lid) {
+        estMS = max(estMS, lid.position(position, speed));
+    });
     return estMS;
 }
 
@@ -95,17 +153,17 @@ int TPP_Puppet::wink(bool leftorright){
     logPuppet.info("Wink");
 
     if (leftorright) {
-        eyelidLeftUpper.position(0,MOVE_SPEED_FAST);
-        eyelidLeftLower.position(0,MOVE_SPEED_FAST);
+        eyelidLeftUpper().position(0,MOVE_SPEED_FAST);
+        eyelidLeftLower().position(0,MOVE_SPEED_FAST);
         delay(200);
-        eyelidLeftUpper.position(50,MOVE_SPEED_FAST);
-        eyelidLeftLower.position(50,MOVE_SPEED_FAST);
+        eyelidLeftUpper().position(50,MOVE_SPEED_FAST);
+        eyelidLeftLower().position(50,MOVE_SPEED_FAST);
     } else {
-        eyelidRightUpper.position(0,100);
-        eyelidRightLower.position(0,100);
+        eyelidRightUpper().position(0,100);
+        eyelidRightLower().position(0,100);
         delay(200);
-        eyelidRightUpper.position(50,MOVE_SPEED_FAST);
-        eyelidRightLower.position(50,MOVE_SPEED_FAST);
+        eyelidRightUpper().position(50,MOVE_SPEED_FAST);
+        eyelidRightLower().position(50,MOVE_SPEED_FAST);
 
     }
 
@@ -134,6 +192,13 @@ void TPP_Eyeball::init(int xservoNumIn, int xmidPosIn, int leftOffsetIn, int rig
     logPuppet.trace("eyeball init %d %d %d ",xservoNumIn,  xmidPosIn,  xmidPos);
     xServo.begin(xservoNumIn, xmidPos);
     yServo.begin(yservoNumIn, ymidPos);
+    xServo.setLimits(xmidPos+leftOffset, xmidPos+rightOffset);
+    yServo.setLimits(ymidPos+downOffset, ymidPos+upOffset);
+
+    pursuitX.low = xmidPos + min(leftOffset, rightOffset);
+    pursuitX.high = xmidPos + max(leftOffset, rightOffset);
+    pursuitY.low = ymidPos + min(upOffset, downOffset);
+    pursuitY.high = ymidPos + max(upOffset, downOffset);
 
 }
 
@@ -142,6 +207,10 @@ void TPP_Eyeball::init(int xservoNumIn, int xmidPosIn, int leftOffsetIn, int rig
  */
 void TPP_Eyeball::process() {
 
+    if (pursuing && millis() - lastFrameMS >= PURSUIT_FRAME_MS) {
+        pursuitFrame();
+    }
+
     xServo.process();
     yServo.process();
 
@@ -171,6 +240,7 @@ int TPP_Eyeball::lookCenter(float speed){
 int TPP_Eyeball::positionX(int position, float speed) {
 
     logPuppet.trace("eyeballs positionX");
+    pursuing = false;
 
     position = map(position, 0, 100, xmidPos+leftOffset, xmidPos+rightOffset );
     return xServo.moveTo(position, speed);
@@ -186,12 +256,183 @@ int TPP_Eyeball::positionX(int position, float speed) {
 int TPP_Eyeball::positionY(int position, float speed) {
 
     logPuppet.trace("eyeballs positionY");
+    pursuing = false;
 
     position = map(position, 0, 100, ymidPos+downOffset, ymidPos+upOffset);
     return yServo.moveTo(position, speed);
 
 }
 
+/* ----- setOffset -----
+ * Micro-motion offsets, in thousandths of the travel
+ */
+void TPP_Eyeball::setOffset(int xPerMille, int yPerMille) {
+
+    xServo.setOffset(xPerMille * (rightOffset - leftOffset) / 1000);
+    yServo.setOffset(yPerMille * (upOffset - downOffset) / 1000);
+
+}
+
+/* ----- pursue -----
+ * The target the eyes follow is at x (0:left, 100:right) and y (0:down, 100:up)
+ * at millis() timeMS. Call it as often as the target is known. The first call
+ * starts the pursuit.
+ */
+void TPP_Eyeball::pursue(int x, int y, unsigned long timeMS) {
+
+    pursuitX.measured = map(constrain(x, 0, 100), 0, 100, xmidPos+leftOffset, xmidPos+rightOffset) << 16;
+    pursuitY.measured = map(constrain(y, 0, 100), 0, 100, ymidPos+downOffset, ymidPos+upOffset) << 16;
+
+    if (!pursuing) {
+        // start from the target, standing still
+        logPuppet.info("eyeballs pursuit start");
+        pursuitX.position = pursuitX.measured;
+        pursuitY.position = pursuitY.measured;
+        pursuitX.velocity = 0;
+        pursuitY.velocity = 0;
+        pursuing = true;
+        saccading = false;
+        newTarget = false;
+        lastFrameMS = millis() - PURSUIT_FRAME_MS;  // aim at the next process()
+    } else if (timeMS != targetMS) {
+        newTarget = true;
+    }
+    lastTargetMS = targetMS;
+    targetMS = timeMS;
+
+}
+
+/* ----- stopPursuit -----
+ * The eyes stop where they are
+ */
+void TPP_Eyeball::stopPursuit() {
+
+    if (pursuing) {
+        logPuppet.info("eyeballs pursuit stop");
+        pursuing = false;
+        xServo.moveTo(xServo.getPosition(), MOVE_SPEED_FAST);
+        yServo.moveTo(yServo.getPosition(), MOVE_SPEED_FAST);
+    }
+
+}
+
+bool TPP_Eyeball::isPursuing() {
+
+    return pursuing;
+
+}
+
+/* ----- pursuitFrame -----
+ * Once every PURSUIT_FRAME_MS while pursuing: brings the target estimate up to
+ * date and moves the eyes after it, or jumps if they are too far behind.
+ */
+void TPP_Eyeball::pursuitFrame() {
+
+    unsigned long now = millis();
+    int32_t frameMS = min(now - lastFrameMS, (unsigned long)PURSUIT_TIMEOUT_MS);
+    lastFrameMS = now;
+
+    bool targetLost = false;
+    if (newTarget || now - targetMS <= PURSUIT_TIMEOUT_MS) {
+        int32_t sinceTarget = constrain((int32_t)(now - targetMS), 0, PURSUIT_TIMEOUT_MS);
+        int32_t sinceLast = constrain((int32_t)(targetMS - lastTargetMS), 1, PURSUIT_TIMEOUT_MS);
+        trackAxis(pursuitX, frameMS, sinceTarget, sinceLast);
+        trackAxis(pursuitY, frameMS, sinceTarget, sinceLast);
+        newTarget = false;
+    } else {
+        // the target has gone quiet, hold where it was last seen
+        pursuitX.velocity = 0;
+        pursuitY.velocity = 0;
+        targetLost = true;
+    }
+
+    // let a saccade finish before aiming again
+    if (saccading) {
+        if (abs(xServo.getPosition() - pursuitX.saccadeTo) >= 2 ||
+            abs(yServo.getPosition() - pursuitY.saccadeTo) >= 2) {
+            return;
+        }
+        saccading = false;
+    }
+
+    int aimX = aimOf(pursuitX, PURSUIT_LEAD_MS);
+    int aimY = aimOf(pursuitY, PURSUIT_LEAD_MS);
+
+    // once the eyes are there the pursuit is over, and nothing needs to move
+    if (targetLost && xServo.getPosition() == aimX && yServo.getPosition() == aimY) {
+        logPuppet.info("eyeballs pursuit timed out");
+        pursuing = false;
+        return;
+    }
+
+    if (abs(aimX - xServo.getPosition()) > PURSUIT_SACCADE_TICKS ||
+        abs(aimY - yServo.getPosition()) > PURSUIT_SACCADE_TICKS) {
+        // too far behind: jump to where the target will be when we get there
+        int jumpMS = max(xServo.moveTo(aimX, MOVE_SPEED_FAST), yServo.moveTo(aimY, MOVE_SPEED_FAST));
+        pursuitX.saccadeTo = aimOf(pursuitX, jumpMS);
+        pursuitY.saccadeTo = aimOf(pursuitY, jumpMS);
+        xServo.moveTo(pursuitX.saccadeTo, MOVE_SPEED_FAST);
+        yServo.moveTo(pursuitY.saccadeTo, MOVE_SPEED_FAST);
+        saccading = true;
+        logPuppet.trace("eyeballs saccade to %d %d", pursuitX.saccadeTo, pursuitY.saccadeTo);
+        return;
+    }
+
+    followAxis(pursuitX, xServo, aimX);
+    followAxis(pursuitY, yServo, aimY);
+
+}
+
+/* ----- trackAxis -----
+ * One step of the alpha-beta filter: predicts the target frameMS on, then if there
+ * is a new target corrects the estimate by how far the target was from where the
+ * prediction had it sinceTarget ms ago. sinceLast is the time between the last
+ * two targets. A target that jumps further than PURSUIT_SACCADE_TICKS restarts
+ * the estimate, so the jump doesn't read as speed.
+ */
+void TPP_Eyeball::trackAxis(PursuitAxis &axis, int32_t frameMS, int32_t sinceTarget, int32_t sinceLast) {
+
+    axis.position += axis.velocity * frameMS;
+
+    if (newTarget) {
+        int32_t residual = axis.measured - (axis.position - axis.velocity * sinceTarget);
+        if (abs(residual) > (PURSUIT_SACCADE_TICKS << 16)) {
+            // the target jumped rather than moved: start again from where it is now
+            axis.position = axis.measured;
+            axis.velocity = 0;
+            return;
+        }
+        axis.position += (int32_t)(((int64_t)residual * PURSUIT_ALPHA) >> 8);
+        axis.velocity += (int32_t)((((int64_t)residual * PURSUIT_BETA) >> 8) / sinceLast);
+        axis.velocity = constrain(axis.velocity, -PURSUIT_MAX_VELOCITY, PURSUIT_MAX_VELOCITY);
+    }
+
+    axis.position = constrain(axis.position, axis.low << 16, axis.high << 16);
+
+}
+
+/* ----- aimOf -----
+ * Where the target will be leadMS from now, in servo ticks
+ */
+int TPP_Eyeball::aimOf(PursuitAxis &axis, int32_t leadMS) {
+
+    int32_t aim = axis.position + axis.velocity * min(leadMS, (int32_t)PURSUIT_TIMEOUT_MS);
+    return constrain(aim >> 16, axis.low, axis.high);
+
+}
+
+/* ----- followAxis -----
+ * Moves the servo to aim at the target's speed, plus enough to make up any
+ * error over the next frame
+ */
+void TPP_Eyeball::followAxis(PursuitAxis &axis, volatile TPP_AnimateServo &servo, int aim) {
+
+    int32_t error = abs(aim - servo.getPosition());
+    int32_t speed = (abs(axis.velocity) + (error << 16) / PURSUIT_FRAME_MS) * PURSUIT_MS_PER_STEP;  // Q16 ticks per step
+    servo.moveTo(aim, max(speed / 65536.0f, 0.1f));
+
+}
+
 // ---------------------------------------------------------
 //-------------------   EYE LIDS ---------------------------
 
@@ -205,6 +446,7 @@ void TPP_Eyelid::init(int servoNumIn, int openPosIn, int closedPosIn){
     closedPos = closedPosIn;
 
     myServo.begin(servoNum, closedPos);
+    myServo.setLimits(openPos, closedPos);
 
 }
 
@@ -223,10 +465,27 @@ void TPP_Eyelid::process(){
 int TPP_Eyelid::position(int position, float speed){
 
     logPuppet.trace("Eyelid to position %d%%, speed %.2f", position, speed);
+    closed = (position <= eyelidClosed);
     int newPosition = map(position, 0, 100, closedPos, openPos);
     int durationMS = myServo.moveTo(newPosition, speed);
     return durationMS;
 
 }
 
+/* ----- setOffset -----
+ * Micro-motion offset, in thousandths of the travel toward open. A closed lid
+ * stays closed.
+ */
+void TPP_Eyelid::setOffset(int perMille) {
+
+    myServo.setOffset(closed ? 0 : perMille * (openPos - closedPos) / 1000);
+
+}
+
+bool TPP_Eyelid::isClosed() {
+
+    return closed;
+
+}
+
 
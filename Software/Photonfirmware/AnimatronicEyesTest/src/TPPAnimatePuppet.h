@@ -7,31 +7,76 @@
  * 
  * The library contains objects to control mechanisms in the puppet. Today it holds
  * the eyeball mechanism and the four eyelids.
+ *
+ * A puppet is put together at compile time from a list of mechanism types:
+ * TPP_PuppetOf<TPP_Eyeball, TPP_Eyelid, ...> holds one of each in a std::tuple, and its
+ * process() and isMoving() call every mechanism's own by template recursion, so the
+ * calls are unrolled and inlined with no virtual functions. numMechanisms and
+ * numChannels (servos) are known at compile time. A mechanism type needs
+ *      static const int channels   servos it drives
+ *      void process()
+ *      bool isMoving()             needs process() even with no animation running
+ * A puppet with a mouth or a neck is another list, and shares all the code.
  * 
  * Instantiate this class, and it will create an instance of the TPPAnimateServo library.
  * 
  * Classes: 
- *      Puppet:    holds objects that control all mechanisms. Includes convenience functions
- *                 to command them. Today: eyeballs and eyelids.
+ *      PuppetOf:  holds the mechanisms listed, and calls them all
+ *      Puppet:    the eyes puppet, a PuppetOf the eyeballs and four eyelids. Includes
+ *                 convenience functions to command them, and names them: eyeballs(),
+ *                 eyelidLeftUpper() ...
  *      Eyeballs:  controls the x and y axis of the eyeballs
  *      Eyelid:    controls one eyelid
  *
  * 
  * Key methods
+ *      PuppetOf
+ *          .get<N>()  mechanism number N in the list
+ *          .forEach(f)  calls f(mechanism) on every mechanism
+ *          .forEachOf<Type>(f)  calls f(mechanism) on every mechanism of Type
  *      Puppet
  *          .process()  called over and over to cause the servos to move from current
  *              position to the new target position. This function in turn calls process()
  *              on each of the other control objects
  *          .eyeOpen()  one of several other convenice functions
+ *          .setMicroMotion()  how much the eyes and lids wander on their own, see below
+ *          .pauseMicroMotion()  holds the wander where it is, to save time
+ *          .isMoving()  true if the servos need process() even with no animation running
  *      eyeball
  *          .init()  sets all the parameters needed to control the eyeball mechanism
  *          .positionX/Y() used to set the position of the eyeballs
  *          .lookCenter()  one of several other convenience functions
+ *          .pursue()  follow a moving target, see Pursuit below
+ *          .stopPursuit(), .isPursuing()
+ *          .setOffset()  micro-motion offsets, in thousandths of the travel
  *      eyelid
  *          .init() sets parameters needed to control one eyelid
  *          .position()  moves eyelid with a % open parameter
+ *          .setOffset()  micro-motion offset, in thousandths of the travel toward open
  * 
  * 
+ * Pursuit
+ *      Instead of moving point to point, the eyeballs can follow a target that keeps
+ *      moving: a scripted path or a sensor feed. Each call to .pursue() gives the
+ *      target's x and y (0-100, as positionX/Y) and the millis() it was there; calls
+ *      can come at any rate and need not be regular. Every PURSUIT_FRAME_MS, process()
+ *      runs an alpha-beta filter on each axis to estimate where the target is and how 
+ *      fast it is going, and moves the eyes to where it will be PURSUIT_LEAD_MS ahead,
+ *      at the target's speed. When the eyes are more than PURSUIT_SACCADE_TICKS
+ *      behind, they jump to catch up at MOVE_SPEED_FAST (a saccade), as real eyes do.
+ *      If no target comes for PURSUIT_TIMEOUT_MS, the eyes go to where it was last
+ *      and the pursuit ends there; the next .pursue() starts a new one.
+ *
+ *      The filter is Q16 fixed point, a few integer multiplies per axis per frame,
+ *      and it moves the servos directly: the animation list is not used. positionX/Y
+ *      and lookCenter stop the pursuit.
+ *
+ * Micro-motion
+ *      While the eyes are open, the puppet's TPP_MicroMotion adds a small smooth wander
+ *      to the eyeballs and lids on top of whatever they are doing, so they are never
+ *      quite still. The upper lids wander together, as do the lower lids. Closed lids
+ *      stay closed, and when all the lids are closed nothing wanders.
+ * 
  * For full documentation see https://github/TeamPracticalProjects/XXXX
  * 
  * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
@@ -42,6 +87,9 @@
 #define _TPP_TPPAnimatePuppet_H
 
 #include <TPPAnimateServo.h>
+#include <TPPMicroMotion.h>
+#include <tuple>
+#include <type_traits>
 
 // position definitions to make control easier
 #define eyelidWideOpen 100
@@ -49,19 +97,59 @@
 #define eyelidNormal 50
 #define eyelidSlit 20
 
+// pursuit
+#define PURSUIT_FRAME_MS 20         // how often the filter runs and the eyes are aimed
+#define PURSUIT_LEAD_MS 20          // aim this far ahead of the target, to make up for the servo
+#define PURSUIT_ALPHA 128           // alpha-beta filter gains, Q8: 0.5 ...
+#define PURSUIT_BETA 43             // ... and alpha^2 / (2 - alpha) = 0.167
+#define PURSUIT_SACCADE_TICKS 40    // further behind than this, jump to catch up
+#define PURSUIT_TIMEOUT_MS 500      // no new target for this long, stop where it was last
+#define PURSUIT_MAX_VELOCITY (5 << 16)  // ticks per ms, Q16. The fastest a servo can go.
+#define PURSUIT_MS_PER_STEP 2       // TPP_AnimateServo moves one step every 2 ms
+
+// micro-motion channels
+enum eMicroChannel {
+    microEyeX = 0,
+    microEyeY,
+    microLidsUpper,
+    microLidsLower,
+    microChannels
+};
+
 
 
 class TPP_Eyeball {
 
     public:
+        static const int channels = 2;
+
         void init(int xservoNum, int xmidPos, int leftOffset, int rightOffset, 
              int yservoNum, int ymidPos, int upOffset, int downOffset);
         void process();
         int positionX(int position, float speed);
         int positionY(int position, float speed); 
         int lookCenter(float speed);
+        void pursue(int x, int y, unsigned long timeMS);
+        void stopPursuit();
+        bool isPursuing();
+        bool isMoving() { return pursuing; }
+        void setOffset(int xPerMille, int yPerMille);
 
     private:
+        // alpha-beta tracker for one axis of the target, in servo ticks
+        struct PursuitAxis {
+            int32_t position;       // estimated target position, Q16 ticks
+            int32_t velocity;       // estimated target velocity, Q16 ticks per ms
+            int32_t measured;       // the latest target given to pursue(), Q16 ticks
+            int low;                // ends of travel
+            int high;
+            int saccadeTo;          // where the last saccade went
+        };
+        void pursuitFrame();
+        void trackAxis(PursuitAxis &axis, int32_t frameMS, int32_t sinceTarget, int32_t sinceLast);
+        int aimOf(PursuitAxis &axis, int32_t leadMS);
+        void followAxis(PursuitAxis &axis, volatile TPP_AnimateServo &servo, int aim);
+
         int xservoNum;
         int yservoNum;
         int xmidPos;
@@ -73,39 +161,163 @@ class TPP_Eyeball {
         volatile TPP_AnimateServo xServo;
         volatile TPP_AnimateServo yServo;
 
+        PursuitAxis pursuitX;
+        PursuitAxis pursuitY;
+        bool pursuing = false;
+        bool saccading = false;             // jumping to catch up, don't aim until there
+        bool newTarget = false;             // pursue() called since the last frame
+        unsigned long targetMS = 0;         // time of the latest target
+        unsigned long lastTargetMS = 0;     // time of the one before
+        unsigned long lastFrameMS = 0;
+
 };
 
 class TPP_Eyelid {
 
     public:
+        static const int channels = 1;
+
         void init(int servoNum, int openPos, int closedPos);
         void process();
+        bool isMoving() { return false; }
         int position(int position, float speed);
+        void setOffset(int perMille);
+        bool isClosed();
 
     private:
         int servoNum;
         int openPos;
         int closedPos;
+        bool closed = true;         // last told to close
         TPP_AnimateServo myServo;
 
 };
 
-// TPP_Head holds all the other objects that map to a servo(s)
-class TPP_Puppet {
+// servos driven by a list of mechanism types
+template <class... Mechanisms>
+struct TPP_ChannelCount {
+    static const int value = 0;
+};
+
+template <class First, class... Rest>
+struct TPP_ChannelCount<First, Rest...> {
+    static const int value = First::channels + TPP_ChannelCount<Rest...>::value;
+};
+
+// TPP_PuppetOf holds one of each mechanism listed, and calls them all
+template <class... Mechanisms>
+class TPP_PuppetOf {
+
+    public:
+        static const int numMechanisms = sizeof...(Mechanisms);
+        static const int numChannels = TPP_ChannelCount<Mechanisms...>::value;
+
+        template <int N>
+        typename std::tuple_element<N, std::tuple<Mechanisms...> >::type &get() {
+            return std::get<N>(mechanisms_);
+        }
+
+        void process() {
+            Process process;
+            each<0>(process);
+        }
+
+        bool isMoving() {
+            Moving moving;
+            each<0>(moving);
+            return moving.any;
+        }
+
+        template <class F>
+        void forEach(F f) {
+            each<0>(f);
+        }
+
+        template <class Type, class F>
+        void forEachOf(F f) {
+            eachOf<Type, 0>(f);
+        }
+
+    protected:
+        std::tuple<Mechanisms...> mechanisms_;
+
+    private:
+        struct Process {
+            template <class M> void operator()(M &mechanism) { mechanism.process(); }
+        };
+
+        struct Moving {
+            bool any = false;
+            template <class M> void operator()(M &mechanism) { any = mechanism.isMoving() || any; }
+        };
+
+        // f on mechanism N, then on the rest. Ends at the end of the list.
+        template <int N, class F>
+        typename std::enable_if<(N < numMechanisms)>::type each(F &f) {
+            f(std::get<N>(mechanisms_));
+            each<N + 1>(f);
+        }
+
+        template <int N, class F>
+        typename std::enable_if<(N == numMechanisms)>::type each(F &) {}
+
+        // as each(), skipping mechanisms that aren't a Type
+        template <class Type, int N, class F>
+        typename std::enable_if<(N < numMechanisms)>::type eachOf(F &f) {
+            callIf<Type>(f, std::get<N>(mechanisms_));
+            eachOf<Type, N + 1>(f);
+        }
+
+        template <class Type, int N, class F>
+        typename std::enable_if<(N == numMechanisms)>::type eachOf(F &) {}
+
+        template <class Type, class F, class M>
+        static typename std::enable_if<std::is_same<Type, M>::value>::type callIf(F &f, M &mechanism) {
+            f(mechanism);
+        }
+
+        template <class Type, class F, class M>
+        static typename std::enable_if<!std::is_same<Type, M>::value>::type callIf(F &, M &) {}
+
+};
+
+// the mechanisms of the eyes puppet, in this order
+enum ePuppetMechanism {
+    mechanismEyeballs = 0,
+    mechanismEyelidLeftUpper,
+    mechanismEyelidLeftLower,
+    mechanismEyelidRightUpper,
+    mechanismEyelidRightLower
+};
+
+typedef TPP_PuppetOf<TPP_Eyeball, TPP_Eyelid, TPP_Eyelid, TPP_Eyelid, TPP_Eyelid> TPP_EyesMechanisms;
+
+static_assert(TPP_EyesMechanisms::numChannels <= MAX_SERVOS, "more servos than keep wear counters");
+
+// TPP_Puppet is the eyes puppet: the eyeballs and four eyelids
+class TPP_Puppet : public TPP_EyesMechanisms {
 
     public:
         void process();
+        bool isMoving();
         int eyesOpen(int position, float speed);
         int blink();
         int wink(bool leftorright);
+        void setMicroMotion(float eyePercent, float lidPercent, float hz);
+        void pauseMicroMotion(bool pause);
 
-        TPP_Eyelid eyelidLeftUpper;
-        TPP_Eyelid eyelidLeftLower;
-        TPP_Eyelid eyelidRightUpper;
-        TPP_Eyelid eyelidRightLower;
-        TPP_Eyeball eyeballs;
+        TPP_Eyeball &eyeballs() { return get<mechanismEyeballs>(); }
+        TPP_Eyelid &eyelidLeftUpper() { return get<mechanismEyelidLeftUpper>(); }
+        TPP_Eyelid &eyelidLeftLower() { return get<mechanismEyelidLeftLower>(); }
+        TPP_Eyelid &eyelidRightUpper() { return get<mechanismEyelidRightUpper>(); }
+        TPP_Eyelid &eyelidRightLower() { return get<mechanismEyelidRightLower>(); }
+        TPP_MicroMotion microMotion;
         
     private:
+        void applyMicroMotion();
+        bool microMotionStarted = false;
+        bool microMotionAwake = false;      // wandering, the last time offsets were applied
+        bool microMotionPaused = false;     // offsets held where they are
 
 };
 
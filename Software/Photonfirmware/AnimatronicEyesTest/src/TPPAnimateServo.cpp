@@ -12,7 +12,8 @@
  *      begin:  pass in the servo number on the AdaFruit servo driver board
  *      moveTo: pass in a target PWM duration and increment 
  *      process: called over and over to cause the servo to move from its current
- *              position to the new target position
+ *              position to the new target position, accelerating no faster than
+ *              SERVO_ACCEL so that a new target mid-move doesn't jerk the servo
  * 
  * For full documentation see https://github/TeamPracticalProjects/XXXX
  * 
@@ -25,33 +26,46 @@
                             // slow the timer work
 
 #define MS_BETWEEN_MOVES 1  // we will not move any particular servo more ofen than this
-#define MAX_SERVOS 6
 
 Logger logAniservo("app.aniservo");
 
 static Adafruit_PWMServoDriver pwm_; 
 
+// servos that keep wear counters, indexed by servo number. Filled in by begin()
+static volatile TPP_AnimateServo *wearServos_[MAX_SERVOS];
+
+static volatile bool tracing_ = true;   // trace log each move and arrival
+
+// metrics for all servos, count nothing until registerMetrics()
+static TPP_Counter movesMetric_;        // moveTo() calls
+static TPP_Histogram usPerTickMetric_;  // time per tick of travel of each move that arrived
+static const int32_t usPerTickBounds[] = {500, 1000, 2000, 4000, 8000, 16000, 32000};
+
+bool TPP_AnimateServo::warmStart_ = false;
+uint16_t TPP_AnimateServo::startPWM_[PCA9685_CHANNELS];
+
 /* ----- TPP_AnimateServo -----
- *  class initializer. called each time the class is instantiated
+ *  class initializer. called each time the class is instantiated. Servos are
+ *  globals, so nothing here may touch the board; begin() sets it up.
  */
 TPP_AnimateServo::TPP_AnimateServo(){
-    
-    initPWM(); // Calling a static function that will
-               // only be called once when the first instance of
-               // TPP_AnimateServo is created.
 
 }
 
 /* ----- initPWM -----
- *  called from class initializer. 
- *  Because this is declared static it will only be called once
- *  when the first instance of this class is created.
+ *  called from begin(), in setup(). Sets the board up, and reads it back, the
+ *  first time only.
  */
 void TPP_AnimateServo::initPWM(){
 
+    static bool started = false;
+    if (started) {
+        return;     // set up, and read back, by the first servo
+    }
+    started = true;
     pwm_ = Adafruit_PWMServoDriver();
-    pwm_.begin(); 
-    pwm_.setPWMFreq(60);  // Analog servos run at ~60 Hz updates
+    warmStart_ = pwm_.warmBegin(SERVO_PWM_HZ) && 
+                 pwm_.readPWMs(0, PCA9685_CHANNELS, NULL, startPWM_);
 
 }
 
@@ -61,25 +75,87 @@ void TPP_AnimateServo::initPWM(){
  */
 void TPP_AnimateServo::begin(int servoNumIn, int positionIn) volatile {
 
+    initPWM();
+
     // store values in class variables
     servoNum_ = servoNumIn;
     destination_ = positionIn; 
     position_ = positionIn;
 
-    // move servo to new position
+    // after a warm start, begin where the board has the servo and ease to the 
+    // start position; otherwise move servo to new position
     int setPos = floor(position_);
-    pwm_.setPWM(servoNum_, 0, setPos); 
+    int boardPos = -1;
+    if (warmStart_ && servoNum_ >= 0 && servoNum_ < PCA9685_CHANNELS) {
+        boardPos = startPWM_[servoNum_];
+    }
+    if (boardPos >= SERVOMIN && boardPos <= SERVOMAX) {
+        setPos = boardPos;
+        position_ = boardPos;
+        destination_ = boardPos;
+    } else {
+        pwm_.setPWM(servoNum_, 0, setPos); 
+    }
 
-    logAniservo.info("Begin Servo: %d at Pos: %.1f", servoNum_, position_);
+    // pick up the wear counters where the last run left off
+    lastCommanded_ = setPos;
+    lastProcessMS_ = millis();
+    if (servoNum_ >= 0 && servoNum_ < MAX_SERVOS) {
+        wearServos_[servoNum_] = this;
+        loadWear();
+    }
+
+    logAniservo.info("Begin Servo: %d at Pos: %.1f%s", servoNum_, position_, 
+                     (setPos == boardPos) ? ", warm start" : "");
+    if (destination_ != positionIn) {
+        moveTo(positionIn, WARM_START_SPEED);
+    }
 
 }
 
 
+/* ----- stepsToArrive -----
+ * Closed form count of the steps a move takes: distance ticks to go, starting at
+ * velocity ticks per step (negative is away from the destination), cruising at speed
+ * and changing speed by no more than accel each step.
+ */
+static float stepsToArrive(float distance, float velocity, float speed, float accel) {
+
+    float steps = 0;
+
+    if (velocity < 0) {
+        // heading away: stop first, that much further to go
+        steps += -velocity / accel;
+        distance += velocity * velocity / (2 * accel);
+        velocity = 0;
+    } else if (velocity * velocity / (2 * accel) > distance) {
+        // too fast to stop in time: overshoot, stop, and come back from rest
+        steps += velocity / accel;
+        distance = velocity * velocity / (2 * accel) - distance;
+        velocity = 0;
+    }
+
+    // trapezoid: change to the speed of the move, cruise, brake
+    float changeSteps = fabsf(speed - velocity) / accel;
+    float changeDistance = fabsf(speed * speed - velocity * velocity) / (2 * accel);
+    float brakeDistance = speed * speed / (2 * accel);
+    if (changeDistance + brakeDistance <= distance) {
+        return steps + changeSteps + speed / accel + (distance - changeDistance - brakeDistance) / speed;
+    }
+
+    // triangle: too short to get up to speed
+    float peak = sqrtf(accel * distance + velocity * velocity / 2);
+    return steps + (peak - velocity) / accel + peak / accel;
+
+}
+
 /*------- moveTo -------
  *  newPos: new position for the servo
  *  speed: the increment to use in each call to get to the new position 
  *     1 is slow, 10 is fast; 
  *     speed defines: MOVE_SPEED_SLOW 1, MOVE_SPEED_FAST 10, MOVE_SPEED_IMMEDIATE 100
+ *  If the servo is still moving it carries on at the velocity it has and 
+ *     blends into the new move, see process().
  *  Returns the estimated milliseconds needed to get from the current position 
  *     to the new position.
  */
@@ -90,26 +166,42 @@ int TPP_AnimateServo::moveTo (int newPos, float speed)  volatile{
     // Set new destination and start time
     destination_ = newPos;
     timeStart_ = millis();
+    startPosition_ = position_;
     lastDebugNeedsPrinting_ = true;
+    movesMetric_.add();
 
-    // Will we count up or down?
-    if (destination_ < position_) {
-        increment_ = -1 * speed; // count down
-    } else {
-        increment_ = speed; // count up
+    if (speed > wear_.peakSpeed) {
+        wear_.peakSpeed = speed;
     }
 
+    // an immediate move jumps at full speed; a move that takes over from one
+    // blends in from no faster than its own speed, or it would take a hundred
+    // steps of SERVO_ACCEL to slow down and run into the end of travel
+    if (immediate_ && speed < MOVE_SPEED_IMMEDIATE) {
+        velocity_ = constrain((float)velocity_, -speed, speed);
+    }
+    speed_ = speed;
+    immediate_ = (speed >= MOVE_SPEED_IMMEDIATE);
+
     // How long do we anticipate the move will take?
-    int totalDistance = floor(abs((destination_ - position_)));
+    float toGo = destination_ - position_;
+    int totalDistance = floor(fabsf(toGo));
     int servoMoveMS = totalDistance;
 
-    int movesNeeded = totalDistance/speed + 1;
+    int movesNeeded;
+    if (immediate_) {
+        movesNeeded = totalDistance/speed + 1;
+    } else {
+        float towards = (toGo < 0) ? -velocity_ : velocity_;
+        movesNeeded = ceil(stepsToArrive(fabsf(toGo), towards, speed, SERVO_ACCEL)) + 1;
+    }
+
     int movesMS = movesNeeded * MS_BETWEEN_MOVES + 20;
 
     estimatedMSToFinish = (movesMS + servoMoveMS);
 
-    logAniservo.trace("MoveTo - ServoNum: %d, pos: %.1f, dest: %d, dist: %d inc: %.2f, movesNeeded: %d, estDur: %d", 
-              servoNum_, position_, destination_, totalDistance, increment_, movesNeeded, estimatedMSToFinish);
+    if (tracing_) logAniservo.trace("MoveTo - ServoNum: %d, pos: %.1f, dest: %d, dist: %d vel: %.2f, movesNeeded: %d, estDur: %d", 
+              servoNum_, position_, destination_, totalDistance, velocity_, movesNeeded, estimatedMSToFinish);
 
 
     return estimatedMSToFinish;
@@ -124,14 +216,26 @@ int TPP_AnimateServo::moveTo (int newPos, float speed)  volatile{
 void TPP_AnimateServo::process() volatile {
 
     bool atDestination = false;
+    unsigned long now = millis();
+    unsigned long elapsedMS = now - lastProcessMS_;
+    lastProcessMS_ = now;
 
     //are we at the destination now?
     int posInt =  floor(position_);
     int distanceToGo = abs(posInt - destination_);
-    if ( distanceToGo < 2 )  {  
-        // we are at the destination
+    if ( distanceToGo < 2 && fabsf(velocity_) <= SERVO_ARRIVE_SPEED )  {  
+        // we are at the destination, and slow enough to stop
         atDestination = true;
         position_ = destination_; // set to prevent servo chatter
+        velocity_ = 0;
+    }
+
+    // charge the time since the last call to moving or holding at a limit
+    if (!atDestination) {
+        wear_.msMoving += elapsedMS;
+    } else if ((limitLow_ >= 0 && abs(destination_ - limitLow_) < 2) || 
+               (limitHigh_ >= 0 && abs(destination_ - limitHigh_) < 2)) {
+        wear_.msAtLimit += elapsedMS;
     }
 
     // Not at the destination yet, find new position for this cycle
@@ -140,44 +244,73 @@ void TPP_AnimateServo::process() volatile {
         //have we waited long enough to make a new position change?
         if (millis() - lastMoveMade_ > MS_BETWEEN_MOVES) {
         
-            // calculate new position
-            position_ += increment_;
-
-            // don't overshoot the destination
-            if (increment_ < 0) {
-                // we are counting down
-                if (position_ < destination_) {
-                    position_ = destination_;  
-                }
+            float toGo = destination_ - position_;
+            if (immediate_) {
+                // full speed from the first step
+                velocity_ = (toGo < 0) ? -speed_ : speed_;
             } else {
-                // we are counting up
-                if (position_ > destination_) {
-                    position_ = destination_; 
+                // the velocity we want: the speed of the move, or slower if we must
+                // start braking to stop at the destination. Get as near to it as
+                // SERVO_ACCEL allows.
+                float wanted = min((float)speed_, sqrtf(2 * SERVO_ACCEL * fabsf(toGo)));
+                if (toGo < 0) {
+                    wanted = -wanted;
                 }
+                velocity_ += constrain(wanted - velocity_, -SERVO_ACCEL, SERVO_ACCEL);
+            }
+
+            // calculate new position
+            position_ += velocity_;
+
+            // don't overshoot the destination unless we are going too fast to stop there
+            bool passed = (toGo < 0) ? (position_ < destination_) : (position_ > destination_);
+            if (passed && (immediate_ || fabsf(velocity_) <= SERVO_ARRIVE_SPEED)) {
+                position_ = destination_;
+                velocity_ = 0;
+            }
+
+            // nor the ends of travel
+            if (limitLow_ >= 0 && position_ < limitLow_) {
+                position_ = limitLow_;
+                velocity_ = 0;
+            } else if (limitHigh_ >= 0 && position_ > limitHigh_) {
+                position_ = limitHigh_;
+                velocity_ = 0;
             }
             
-            // Command the servo
-            int newPosition = floor(position_);
-            pwm_.setPWM (servoNum_, 0, newPosition);
+            commandServo();
             lastMoveMade_ = millis();
 
         }
 
     }
 
+    // holding still, but the offset has changed or the last tick was snapped to
+    // the destination without being sent. Nothing is sent if the servo is there.
+    if (atDestination) {
+        commandServo();
+    }
+
     // we have arrived
     if (atDestination) {
         // we've arrived at the destination, so print some final info but only once
         if (lastDebugNeedsPrinting_) {
 
             lastDebugNeedsPrinting_ = false;
+            unsigned long timeEnd = millis();
+            int distance = abs(startPosition_ - (int)position_);
+            if (distance > 0) {
+                usPerTickMetric_.observe((timeEnd - timeStart_) * 1000 / distance);
+            }
+            if (!tracing_) {
+                return;
+            }
  
-            int timeEnd = millis();
             float MSPerMoveUnit;
-            if (startPosition_ == position_) {
+            if (distance == 0) {
                 MSPerMoveUnit = 0;
             } else {
-                MSPerMoveUnit = ((timeEnd - timeStart_)/abs(startPosition_ - position_));
+                MSPerMoveUnit = ((timeEnd - timeStart_)/(float)distance);
             }
             int actualDuration = timeEnd - timeStart_;
 
@@ -186,13 +319,217 @@ void TPP_AnimateServo::process() volatile {
         //    the log object instead of Serial.print in a Timer call back.
         //    why doesn't this work?
 
-            logAniservo.trace("Arrived, ServoNum: %i, pos: %.2f, inc: %.2f, actDur: %d", 
-              servoNum_, position_, increment_, actualDuration );
-            logAniservo.trace("Summary, inc: %.2f , MS Per Move Unit: %.2f", 
-                increment_, MSPerMoveUnit);
+            logAniservo.trace("Arrived, ServoNum: %i, pos: %.2f, speed: %.2f, actDur: %d", 
+              servoNum_, position_, speed_, actualDuration );
+            logAniservo.trace("Summary, speed: %.2f , MS Per Move Unit: %.2f", 
+                speed_, MSPerMoveUnit);
+
+        }
+    }
+
+}
+
+/* ----- setLimits -----
+ * Tell the servo the two ends of its mechanical travel. Time spent holding
+ * at either end is counted in the wear counters. The order does not matter.
+ */
+void TPP_AnimateServo::setLimits(int limitA, int limitB) volatile {
+
+    limitLow_ = min(limitA, limitB);
+    limitHigh_ = max(limitA, limitB);
+
+}
+
+/* ----- setTracing -----
+ * Trace logging of every move and arrival, for all servos. Turned off when
+ * loop() is short of time.
+ */
+void TPP_AnimateServo::setTracing(bool on) {
+
+    tracing_ = on;
+
+}
+
+/* ----- getPosition -----
+ * Returns the PWM value last sent to the servo
+ */
+int TPP_AnimateServo::getPosition() volatile {
+
+    return floor(position_);
+
+}
+
+/* ----- setOffset -----
+ * ticks is added to every position sent to the servo from now on, whether it is
+ * moving or not. The servo still stops at its limits.
+ */
+void TPP_AnimateServo::setOffset(int ticks) volatile {
+
+    if (ticks != offset_) {
+        offset_ = ticks;
+        offsetChanged_ = true;
+    }
+
+}
+
+/* ----- commandServo -----
+ * Sends the position, plus the offset, to the servo
+ */
+void TPP_AnimateServo::commandServo() volatile {
+
+    int newPosition = floor(position_) + offset_;
+    if (limitLow_ >= 0) {
+        newPosition = constrain(newPosition, limitLow_, limitHigh_);
+    }
+    offsetChanged_ = false;
+    if (newPosition == lastCommanded_) {
+        return;     // the servo is already there
+    }
+    pwm_.setPWM (servoNum_, 0, newPosition);
+    updateWear(newPosition);
+
+}
+
+/* ----- getWear -----
+ * Returns a copy of the wear counters for this servo
+ */
+TPP_ServoWear TPP_AnimateServo::getWear() volatile {
+
+    TPP_ServoWear wear;
+    wear.travelTicks = wear_.travelTicks;
+    wear.reversals = wear_.reversals;
+    wear.msMoving = wear_.msMoving;
+    wear.msAtLimit = wear_.msAtLimit;
+    wear.peakSpeed = wear_.peakSpeed;
+    return wear;
+
+}
+
+/* ----- updateWear -----
+ * Called each time a new position is sent to the servo. Adds the distance
+ * moved to the travel counter and counts a reversal when the direction changes.
+ */
+void TPP_AnimateServo::updateWear(int newPosition) volatile {
+
+    int step = newPosition - lastCommanded_;
+    lastCommanded_ = newPosition;
+
+    if (step == 0) {
+        return;
+    }
+
+    wear_.travelTicks += abs(step);
+
+    int direction = (step > 0) ? 1 : -1;
+    if (lastDirection_ != 0 && direction != lastDirection_) {
+        wear_.reversals++;
+    }
+    lastDirection_ = direction;
+
+}
+
+/* ----- loadWear -----
+ * Reads this servo's wear counters back from EEPROM. If nothing valid has
+ * been saved yet the counters start from zero.
+ */
+void TPP_AnimateServo::loadWear() volatile {
+
+    uint32_t magic = 0;
+    EEPROM.get(WEAR_EEPROM_ADDR, magic);
+    if (magic != WEAR_EEPROM_MAGIC) {
+        return;
+    }
+
+    TPP_ServoWear wear;
+    EEPROM.get(WEAR_EEPROM_ADDR + sizeof(magic) + servoNum_ * sizeof(TPP_ServoWear), wear);
+    if (wear.travelTicks == 0xFFFFFFFF) {
+        return;     // erased: a slot not saved to yet, as when there were only 6
+    }
+    wear_.travelTicks = wear.travelTicks;
+    wear_.reversals = wear.reversals;
+    wear_.msMoving = wear.msMoving;
+    wear_.msAtLimit = wear.msAtLimit;
+    wear_.peakSpeed = wear.peakSpeed;
+
+    logAniservo.info("Servo: %d wear loaded, travel: %lu", servoNum_, (unsigned long)wear.travelTicks);
 
+}
+
+/* ----- saveWear -----
+ * Writes the wear counters of every servo to EEPROM. The EEPROM is emulated
+ * in flash so don't call this more often than every few minutes.
+ */
+void TPP_AnimateServo::saveWear() {
+
+    uint32_t magic = 0;
+    EEPROM.get(WEAR_EEPROM_ADDR, magic);
+
+    for (int i = 0; i < MAX_SERVOS; i++) {
+
+        TPP_ServoWear wear = {0, 0, 0, 0, 0};
+        if (wearServos_[i] != NULL) {
+            wear = wearServos_[i]->getWear();
+        } else if (magic == WEAR_EEPROM_MAGIC) {
+            continue;   // keep what is already saved for servos not in use
         }
+        EEPROM.put(WEAR_EEPROM_ADDR + sizeof(magic) + i * sizeof(TPP_ServoWear), wear);
+
     }
 
+    magic = WEAR_EEPROM_MAGIC;
+    EEPROM.put(WEAR_EEPROM_ADDR, magic);
+
+}
+
+/* ----- registerMetrics -----
+ * Adds servo_moves_total, the moveTo() calls of all servos, and servo_us_per_tick, a
+ * histogram of the time per tick of travel of every move that arrived
+ */
+void TPP_AnimateServo::registerMetrics(TPP_Metrics &metrics) {
+
+    movesMetric_ = metrics.counter("servo_moves_total");
+    usPerTickMetric_ = metrics.histogram("servo_us_per_tick", usPerTickBounds,
+                                         sizeof(usPerTickBounds) / sizeof(usPerTickBounds[0]));
+
+}
+
+/* ----- i2cReport -----
+ * The servo board's I2C error counters, for a cloud variable. Returns the length.
+ */
+int TPP_AnimateServo::i2cReport(char *buffer, int bufferSize) {
+
+    return pwm_.healthReport(buffer, bufferSize);
+
+}
+
+PCA9685_I2CHealth TPP_AnimateServo::getI2CHealth() {
+
+    return pwm_.getHealth();
+
 }
 
+/* ----- wearReport -----
+ * Formats the wear counters of every servo into buffer, one entry per servo:
+ *   servoNum:travelTicks,reversals,msMoving,msAtLimit,peakSpeed;
+ * Returns the length of the string.
+ */
+int TPP_AnimateServo::wearReport(char *buffer, int bufferSize) {
+
+    int len = 0;
+    buffer[0] = 0;
+
+    for (int i = 0; i < MAX_SERVOS && len < bufferSize; i++) {
+
+        if (wearServos_[i] == NULL) {
+            continue;
+        }
+        TPP_ServoWear wear = wearServos_[i]->getWear();
+        len += snprintf(buffer + len, bufferSize - len, "%d:%lu,%lu,%lu,%lu,%.1f;", i,
+            (unsigned long)wear.travelTicks, (unsigned long)wear.reversals,
+            (unsigned long)wear.msMoving, (unsigned long)wear.msAtLimit, wear.peakSpeed);
+
+    }
+
+    return min(len, bufferSize - 1);
+
+}
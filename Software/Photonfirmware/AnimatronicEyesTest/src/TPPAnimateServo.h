@@ -9,10 +9,50 @@
  * 
  * Instantiate this class, and it will create an instance of the AdaFruit PWM Servo Driver.
  * Key methods
- *      begin:  pass in the servo number on the AdaFruit servo driver board
+ *      begin:  pass in the servo number on the AdaFruit servo driver board, and where
+ *              it should start. See Warm start.
  *      moveTo: pass in a target PWM duration and increment 
  *      process: called over and over to cause the servo to move from its current
  *              position to the new target position
+ *      getPosition: where the servo is now, in PWM ticks
+ *      setTracing: turns the trace logging of each move and arrival on (the default) or off
+ *      setOffset: a few ticks added to every position sent to the servo, for
+ *              micro-motion on top of the moves
+ *      setLimits: tell the servo where the ends of its mechanical travel are, used
+ *              for the wear counters and to stop an overshoot
+ *      i2cReport: the servo board's I2C error counters, see Adafruit_PWMServoDriver
+ *      registerMetrics: adds the moves started and the time per tick of each move
+ *              to a metrics registry, for all servos
+ * 
+ * Retargeting
+ *      moveTo() may be called again before the servo gets to its destination, as
+ *      the roaming sequences do all the time. The servo keeps the velocity it has
+ *      and blends into the new move: it speeds up, slows down or turns round at no
+ *      more than SERVO_ACCEL ticks per step per step, and brakes in time to stop
+ *      at the destination. A move reversed at speed may overshoot by up to
+ *      speed^2 / (2 * SERVO_ACCEL) ticks before it comes back, never past the limits.
+ *      MOVE_SPEED_IMMEDIATE (or faster) still jumps straight to the destination.
+ *      A move that takes over from an immediate one starts from no more than its
+ *      own speed.
+ * 
+ * Warm start
+ *      The servo board keeps its power and its PWM outputs when the Photon resets.
+ *      Then the board is not set up again, and the PWM of all 16 channels is read
+ *      back in two auto-increment bursts, by the first begin() (in setup(), not in
+ *      a constructor: the board's driver is a global of another file, and may not
+ *      be constructed yet when the sketch's globals are). begin() starts each
+ *      servo from where the board has it and eases to the start position at
+ *      WARM_START_SPEED, instead of snapping there. From power on the board's
+ *      outputs are off, and begin() sends the start position straight away.
+ * 
+ * Wear counters
+ *      Each servo keeps counters of how hard it has been worked: travel in PWM ticks,
+ *      direction reversals, time moving, time holding at a limit and the peak
+ *      commanded speed. They are updated in process() at a fixed cost per call.
+ *      saveWear() writes the counters of all servos to EEPROM, begin() reads them 
+ *      back, and wearReport() formats them for a cloud variable. Every channel of
+ *      the board has its own slot in EEPROM, by servo number, so a mechanism on
+ *      the upper channels keeps counters too.
  * 
  * For full documentation see https://github/TeamPracticalProjects/XXXX
  * 
@@ -24,13 +64,35 @@
 #define _TPP_Servo_H
 
 #include <Adafruit_PWMServoDriver.h>
+#include <TPPMetrics.h>
 
 #define MOVE_SPEED_SLOW 1
 #define MOVE_SPEED_FAST 10
 #define MOVE_SPEED_IMMEDIATE 100
 
+#define SERVO_ACCEL 2.0     // most the speed may change in one step, ticks per step
+#define SERVO_ARRIVE_SPEED 2.0  // a servo this slow or slower stops dead at its destination
+
 #define SERVOMIN  140 // this is the 'minimum' pulse length count (out of 4096)
 #define SERVOMAX  520 // this is the 'maximum' pulse length count (out of 4096)
+#define SERVO_PWM_HZ PCA9685_SERVO_FREQ     // analog servos run at ~60 Hz updates
+#define WARM_START_SPEED MOVE_SPEED_SLOW    // from where the board has a servo to its start position
+
+#define MAX_SERVOS PCA9685_CHANNELS  // servos numbered 0 to MAX_SERVOS-1 keep wear counters
+
+#define WEAR_EEPROM_ADDR 0  // EEPROM address where the wear counters are stored
+#define WEAR_EEPROM_MAGIC 0x54505731 // "TPW1", marks valid wear counters in EEPROM
+
+/*!
+ *  @brief  Wear and duty cycle counters for one servo
+ */
+struct TPP_ServoWear {
+    uint32_t travelTicks;   // total distance commanded, in PWM ticks
+    uint32_t reversals;     // number of times the direction of travel changed
+    uint32_t msMoving;      // total time spent moving toward a destination
+    uint32_t msAtLimit;     // total time spent holding at either end of travel
+    float peakSpeed;        // fastest speed ever commanded in moveTo()
+};
 
 /*!
  *  @brief  Class that stores state and functions for interacting with the animatronic eyeball mechanism
@@ -42,18 +104,46 @@ class TPP_AnimateServo{
         void begin(int servoNum, int postion) volatile;
         void process() volatile; // called every time in the loop to keep the eyes moving
         int moveTo (int newX, float speed) volatile;
+        void setLimits(int limitA, int limitB) volatile;
+        int getPosition() volatile;
+        void setOffset(int ticks) volatile;
+        TPP_ServoWear getWear() volatile;
+
+        static void saveWear();
+        static int wearReport(char *buffer, int bufferSize);
+        static int i2cReport(char *buffer, int bufferSize);
+        static PCA9685_I2CHealth getI2CHealth();
+        static void setTracing(bool on);
+        static void registerMetrics(TPP_Metrics &metrics);
 
     private:
         
-        void initPWM();      // called once in the class inititator to init pwm library
+        static void initPWM();  // called once, by the first begin(), to init pwm library
+        static bool warmStart_;                          // the board was running, startPWM_ is valid
+        static uint16_t startPWM_[PCA9685_CHANNELS];     // OFF tick of each channel, read back at start
         volatile int servoNum_ = 0;          // Number of this servo on the driver board 
         volatile float position_ = -1;       // the current position of the servo
         volatile int destination_ = 0;       // the position we are heading towards
-        volatile float increment_ = 1;       // increment we are using to get from position to destination
-        volatile int lastMoveMade_ = 0;      // time the last time we moved the servo position
+        volatile float speed_ = 1;           // speed of the move, ticks per step
+        volatile float velocity_ = 0;        // ticks moved in the last step, negative counting down
+        volatile bool immediate_ = false;    // move at full speed from the first step
+        volatile int offset_ = 0;            // added to the position sent to the servo
+        volatile bool offsetChanged_ = false;// send the position again even if not moving
+        void commandServo() volatile;
+        volatile unsigned long lastMoveMade_ = 0;  // time the last time we moved the servo position
+
+        // wear counters
+        void updateWear(int newPosition) volatile;
+        void loadWear() volatile;
+        volatile TPP_ServoWear wear_ = {0, 0, 0, 0, 0};
+        volatile int limitLow_ = -1;         // low end of mechanical travel, -1 if not known
+        volatile int limitHigh_ = -1;        // high end of mechanical travel, -1 if not known
+        volatile int lastCommanded_ = -1;    // last PWM value sent to the servo
+        volatile int lastDirection_ = 0;     // direction of the last step: -1, 0 or 1
+        volatile unsigned long lastProcessMS_ = 0; // millis() of the last call to process()
         
         // used for debugging
-        volatile int timeStart_ = 0;         // time we started moving. Used for debug
+        volatile unsigned long timeStart_ = 0;     // time we started moving. Used for debug
         volatile int startPosition_ = 0;     // position at the start of the move. Used for debug
         volatile bool lastDebugNeedsPrinting_ = true;// in debugging used to print a message when destination is reached
                                             // set to true when a new destination is set 
@@ -10,7 +10,8 @@
  * the objects from the previous scene to the new scene.
  * 
  * The scene control will ask each object how long it will take to reach the new position and
- * wait that long before moving to the next scene. 
+ * wait that long before moving to the next scene. The wait is a timer on the timer wheel,
+ * so nothing is checked until the next scene is due.
  * 
  * When adding a scene you specify a "delay". A delay of 0 means to move to the next scene as 
  * soon as the time specified by the objects is exceeded. 
@@ -27,11 +28,16 @@
  * Instantiate this class, and it will create an instance of the TPPAnimatepuppet library.
  * 
  * Key methods
+ *      .begin()  reserves the scene list, room for maxScenes, from the arena, and
+ *              sets the timer wheel the scene waits are kept on
  *      .process()  called over and over to cause the objects to move from current
  *              position to the new target position. This function in turn calls process()
  *              on each of the other control objects
  *      .addScene()  as described above, adds a new scene to the end of the scene list
  *      .startRunning()  starts the animation list running from the first scene
+ *      .getRunCount(), .getScenesPlayed(), .getOverflowCount()  statistics since power on:
+ *              runs started, scenes set and scenes lost because the list was full
+ *      .registerMetrics()  adds how late scenes change to a metrics registry
  * 
  * still to come
  *      .stopRunning()
@@ -48,6 +54,9 @@
 
 Logger logAnilist("app.anilist");
 
+// upper bounds of the scene lateness histogram, ms
+static const int32_t sceneLateBounds[] = {1, 2, 5, 10, 20, 50, 100};
+
 // The order of these must correspond to the order in the eScene enumeration
 const char* eSceneNames[8] {
     "sceneEyesAheadOpen",
@@ -60,6 +69,21 @@ const char* eSceneNames[8] {
     "sceneBlink"
 };
 
+/* ----- begin -----
+ * Reserves the scene list from the arena. Call in setup(), before any addScene().
+ * If the arena has no room, every scene added counts as an overflow. The sketch
+ * must call timers.process() every loop for the scenes to change.
+ */
+void animationList::begin(TPP_Arena &arena, TPP_TimerWheel &timers, int maxScenes) {
+
+    timers_ = &timers;
+    sceneBlock_ = arena.reserve("scenes", maxScenes * sizeof(sceneInfo));
+    sceneList_ = sceneBlock_ ? (sceneInfo *)sceneBlock_->getData() : NULL;
+    maxScenes_ = sceneBlock_ ? maxScenes : 0;
+    clearSceneList();
+
+}
+
 /* ------ addScene
  * Adds a scene to the end of the animation scene list
  * parameters
@@ -77,8 +101,9 @@ const char* eSceneNames[8] {
 int animationList::addScene(eScene sceneIn, int modifierIn, float speedIn, int delayAfterMoveMSIn){
 
     // is there room for another scene?
-    if (lastSceneIndex_ == MAX_SCENE - 1) {
+    if (lastSceneIndex_ >= maxScenes_ - 1) {
         logAnilist.warn("Too many scenes.");
+        overflowCount_++;
         return 1;
     }
 
@@ -88,6 +113,7 @@ int animationList::addScene(eScene sceneIn, int modifierIn, float speedIn, int d
     sceneList_[lastSceneIndex_].modifier = modifierIn;
     sceneList_[lastSceneIndex_].speed = speedIn;
     sceneList_[lastSceneIndex_].delayAfterMoveMS = delayAfterMoveMSIn;
+    sceneBlock_->use((lastSceneIndex_ + 1) * sizeof(sceneInfo));
 
     return 0;
 
@@ -99,8 +125,11 @@ int animationList::addScene(eScene sceneIn, int modifierIn, float speedIn, int d
 void animationList::startRunning(){
     
     isRunning_ = true;
-    nextSceneChangeMS_ = millis();
+    timers_->schedule(sceneTimer_, 1, sceneTimerDone, this);     // the first scene at the next ms
+    sceneDue_ = false;
+    sceneTimed_ = false;
     currentSceneIndex_ = -1;
+    runCount_++;
     logAnilist("starting animation run");
 
 }
@@ -120,6 +149,38 @@ bool animationList::isRunning(){
  */
 void animationList::stopRunning(){
     isRunning_ = false;
+    timers_->cancel(sceneTimer_);
+}
+
+/* ----- getRunCount -----
+ * returns the number of animation runs started since power on
+ */
+unsigned long animationList::getRunCount(){
+    return runCount_;
+}
+
+/* ----- getScenesPlayed -----
+ * returns the number of scenes set since power on
+ */
+unsigned long animationList::getScenesPlayed(){
+    return scenesPlayed_;
+}
+
+/* ----- getOverflowCount -----
+ * returns the number of scenes that could not be added
+ * since power on because the scene list was full
+ */
+unsigned long animationList::getOverflowCount(){
+    return overflowCount_;
+}
+
+/* ----- registerMetrics -----
+ * Adds anim_scene_late_ms, a histogram of how long after its time each scene
+ * changed, for the scenes that wait for the one before
+ */
+void animationList::registerMetrics(TPP_Metrics &metrics){
+    sceneLateMetric_ = metrics.histogram("anim_scene_late_ms", sceneLateBounds,
+                                         sizeof(sceneLateBounds) / sizeof(sceneLateBounds[0]));
 }
 
 /* ----- clearSceneList -----
@@ -129,8 +190,19 @@ void animationList::stopRunning(){
  */
 void animationList::clearSceneList(){
     isRunning_ = false;
+    timers_->cancel(sceneTimer_);
     currentSceneIndex_ = -1;
     lastSceneIndex_ = -1;
+    if (sceneBlock_ != NULL) {
+        sceneBlock_->use(0);
+    }
+}
+
+/* ----- sceneTimerDone -----
+ * The scene timer's callback: the scene has had its time
+ */
+void animationList::sceneTimerDone(void *context){
+    ((animationList *)context)->sceneDue_ = true;
 }
 
 /* --------- process()
@@ -140,20 +212,26 @@ void animationList::clearSceneList(){
 void animationList::process() {
 
     bool sceneChangeNow = false;
-    int runTime = millis();
     int timeToFinishScene_ = 0;    
 
-    // if not running, then exit
+    // if not running, then exit. Eyes pursuing a target or wandering still need to move.
     if (!isRunning_) {
+        if (puppet.isMoving()) {
+            puppet.process();
+        }
         return;
     }
 
     // Is it time to change to the next scene?
-    if (runTime > nextSceneChangeMS_) {
+    if (sceneDue_) {
 
+        sceneDue_ = false;
         currentSceneIndex_++;
         if (currentSceneIndex_ <= lastSceneIndex_) {
             sceneChangeNow = true;
+            if (sceneTimed_) {
+                sceneLateMetric_.observe(millis() - sceneTimer_.getDeadline());
+            }
             logAnilist.trace("moving to scene list # %d ", currentSceneIndex_);
         } else {
             logAnilist.trace("Last Scene has played");
@@ -174,15 +252,21 @@ void animationList::process() {
         float thisSpeed = sceneList_[currentSceneIndex_].speed;
 
         timeToFinishScene_ = setScene(thisScene, thisModifier, thisSpeed); //XXX, &puppet);
+        scenesPlayed_++;
 
         // Should we wait for the servos to finish moving?
         if (sceneList_[currentSceneIndex_].delayAfterMoveMS > -1 ){
 
-            nextSceneChangeMS_ = millis() + timeToFinishScene_ + sceneList_[currentSceneIndex_].delayAfterMoveMS;
+            // the next scene starts the ms after the wait is over
+            int waitMS = max(timeToFinishScene_ + sceneList_[currentSceneIndex_].delayAfterMoveMS, 0) + 1;
+            timers_->schedule(sceneTimer_, waitMS, sceneTimerDone, this);
+            sceneTimed_ = true;
+            logAnilist.trace("Next scene at: %lu", (unsigned long)sceneTimer_.getDeadline());
 
-        }  // else the scene will change on the very next call to this process() routine
-        
-        logAnilist.trace("Next scene at: %d",nextSceneChangeMS_);
+        } else {
+            sceneDue_ = true;       // the scene will change on the very next call to this process() routine
+            sceneTimed_ = false;
+        }
     }
 
     puppet.process();
@@ -202,12 +286,12 @@ int animationList::setScene(eScene newScene, int modifier, float speed) { //, TP
     switch (newScene) {
 
         case sceneEyesAheadOpen:
-            timeForSceneChange = puppet.eyeballs.lookCenter(speed) ;
+            timeForSceneChange = puppet.eyeballs().lookCenter(speed) ;
             timeForSceneChange = puppet.eyesOpen(50, speed);
             break;
 
         case sceneEyesAhead: 
-            timeForSceneChange = puppet.eyeballs.lookCenter(speed) ;
+            timeForSceneChange = puppet.eyeballs().lookCenter(speed) ;
             break;
 
         case sceneEyesOpen:
@@ -216,11 +300,11 @@ int animationList::setScene(eScene newScene, int modifier, float speed) { //, TP
             break;
 
         case sceneEyesLeftRight:
-            timeForSceneChange = puppet.eyeballs.positionX(modifier,speed); 
+            timeForSceneChange = puppet.eyeballs().positionX(modifier,speed); 
             break;
 
         case sceneEyesUpDown:
-            timeForSceneChange = puppet.eyeballs.positionY(modifier,speed);
+            timeForSceneChange = puppet.eyeballs().positionY(modifier,speed);
             break;
 
         case sceneBlink:
@@ -228,13 +312,13 @@ int animationList::setScene(eScene newScene, int modifier, float speed) { //, TP
             break;
 
         case sceneEyelidsLeft:
-            timeForSceneChange = puppet.eyelidLeftUpper.position(modifier, speed);
-            timeForSceneChange = puppet.eyelidLeftLower.position(modifier, speed);
+            timeForSceneChange = puppet.eyelidLeftUpper().position(modifier, speed);
+            timeForSceneChange = puppet.eyelidLeftLower().position(modifier, speed);
             break;
 
         case sceneEyelidsRight:
-            timeForSceneChange = puppet.eyelidRightUpper.position(modifier, speed);
-            timeForSceneChange = puppet.eyelidRightLower.position(modifier, speed);
+            timeForSceneChange = puppet.eyelidRightUpper().position(modifier, speed);
+            timeForSceneChange = puppet.eyelidRightLower().position(modifier, speed);
             break;
 
         default:
@@ -10,7 +10,8 @@
  * the objects from the previous scene to the new scene.
  * 
  * The scene control will ask each object how long it will take to reach the new position and
- * wait that long before moving to the next scene. 
+ * wait that long before moving to the next scene. The wait is a timer on the timer wheel,
+ * so nothing is checked until the next scene is due.
  * 
  * When adding a scene you specify a "delay". A delay of 0 means to move to the next scene as 
  * soon as the time specified by the objects is exceeded. 
@@ -27,11 +28,15 @@
  * Instantiate this class, and it will create an instance of the TPPAnimateHead library.
  * 
  * Key methods
+ *      .begin()  reserves the scene list, room for maxScenes, from the arena, and
+ *              sets the timer wheel the scene waits are kept on
  *      .process()  called over and over to cause the objects to move from current
  *              position to the new target position. This function in turn calls process()
  *              on each of the other control objects
  *      .addScene()  as described above, adds a new scene to the end of the scene list
  *      .startRunning()  starts the animation list running from the first scene
+ *      .getRunCount(), .getScenesPlayed(), .getOverflowCount()  statistics since power on:
+ *              runs started, scenes set and scenes lost because the list was full
  * 
  * still to come
  *      .stopRunning()
@@ -50,6 +55,9 @@
 #define MAX_SCENE 100
 
 #include <TPPAnimatePuppet.h>
+#include <TPPArena.h>
+#include <TPPMetrics.h>
+#include <TPPTimerWheel.h>
 //#include <Wire.h> // DO NOT USE Serial.anything, it is not thread safe. Use Log.
 
 enum eScene {
@@ -71,12 +79,17 @@ enum eScene {
 
 class animationList {
     public:
+        void begin(TPP_Arena &arena, TPP_TimerWheel &timers, int maxScenes = MAX_SCENE);
         int addScene(eScene scene, int modifier, float speed, int delayAfterMoveMS);
         void process();
         void startRunning();
         bool isRunning();
         void stopRunning();
         void clearSceneList();
+        unsigned long getRunCount();
+        unsigned long getScenesPlayed();
+        unsigned long getOverflowCount();
+        void registerMetrics(TPP_Metrics &metrics);
         TPP_Puppet puppet;
 
     private: 
@@ -86,15 +99,27 @@ class animationList {
             float speed;
             int delayAfterMoveMS;
         };
-        sceneInfo sceneList_[MAX_SCENE]; // list of scenes to be played in order
+        sceneInfo *sceneList_ = NULL;   // list of scenes to be played in order, in the arena
+        TPP_ArenaBlock *sceneBlock_ = NULL;
+        int maxScenes_ = 0;
        
         int setScene(eScene newScene, int modifier, float speed); //XXX, TPP_Head *theHead);
 
         int currentSceneIndex_ = 0;     // index into sceneList of the scene currently displayed
         int lastSceneIndex_ = -1;       // index into sceneList of the last valid scene
-        int nextSceneChangeMS_ = 0;    // millis() when the scene should move to the next in the sceneList
+        static void sceneTimerDone(void *context);
+        TPP_TimerWheel *timers_ = NULL;
+        TPP_Timer sceneTimer_;          // runs out when the scene should move to the next in the sceneList
+        bool sceneDue_ = false;         // time to move to the next scene
+        bool sceneTimed_ = false;       // sceneTimer_ was set by a scene that waits
         bool isRunning_ = false;
 
+        // statistics since power on
+        unsigned long runCount_ = 0;        // number of calls to startRunning()
+        unsigned long scenesPlayed_ = 0;    // number of scenes set
+        unsigned long overflowCount_ = 0;   // number of scenes not added because the list was full
+        TPP_Histogram sceneLateMetric_;     // ms each waiting scene changed after it was due
+
 };
 
 
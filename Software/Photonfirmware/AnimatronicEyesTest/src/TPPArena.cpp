@@ -0,0 +1,88 @@
+/*
+ * TPPArena.cpp
+ *
+ * Team Practical Project static memory arena
+ *
+ * Fixed size blocks reserved at startup, with usage and high-water marks.
+ * See TPPArena.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <TPPArena.h>
+
+Logger logArena("app.arena");
+
+/* ----- use -----
+ * Bytes of the block in use now, by the subsystem's own count
+ */
+void TPP_ArenaBlock::use(size_t bytes) {
+
+    used_ = min(bytes, size_);
+    if (used_ > highWater_) {
+        highWater_ = used_;
+    }
+
+}
+
+/* ----- reserve -----
+ * A block of bytes, aligned to ARENA_ALIGN, for the rest of the run. Returns NULL
+ * (and logs why) if the arena is sealed, out of blocks or out of room.
+ */
+TPP_ArenaBlock *TPP_Arena::reserve(const char *name, size_t bytes) {
+
+    size_t start = (reserved_ + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (sealed_ || numBlocks_ == ARENA_MAX_BLOCKS || start + bytes > ARENA_BYTES) {
+        failures_++;
+        logArena.error("no room for %s, %u bytes: %u of %u reserved%s", name, (unsigned)bytes,
+                       (unsigned)reserved_, (unsigned)ARENA_BYTES, sealed_ ? ", sealed" : "");
+        return NULL;
+    }
+
+    TPP_ArenaBlock &block = blocks_[numBlocks_++];
+    block.name_ = name;
+    block.data_ = memory_ + start;
+    block.size_ = bytes;
+    block.used_ = 0;
+    block.highWater_ = 0;
+    memset(block.data_, 0, bytes);
+    reserved_ = start + bytes;
+    logArena.info("%s: %u bytes", name, (unsigned)bytes);
+    return &block;
+
+}
+
+/* ----- seal -----
+ * No more blocks after this
+ */
+void TPP_Arena::seal() {
+
+    sealed_ = true;
+    logArena.info("sealed, %u of %u bytes reserved in %d blocks", (unsigned)reserved_,
+                  (unsigned)ARENA_BYTES, numBlocks_);
+
+}
+
+TPP_ArenaBlock *TPP_Arena::getBlock(int block) {
+
+    return (block >= 0 && block < numBlocks_) ? &blocks_[block] : NULL;
+
+}
+
+/* ----- report -----
+ * "arena R/S bytes, F failed; name used/size (max H), ..."
+ * Returns the length of the string.
+ */
+int TPP_Arena::report(char *buffer, int bufferSize) {
+
+    int len = snprintf(buffer, bufferSize, "arena %u/%u bytes, %lu failed", (unsigned)reserved_,
+                       (unsigned)ARENA_BYTES, failures_);
+    for (int b = 0; b < numBlocks_ && len < bufferSize; b++) {
+        TPP_ArenaBlock &block = blocks_[b];
+        len += snprintf(buffer + len, bufferSize - len, "; %s %u/%u (max %u)", block.name_,
+                        (unsigned)block.used_, (unsigned)block.size_, (unsigned)block.highWater_);
+    }
+    return min(len, bufferSize - 1);
+
+}
@@ -0,0 +1,85 @@
+/*
+ * TPPArena.h
+ *
+ * Team Practical Project static memory arena
+ *
+ * The Photon has little RAM, and nothing here showed how much of it was in use.
+ * Instead of each library keeping its own fixed array, or allocating from the heap
+ * as it goes, every subsystem reserves the memory it needs from one arena of
+ * ARENA_BYTES, fixed at compile time, in its begin(). After setup() the sketch
+ * seals the arena; nothing is allocated after that, so memory use can't creep up
+ * or fragment over days of running, and what it is is known at startup.
+ *
+ * Each reservation is a block with a name. The subsystem tells its block how much
+ * of it is in use whenever that changes (scenes queued, cues waiting, samples
+ * captured), and the block keeps the high-water mark. That shows which blocks are
+ * bigger than they need to be, and which ran full.
+ *
+ * Key methods
+ *      .reserve()      during begin(): a block of bytes with a name, or NULL if the
+ *                      arena is full or sealed
+ *      .seal()         call at the end of setup(); any later reserve() fails
+ *      .report()       the arena and every block, used and high-water, as text, for
+ *                      a cloud variable
+ *
+ *  TPP_ArenaBlock
+ *      .getData()      the block's memory, aligned for any type
+ *      .use()          bytes in use now; keeps the high-water mark
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_ARENA_H
+#define _TPP_ARENA_H
+
+#include <Arduino.h>
+
+#define ARENA_BYTES 2560            // scene list, show cue queue and control packet, with room to spare
+#define ARENA_MAX_BLOCKS 8
+#define ARENA_ALIGN 8
+
+class TPP_ArenaBlock {
+
+    public:
+        void *getData() { return data_; }
+        const char *getName() { return name_; }
+        size_t getSize() { return size_; }
+        size_t getUsed() { return used_; }
+        size_t getHighWater() { return highWater_; }
+        void use(size_t bytes);
+
+    private:
+        friend class TPP_Arena;
+        const char *name_ = "";
+        uint8_t *data_ = NULL;
+        size_t size_ = 0;
+        size_t used_ = 0;
+        size_t highWater_ = 0;
+
+};
+
+class TPP_Arena {
+
+    public:
+        TPP_ArenaBlock *reserve(const char *name, size_t bytes);
+        void seal();
+        bool isSealed() { return sealed_; }
+        size_t getSize() { return ARENA_BYTES; }
+        size_t getReserved() { return reserved_; }
+        int getBlocks() { return numBlocks_; }
+        TPP_ArenaBlock *getBlock(int block);
+        unsigned long getFailures() { return failures_; }
+        int report(char *buffer, int bufferSize);
+
+    private:
+        alignas(ARENA_ALIGN) uint8_t memory_[ARENA_BYTES];
+        size_t reserved_ = 0;
+        TPP_ArenaBlock blocks_[ARENA_MAX_BLOCKS];
+        int numBlocks_ = 0;
+        bool sealed_ = false;
+        unsigned long failures_ = 0;    // reserve() calls refused
+
+};
+
+#endif
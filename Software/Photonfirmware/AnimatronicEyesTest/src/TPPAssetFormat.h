@@ -0,0 +1,99 @@
+/*
+ * TPPAssetFormat.h
+ *
+ * Team Practical Project asset pack format
+ *
+ * Servo settings, scene sequences and envelope tracks, packed into one read-only
+ * block by the asset packer on a PC (Software/HostTools/AssetPack) and read in
+ * place by TPP_AssetPack. The packer includes the copy in AnimatronicEyesTest; the
+ * copies in other firmware projects must stay the same.
+ *
+ * Layout, all little endian:
+ *      AssetPackHeader
+ *      AssetIndexEntry[count]      sorted by id, so a lookup is a binary search
+ *      data                        each asset's data starts on an ASSET_ALIGN boundary
+ *
+ * An asset is found by the id of its name (assetId(), FNV-1a), never by the name
+ * itself, so the names cost no space in the pack. The packer refuses two names with
+ * the same id. The checksum covers everything after the header; a pack that doesn't
+ * match is not used.
+ *
+ * Asset data by type. count in the index entry is the number of items:
+ *      assetSetting    int32_t[count]
+ *      assetSequence   AssetScene[count]
+ *      assetEnvelope   AssetEnvelopeHeader, then uint16_t samples[count], 0 - 4095
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_ASSET_FORMAT_H
+#define _TPP_ASSET_FORMAT_H
+
+#include <stdint.h>
+
+#define ASSET_PACK_MAGIC 0x4B415054     // "TPAK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_ALIGN 4
+
+enum eAssetType {
+    assetSetting = 1,
+    assetSequence,
+    assetEnvelope
+};
+
+struct __attribute__((packed)) AssetPackHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t count;         // index entries
+    uint32_t size;          // bytes in the whole pack, header included
+    uint32_t checksum;      // assetChecksum() of the bytes after the header
+};
+
+struct __attribute__((packed)) AssetIndexEntry {
+    uint32_t id;            // assetId() of the name
+    uint8_t type;           // eAssetType
+    uint8_t reserved;
+    uint16_t count;         // items in the data
+    uint32_t offset;        // from the start of the pack
+    uint32_t length;        // bytes
+};
+
+// One scene of a sequence, as passed to animationList::addScene()
+struct __attribute__((packed)) AssetScene {
+    uint8_t scene;          // eScene
+    uint8_t reserved;
+    int16_t modifier;
+    uint16_t speedX100;     // speed x 100
+    int16_t delayAfterMS;
+};
+
+struct __attribute__((packed)) AssetEnvelopeHeader {
+    uint16_t intervalMS;    // between samples
+    uint16_t reserved;
+};
+
+// FNV-1a of the name
+inline uint32_t assetId(const char *name) {
+
+    uint32_t hash = 2166136261u;
+    while (*name != 0) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    return hash;
+
+}
+
+// FNV-1a of length bytes
+inline uint32_t assetChecksum(const uint8_t *data, uint32_t length) {
+
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * TPPAssetPack.cpp
+ *
+ * Team Practical Project asset pack reader
+ *
+ * Binary search of the pack index, and reads in place. See TPPAssetPack.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <TPPAssetPack.h>
+
+Logger logAssets("app.assets");
+
+/* ----- begin -----
+ * Checks the pack: magic, version, size, checksum, and an index that is sorted and
+ * points inside the pack. Returns false if any is wrong; the pack is then not used.
+ */
+bool TPP_AssetPack::begin(const uint8_t *pack, uint32_t size) {
+
+    pack_ = NULL;
+    index_ = NULL;
+    count_ = 0;
+
+    const AssetPackHeader *header = (const AssetPackHeader *)pack;
+    if (pack == NULL || size < sizeof(AssetPackHeader) || header->magic != ASSET_PACK_MAGIC ||
+        header->version != ASSET_PACK_VERSION || header->size != size) {
+        logAssets.error("no asset pack");
+        return false;
+    }
+    if (assetChecksum(pack + sizeof(AssetPackHeader), size - sizeof(AssetPackHeader)) != header->checksum) {
+        logAssets.error("asset pack checksum wrong");
+        return false;
+    }
+    const AssetIndexEntry *index = (const AssetIndexEntry *)(pack + sizeof(AssetPackHeader));
+    if (sizeof(AssetPackHeader) + header->count * sizeof(AssetIndexEntry) > size) {
+        logAssets.error("asset pack index too long");
+        return false;
+    }
+    for (int i = 0; i < header->count; i++) {
+        if (index[i].offset > size || index[i].length > size - index[i].offset ||
+            (i > 0 && index[i].id <= index[i - 1].id)) {
+            logAssets.error("asset pack index entry %d bad", i);
+            return false;
+        }
+    }
+
+    pack_ = pack;
+    index_ = index;
+    count_ = header->count;
+    logAssets.info("asset pack: %d assets, %lu bytes", count_, (unsigned long)size);
+    return true;
+
+}
+
+/* ----- find -----
+ * The index entry of name, by binary search on its id, or NULL if it isn't in the
+ * pack as that type
+ */
+const AssetIndexEntry *TPP_AssetPack::find(const char *name, eAssetType type) {
+
+    uint32_t id = assetId(name);
+    int low = 0;
+    int high = count_ - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (index_[middle].id == id) {
+            return (index_[middle].type == type) ? &index_[middle] : NULL;
+        }
+        if (index_[middle].id < id) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return NULL;
+
+}
+
+/* ----- getSetting -----
+ * Value number item of the setting name, or fallback if the pack doesn't have it
+ */
+int TPP_AssetPack::getSetting(const char *name, int fallback, int item) {
+
+    const AssetIndexEntry *entry = find(name, assetSetting);
+    if (entry == NULL || item < 0 || item >= entry->count) {
+        return fallback;
+    }
+    return ((const int32_t *)(pack_ + entry->offset))[item];
+
+}
+
+/* ----- getSequence -----
+ * Points scenes at the sequence name in the pack. Returns the number of scenes, 0
+ * if the pack doesn't have it.
+ */
+int TPP_AssetPack::getSequence(const char *name, const AssetScene *&scenes) {
+
+    const AssetIndexEntry *entry = find(name, assetSequence);
+    if (entry == NULL) {
+        scenes = NULL;
+        return 0;
+    }
+    scenes = (const AssetScene *)(pack_ + entry->offset);
+    return entry->count;
+
+}
+
+/* ----- getEnvelope -----
+ * The samples of the envelope track name in the pack, with its size and the ms
+ * between samples, or NULL if the pack doesn't have it
+ */
+const uint16_t *TPP_AssetPack::getEnvelope(const char *name, int &size, int &intervalMS) {
+
+    const AssetIndexEntry *entry = find(name, assetEnvelope);
+    if (entry == NULL) {
+        size = 0;
+        intervalMS = 0;
+        return NULL;
+    }
+    const AssetEnvelopeHeader *header = (const AssetEnvelopeHeader *)(pack_ + entry->offset);
+    size = entry->count;
+    intervalMS = header->intervalMS;
+    return (const uint16_t *)(header + 1);
+
+}
@@ -0,0 +1,55 @@
+/*
+ * TPPAssetPack.h
+ *
+ * Team Practical Project asset pack reader
+ *
+ * Servo settings, scene sequences and envelope tracks used to be spread over
+ * #defines, C arrays and sequence functions, and each new one cost RAM and a code
+ * change. They can now come from one asset pack, made on a PC by the asset packer
+ * (Software/HostTools/AssetPack) from a text list of assets. The packer writes the
+ * pack as a const array, which the compiler leaves in flash. Nothing is copied into
+ * RAM: a lookup is a binary search of the pack's sorted index, and returns a pointer
+ * into the pack. See TPPAssetFormat.h for the layout.
+ *
+ * The sketch only names the assets it wants, so assets can be changed or added by
+ * running the packer again, without touching the firmware code. The reader works on
+ * any block of memory, so a pack in external flash would be read the same way.
+ *
+ * Key methods
+ *      .begin()        the pack and its size. Checks the header, index and checksum;
+ *                      returns false, and every lookup fails, if they are wrong.
+ *      .getSetting()   an int by name, or a fallback if the pack doesn't have it
+ *      .getSequence()  the scenes of a sequence by name, in place
+ *      .getEnvelope()  the samples of an envelope track by name, in place
+ *      .getCount()     assets in the pack
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_ASSET_PACK_H
+#define _TPP_ASSET_PACK_H
+
+#include <Arduino.h>
+#include <TPPAssetFormat.h>
+
+class TPP_AssetPack {
+
+    public:
+        bool begin(const uint8_t *pack, uint32_t size);
+        bool isValid() { return index_ != NULL; }
+        int getCount() { return count_; }
+        int getSetting(const char *name, int fallback, int item = 0);
+        int getSequence(const char *name, const AssetScene *&scenes);
+        const uint16_t *getEnvelope(const char *name, int &size, int &intervalMS);
+
+    private:
+        const AssetIndexEntry *find(const char *name, eAssetType type);
+
+        const uint8_t *pack_ = NULL;
+        const AssetIndexEntry *index_ = NULL;
+        int count_ = 0;
+
+};
+
+#endif
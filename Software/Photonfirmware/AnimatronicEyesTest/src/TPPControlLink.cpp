@@ -0,0 +1,219 @@
+/*
+ * TPPControlLink.cpp
+ *
+ * Team Practical Project local control, puppet side
+ *
+ * Answers call, get and list requests from a control client on the local
+ * network. See TPPControlLink.h and TPPControlProtocol.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <TPPControlLink.h>
+
+Logger logControl("app.control");
+
+/* ----- begin -----
+ * port is the UDP port to listen on. Listening starts once WiFi is ready.
+ * The packet buffer is reserved from the arena, with a byte to spare to end
+ * a call's text with a 0.
+ */
+void TPP_ControlLink::begin(int port, TPP_Arena &arena) {
+
+    port_ = port;
+    packetBlock_ = arena.reserve("control", CONTROL_MAX_PACKET + 1);
+    packet_ = packetBlock_ ? (uint8_t *)packetBlock_->getData() : NULL;
+
+}
+
+/* ----- function -----
+ * Adds a function the client can call by name. Returns false if the table
+ * is full or the name is too long.
+ */
+bool TPP_ControlLink::function(const char *name, TPP_ControlFunction function) {
+
+    if (numFunctions_ >= CONTROL_MAX_FUNCTIONS || strlen(name) >= CONTROL_NAME_SIZE) {
+        logControl.error("can't add function %s", name);
+        return false;
+    }
+    functions_[numFunctions_].name = name;
+    functions_[numFunctions_].function = function;
+    numFunctions_++;
+    return true;
+
+}
+
+/* ----- variable -----
+ * Adds a variable the client can get by name: a 0 terminated char buffer, an
+ * int, or a report function that writes the value into the reply. Returns false
+ * if the table is full or the name is too long.
+ */
+bool TPP_ControlLink::variable(const char *name, const char *text) {
+
+    return addVariable(name, text, NULL, NULL);
+
+}
+
+bool TPP_ControlLink::variable(const char *name, const int *value) {
+
+    return addVariable(name, NULL, value, NULL);
+
+}
+
+bool TPP_ControlLink::variable(const char *name, TPP_ControlReport report) {
+
+    return addVariable(name, NULL, NULL, report);
+
+}
+
+bool TPP_ControlLink::addVariable(const char *name, const char *text, const int *value, TPP_ControlReport report) {
+
+    if (numVariables_ >= CONTROL_MAX_VARIABLES || strlen(name) >= CONTROL_NAME_SIZE) {
+        logControl.error("can't add variable %s", name);
+        return false;
+    }
+    variables_[numVariables_].name = name;
+    variables_[numVariables_].text = text;
+    variables_[numVariables_].value = value;
+    variables_[numVariables_].report = report;
+    numVariables_++;
+    return true;
+
+}
+
+/* ----- answerCall -----
+ * Runs the function, with the request's text as its String argument
+ */
+void TPP_ControlLink::answerCall(ControlMessage &message) {
+
+    for (int i = 0; i < numFunctions_; i++) {
+        if (strcmp(functions_[i].name, message.name) == 0) {
+            ((char *)message.text)[message.textLength] = 0;     // there is a spare byte after the packet
+            logControl.info("call %s(\"%s\")", message.name, message.text);
+            message.result = functions_[i].function(String(message.text));
+            message.textLength = 0;
+            return;
+        }
+    }
+    message.status = controlUnknownName;
+
+}
+
+/* ----- answerGet -----
+ * Puts the variable's value in the reply's text. Long text is cut short
+ * to fit a packet. A report function is given the request's text.
+ */
+void TPP_ControlLink::answerGet(ControlMessage &message) {
+
+    char *text = (char *)packet_ + sizeof(ControlPacketHeader);
+    for (int i = 0; i < numVariables_; i++) {
+        const controlVariable &variable = variables_[i];
+        if (strcmp(variable.name, message.name) == 0) {
+            if (variable.text != NULL) {
+                message.textLength = strnlen(variable.text, CONTROL_MAX_TEXT);
+                message.text = variable.text;
+            } else if (variable.report != NULL) {
+                char argument[CONTROL_NAME_SIZE];   // the reply is written over the request
+                int n = min(message.textLength, CONTROL_NAME_SIZE - 1);
+                memcpy(argument, message.text, n);
+                argument[n] = 0;
+                message.textLength = constrain(variable.report(argument, text, CONTROL_MAX_TEXT), 0, CONTROL_MAX_TEXT);
+                message.text = text;
+            } else {
+                message.textLength = snprintf(text, CONTROL_MAX_TEXT, "%d", *variable.value);
+                message.text = text;
+            }
+            return;
+        }
+    }
+    message.status = controlUnknownName;
+
+}
+
+/* ----- answerList -----
+ * Puts every name in the reply's text, as many as fit
+ */
+void TPP_ControlLink::answerList(ControlMessage &message) {
+
+    char *text = (char *)packet_ + sizeof(ControlPacketHeader);
+    int length = 0;
+    for (int i = 0; i < numFunctions_ + numVariables_; i++) {
+        bool isFunction = i < numFunctions_;
+        const char *name = isFunction ? functions_[i].name : variables_[i - numFunctions_].name;
+        int n = snprintf(text + length, CONTROL_MAX_TEXT - length, "%s %s\n", isFunction ? "call" : "get", name);
+        if (n >= CONTROL_MAX_TEXT - length) {
+            break;
+        }
+        length += n;
+    }
+    message.text = text;
+    message.textLength = length;
+
+}
+
+/* ----- answer -----
+ * Reads one waiting request and answers it. Returns false if there was none.
+ */
+bool TPP_ControlLink::answer() {
+
+    int size = udp_.parsePacket();
+    if (size <= 0) {
+        return false;
+    }
+    int length = udp_.read(packet_, min(size, CONTROL_MAX_PACKET));
+    packetBlock_->use(length);
+
+    ControlMessage message;
+    if (size > CONTROL_MAX_PACKET || !controlDecode(packet_, length, message) || message.type == controlReply) {
+        errors_++;
+        return true;    // not one of ours; no answer
+    }
+
+    requests_++;
+    message.request = message.type;
+    message.type = controlReply;
+    message.status = controlOK;
+    message.result = 0;
+    switch (message.request) {
+        case controlCall:   answerCall(message);    break;
+        case controlGet:    answerGet(message);     break;
+        case controlList:   answerList(message);    break;
+        default:            message.status = controlBadRequest; break;
+    }
+    if (message.status != controlOK) {
+        errors_++;
+        message.textLength = 0;
+        logControl.warn("request %d for \"%s\" failed, status %d", message.request, message.name, message.status);
+    }
+
+    length = controlEncode(message, packet_, CONTROL_MAX_PACKET);
+    packetBlock_->use(length);
+    udp_.sendPacket(packet_, length, udp_.remoteIP(), udp_.remotePort());
+    return true;
+
+}
+
+/* ----- process -----
+ * Call every loop(). Answers up to CONTROL_MAX_PER_LOOP requests.
+ */
+void TPP_ControlLink::process() {
+
+    if (packet_ == NULL) {
+        return;
+    }
+    if (!listening_) {
+        if (!WiFi.ready()) {
+            return;
+        }
+        listening_ = udp_.begin(port_) != 0;
+        if (!listening_) {
+            return;
+        }
+        logControl.info("listening for control requests on port %d", port_);
+    }
+
+    for (int i = 0; i < CONTROL_MAX_PER_LOOP && answer(); i++) {
+    }
+
+}
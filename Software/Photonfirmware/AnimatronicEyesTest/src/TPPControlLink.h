@@ -0,0 +1,90 @@
+/*
+ * TPPControlLink.h
+ *
+ * Team Practical Project local control, puppet side
+ *
+ * Answers control requests from a client on the local network
+ * (Software/HostTools/PuppetControl) as described in TPPControlProtocol.h. The sketch
+ * gives the link the same functions and variables it gives the Particle cloud, and
+ * the client can then call and read them in a few ms with no internet, and without
+ * the cloud's limit on how many there are.
+ *
+ * Functions are int f(String), as for Particle.function(). Variables are a char
+ * buffer or an int, read when asked for, as for Particle.variable(), or a report
+ * function that writes the value when asked for, given the text of the request
+ * (for a value too big to keep, like a metrics snapshot). Names are kept
+ * as pointers, so pass string literals. The tables are fixed size; nothing is
+ * allocated except the String a function is called with.
+ *
+ * The UDP port is opened the first time process() is called with WiFi ready.
+ *
+ * Key methods
+ *      .begin()        sets the UDP port to listen on, and reserves the packet buffer
+ *                      from the arena
+ *      .function()     adds a function the client can call
+ *      .variable()     adds a variable the client can get
+ *      .process()      called every loop(). Answers the requests that have arrived.
+ *      .getRequests(), .getErrors()  statistics since power on: requests answered, and
+ *                      requests that were not understood or named nothing known
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_CONTROL_LINK_H
+#define _TPP_CONTROL_LINK_H
+
+#include <Arduino.h>
+#include <TPPControlProtocol.h>
+#include <TPPArena.h>
+
+#define CONTROL_MAX_FUNCTIONS 16
+#define CONTROL_MAX_VARIABLES 16
+#define CONTROL_MAX_PER_LOOP 4      // requests answered in one process()
+
+typedef int (*TPP_ControlFunction)(String);
+typedef int (*TPP_ControlReport)(const char *argument, char *buffer, int size);    // returns the length
+
+class TPP_ControlLink {
+
+    public:
+        void begin(int port, TPP_Arena &arena);
+        bool function(const char *name, TPP_ControlFunction function);
+        bool variable(const char *name, const char *text);
+        bool variable(const char *name, const int *value);
+        bool variable(const char *name, TPP_ControlReport report);
+        void process();
+        unsigned long getRequests() { return requests_; }
+        unsigned long getErrors() { return errors_; }
+
+    private:
+        struct controlFunction {
+            const char *name;
+            TPP_ControlFunction function;
+        };
+        struct controlVariable {
+            const char *name;
+            const char *text;       // one of these is set
+            const int *value;
+            TPP_ControlReport report;
+        };
+        bool answer();
+        void answerCall(ControlMessage &message);
+        void answerGet(ControlMessage &message);
+        void answerList(ControlMessage &message);
+        bool addVariable(const char *name, const char *text, const int *value, TPP_ControlReport report);
+        UDP udp_;
+        int port_ = CONTROL_DEFAULT_PORT;
+        bool listening_ = false;
+        uint8_t *packet_ = NULL;            // requests are read and answered here, in the arena
+        TPP_ArenaBlock *packetBlock_ = NULL;
+        controlFunction functions_[CONTROL_MAX_FUNCTIONS];
+        int numFunctions_ = 0;
+        controlVariable variables_[CONTROL_MAX_VARIABLES];
+        int numVariables_ = 0;
+        unsigned long requests_ = 0;
+        unsigned long errors_ = 0;
+
+};
+
+#endif
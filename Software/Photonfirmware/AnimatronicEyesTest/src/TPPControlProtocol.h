@@ -0,0 +1,140 @@
+/*
+ * TPPControlProtocol.h
+ *
+ * Team Practical Project local control protocol
+ *
+ * The UDP packets passed between a control client on a PC
+ * (Software/HostTools/PuppetControl) and a puppet on the same network, to do what the
+ * Particle cloud functions and variables do without going through the cloud. The
+ * exhibit network often has no internet, and a cloud round trip takes seconds; on
+ * the LAN the puppet answers in a few ms. This file is included by both, so change
+ * it in one place only.
+ *
+ * Every request is answered by one reply with the same seq:
+ *
+ *      controlCall     runs the function called name with text as its argument,
+ *                      like a cloud function. The reply's result is what it returned.
+ *      controlGet      the reply's text is the value of the variable called name. Any
+ *                      text in the request is passed to a variable worked out when
+ *                      asked for, e.g. which page of a metrics snapshot.
+ *      controlList     the reply's text is every name, one per line, "call NAME" or
+ *                      "get NAME"
+ *
+ * A reply with a status other than controlOK has no text. The client sends a
+ * request again if no reply comes; calls are not remembered, so a function whose
+ * reply was lost runs twice.
+ *
+ * Packets are sent as the raw header followed by textLength bytes of text, with no
+ * 0 at the end. The Photon and PCs are all little endian.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_CONTROL_PROTOCOL_H
+#define _TPP_CONTROL_PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define CONTROL_PROTOCOL_MAGIC 0x43505054   // "TPPC"
+#define CONTROL_PROTOCOL_VERSION 1
+#define CONTROL_DEFAULT_PORT 8810
+#define CONTROL_NAME_SIZE 16                // the longest name is 15 characters
+#define CONTROL_MAX_PACKET 512              // fits the shim's and the Photon's UDP buffers
+
+enum eControlPacket {
+    controlCall = 1,        // client to puppet
+    controlGet,             // client to puppet
+    controlList,            // client to puppet
+    controlReply            // puppet to client
+};
+
+enum eControlStatus {
+    controlOK = 0,
+    controlUnknownName,     // no function or variable by that name
+    controlBadRequest       // not a request the puppet understands
+};
+
+struct __attribute__((packed)) ControlPacketHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;           // eControlPacket
+    uint8_t request;        // replies: the eControlPacket type answered
+    uint8_t status;         // replies: eControlStatus
+    uint16_t seq;           // chosen by the client, echoed in the reply
+    uint16_t textLength;    // bytes of text after the header
+    int32_t result;         // replies to controlCall: what the function returned
+    char name[CONTROL_NAME_SIZE];   // 0 terminated
+};
+
+#define CONTROL_MAX_TEXT (CONTROL_MAX_PACKET - (int)sizeof(ControlPacketHeader))
+
+// A packet taken apart. text points into the packet and is not 0 terminated.
+struct ControlMessage {
+    int type;               // eControlPacket
+    int request;
+    int status;
+    uint16_t seq;
+    int32_t result;
+    char name[CONTROL_NAME_SIZE];
+    const char *text;
+    int textLength;
+};
+
+inline void controlSetMessage(ControlMessage &message, eControlPacket type, uint16_t seq, const char *name = "") {
+    memset(&message, 0, sizeof(message));
+    message.type = type;
+    message.seq = seq;
+    strncpy(message.name, name, CONTROL_NAME_SIZE - 1);
+    message.text = "";
+}
+
+// Puts message in buffer. Returns the packet length, or 0 if it doesn't fit.
+inline int controlEncode(const ControlMessage &message, uint8_t *buffer, int size) {
+
+    int length = (int)sizeof(ControlPacketHeader) + message.textLength;
+    if (message.textLength < 0 || message.textLength > CONTROL_MAX_TEXT || length > size) {
+        return 0;
+    }
+    ControlPacketHeader *header = (ControlPacketHeader *)buffer;
+    header->magic = CONTROL_PROTOCOL_MAGIC;
+    header->version = CONTROL_PROTOCOL_VERSION;
+    header->type = message.type;
+    header->request = message.request;
+    header->status = message.status;
+    header->seq = message.seq;
+    header->textLength = message.textLength;
+    header->result = message.result;
+    memset(header->name, 0, CONTROL_NAME_SIZE);
+    memcpy(header->name, message.name, strnlen(message.name, CONTROL_NAME_SIZE - 1));
+    memmove(buffer + sizeof(ControlPacketHeader), message.text, message.textLength);   // text may already be there
+    return length;
+
+}
+
+// Takes the packet in buffer apart. Returns false if it is not a packet of ours
+// of the right length.
+inline bool controlDecode(const uint8_t *buffer, int length, ControlMessage &message) {
+
+    const ControlPacketHeader *header = (const ControlPacketHeader *)buffer;
+    if (length < (int)sizeof(ControlPacketHeader) || header->magic != CONTROL_PROTOCOL_MAGIC ||
+        header->version != CONTROL_PROTOCOL_VERSION ||
+        length != (int)sizeof(ControlPacketHeader) + header->textLength ||
+        header->type < controlCall || header->type > controlReply) {
+        return false;
+    }
+    message.type = header->type;
+    message.request = header->request;
+    message.status = header->status;
+    message.seq = header->seq;
+    message.result = header->result;
+    memcpy(message.name, header->name, CONTROL_NAME_SIZE);
+    message.name[CONTROL_NAME_SIZE - 1] = 0;
+    message.text = (const char *)buffer + sizeof(ControlPacketHeader);
+    message.textLength = header->textLength;
+    return true;
+
+}
+
+#endif
@@ -0,0 +1,268 @@
+/*
+ * TPPMechanism.h
+ *
+ * Team Practical Project generic mechanism
+ *
+ * TPP_Eyeball and TPP_Eyelid each know one mechanism and take their own init()
+ * parameters. A neck or head turn is different again: heavier servos that must
+ * not be started or stopped hard, and axes that may share servos (a differential
+ * neck tilts when both servos turn together and rolls when they turn apart).
+ * TPP_Mechanism<AXES, CHANNELS> is any such mechanism, set up from two tables:
+ *
+ *      TPP_MechanismAxis[AXES]         per axis: top speed and acceleration, in percent
+ *                                      of travel per second (and per second squared),
+ *                                      and where it starts
+ *      TPP_MechanismChannel[CHANNELS]  per servo: its number on the servo board, its
+ *                                      PWM at -100%, 0 and +100%, and how much of each
+ *                                      axis it follows (the mix, in percent)
+ *
+ * Axes are positioned 0-100, 50 in the middle, like the rest of the library. A
+ * servo's position is the sum of each axis's offset from the middle times its mix,
+ * so pan/tilt/roll is a matter of the tables, not code.
+ *
+ * Every MECHANISM_FRAME_MS, process() moves all the axes in one pass over the
+ * tables: each axis speeds up, cruises and brakes within its limits to arrive at
+ * its target, then every servo is given its mixed position for the end of the frame
+ * at the speed that gets it there in one frame. All the state is in fixed size
+ * arrays in the object; nothing is allocated.
+ *
+ * A TPP_Mechanism has the channels, process() and isMoving() that TPP_PuppetOf
+ * needs, so it can be listed in a puppet.
+ *
+ * Example, a differential neck on servos 6 and 7 with a pan servo on 8:
+ *
+ *      const TPP_MechanismAxis neckAxes[] = {
+ *          // speed, accel, home
+ *          {  60, 120, 50 },       // pan
+ *          {  30,  60, 50 },       // tilt
+ *          {  30,  60, 50 }        // roll
+ *      };
+ *      const TPP_MechanismChannel<3> neckChannels[] = {
+ *          // servo, low, mid, high, mix of pan, tilt, roll
+ *          { 6, 200, 330, 460, {   0, 100,  100 } },
+ *          { 7, 460, 330, 200, {   0, 100, -100 } },
+ *          { 8, 180, 330, 480, { 100,   0,    0 } }
+ *      };
+ *      TPP_Mechanism<3> neck;
+ *      neck.begin(neckAxes, neckChannels);
+ *      neck.position(neckTilt, 80, MOVE_SPEED_SLOW);
+ *
+ * Key methods
+ *      .begin()        the axis and channel tables, copied in. The servos start
+ *                      at the axes' home positions.
+ *      .position()     moves an axis, 0-100, at a speed 1-10 of its top speed.
+ *                      Returns the estimated ms to get there.
+ *      .setPose()      moves every axis at once
+ *      .process()      called over and over to move the servos
+ *      .isMoving(), .getPosition()
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_MECHANISM_H
+#define _TPP_MECHANISM_H
+
+#include <Arduino.h>
+#include <TPPAnimateServo.h>
+
+#define MECHANISM_FRAME_MS 20       // how often the axes are moved
+#define MECHANISM_MS_PER_STEP 2     // TPP_AnimateServo moves one step every 2 ms
+#define MECHANISM_ARRIVED 0.5       // percent; closer than this and slow enough, an axis is there
+
+// the axes of a neck, for the example above
+enum eNeckAxis {
+    neckPan = 0,
+    neckTilt,
+    neckRoll
+};
+
+struct TPP_MechanismAxis {
+    float maxSpeed;         // percent of travel per second
+    float maxAccel;         // percent of travel per second per second
+    int home;               // 0-100, where the axis starts
+};
+
+template <int AXES>
+struct TPP_MechanismChannel {
+    int servoNum;           // on the servo board
+    int lowPos;             // PWM with the mix at -100%
+    int midPos;             // PWM with every axis in the middle
+    int highPos;            // PWM with the mix at +100%
+    int8_t mix[AXES];       // percent of each axis's offset from the middle
+};
+
+template <int AXES, int CHANNELS = AXES>
+class TPP_Mechanism {
+
+    public:
+        static const int channels = CHANNELS;
+
+        /* ----- begin -----
+         * Copies the tables in, and starts every servo where the axes' home
+         * positions put it
+         */
+        void begin(const TPP_MechanismAxis (&axisTable)[AXES], const TPP_MechanismChannel<AXES> (&channelTable)[CHANNELS]) {
+
+            for (int a = 0; a < AXES; a++) {
+                axes_[a] = axisTable[a];
+                position_[a] = constrain(axisTable[a].home, 0, 100);
+                target_[a] = position_[a];
+                velocity_[a] = 0;
+                speed_[a] = axisTable[a].maxSpeed;
+            }
+            for (int c = 0; c < CHANNELS; c++) {
+                channels_[c] = channelTable[c];
+                servos_[c].begin(channelTable[c].servoNum, mixedPosition(c));
+                servos_[c].setLimits(channelTable[c].lowPos, channelTable[c].highPos);
+            }
+            lastFrameMS_ = millis();
+            moving_ = false;
+
+        }
+
+        /* ----- position -----
+         * Moves axis to position 0-100 at speed 1 (slow) to 10 (fast) of its top
+         * speed. Returns the estimated ms to get there from a standstill.
+         */
+        int position(int axis, int position, float speed) {
+
+            if (axis < 0 || axis >= AXES) {
+                return 0;
+            }
+            target_[axis] = constrain(position, 0, 100);
+            speed_[axis] = axes_[axis].maxSpeed * constrain(speed / MOVE_SPEED_FAST, 0.01f, 1.0f);
+            moving_ = true;
+            return estimateMS(axis);
+
+        }
+
+        /* ----- setPose -----
+         * Moves every axis to positions[axis], 0-100. Returns the estimated ms
+         * until the last one gets there.
+         */
+        int setPose(const int (&positions)[AXES], float speed) {
+
+            int estMS = 0;
+            for (int a = 0; a < AXES; a++) {
+                estMS = max(estMS, position(a, positions[a], speed));
+            }
+            return estMS;
+
+        }
+
+        int getPosition(int axis) {
+
+            return (axis >= 0 && axis < AXES) ? (int)(position_[axis] + 0.5f) : 0;
+
+        }
+
+        bool isMoving() {
+
+            return moving_;
+
+        }
+
+        /* ----- process -----
+         * Moves the axes once every MECHANISM_FRAME_MS, and lets the servos step
+         */
+        void process() {
+
+            unsigned long now = millis();
+            if (moving_ && now - lastFrameMS_ >= MECHANISM_FRAME_MS) {
+                float frameS = min(now - lastFrameMS_, (unsigned long)(4 * MECHANISM_FRAME_MS)) / 1000.0f;
+                lastFrameMS_ = now;
+                moving_ = moveAxes(frameS);
+                for (int c = 0; c < CHANNELS; c++) {
+                    int to = mixedPosition(c);
+                    float ticksPerStep = abs(to - servos_[c].getPosition()) * MECHANISM_MS_PER_STEP / (float)MECHANISM_FRAME_MS;
+                    servos_[c].moveTo(to, max(ticksPerStep, 0.1f));
+                }
+            } else if (!moving_) {
+                lastFrameMS_ = now;
+            }
+
+            for (int c = 0; c < CHANNELS; c++) {
+                servos_[c].process();
+            }
+
+        }
+
+    private:
+        /* ----- moveAxes -----
+         * One frame for every axis: the velocity it wants is its speed, or slower if
+         * it must brake to stop at the target, and it gets as near to that as its
+         * acceleration allows. Returns true if any axis has further to go.
+         */
+        bool moveAxes(float frameS) {
+
+            bool moving = false;
+            for (int a = 0; a < AXES; a++) {
+                float toGo = target_[a] - position_[a];
+                float accel = axes_[a].maxAccel * frameS;
+                if (fabsf(toGo) < MECHANISM_ARRIVED && fabsf(velocity_[a]) <= accel) {
+                    position_[a] = target_[a];
+                    velocity_[a] = 0;
+                    continue;
+                }
+                float wanted = min(speed_[a], sqrtf(2 * axes_[a].maxAccel * fabsf(toGo)));
+                if (toGo < 0) {
+                    wanted = -wanted;
+                }
+                velocity_[a] += constrain(wanted - velocity_[a], -accel, accel);
+                position_[a] = constrain(position_[a] + velocity_[a] * frameS, 0.0f, 100.0f);
+                moving = true;
+            }
+            return moving;
+
+        }
+
+        /* ----- mixedPosition -----
+         * The PWM for channel: the sum of each axis's offset from the middle times
+         * its mix, from -100% (lowPos) through 0 (midPos) to +100% (highPos)
+         */
+        int mixedPosition(int channel) {
+
+            const TPP_MechanismChannel<AXES> &ch = channels_[channel];
+            float mixed = 0;
+            for (int a = 0; a < AXES; a++) {
+                mixed += ch.mix[a] * (position_[a] - 50) / 5000.0f;
+            }
+            mixed = constrain(mixed, -1.0f, 1.0f);
+            return ch.midPos + mixed * ((mixed < 0) ? ch.midPos - ch.lowPos : ch.highPos - ch.midPos);
+
+        }
+
+        /* ----- estimateMS -----
+         * Time for axis to get to its target from a standstill: up to speed, along,
+         * and down again, or up and down if it never gets to speed
+         */
+        int estimateMS(int axis) {
+
+            float distance = fabsf(target_[axis] - position_[axis]);
+            float speed = speed_[axis];
+            float accel = max(axes_[axis].maxAccel, 0.01f);
+            float seconds;
+            if (distance >= speed * speed / accel) {
+                seconds = distance / speed + speed / accel;
+            } else {
+                seconds = 2 * sqrtf(distance / accel);
+            }
+            return seconds * 1000 + MECHANISM_FRAME_MS;
+
+        }
+
+        // the tables, and the state of each axis, side by side
+        TPP_MechanismAxis axes_[AXES];
+        TPP_MechanismChannel<AXES> channels_[CHANNELS];
+        float position_[AXES];          // percent
+        float velocity_[AXES];          // percent per second
+        float target_[AXES];            // percent
+        float speed_[AXES];             // top speed of the move, percent per second
+        TPP_AnimateServo servos_[CHANNELS];
+        unsigned long lastFrameMS_ = 0;
+        bool moving_ = false;
+
+};
+
+#endif
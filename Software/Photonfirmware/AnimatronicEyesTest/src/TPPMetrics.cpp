@@ -0,0 +1,184 @@
+/*
+ * TPPMetrics.cpp
+ *
+ * Team Practical Project metrics registry
+ *
+ * Registers metrics and writes snapshots of them. See TPPMetrics.h and
+ * TPPMetricsFormat.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <TPPMetrics.h>
+
+#define METRICS_MORE_TEXT 16        // room kept for the "# next N" line
+
+Logger logMetrics("app.metrics");
+
+/* ----- add -----
+ * The next free metric, set up with name and type, or NULL if the registry
+ * is full or the name is too long
+ */
+TPP_Metric *TPP_Metrics::add(const char *name, int type, TPP_MetricSource source) {
+
+    if (numMetrics_ >= METRICS_MAX || strlen(name) >= METRICS_NAME_SIZE) {
+        logMetrics.error("can't add metric %s", name);
+        return NULL;
+    }
+    TPP_Metric *metric = &metrics_[numMetrics_++];
+    metric->name = name;
+    metric->type = type;
+    metric->source = source;
+    metric->value.store(0);
+    metric->bounds = NULL;
+    metric->numBounds = 0;
+    metric->counts = NULL;
+    return metric;
+
+}
+
+TPP_Counter TPP_Metrics::counter(const char *name) {
+
+    TPP_Counter counter;
+    counter.metric_ = add(name, metricCounter, NULL);
+    return counter;
+
+}
+
+TPP_Gauge TPP_Metrics::gauge(const char *name) {
+
+    TPP_Gauge gauge;
+    gauge.metric_ = add(name, metricGauge, NULL);
+    return gauge;
+
+}
+
+/* ----- counter, gauge -----
+ * A counter or gauge whose value is source(), read when a snapshot is taken.
+ * Returns false if the registry is full.
+ */
+bool TPP_Metrics::counter(const char *name, TPP_MetricSource source) {
+
+    return add(name, metricCounter, source) != NULL;
+
+}
+
+bool TPP_Metrics::gauge(const char *name, TPP_MetricSource source) {
+
+    return add(name, metricGauge, source) != NULL;
+
+}
+
+/* ----- histogram -----
+ * bounds are the upper bounds of the buckets, ascending, at most METRICS_MAX_BOUNDS
+ * of them; one more bucket counts the values over the last. bounds is kept as a
+ * pointer, so pass a static table.
+ */
+TPP_Histogram TPP_Metrics::histogram(const char *name, const int32_t *bounds, int numBounds) {
+
+    TPP_Histogram histogram;
+    if (numBounds < 1 || numBounds > METRICS_MAX_BOUNDS || numBuckets_ + numBounds + 1 > METRICS_MAX_BUCKETS) {
+        logMetrics.error("can't add histogram %s of %d buckets", name, numBounds);
+        return histogram;
+    }
+    TPP_Metric *metric = add(name, metricHistogram, NULL);
+    if (metric != NULL) {
+        metric->bounds = bounds;
+        metric->numBounds = numBounds;
+        metric->counts = &buckets_[numBuckets_];
+        for (int b = 0; b <= numBounds; b++) {
+            metric->counts[b].store(0);
+        }
+        numBuckets_ += numBounds + 1;
+    }
+    histogram.metric_ = metric;
+    return histogram;
+
+}
+
+/* ----- read -----
+ * The values of metric index now. The buckets are read one by one while they
+ * may still be counting, so a histogram's count and sum can be a value apart.
+ */
+void TPP_Metrics::read(int index, MetricsRecord &record) {
+
+    TPP_Metric &metric = metrics_[index];
+    record.type = metric.type;
+    record.name = metric.name;
+    record.nameLength = strlen(metric.name);
+    record.value = (metric.source != NULL) ? metric.source() : metric.value.load(std::memory_order_relaxed);
+    record.numBounds = metric.numBounds;
+    for (int b = 0; b < metric.numBounds; b++) {
+        record.bounds[b] = metric.bounds[b];
+        record.counts[b] = metric.counts[b].load(std::memory_order_relaxed);
+    }
+    if (metric.type == metricHistogram) {
+        record.counts[metric.numBounds] = metric.counts[metric.numBounds].load(std::memory_order_relaxed);
+    }
+
+}
+
+/* ----- writeText -----
+ * Writes the metrics from first on as Prometheus text, as many as fit, and moves
+ * first on past them. Ends with a "# next N" line if there are more, N being
+ * where to start the next page. Returns the length of the text, which is 0
+ * terminated.
+ */
+int TPP_Metrics::writeText(char *buffer, int size, int &first) {
+
+    int length = 0;
+    buffer[0] = 0;
+    first = max(first, 0);
+    MetricsRecord record;
+    while (first < numMetrics_) {
+        int room = size - METRICS_MORE_TEXT - length;
+        read(first, record);
+        int n = (room > 0) ? metricsFormatText(record, buffer + length, room) : 0;
+        if (n == 0) {
+            break;
+        }
+        length += n;
+        first++;
+    }
+    if (first < numMetrics_) {
+        length += snprintf(buffer + length, size - length, "# next %d\n", first);
+    }
+    return length;
+
+}
+
+/* ----- writeBinary -----
+ * Writes a snapshot header and the metrics from first on as binary records, as
+ * many as fit, and moves first on past them. Returns the bytes written.
+ */
+int TPP_Metrics::writeBinary(uint8_t *buffer, int size, int &first) {
+
+    if (size < (int)sizeof(MetricsSnapshotHeader)) {
+        return 0;
+    }
+    MetricsSnapshotHeader header;
+    header.magic = METRICS_FORMAT_MAGIC;
+    header.version = METRICS_FORMAT_VERSION;
+    first = max(first, 0);
+    header.first = first;
+    header.count = 0;
+    header.total = numMetrics_;
+    header.uptimeMS = millis();
+
+    int length = sizeof(header);
+    MetricsRecord record;
+    while (first < numMetrics_) {
+        read(first, record);
+        int n = metricsEncodeRecord(record, buffer + length, size - length);
+        if (n == 0) {
+            break;
+        }
+        length += n;
+        header.count++;
+        first++;
+    }
+    memcpy(buffer, &header, sizeof(header));
+    return length;
+
+}
@@ -0,0 +1,143 @@
+/*
+ * TPPMetrics.h
+ *
+ * Team Practical Project metrics registry
+ *
+ * One place for the numbers worth watching in a running puppet, so its behavior
+ * can be followed without turning on trace logging. The sketch and the libraries
+ * register named metrics in setup() and update them as things happen:
+ *
+ *      counter     how many times something happened
+ *      gauge       a value that goes up and down
+ *      histogram   how values were spread over fixed buckets, with their sum,
+ *                  e.g. how late each scene started
+ *
+ * A counter or gauge can also be read from a function when a snapshot is taken,
+ * for a number some library already keeps.
+ *
+ * Registering returns a small handle. Updating through it is one or two atomic
+ * adds or stores (a histogram also looks through its at most METRICS_MAX_BOUNDS
+ * bounds), with no lock, so it is safe from a timer or interrupt and costs about
+ * as much as an increment. A handle from a registry that was full, or one never
+ * registered, does nothing.
+ *
+ * A snapshot is written on demand, in the compact binary or the Prometheus text of
+ * TPPMetricsFormat.h, a page at a time if it doesn't fit the buffer.
+ *
+ * All the storage is in fixed size arrays in the registry; nothing is allocated.
+ * Names are kept as pointers, so pass string literals.
+ *
+ * Key methods
+ *      .counter(), .gauge(), .histogram()  register a metric. Call in setup().
+ *      .writeText()    a page of the snapshot as Prometheus text
+ *      .writeBinary()  a page of the snapshot as binary records
+ *      .getCount()
+ *  and on the handles
+ *      TPP_Counter .add()          TPP_Gauge .set(), .add()        TPP_Histogram .observe()
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_METRICS_H
+#define _TPP_METRICS_H
+
+#include <Arduino.h>
+#include <TPPMetricsFormat.h>
+#include <atomic>
+
+#define METRICS_MAX 32
+#define METRICS_MAX_BUCKETS 64      // bucket counters shared by all the histograms
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "metric updates must be lock free");
+
+typedef int32_t (*TPP_MetricSource)();
+
+struct TPP_Metric {
+    const char *name;
+    int type;                       // eMetricType
+    TPP_MetricSource source;        // read at snapshot time, if set
+    std::atomic<int32_t> value;     // counters and gauges; the sum for histograms
+    const int32_t *bounds;
+    int numBounds;
+    std::atomic<uint32_t> *counts;  // numBounds + 1, in the registry's bucket pool
+};
+
+class TPP_Counter {
+
+    public:
+        void add(uint32_t n = 1) {
+            if (metric_ != NULL) {
+                metric_->value.fetch_add(n, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        friend class TPP_Metrics;
+        TPP_Metric *metric_ = NULL;
+
+};
+
+class TPP_Gauge {
+
+    public:
+        void set(int32_t value) {
+            if (metric_ != NULL) {
+                metric_->value.store(value, std::memory_order_relaxed);
+            }
+        }
+        void add(int32_t n) {
+            if (metric_ != NULL) {
+                metric_->value.fetch_add(n, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        friend class TPP_Metrics;
+        TPP_Metric *metric_ = NULL;
+
+};
+
+class TPP_Histogram {
+
+    public:
+        void observe(int32_t value) {
+            if (metric_ != NULL) {
+                int b = 0;
+                while (b < metric_->numBounds && value > metric_->bounds[b]) {
+                    b++;
+                }
+                metric_->counts[b].fetch_add(1, std::memory_order_relaxed);
+                metric_->value.fetch_add(value, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        friend class TPP_Metrics;
+        TPP_Metric *metric_ = NULL;
+
+};
+
+class TPP_Metrics {
+
+    public:
+        TPP_Counter counter(const char *name);
+        TPP_Gauge gauge(const char *name);
+        TPP_Histogram histogram(const char *name, const int32_t *bounds, int numBounds);
+        bool counter(const char *name, TPP_MetricSource source);
+        bool gauge(const char *name, TPP_MetricSource source);
+        int writeText(char *buffer, int size, int &first);
+        int writeBinary(uint8_t *buffer, int size, int &first);
+        int getCount() { return numMetrics_; }
+
+    private:
+        TPP_Metric *add(const char *name, int type, TPP_MetricSource source);
+        void read(int index, MetricsRecord &record);
+        TPP_Metric metrics_[METRICS_MAX];
+        int numMetrics_ = 0;
+        std::atomic<uint32_t> buckets_[METRICS_MAX_BUCKETS];
+        int numBuckets_ = 0;
+
+};
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * TPPMicroMotion.cpp
+ *
+ * Team Practical Project animatronic micro-motion
+ *
+ * Smooth noise offsets for the servo channels. See TPPMicroMotion.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <TPPMicroMotion.h>
+
+void TPP_MicroMotion::begin(int numChannels, uint32_t seed) {
+
+    numChannels_ = constrain(numChannels, 0, MICRO_MAX_CHANNELS);
+    for (int c = 0; c < numChannels_; c++) {
+        channels_[c].seed = seed + c * 0x9E3779B9;  // far apart, so the channels don't look alike
+        channels_[c].amplitude = 0;
+        channels_[c].offset = 0;
+    }
+    phase_ = 0;
+    lastFrameMS_ = millis();
+
+}
+
+void TPP_MicroMotion::setAmplitude(int channel, int amplitude) {
+
+    if (channel >= 0 && channel < numChannels_) {
+        channels_[channel].amplitude = max(0, amplitude);
+    }
+
+}
+
+int TPP_MicroMotion::getAmplitude(int channel) {
+
+    return (channel >= 0 && channel < numChannels_) ? channels_[channel].amplitude : 0;
+
+}
+
+void TPP_MicroMotion::setFrequency(float hz) {
+
+    phasePerMS_ = constrain(hz, 0.0, MICRO_MAX_HZ) * 65536 / 1000;
+
+}
+
+float TPP_MicroMotion::getFrequency() {
+
+    return phasePerMS_ * 1000.0 / 65536;
+
+}
+
+/* ----- isOn -----
+ * true if any channel has an amplitude, or is still offset
+ */
+bool TPP_MicroMotion::isOn() {
+
+    for (int c = 0; c < numChannels_; c++) {
+        if (channels_[c].amplitude != 0 || channels_[c].offset != 0) {
+            return true;
+        }
+    }
+    return false;
+
+}
+
+/* ----- update -----
+ * Works out the offset of every channel once every MICRO_FRAME_MS. Returns true
+ * when it did.
+ */
+bool TPP_MicroMotion::update() {
+
+    unsigned long now = millis();
+    unsigned long elapsedMS = now - lastFrameMS_;
+    if (elapsedMS < MICRO_FRAME_MS) {
+        return false;
+    }
+    lastFrameMS_ = now;
+    phase_ += phasePerMS_ * elapsedMS;
+
+    for (int c = 0; c < numChannels_; c++) {
+        Channel &channel = channels_[c];
+        channel.offset = (noise(phase_, channel.seed) * channel.amplitude) >> 15;
+    }
+    return true;
+
+}
+
+int TPP_MicroMotion::getOffset(int channel) {
+
+    return (channel >= 0 && channel < numChannels_) ? channels_[channel].offset : 0;
+
+}
+
+/* ----- gradient -----
+ * The slope of the noise at a whole step, -1.0 to 1.0 in Q15, from an integer hash
+ * of the step and the seed
+ */
+int32_t TPP_MicroMotion::gradient(uint32_t step, uint32_t seed) {
+
+    uint32_t h = (step ^ seed) * 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return (int32_t)(int16_t)h;
+
+}
+
+/* ----- noise -----
+ * The noise at phase (in steps, Q16), -1.0 to 1.0 in Q15
+ */
+int32_t TPP_MicroMotion::noise(uint32_t phase, uint32_t seed) {
+
+    uint32_t step = phase >> 16;
+    int32_t f = (phase & 0xFFFF) >> 1;                          // how far past the step, Q15
+
+    int32_t a = (gradient(step, seed) * f) >> 15;               // from the step before
+    int32_t b = (gradient(step + 1, seed) * (f - 32768)) >> 15; // from the step after
+    int32_t s = (((f * f) >> 15) * (3 * 32768 - 2 * f)) >> 15;  // smoothstep 3f^2 - 2f^3
+
+    return (a + (((b - a) * s) >> 15)) * 2;                     // 1-D gradient noise is within +/-0.5
+
+}
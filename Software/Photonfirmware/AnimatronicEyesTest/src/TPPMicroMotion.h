@@ -0,0 +1,68 @@
+/*
+ * TPPMicroMotion.h
+ *
+ * Team Practical Project animatronic micro-motion
+ *
+ * Real eyes are never quite still. Instead of faking that with long lists of small
+ * random scenes, this layer makes a small, smooth wander for each channel that the
+ * puppet adds on top of whatever the sequence is doing.
+ *
+ * Each channel is 1-D gradient (Perlin) noise: at every whole step of the noise a
+ * gradient is picked by an integer hash of the step number and the channel's seed,
+ * and between steps the two gradients are blended with a smoothstep. That gives a
+ * wander with no jumps, and little motion faster than the frequency set. It needs
+ * no tables and no state but the time, so it never repeats and never drifts off.
+ * Everything is integer: one channel costs two hashes and a few multiplies, a few
+ * dozen cycles, once every MICRO_FRAME_MS.
+ *
+ * Key methods
+ *      .begin()            number of channels and a seed, so puppets differ
+ *      .setAmplitude()     largest offset of a channel, in the caller's units (TPP_Puppet
+ *                          uses thousandths of the servo's travel). 0 turns it off.
+ *      .setFrequency()     how fast the wander is, in Hz, for all channels
+ *      .update()           call every loop(). Returns true when there are new offsets.
+ *      .getOffset()        the latest offset of a channel, -amplitude to amplitude
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_MICRO_MOTION_H
+#define _TPP_MICRO_MOTION_H
+
+#include <Arduino.h>
+
+#define MICRO_MAX_CHANNELS 4
+#define MICRO_FRAME_MS 20           // new offsets this often
+#define MICRO_MAX_HZ 10.0           // faster than this is a shake, not a wander
+
+class TPP_MicroMotion {
+
+    public:
+        void begin(int numChannels, uint32_t seed);
+        void setAmplitude(int channel, int amplitude);
+        int getAmplitude(int channel);
+        void setFrequency(float hz);
+        float getFrequency();
+        bool isOn();
+        bool update();
+        int getOffset(int channel);
+
+    private:
+        struct Channel {
+            uint32_t seed;
+            int amplitude;
+            int offset;
+        };
+        static int32_t gradient(uint32_t step, uint32_t seed);
+        static int32_t noise(uint32_t phase, uint32_t seed);
+
+        Channel channels_[MICRO_MAX_CHANNELS];
+        int numChannels_ = 0;
+        uint32_t phase_ = 0;        // noise steps since begin(), Q16
+        uint32_t phasePerMS_ = 0;   // Q16
+        unsigned long lastFrameMS_ = 0;
+
+};
+
+#endif
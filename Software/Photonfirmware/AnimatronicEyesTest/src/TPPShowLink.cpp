@@ -0,0 +1,154 @@
+/*
+ * TPPShowLink.cpp
+ *
+ * Team Practical Project show control, puppet side
+ *
+ * Answers time sync requests from the show controller and holds cues until
+ * they are due. See TPPShowLink.h and TPPShowProtocol.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include <TPPShowLink.h>
+
+Logger logShow("app.show");
+
+/* ----- begin -----
+ * port is the UDP port to listen on. Listening starts once WiFi is ready.
+ * The queue of cues waiting for their time is reserved from the arena.
+ */
+void TPP_ShowLink::begin(int port, TPP_Arena &arena) {
+
+    port_ = port;
+    pendingBlock_ = arena.reserve("cues", SHOW_MAX_PENDING_CUES * sizeof(ShowCuePacket));
+    pending_ = pendingBlock_ ? (ShowCuePacket *)pendingBlock_->getData() : NULL;
+    maxPending_ = pendingBlock_ ? SHOW_MAX_PENDING_CUES : 0;
+    numPending_ = 0;
+
+}
+
+/* ----- alreadySeen -----
+ * true if this cue id was received before. Otherwise remembers it.
+ * Cue ids start at 1.
+ */
+bool TPP_ShowLink::alreadySeen(uint32_t cueId) {
+
+    for (int i = 0; i < SHOW_RECENT_CUES; i++) {
+        if (recent_[i] == cueId) {
+            return true;
+        }
+    }
+    recent_[nextRecent_] = cueId;
+    nextRecent_ = (nextRecent_ + 1) % SHOW_RECENT_CUES;
+    return false;
+
+}
+
+/* ----- readPacket -----
+ * Reads one waiting packet. Returns false if there was none. Sync requests
+ * are answered here so the reply carries the time the request was read.
+ */
+bool TPP_ShowLink::readPacket() {
+
+    uint8_t buffer[64];
+    int size = udp_.parsePacket();
+    if (size <= 0) {
+        return false;
+    }
+    uint32_t nowMS = millis();
+    int length = udp_.read(buffer, min(size, (int)sizeof(buffer)));
+    if (size > (int)sizeof(buffer)) {
+        return true;    // not one of ours
+    }
+    controllerIP_ = udp_.remoteIP();
+    controllerPort_ = udp_.remotePort();
+
+    switch (showPacketType(buffer, length)) {
+
+        case showSyncRequest: {
+            const ShowSyncRequestPacket *request = (const ShowSyncRequestPacket *)buffer;
+            ShowSyncReplyPacket reply;
+            showSetHeader(reply.header, showSyncReply);
+            reply.syncSeq = request->syncSeq;
+            reply.puppetMS = nowMS;
+            udp_.sendPacket((const uint8_t *)&reply, sizeof(reply), controllerIP_, controllerPort_);
+            break;
+        }
+
+        case showCue: {
+            const ShowCuePacket *cue = (const ShowCuePacket *)buffer;
+            if (alreadySeen(cue->cueId)) {
+                break;
+            }
+            if (numPending_ >= maxPending_) {
+                cuesDropped_++;
+                logShow.warn("cue %lu dropped, %d cues waiting", (unsigned long)cue->cueId, numPending_);
+                break;
+            }
+            pending_[numPending_++] = *cue;
+            pendingBlock_->use(numPending_ * sizeof(ShowCuePacket));
+            logShow.trace("cue %lu action %d due in %ld ms", (unsigned long)cue->cueId, cue->action,
+                          (long)(int32_t)(cue->atPuppetMS - nowMS));
+            break;
+        }
+
+        default:
+            break;
+
+    }
+    return true;
+
+}
+
+/* ----- process -----
+ * Call every loop(). Returns true with dueCue filled in when a cue's time has come;
+ * the cue is then reported to the controller as run.
+ */
+bool TPP_ShowLink::process(ShowCuePacket &dueCue) {
+
+    if (!listening_) {
+        if (!WiFi.ready()) {
+            return false;
+        }
+        listening_ = udp_.begin(port_) != 0;
+        if (!listening_) {
+            return false;
+        }
+        logShow.info("listening for show cues on port %d", port_);
+    }
+
+    // read what has arrived, so sync replies go out promptly
+    for (int i = 0; i < SHOW_MAX_PENDING_CUES && readPacket(); i++) {
+    }
+
+    // the earliest cue that is due. Wrap safe: compares the signed difference.
+    uint32_t nowMS = millis();
+    int due = -1;
+    for (int i = 0; i < numPending_; i++) {
+        if ((int32_t)(nowMS - pending_[i].atPuppetMS) >= 0 &&
+            (due < 0 || (int32_t)(pending_[i].atPuppetMS - pending_[due].atPuppetMS) < 0)) {
+            due = i;
+        }
+    }
+    if (due < 0) {
+        return false;
+    }
+
+    dueCue = pending_[due];
+    pending_[due] = pending_[--numPending_];
+    pendingBlock_->use(numPending_ * sizeof(ShowCuePacket));
+
+    cuesRun_++;
+    if ((int32_t)(nowMS - dueCue.atPuppetMS) > SHOW_LATE_MS) {
+        cuesLate_++;
+    }
+
+    ShowCueDonePacket done;
+    showSetHeader(done.header, showCueDone);
+    done.cueId = dueCue.cueId;
+    done.ranPuppetMS = nowMS;
+    udp_.sendPacket((const uint8_t *)&done, sizeof(done), controllerIP_, controllerPort_);
+    return true;
+
+}
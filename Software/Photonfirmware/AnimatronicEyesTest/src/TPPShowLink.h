@@ -0,0 +1,66 @@
+/*
+ * TPPShowLink.h
+ *
+ * Team Practical Project show control, puppet side
+ *
+ * Lets a puppet take part in a show run by the show controller on a PC
+ * (Software/HostTools/ShowControl). The link listens for UDP packets as described in
+ * TPPShowProtocol.h: it answers time sync requests at once, and holds each cue it
+ * is sent until millis() reaches the cue time. The sketch then runs the cue.
+ *
+ * The UDP port is opened the first time process() is called with WiFi ready.
+ *
+ * Key methods
+ *      .begin()    sets the UDP port to listen on, and reserves the cue queue from the arena
+ *      .process()  called every loop(). Reads packets and returns true, with the cue,
+ *              when a cue is due. Call again until it returns false, as more than one
+ *              cue can be due at once.
+ *      .getCuesRun(), .getCuesLate(), .getCuesDropped()  statistics since power on:
+ *              cues run, cues run more than SHOW_LATE_MS after their time, and cues
+ *              lost because SHOW_MAX_PENDING_CUES were already waiting
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SHOW_LINK_H
+#define _TPP_SHOW_LINK_H
+
+#include <Arduino.h>
+#include <TPPShowProtocol.h>
+#include <TPPArena.h>
+
+#define SHOW_MAX_PENDING_CUES 16
+#define SHOW_RECENT_CUES 32         // cue ids remembered to ignore the copies the controller sends
+#define SHOW_LATE_MS 5
+
+class TPP_ShowLink {
+
+    public:
+        void begin(int port, TPP_Arena &arena);
+        bool process(ShowCuePacket &dueCue);
+        unsigned long getCuesRun() { return cuesRun_; }
+        unsigned long getCuesLate() { return cuesLate_; }
+        unsigned long getCuesDropped() { return cuesDropped_; }
+
+    private:
+        bool readPacket();
+        bool alreadySeen(uint32_t cueId);
+        UDP udp_;
+        int port_ = SHOW_DEFAULT_PORT;
+        bool listening_ = false;
+        IPAddress controllerIP_;
+        int controllerPort_ = 0;
+        ShowCuePacket *pending_ = NULL;     // cues waiting for their time, in the arena
+        TPP_ArenaBlock *pendingBlock_ = NULL;
+        int maxPending_ = 0;
+        int numPending_ = 0;
+        uint32_t recent_[SHOW_RECENT_CUES] = {0};
+        int nextRecent_ = 0;
+        unsigned long cuesRun_ = 0;
+        unsigned long cuesLate_ = 0;
+        unsigned long cuesDropped_ = 0;
+
+};
+
+#endif
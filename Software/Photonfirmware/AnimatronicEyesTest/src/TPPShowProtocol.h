@@ -0,0 +1,121 @@
+/*
+ * TPPShowProtocol.h
+ *
+ * Team Practical Project show control protocol
+ *
+ * The UDP packets passed between the show controller on a PC
+ * (Software/HostTools/ShowControl) and each puppet, so several puppets can run
+ * coordinated routines. This file is included by both, so change it in one place only.
+ *
+ * Time sync. The puppets do not set their clocks. The controller sends a
+ * showSyncRequest and the puppet answers at once with its millis(). From the send
+ * and receive times of the fastest of a few exchanges the controller knows the
+ * puppet's clock offset to about a ms, and from successive rounds how fast the
+ * puppet's clock drifts. It then sends every cue stamped with the time on THAT
+ * puppet's clock at which the cue should run.
+ *
+ * Cues. A puppet holds each cue until its millis() reaches the cue time, runs it,
+ * and answers with a showCueDone holding the time it actually ran, so the
+ * controller can measure how closely the puppets kept together. The controller
+ * sends each cue more than once; the cueId lets the puppet ignore the copies.
+ *
+ * Packets are sent as the raw structs. The Photon and PCs are all little endian.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SHOW_PROTOCOL_H
+#define _TPP_SHOW_PROTOCOL_H
+
+#include <stdint.h>
+
+#define SHOW_PROTOCOL_MAGIC 0x53505054   // "TPPS"
+#define SHOW_PROTOCOL_VERSION 1
+#define SHOW_DEFAULT_PORT 8800
+
+enum eShowPacket {
+    showSyncRequest = 1,    // controller to puppet
+    showSyncReply,          // puppet to controller
+    showCue,                // controller to puppet
+    showCueDone             // puppet to controller
+};
+
+enum eShowAction {
+    showActionSequence = 1, // param[0] is an eShowSequence
+    showActionLook,         // param[0] left/right 0-100, param[1] up/down 0-100, param[2] speed x 10
+    showActionAttention,    // param[0] 1 to act as if A5 were high, 0 to release
+    showActionBlink,
+    showActionPursue        // param[0] left/right 0-100, param[1] up/down 0-100 of a moving target
+                            // the eyes follow; param[0] -1 stops following
+};
+
+// Named sequences a cue can start. The sketch maps these to its sequence functions.
+enum eShowSequence {
+    showSequenceAsleep = 1,
+    showSequenceWake,
+    showSequenceRoam,
+    showSequenceRoamAhead,
+    showSequenceBlink,
+    showSequenceEndStandard
+};
+
+struct __attribute__((packed)) ShowPacketHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;           // eShowPacket
+    uint16_t reserved;
+};
+
+struct __attribute__((packed)) ShowSyncRequestPacket {
+    ShowPacketHeader header;
+    uint32_t syncSeq;       // echoed in the reply
+};
+
+struct __attribute__((packed)) ShowSyncReplyPacket {
+    ShowPacketHeader header;
+    uint32_t syncSeq;
+    uint32_t puppetMS;      // puppet millis() when the request was read
+};
+
+struct __attribute__((packed)) ShowCuePacket {
+    ShowPacketHeader header;
+    uint32_t cueId;
+    uint32_t atPuppetMS;    // run when the puppet's millis() reaches this
+    uint8_t action;         // eShowAction
+    uint8_t reserved;
+    int16_t param[3];
+};
+
+struct __attribute__((packed)) ShowCueDonePacket {
+    ShowPacketHeader header;
+    uint32_t cueId;
+    uint32_t ranPuppetMS;   // puppet millis() when the cue ran
+};
+
+inline void showSetHeader(ShowPacketHeader &header, eShowPacket type) {
+    header.magic = SHOW_PROTOCOL_MAGIC;
+    header.version = SHOW_PROTOCOL_VERSION;
+    header.type = type;
+    header.reserved = 0;
+}
+
+// The packet type, or 0 if buffer is not a packet of ours of the right length
+inline int showPacketType(const uint8_t *buffer, int length) {
+
+    const ShowPacketHeader *header = (const ShowPacketHeader *)buffer;
+    if (length < (int)sizeof(ShowPacketHeader) || header->magic != SHOW_PROTOCOL_MAGIC ||
+        header->version != SHOW_PROTOCOL_VERSION) {
+        return 0;
+    }
+    switch (header->type) {
+        case showSyncRequest:   return length == sizeof(ShowSyncRequestPacket) ? showSyncRequest : 0;
+        case showSyncReply:     return length == sizeof(ShowSyncReplyPacket) ? showSyncReply : 0;
+        case showCue:           return length == sizeof(ShowCuePacket) ? showCue : 0;
+        case showCueDone:       return length == sizeof(ShowCueDonePacket) ? showCueDone : 0;
+    }
+    return 0;
+
+}
+
+#endif
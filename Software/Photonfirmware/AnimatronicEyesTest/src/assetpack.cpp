@@ -0,0 +1,117 @@
+/*
+ * assetpack.cpp
+ *
+ * Team Practical Project asset pack
+ *
+ * Made by assetpack (Software/HostTools/AssetPack) from assets/eyes.assets.
+ * Do not edit; change the asset list and run the packer again.
+ *
+ *      setting   X_POS_MID                  4 bytes
+ *      setting   X_POS_LEFT_OFFSET          4 bytes
+ *      setting   X_POS_RIGHT_OFFSET         4 bytes
+ *      setting   Y_POS_MID                  4 bytes
+ *      setting   Y_POS_UP_OFFSET            4 bytes
+ *      setting   Y_POS_DOWN_OFFSET          4 bytes
+ *      setting   LEFT_UPPER_CLOSED          4 bytes
+ *      setting   LEFT_UPPER_OPEN            4 bytes
+ *      setting   LEFT_LOWER_CLOSED          4 bytes
+ *      setting   LEFT_LOWER_OPEN            4 bytes
+ *      setting   RIGHT_UPPER_OFFSET         4 bytes
+ *      setting   RIGHT_LOWER_OFFSET         4 bytes
+ *      sequence  blink                     32 bytes
+ *      sequence  blinkSlow                 32 bytes
+ *      sequence  asleep                    24 bytes
+ *      sequence  wake                     120 bytes
+ *      sequence  lookReal                 144 bytes
+ *      sequence  endStandard               16 bytes
+ *      sequence  lookAround                64 bytes
+ *      sequence  generalTests             408 bytes
+ *
+ */
+
+#include <stdint.h>
+
+extern const uint8_t assetPackData[];
+extern const uint32_t assetPackSize;
+
+__attribute__((aligned(4))) const uint8_t assetPackData[] = {
+    0x54, 0x50, 0x41, 0x4b, 0x01, 0x00, 0x14, 0x00, 0xc8, 0x04, 0x00, 0x00, 0xe1, 0xd5, 0xfd, 0xe2,
+    0x28, 0x01, 0xfa, 0x06, 0x01, 0x00, 0x01, 0x00, 0x50, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x89, 0x75, 0x61, 0x07, 0x02, 0x00, 0x04, 0x00, 0x54, 0x01, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00,
+    0xcf, 0x91, 0x1c, 0x26, 0x01, 0x00, 0x01, 0x00, 0x74, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x54, 0x50, 0x11, 0x27, 0x02, 0x00, 0x04, 0x00, 0x78, 0x01, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00,
+    0xaf, 0x71, 0x2d, 0x30, 0x01, 0x00, 0x01, 0x00, 0x98, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0xdc, 0x4e, 0x89, 0x3a, 0x01, 0x00, 0x01, 0x00, 0x9c, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0xeb, 0xe5, 0x4d, 0x44, 0x02, 0x00, 0x02, 0x00, 0xa0, 0x01, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
+    0x30, 0x06, 0x9c, 0x51, 0x01, 0x00, 0x01, 0x00, 0xb0, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0xe3, 0xfb, 0xb6, 0x56, 0x01, 0x00, 0x01, 0x00, 0xb4, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0xf6, 0xdd, 0x6c, 0xad, 0x02, 0x00, 0x12, 0x00, 0xb8, 0x01, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00,
+    0x0d, 0x04, 0x33, 0xae, 0x02, 0x00, 0x0f, 0x00, 0x48, 0x02, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00,
+    0x1b, 0x3a, 0xc2, 0xb5, 0x01, 0x00, 0x01, 0x00, 0xc0, 0x02, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x78, 0x98, 0xdb, 0xb8, 0x01, 0x00, 0x01, 0x00, 0xc4, 0x02, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x0b, 0x8b, 0xc6, 0xd6, 0x01, 0x00, 0x01, 0x00, 0xc8, 0x02, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0xfc, 0xb7, 0x4b, 0xd7, 0x01, 0x00, 0x01, 0x00, 0xcc, 0x02, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x2f, 0xed, 0xb6, 0xdd, 0x01, 0x00, 0x01, 0x00, 0xd0, 0x02, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x2f, 0x3e, 0xe4, 0xe0, 0x02, 0x00, 0x03, 0x00, 0xd4, 0x02, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00,
+    0x04, 0xf8, 0xa4, 0xe6, 0x02, 0x00, 0x33, 0x00, 0xec, 0x02, 0x00, 0x00, 0x98, 0x01, 0x00, 0x00,
+    0x30, 0x28, 0x6c, 0xf2, 0x01, 0x00, 0x01, 0x00, 0x84, 0x04, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0xcb, 0xcb, 0x08, 0xf3, 0x02, 0x00, 0x08, 0x00, 0x88, 0x04, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00,
+    0xb8, 0xff, 0xff, 0xff, 0x06, 0x00, 0x00, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x06, 0x00, 0x32, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x32, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x80, 0xff, 0xff, 0xff, 0x06, 0x00, 0x00, 0x00, 0x10, 0x27, 0xff, 0xff,
+    0x05, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x06, 0x00, 0x32, 0x00, 0x10, 0x27, 0xff, 0xff,
+    0x05, 0x00, 0x32, 0x00, 0x10, 0x27, 0xe8, 0x03, 0xbc, 0x02, 0x00, 0x00, 0x57, 0x01, 0x00, 0x00,
+    0x01, 0x00, 0xff, 0xff, 0x2c, 0x01, 0xff, 0xff, 0x04, 0x00, 0x32, 0x00, 0x64, 0x00, 0x64, 0x00,
+    0xd9, 0x01, 0x00, 0x00, 0xdf, 0x01, 0x00, 0x00, 0x01, 0x00, 0xff, 0xff, 0x10, 0x27, 0xff, 0xff,
+    0x04, 0x00, 0x00, 0x00, 0x10, 0x27, 0xb8, 0x0b, 0x04, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x05, 0x00, 0x14, 0x00, 0x0a, 0x00, 0xff, 0xff, 0x02, 0x00, 0x00, 0x00, 0x14, 0x00, 0xe8, 0x03,
+    0x02, 0x00, 0x64, 0x00, 0x14, 0x00, 0xd0, 0x07, 0x02, 0x00, 0x32, 0x00, 0x32, 0x00, 0xff, 0xff,
+    0x05, 0x00, 0x00, 0x00, 0x14, 0x00, 0xe8, 0x03, 0x02, 0x00, 0x4b, 0x00, 0x14, 0x00, 0xff, 0xff,
+    0x04, 0x00, 0x14, 0x00, 0x0a, 0x00, 0xff, 0xff, 0x02, 0x00, 0x23, 0x00, 0x14, 0x00, 0xd0, 0x07,
+    0x04, 0x00, 0x00, 0x00, 0x0a, 0x00, 0xd0, 0x07, 0x02, 0x00, 0x32, 0x00, 0x28, 0x00, 0xff, 0xff,
+    0x04, 0x00, 0x32, 0x00, 0x32, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x10, 0x27, 0xff, 0xff,
+    0x05, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x06, 0x00, 0x32, 0x00, 0x10, 0x27, 0xff, 0xff,
+    0x05, 0x00, 0x32, 0x00, 0x10, 0x27, 0x00, 0x00, 0x05, 0x00, 0x14, 0x00, 0x0a, 0x00, 0xff, 0xff,
+    0x02, 0x00, 0x00, 0x00, 0x14, 0x00, 0xe8, 0x03, 0x02, 0x00, 0x64, 0x00, 0x14, 0x00, 0xd0, 0x07,
+    0x02, 0x00, 0x32, 0x00, 0x32, 0x00, 0xff, 0xff, 0x05, 0x00, 0x00, 0x00, 0x14, 0x00, 0xe8, 0x03,
+    0x02, 0x00, 0x4b, 0x00, 0x14, 0x00, 0xff, 0xff, 0x04, 0x00, 0x14, 0x00, 0x0a, 0x00, 0xff, 0xff,
+    0x02, 0x00, 0x23, 0x00, 0x14, 0x00, 0xd0, 0x07, 0x04, 0x00, 0x00, 0x00, 0x0a, 0x00, 0xd0, 0x07,
+    0x02, 0x00, 0x32, 0x00, 0x28, 0x00, 0xff, 0xff, 0x04, 0x00, 0x32, 0x00, 0x32, 0x00, 0x00, 0x00,
+    0x06, 0x00, 0x00, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x06, 0x00, 0x32, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x32, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x3d, 0x01, 0x00, 0x00, 0x04, 0x01, 0x00, 0x00, 0xf2, 0x01, 0x00, 0x00, 0xf8, 0x02, 0x00, 0x00,
+    0x5d, 0x00, 0x00, 0x00, 0x01, 0x00, 0xff, 0xff, 0x10, 0x27, 0xff, 0xff, 0x04, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0xb8, 0x0b, 0x04, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x01, 0x00, 0xff, 0xff,
+    0x10, 0x27, 0xff, 0xff, 0x04, 0x00, 0x00, 0x00, 0x10, 0x27, 0xb8, 0x0b, 0x04, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x01, 0x00, 0xff, 0xff, 0x10, 0x27, 0xff, 0xff, 0x04, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0xb8, 0x0b, 0x04, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x05, 0x00, 0x14, 0x00,
+    0x0a, 0x00, 0xff, 0xff, 0x02, 0x00, 0x00, 0x00, 0x14, 0x00, 0xe8, 0x03, 0x02, 0x00, 0x64, 0x00,
+    0x14, 0x00, 0xd0, 0x07, 0x02, 0x00, 0x32, 0x00, 0x32, 0x00, 0xff, 0xff, 0x05, 0x00, 0x00, 0x00,
+    0x14, 0x00, 0xe8, 0x03, 0x02, 0x00, 0x4b, 0x00, 0x14, 0x00, 0xff, 0xff, 0x04, 0x00, 0x14, 0x00,
+    0x0a, 0x00, 0xff, 0xff, 0x02, 0x00, 0x23, 0x00, 0x14, 0x00, 0xd0, 0x07, 0x04, 0x00, 0x00, 0x00,
+    0x0a, 0x00, 0xd0, 0x07, 0x02, 0x00, 0x32, 0x00, 0x28, 0x00, 0xff, 0xff, 0x04, 0x00, 0x32, 0x00,
+    0x32, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x06, 0x00, 0x32, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x32, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x64, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x64, 0x00, 0x00, 0x00, 0x02, 0x00, 0x64, 0x00, 0x64, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x64, 0x00, 0x00, 0x00, 0x02, 0x00, 0x64, 0x00, 0x64, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x64, 0x00, 0x00, 0x00, 0x02, 0x00, 0x64, 0x00, 0xe8, 0x03, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0xe8, 0x03, 0x00, 0x00, 0x02, 0x00, 0x64, 0x00, 0xe8, 0x03, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0xe8, 0x03, 0x00, 0x00, 0x01, 0x00, 0xff, 0xff, 0x64, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
+    0x64, 0x00, 0x00, 0x00, 0x03, 0x00, 0x64, 0x00, 0x64, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
+    0x64, 0x00, 0x00, 0x00, 0x03, 0x00, 0x64, 0x00, 0x64, 0x00, 0x00, 0x00, 0x01, 0x00, 0xff, 0xff,
+    0x64, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x06, 0x00, 0x32, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x32, 0x00,
+    0x10, 0x27, 0xe8, 0x03, 0x06, 0x00, 0x00, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x06, 0x00, 0x32, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x32, 0x00,
+    0x10, 0x27, 0xe8, 0x03, 0x06, 0x00, 0x00, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x06, 0x00, 0x32, 0x00, 0x10, 0x27, 0xff, 0xff, 0x05, 0x00, 0x32, 0x00,
+    0x10, 0x27, 0xe8, 0x03, 0x01, 0x00, 0xff, 0xff, 0x2c, 0x01, 0xff, 0xff, 0x04, 0x00, 0x32, 0x00,
+    0x64, 0x00, 0x64, 0x00, 0x73, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x64, 0x00, 0x00, 0x00,
+    0x02, 0x00, 0x00, 0x00, 0x64, 0x00, 0xf4, 0x01, 0x02, 0x00, 0x64, 0x00, 0x64, 0x00, 0xf4, 0x01,
+    0x01, 0x00, 0xff, 0xff, 0x64, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x64, 0x00, 0xf4, 0x01,
+    0x03, 0x00, 0x64, 0x00, 0x64, 0x00, 0xf4, 0x01, 0x01, 0x00, 0xff, 0xff, 0x2c, 0x01, 0xff, 0xff,
+    0x04, 0x00, 0x32, 0x00, 0x64, 0x00, 0x64, 0x00,
+};
+
+const uint32_t assetPackSize = 1224;
@@ -10,11 +10,10 @@
  * data for the input .wav file.  The simulation was was copied to an Excel
  * spreadsheet and then edited so that only samples of the data at 250 ms
  * intervals were retained.  These samples (4 seconds worth of speech data) were
- * then copied inbto the array "env_data" which is contained in the file "env_data.dat".
- * This file also contains the number of elements in the array in the const int "env_data_size"
- * (in this case, 201 elements in the array representing about 4 seconds worth of
- * sample envelope data).  The data in the array is scaled where 0 = 0 volts and
- * 4095 = 3.3 volts.
+ * then copied inbto the file "welcome_env.txt" in HostTools/AssetPack/assets, and packed
+ * as the envelope "welcome" into the asset pack in assetpack.cpp (201 samples
+ * representing about 4 seconds worth of sample envelope data).  The data is scaled
+ * where 0 = 0 volts and 4095 = 3.3 volts.
  * 
  * This program loops through the array, averaging the last NUM_AVERAGE number
  * of samples, scaling the result to the servo values 0 to 90 degrees, and operating
@@ -25,34 +24,47 @@
  * The program runs on a Particle Photon that is used on a TPP "Wireless_IO_Board".
  * This board has a servo control attachment on Photon pin D1.
  * 
- * The program reads through the array, averaging and controlling the servo, until
- * all of the array has been read through.  The program then waits loops forever until
- * the Photon is reset.
+ * The program plays the array through the envelope player (TPPEnvelopePlayer), which
+ * resamples it to one value every 10 ms, the rate the mouth firmware samples the live
+ * envelope at, whatever rate the track was captured at.  When the track has played
+ * the D7 LED blinks and the mouth stays closed until the track is played again from
+ * the console.
+ * 
+ * Console functions:
+ *   "play": plays the welcome track again.  The argument is the ms between its samples (default
+ *      20); anything else plays it faster or slower.  Starts another track alongside any
+ *      still playing, up to 4; the mouth follows the loudest.
+ *   "loop": 1 to play tracks over and over, 0 to stop at the end.  Applies to tracks started after.
+ *   "seek": moves every playing track to the argument, in ms from its start.
+ *   "stop": stops every track.
  * 
  * (c) 2020, 2021 Team Practical Projects, Bob Glicksman, Jim Schrempp
+ * version: 1.2; the track is read in place from the asset pack (TPPAssetPack) in
+ *   place of the env_data array compiled into the sketch.
+ * version: 1.1; the envelope player replaces the fixed 20 ms walk through the array,
+ *   and the end of the track no longer hangs the Photon in while(true).
  * version: 1.0; 12-18-20
  * 
  * *********************************************************************************/
 
-// Data file
-const int env_data_size = 201;
-uint16_t env_data[] = 
-	{34,34,34,34,34,34,34,34,34,34,34,34,43,2439,3374,2481,1845,1937,1681,1534,
-	2152,671,138,49,36,34,37,219,1224,1026,744,790,1557,1671,587,405,315,676,1605,1258,
-	1216,1996,2155,2004,1492,1043,371,110,45,36,34,68,808,297,718,995,672,215,127,82,
-	58,331,304,658,1714,1553,1581,1459,784,337,168,53,37,34,41,732,266,224,1502,2757,
-	1809,352,78,69,84,50,753,2165,2499,2787,2833,2712,3142,1920,969,827,435,574,632,128,
-	47,61,40,327,1433,1610,1439,1755,2452,2471,1441,443,350,234,222,112,45,36,38,46,
-	81,85,58,39,39,38,40,49,46,51,53,42,37,34,34,34,196,165,89,60,
-	97,228,318,289,140,52,37,34,34,35,39,55,61,90,86,80,52,41,39,37,
-	41,101,115,387,573,505,519,198,224,75,41,35,34,34,34,35,57,89,209,394,
-	560,465,118,49,38,35,43,43,52,61,93,166,228,194,192,122,59,43,37,34,34};
+#include "TPPEnvelopePlayer.h"
+#include "TPPAssetPack.h"
+
+// The envelope track comes from the asset pack (assetpack.cpp, made by HostTools/AssetPack)
+extern const uint8_t assetPackData[];
+extern const uint32_t assetPackSize;
+TPP_AssetPack assets;
+const uint16_t *env_data = NULL;    // the "welcome" track, in place in the pack
+int env_data_size = 0;
+int env_data_interval_ms = 20;      // ms between the track's samples, from the pack
 
 // Photon pin definitions
 const int SERVO_PIN = D1;
 
 // Constants
-const int NUMBER_SAMPLES_TO_AVERAGE = 2;    // this number of samples is averaged to drive the servo
+const int NUMBER_SAMPLES_TO_AVERAGE = 4;    // this number of samples is averaged to drive the servo
+const int OUTPUT_INTERVAL = 10;     // ms between envelope player outputs
+const unsigned long BLINK_INTERVAL = 500;   // D7 blink when the track is done
 const int MOUTH_CLOSED = 90;    // servo position for the mouth closed
 const int MOUTH_OPENED = 180;   // servo position for wide open mouth
 const int MIN_DATA = 0;         // lowest value of averaged data
@@ -61,15 +73,27 @@ const int MAX_DATA = 3500;      // highest value of averaged data
 // define the mouth servo object
 Servo mouthServo;
 
+// define the envelope player
+TPP_EnvelopePlayer envPlayer;
+bool loopTracks = false;        // set by the "loop" console function
+
 // Globals for console display
     int dataPointIndex = 0;     // variable to hold the index into the data array
     int servoPoints = 0;        // number of servo control points
+    double updateMicros = 0;    // time the envelope player takes for each output
 
 void setup() {
     pinMode(D7, OUTPUT);
+    assets.begin(assetPackData, assetPackSize);
+    env_data = assets.getEnvelope("welcome", env_data_size, env_data_interval_ms);
     mouthServo.attach(SERVO_PIN);
     Particle.variable("index", dataPointIndex);
     Particle.variable("servoPoints", servoPoints);
+    Particle.variable("updateMicros", updateMicros);
+    Particle.function("play", playTrack);
+    Particle.function("loop", loopTrack);
+    Particle.function("seek", seekTrack);
+    Particle.function("stop", stopTracks);
 
     // flash D7 LED twice to indocate setup is complete
     flashLED(D7);
@@ -83,20 +107,38 @@ void setup() {
 
 void loop() {
 
-    static unsigned long sampleTime = millis();
+    static unsigned long blinkTime = millis();
     static unsigned int averagedData = 0;
     static int numberAveragedPoints = 0;
+    static bool started = false;
     int servoCommand;
 
+    // start the track the first time through
+    if(started == false) {
+        envPlayer.begin(OUTPUT_INTERVAL);
+        playTrack("");
+        started = true;
+    }
+
+    // the player makes an output every 10 ms; the mouth follows the loudest track
+    if(envPlayer.update() == true) {
+        bool playing = false;
+        unsigned int loudest = 0;
+        for(int track = 0; track < ENV_PLAYER_TRACKS; track++) {
+            if(envPlayer.isPlaying(track) == true) {
+                loudest = max(loudest, (unsigned int)envPlayer.read(track));
+                if(playing == false) {  // report the position of the first track playing
+                    dataPointIndex = envPlayer.getPositionMS(track) / env_data_interval_ms;
+                }
+                playing = true;
+            }
+        }
+        updateMicros = envPlayer.getUpdateMicros();
 
-    // process the data array
-    if(dataPointIndex < env_data_size) {
-        //  walk through the data samples array, one point every 20 ms
-        if( (millis() - sampleTime) >= 20) {  // wait for 50 ms to elapse
-            if(numberAveragedPoints < NUMBER_SAMPLES_TO_AVERAGE) { // get another point into the average
-                averagedData += env_data[dataPointIndex++];
-                numberAveragedPoints++;
-            } else { // process the average, control the servo, and reset for another average
+        if(playing == true) {
+            averagedData += loudest;
+            numberAveragedPoints++;
+            if(numberAveragedPoints >= NUMBER_SAMPLES_TO_AVERAGE) { // process the average and control the servo
                 averagedData = averagedData / NUMBER_SAMPLES_TO_AVERAGE;
                 // scale the data
                 servoCommand = map(averagedData, MIN_DATA, MAX_DATA, MOUTH_OPENED, MOUTH_CLOSED);
@@ -106,25 +148,55 @@ void loop() {
                 // reset averaged data
                 averagedData = 0;
                 numberAveragedPoints = 0;
+                flashLED(D7); // toogle the D7 LED to show things are working
+            }
+        } else {    // all tracks are done: close the mouth and blink until one is played again
+            averagedData = 0;
+            numberAveragedPoints = 0;
+            if( (millis() - blinkTime) >= BLINK_INTERVAL) {
+                mouthServo.write(map(0, MIN_DATA, MAX_DATA, MOUTH_OPENED, MOUTH_CLOSED));   // where silence puts the mouth
+                flashLED(D7);
+                blinkTime = millis();
             }
-
-            flashLED(D7); // toogle the D7 LED to show things are working
-            sampleTime = millis();  // reset the sample interval time
         }
-        
+    }
 
+}   // end of loop()
 
-    } else {    // we have walked through the entire data array
-        while(true){
-            // loop forever until reset the Photon
-            flashLED(D7);
-            delay(500);
-            flashLED(D7);
-            delay(500);
-        }
+// console function to play the welcome track. The argument is the ms between samples, default 20.
+int playTrack(String interval) {
+    int intervalMS = interval.toInt();
+    if(intervalMS <= 0) {
+        intervalMS = env_data_interval_ms;
     }
+    if(env_data == NULL) {  // no track in the asset pack
+        return -1;
+    }
+    servoPoints = 0;
+    return envPlayer.play(env_data, env_data_size, intervalMS, loopTracks);
+}   // end of playTrack()
+
+// console function: 1 to loop tracks started after this, 0 to play them once
+int loopTrack(String loop) {
+    loopTracks = (loop.toInt() == 1);
+    return loopTracks;
+}   // end of loopTrack()
+
+// console function to move every playing track to the argument, in ms
+int seekTrack(String ms) {
+    for(int track = 0; track < ENV_PLAYER_TRACKS; track++) {
+        envPlayer.seek(track, ms.toInt());
+    }
+    return ms.toInt();
+}   // end of seekTrack()
 
-}   // end of loop()
+// console function to stop every track
+int stopTracks(String unused) {
+    for(int track = 0; track < ENV_PLAYER_TRACKS; track++) {
+        envPlayer.stop(track);
+    }
+    return 0;
+}   // end of stopTracks()
 
 void flashLED(int LEDpin) {
     static  bool flashLed = true;
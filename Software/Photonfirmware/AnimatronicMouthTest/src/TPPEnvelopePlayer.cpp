@@ -0,0 +1,221 @@
+/*
+ * TPPEnvelopePlayer.cpp
+ *
+ * Team Practical Project stored envelope player
+ *
+ * Polyphase resampling of stored envelope tracks. See TPPEnvelopePlayer.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include "TPPEnvelopePlayer.h"
+#include <math.h>
+
+void TPP_EnvelopePlayer::begin(int outputMS) {
+
+    outputMS_ = max(1, outputMS);
+    for (int t = 0; t < ENV_PLAYER_TRACKS; t++) {
+        tracks_[t].playing = false;
+        tracks_[t].output = 0;
+    }
+    lastOutputMS_ = millis();
+
+}
+
+/* ----- play -----
+ * Starts size samples of data, captured every intervalMS, from the beginning.
+ * Returns the track number for the other methods, or -1 if all tracks are playing.
+ */
+int TPP_EnvelopePlayer::play(const uint16_t *data, int size, int intervalMS, bool loop) {
+
+    if (data == NULL || size <= 0 || size >= 65536 || intervalMS <= 0) {
+        return -1;
+    }
+    for (int t = 0; t < ENV_PLAYER_TRACKS; t++) {
+        Track &track = tracks_[t];
+        if (track.playing) {
+            continue;
+        }
+        track.data = data;
+        track.size = size;
+        track.intervalMS = intervalMS;
+        track.loop = loop;
+        track.position = 0;
+        track.step = ((uint32_t)outputMS_ << 16) / intervalMS;
+        track.output = 0;
+        design(track);
+        track.playing = true;
+        return t;
+    }
+    return -1;
+
+}
+
+void TPP_EnvelopePlayer::stop(int track) {
+
+    if (track >= 0 && track < ENV_PLAYER_TRACKS) {
+        tracks_[track].playing = false;
+        tracks_[track].output = 0;
+    }
+
+}
+
+bool TPP_EnvelopePlayer::isPlaying(int track) {
+
+    return track >= 0 && track < ENV_PLAYER_TRACKS && tracks_[track].playing;
+
+}
+
+/* ----- seek -----
+ * Moves a track to ms from its start. Past the end, a looping track goes round
+ * again; one that doesn't loop stops at its next output.
+ */
+void TPP_EnvelopePlayer::seek(int track, unsigned long ms) {
+
+    if (!isPlaying(track)) {
+        return;
+    }
+    Track &t = tracks_[track];
+    uint64_t position = ((uint64_t)ms << 16) / t.intervalMS;
+    uint64_t length = (uint64_t)t.size << 16;
+    if (position >= length) {
+        position = t.loop ? position % length : length;
+    }
+    t.position = (uint32_t)position;
+
+}
+
+unsigned long TPP_EnvelopePlayer::getPositionMS(int track) {
+
+    if (!isPlaying(track)) {
+        return 0;
+    }
+    return (unsigned long)(((uint64_t)tracks_[track].position * tracks_[track].intervalMS) >> 16);
+
+}
+
+/* ----- update -----
+ * Makes the next output sample of every track once each output interval. Returns
+ * true if it did.
+ */
+bool TPP_EnvelopePlayer::update() {
+
+    if ((millis() - lastOutputMS_) < (unsigned long)outputMS_) {
+        return false;
+    }
+    lastOutputMS_ += outputMS_;
+    if ((millis() - lastOutputMS_) > (unsigned long)(outputMS_ * ENV_PLAYER_MAX_BEHIND)) {
+        lastOutputMS_ = millis();   // too far behind to catch up; carry on from now
+    }
+
+    uint32_t startTicks = System.ticks();
+    for (int t = 0; t < ENV_PLAYER_TRACKS; t++) {
+        if (tracks_[t].playing) {
+            makeOutput(tracks_[t]);
+        }
+    }
+    uint32_t ticks = System.ticks() - startTicks;
+    updateTicks_ += ticks;
+    updates_++;
+    if (ticks > updateMaxTicks_) {
+        updateMaxTicks_ = ticks;
+    }
+    return true;
+
+}
+
+/* ----- read -----
+ * The latest output of a track, 0 - 4095, or 0 if it isn't playing
+ */
+int TPP_EnvelopePlayer::read(int track) {
+
+    return isPlaying(track) ? tracks_[track].output : 0;
+
+}
+
+float TPP_EnvelopePlayer::getUpdateMicros() {
+
+    return updates_ > 0 ? (float)updateTicks_ / updates_ / System.ticksPerMicrosecond() : 0;
+
+}
+
+float TPP_EnvelopePlayer::getUpdateMaxMicros() {
+
+    return (float)updateMaxTicks_ / System.ticksPerMicrosecond();
+
+}
+
+/* ----- design -----
+ * The filter for each phase: a Hann windowed sinc, cut off at the lower Nyquist rate
+ * of the track and the output. Each phase is scaled to add up to exactly 1.0, so a
+ * steady level plays back as the same level.
+ */
+void TPP_EnvelopePlayer::design(Track &track) {
+
+    const int one = 1 << ENV_PLAYER_COEF_Q;
+    const int half = ENV_PLAYER_TAPS / 2;
+    float cutoff = min(1.0f, (float)track.intervalMS / outputMS_);  // of the track's Nyquist rate
+
+    for (int phase = 0; phase < ENV_PLAYER_PHASES; phase++) {
+        float fraction = (float)phase / ENV_PLAYER_PHASES;
+        float taps[ENV_PLAYER_TAPS];
+        float sum = 0;
+        for (int k = 0; k < ENV_PLAYER_TAPS; k++) {
+            float distance = (k - (half - 1)) - fraction;   // from the output to this tap, in samples
+            float x = M_PI * cutoff * distance;
+            float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf(x) / x;
+            float window = 0.5f + 0.5f * cosf(M_PI * distance / half);
+            taps[k] = cutoff * sinc * window;
+            sum += taps[k];
+        }
+        int total = 0;
+        for (int k = 0; k < ENV_PLAYER_TAPS; k++) {
+            track.coef[phase][k] = (int16_t)lroundf(taps[k] / sum * one);
+            total += track.coef[phase][k];
+        }
+        track.coef[phase][half - 1 + (fraction >= 0.5f)] += one - total;  // rounding, into the nearest tap
+    }
+
+}
+
+/* ----- sampleAt -----
+ * A track sample, going round for a looping track and holding the first or last
+ * sample past the ends of one that doesn't loop
+ */
+int TPP_EnvelopePlayer::sampleAt(const Track &track, int index) {
+
+    if (track.loop) {
+        index %= track.size;
+        return track.data[index < 0 ? index + track.size : index];
+    }
+    return track.data[constrain(index, 0, track.size - 1)];
+
+}
+
+/* ----- makeOutput -----
+ * One output sample at the track's position, then moves the position on
+ */
+void TPP_EnvelopePlayer::makeOutput(Track &track) {
+
+    int index = track.position >> 16;
+    if (index >= track.size) {
+        track.playing = false;      // a track that doesn't loop has ended
+        track.output = 0;
+        return;
+    }
+    const int16_t *coef = track.coef[(track.position & 0xFFFF) * ENV_PLAYER_PHASES >> 16];
+    int first = index - (ENV_PLAYER_TAPS / 2 - 1);
+
+    int32_t sum = 0;
+    for (int k = 0; k < ENV_PLAYER_TAPS; k++) {
+        sum += coef[k] * sampleAt(track, first + k);
+    }
+    track.output = constrain((sum + (1 << (ENV_PLAYER_COEF_Q - 1))) >> ENV_PLAYER_COEF_Q, 0, 4095);
+
+    track.position += track.step;
+    while (track.loop && (track.position >> 16) >= (uint32_t)track.size) {
+        track.position -= (uint32_t)track.size << 16;
+    }
+
+}
@@ -0,0 +1,86 @@
+/*
+ * TPPEnvelopePlayer.h
+ *
+ * Team Practical Project stored envelope player
+ *
+ * Plays stored envelope tracks at a fixed output interval (10 ms, the rate speak()
+ * samples the live envelope at in the mouth firmware), whatever interval each track
+ * was captured at. A track captured every 20 ms, or every 5, or at the 10 ms of
+ * visemegen, plays at the same speed it was recorded.
+ *
+ * Each output sample is resampled from the track with a polyphase filter: a windowed
+ * sinc low-pass of ENV_PLAYER_TAPS taps, worked out ahead for ENV_PLAYER_PHASES
+ * positions between two track samples. The cutoff is the lower of the two Nyquist
+ * rates, so a track played at a lower rate than it was captured at is smoothed,
+ * not aliased. The position in the track is Q16 fixed point; each output costs
+ * ENV_PLAYER_TAPS 16 x 16 bit multiply-adds per track playing, however long the track,
+ * whatever the rates.
+ *
+ * Up to ENV_PLAYER_TRACKS tracks play at once, each looping or not, and each can be
+ * moved to any time with .seek(). Track data stays where it is (in flash); it is not copied.
+ *
+ * Key methods
+ *      .begin()            sets the output interval
+ *      .play()             starts a track, returns its number, or -1 if all are in use
+ *      .stop(), .seek(), .isPlaying(), .getPositionMS()
+ *      .update()           call every loop(). Returns true when there is a new output
+ *                          sample; .read() has it for each track.
+ *      .getUpdateMicros(), .getUpdateMaxMicros()
+ *                          time to make one output sample for all tracks
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_ENVELOPE_PLAYER_H
+#define _TPP_ENVELOPE_PLAYER_H
+
+#include "Particle.h"
+
+#define ENV_PLAYER_TRACKS 4
+#define ENV_PLAYER_TAPS 8
+#define ENV_PLAYER_PHASES 32
+#define ENV_PLAYER_COEF_Q 14            // filter coefficients are Q14
+#define ENV_PLAYER_MAX_BEHIND 5         // outputs made up after a slow loop(); beyond that they are skipped
+
+class TPP_EnvelopePlayer {
+
+    public:
+        void begin(int outputMS);
+        int play(const uint16_t *data, int size, int intervalMS, bool loop);
+        void stop(int track);
+        bool isPlaying(int track);
+        void seek(int track, unsigned long ms);
+        unsigned long getPositionMS(int track);
+        bool update();
+        int read(int track);
+        float getUpdateMicros();
+        float getUpdateMaxMicros();
+
+    private:
+        struct Track {
+            const uint16_t *data;
+            int size;
+            int intervalMS;
+            bool loop;
+            bool playing;
+            uint32_t position;                  // in track samples, Q16
+            uint32_t step;                      // position moved per output, Q16
+            int16_t coef[ENV_PLAYER_PHASES][ENV_PLAYER_TAPS];
+            int output;
+        };
+        void design(Track &track);
+        int sampleAt(const Track &track, int index);
+        void makeOutput(Track &track);
+
+        Track tracks_[ENV_PLAYER_TRACKS];
+        int outputMS_ = 10;
+        unsigned long lastOutputMS_ = 0;
+
+        uint32_t updateTicks_ = 0;              // for the benchmark
+        uint32_t updateMaxTicks_ = 0;
+        uint32_t updates_ = 0;
+
+};
+
+#endif
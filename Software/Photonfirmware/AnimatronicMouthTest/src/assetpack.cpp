@@ -0,0 +1,49 @@
+/*
+ * assetpack.cpp
+ *
+ * Team Practical Project asset pack
+ *
+ * Made by assetpack (Software/HostTools/AssetPack) from assets/mouthtest.assets.
+ * Do not edit; change the asset list and run the packer again.
+ *
+ *      envelope  welcome                  406 bytes
+ *
+ */
+
+#include <stdint.h>
+
+extern const uint8_t assetPackData[];
+extern const uint32_t assetPackSize;
+
+__attribute__((aligned(4))) const uint8_t assetPackData[] = {
+    0x54, 0x50, 0x41, 0x4b, 0x01, 0x00, 0x01, 0x00, 0xb6, 0x01, 0x00, 0x00, 0x02, 0x34, 0x19, 0xa9,
+    0xf3, 0x7d, 0xe1, 0x27, 0x03, 0x00, 0xc9, 0x00, 0x20, 0x00, 0x00, 0x00, 0x96, 0x01, 0x00, 0x00,
+    0x14, 0x00, 0x00, 0x00, 0x22, 0x00, 0x22, 0x00, 0x22, 0x00, 0x22, 0x00, 0x22, 0x00, 0x22, 0x00,
+    0x22, 0x00, 0x22, 0x00, 0x22, 0x00, 0x22, 0x00, 0x22, 0x00, 0x22, 0x00, 0x2b, 0x00, 0x87, 0x09,
+    0x2e, 0x0d, 0xb1, 0x09, 0x35, 0x07, 0x91, 0x07, 0x91, 0x06, 0xfe, 0x05, 0x68, 0x08, 0x9f, 0x02,
+    0x8a, 0x00, 0x31, 0x00, 0x24, 0x00, 0x22, 0x00, 0x25, 0x00, 0xdb, 0x00, 0xc8, 0x04, 0x02, 0x04,
+    0xe8, 0x02, 0x16, 0x03, 0x15, 0x06, 0x87, 0x06, 0x4b, 0x02, 0x95, 0x01, 0x3b, 0x01, 0xa4, 0x02,
+    0x45, 0x06, 0xea, 0x04, 0xc0, 0x04, 0xcc, 0x07, 0x6b, 0x08, 0xd4, 0x07, 0xd4, 0x05, 0x13, 0x04,
+    0x73, 0x01, 0x6e, 0x00, 0x2d, 0x00, 0x24, 0x00, 0x22, 0x00, 0x44, 0x00, 0x28, 0x03, 0x29, 0x01,
+    0xce, 0x02, 0xe3, 0x03, 0xa0, 0x02, 0xd7, 0x00, 0x7f, 0x00, 0x52, 0x00, 0x3a, 0x00, 0x4b, 0x01,
+    0x30, 0x01, 0x92, 0x02, 0xb2, 0x06, 0x11, 0x06, 0x2d, 0x06, 0xb3, 0x05, 0x10, 0x03, 0x51, 0x01,
+    0xa8, 0x00, 0x35, 0x00, 0x25, 0x00, 0x22, 0x00, 0x29, 0x00, 0xdc, 0x02, 0x0a, 0x01, 0xe0, 0x00,
+    0xde, 0x05, 0xc5, 0x0a, 0x11, 0x07, 0x60, 0x01, 0x4e, 0x00, 0x45, 0x00, 0x54, 0x00, 0x32, 0x00,
+    0xf1, 0x02, 0x75, 0x08, 0xc3, 0x09, 0xe3, 0x0a, 0x11, 0x0b, 0x98, 0x0a, 0x46, 0x0c, 0x80, 0x07,
+    0xc9, 0x03, 0x3b, 0x03, 0xb3, 0x01, 0x3e, 0x02, 0x78, 0x02, 0x80, 0x00, 0x2f, 0x00, 0x3d, 0x00,
+    0x28, 0x00, 0x47, 0x01, 0x99, 0x05, 0x4a, 0x06, 0x9f, 0x05, 0xdb, 0x06, 0x94, 0x09, 0xa7, 0x09,
+    0xa1, 0x05, 0xbb, 0x01, 0x5e, 0x01, 0xea, 0x00, 0xde, 0x00, 0x70, 0x00, 0x2d, 0x00, 0x24, 0x00,
+    0x26, 0x00, 0x2e, 0x00, 0x51, 0x00, 0x55, 0x00, 0x3a, 0x00, 0x27, 0x00, 0x27, 0x00, 0x26, 0x00,
+    0x28, 0x00, 0x31, 0x00, 0x2e, 0x00, 0x33, 0x00, 0x35, 0x00, 0x2a, 0x00, 0x25, 0x00, 0x22, 0x00,
+    0x22, 0x00, 0x22, 0x00, 0xc4, 0x00, 0xa5, 0x00, 0x59, 0x00, 0x3c, 0x00, 0x61, 0x00, 0xe4, 0x00,
+    0x3e, 0x01, 0x21, 0x01, 0x8c, 0x00, 0x34, 0x00, 0x25, 0x00, 0x22, 0x00, 0x22, 0x00, 0x23, 0x00,
+    0x27, 0x00, 0x37, 0x00, 0x3d, 0x00, 0x5a, 0x00, 0x56, 0x00, 0x50, 0x00, 0x34, 0x00, 0x29, 0x00,
+    0x27, 0x00, 0x25, 0x00, 0x29, 0x00, 0x65, 0x00, 0x73, 0x00, 0x83, 0x01, 0x3d, 0x02, 0xf9, 0x01,
+    0x07, 0x02, 0xc6, 0x00, 0xe0, 0x00, 0x4b, 0x00, 0x29, 0x00, 0x23, 0x00, 0x22, 0x00, 0x22, 0x00,
+    0x22, 0x00, 0x23, 0x00, 0x39, 0x00, 0x59, 0x00, 0xd1, 0x00, 0x8a, 0x01, 0x30, 0x02, 0xd1, 0x01,
+    0x76, 0x00, 0x31, 0x00, 0x26, 0x00, 0x23, 0x00, 0x2b, 0x00, 0x2b, 0x00, 0x34, 0x00, 0x3d, 0x00,
+    0x5d, 0x00, 0xa6, 0x00, 0xe4, 0x00, 0xc2, 0x00, 0xc0, 0x00, 0x7a, 0x00, 0x3b, 0x00, 0x2b, 0x00,
+    0x25, 0x00, 0x22, 0x00, 0x22, 0x00,
+};
+
+const uint32_t assetPackSize = 438;
@@ -29,7 +29,9 @@
  *    D5: connected to a red LED.  Indicated when the demo is paused.
  *    D6: connected to a green LED.  Indicates when the eyes are signalled.
  *    A0, A1, A2: connected internally on the PCB to the analog processing circuirty. Pin
- *      A2 has the envelope data that is samplled every 10 ms for analog signal processing.
+ *      A0 has the envelope data that is samplled every 10 ms for analog signal processing.
+ *      A1 has the raw preamp signal and A2 its DC offset; the software envelope detector
+ *      uses these instead of A0 when selected.
  *    A3: connected to an external momentary pushbutton switch.  The switch is used to pause
  *      and unpause the demo.
  *    A4: connected to a PIR device.  The PIR used runs off of 5 volts and this pin is 5 volt
@@ -50,6 +52,58 @@
  * Released under open source, non-commercial license.
  * Date: 4/20/21
  * 
+ * version 1.9: interjections. With the "interjection" cloud function set to "motion" or
+ *  "button", new motion or a button press while a clip plays has the mini MP3 player
+ *  play a short advert clip over it, at once: the clip is held, the advert plays, and
+ *  the clip goes on where it was. The mouth follows the advert with its own analog
+ *  processing parameters for its length, then goes back to the clip's. The time from
+ *  the trigger to the advert's sound, found in the envelope, is a metric, the
+ *  "interjection ms" cloud variable, and published. While interjections are set to
+ *  "button", the button pauses the demo only between clips.
+ * version 1.8: timer wheel. The envelope sampling, the waits of the demo state machine
+ *  and the volume sweep, the button debounce and the cloud variable refresh are timers
+ *  on one TPP_TimerWheel that call back or run out when due, instead of millis()
+ *  compared every loop(). Samples keep their 10 ms from when each was due.
+ * version 1.7: metrics. The counts and timings worth watching are kept in a metrics
+ *  registry: clips played, the volume, how long the mini MP3 player takes to start a
+ *  clip, envelope samples and how late each was taken, clip matches, and the frame
+ *  budget. The "metrics" cloud function publishes them as Prometheus text, a page at
+ *  a time: pass the index to start from, and it returns the index of the next page,
+ *  or 0 after the last. Updating a metric is an atomic add, safe from the timer
+ *  interrupt. The publish buffer is now 600 characters, and the arena 1024 bytes.
+ * version 1.6: static arena. The sync and clip capture buffers and the text of every
+ *  publish are reserved from one arena of ARENA_BYTES in setup(), and the clip data is
+ *  numbers, not Strings, so nothing is allocated from the heap after setup() but the
+ *  Strings the cloud functions are called with. The "memory" cloud variable reports
+ *  each block's size, use and high-water mark, and the free heap.
+ * version 1.5: frame budget. When loop() runs over FRAME_BUDGET_US (the mini MP3 player
+ *  blocking, a burst of publishes), sync measurement and then the clip match and sync
+ *  publishes are given up until it fits again, so the envelope sampling and the mouth
+ *  servo keep their 10 ms. Samples are now timed from when they were due, not from when
+ *  they were taken, so a late one doesn't push the rest back. The "frame budget" cloud
+ *  variable reports the level and how often each was entered.
+ * version 1.4: sync offset measurement. With "sync measure" set "on", every play of a
+ *  clip with a fingerprint is timed: the BUSY pin, and the sound, found by cross-correlating
+ *  the envelope against the fingerprint. The median delay of the sound after BUSY falls,
+ *  over many plays, is kept in EEPROM as the installation's sync offset, and the mouth
+ *  waits that long after BUSY before it moves. Each play is published, and "sync measure"
+ *  "report" publishes the distribution. The offset and a confidence are cloud variables.
+ * version 1.3: clip identification. A clip started from the cloud, or one the player
+ *  goes on to by itself, is recognized from the first 320 ms of its envelope against
+ *  fingerprints of the known clips, and that clip's analog processing parameters are
+ *  applied. The "clip fingerprint" cloud function manages the fingerprints: "learn N"
+ *  records the next clip played as clip N, "forget N", "clear", and "benchmark" publishes
+ *  the time a match takes against libraries of 1 to 64 clips.
+ * version 1.2: volume compensation. The envelope grows with the player volume, so the
+ *  aMax/aMin values tuned per clip held only at volume 23. Each averaged envelope value
+ *  is now scaled by a gain for the current volume (one fixed point multiply), from a
+ *  table measured by the "volume sweep" cloud function and kept in EEPROM. Changing
+ *  the volume no longer needs any clip retuned.
+ * version 1.1: software envelope detector. The "envelope source" cloud function selects
+ *  the hardware envelope on A0 (0, the default) or an envelope computed from the raw
+ *  preamp on A1 (1), sampled at several kHz by a timer interrupt. The "envelope cutoff"
+ *  cloud function sets its low-pass cutoff in Hz, and "envelope benchmark" publishes
+ *  the CPU time it uses. Needs the SparkIntervalTimer library.
  * version 1.0: initial release; full capability
  * version 0.2: implemented and tested button state machine. Need to add pause state.
  * version 0.1: code is tested but needs pause button to be implemented.
@@ -58,6 +112,13 @@
 
 #include <DFRobotDFPlayerMini.h>
 #include <math.h>
+#include "TPPEnvelopeDetector.h"
+#include "TPPClipMatcher.h"
+#include "TPPSyncMeter.h"
+#include "TPPFrameBudget.h"
+#include "TPPArena.h"
+#include "TPPMetrics.h"
+#include "TPPTimerWheel.h"
 
 // create an instance of the mini MP3 player
 DFRobotDFPlayerMini miniMP3Player;
@@ -65,6 +126,42 @@ DFRobotDFPlayerMini miniMP3Player;
 // create an instance of the servo
 Servo mouthServo;
 
+// create an instance of the software envelope detector
+TPP_EnvelopeDetector softEnvelope;
+
+// create the arena the libraries reserve their memory from in setup()
+TPP_Arena arena;
+
+// create an instance of the clip matcher
+TPP_ClipMatcher clipMatcher;
+
+// create an instance of the sync meter
+TPP_SyncMeter syncMeter;
+
+// create an instance of the frame budget monitor
+TPP_FrameBudget frameBudget;
+
+// create the metrics registry, and the metrics the sketch updates
+TPP_Metrics metrics;
+TPP_Counter playsMetric;        // clips started on the mini MP3 player
+TPP_Gauge volumeMetric;         // the volume last sent to the player
+TPP_Histogram startMetric;      // ms from play to busy asserting
+TPP_Counter samplesMetric;      // envelope samples taken
+TPP_Histogram sampleLateMetric; // ms each sample was taken after it was due
+TPP_Counter matchesMetric;      // clips identified by the clip matcher
+TPP_Counter interjectionsMetric;    // advert clips played over a clip
+TPP_Histogram interjectionMetric;   // ms from the trigger to the advert's sound
+TPP_Counter interjectionMissedMetric; // interjections whose sound wasn't found
+
+// create the timer wheel, and the timers on it
+TPP_TimerWheel timers;
+TPP_Timer sampleTimer;    // the next envelope sample
+TPP_Timer stateTimer;     // the waits of the loop() state machine
+TPP_Timer sweepTimer;     // the waits of the volume sweep
+TPP_Timer debounceTimer;  // button debouncing
+TPP_Timer reportTimer;    // refreshes the frame budget and memory cloud variables
+TPP_Timer interjectionTimer;  // the end of an interjection
+
 // define Photon pins
 const int BUSY_PIN = D2;
 const int SERVO_PIN = D3;
@@ -73,6 +170,8 @@ const int GREEN_LED_PIN = D6;
 const int BUTTON_PIN = A3;
 const int LED_PIN = D7;
 const int ANALOG_ENV_INPUT = A0;
+const int RAW_AUDIO_INPUT = A1;
+const int AUDIO_OFFSET_INPUT = A2;
 const int PIR_PIN = A4;
 const int EYES_SIGNAL_PIN = A5;
 
@@ -84,31 +183,98 @@ const unsigned long BUSY_WAIT = 2000UL; // busy pin wait time = 2 second
 const unsigned long EYES_START_TIME = 1000UL; // time to eye sequence to start up
 const unsigned long EYES_COMPLETE_TIME = 1000UL;  // time to eye sequence to stop
 const unsigned long DEBOUNCE_TIME = 10UL; // time for button debouncing
+const unsigned long REPORT_INTERVAL = 1000UL; // time between refreshes of the frame budget and memory variables
+const int MAX_VOLUME = 30;  // the mini MP3 player volume range is 0 - 30
+const int REFERENCE_VOLUME = 23;  // the volume the clips' aMax and aMin were tuned at
+const int SWEEP_VOLUME_STEP = 3;  // volumes measured by the sweep, others are interpolated
+const unsigned long SWEEP_QUIET_TIME = 1000UL;  // time to measure the envelope with no sound
+const unsigned long SWEEP_START_TIMEOUT = 3000UL; // give up if a sweep clip doesn't start
+const int GAIN_ONE = 256; // volume gains are fixed point, 256 = 1.0
+const int GAIN_MIN = 64;  // 0.25
+const int GAIN_MAX = 4096;  // 16.0
+const int VOLUME_GAIN_EEPROM_ADDR = 0;
+const uint32_t VOLUME_GAIN_MAGIC = 0x54505647;  // "TPVG", marks a saved table
+const unsigned long FRAME_BUDGET_US = 2000UL; // loop() time before optional work is shed
+const unsigned long SAMPLE_MAX_BEHIND = 5;  // samples late before speak() gives up catching up
+const int PUBLISH_TEXT_SIZE = 600;  // longest publish, in the arena; the cloud takes 622
+const int INTERJECTION_ONSET = 400; // compensated envelope the advert's sound rises through
+const unsigned long INTERJECTION_TIMEOUT = 1000UL;  // give up listening for the advert's sound
+
+// optional work, in the order it is given up when loop() runs over FRAME_BUDGET_US
+enum OptionalJobs {
+  jobStatistics = 1,  // envelope max and min
+  jobTelemetry,       // clip match and sync publishes
+  numOptionalJobs = jobTelemetry
+};
 
 // define global variables for the audio envelope data
 int maxValue = 4095; // the highest expected analog input value - for servo mapping
 int minValue = 0; // the lowest expected analog input value - for servo mapping
 int numSamples = 5; // the number of analog input samples to average for a servo command
 int nlProcess = 0;  // 0 for skip non linear processing, 1 for sqrt processing, more later...
+int envelopeSource = 0; // 0 for the hardware envelope on A0, 1 for the software envelope from A1
+int currentVolume = REFERENCE_VOLUME; // the volume last sent to the mini MP3 player
+int volumeGain = GAIN_ONE;  // envelope gain for currentVolume, 256 = 1.0
+bool matchReady = false;  // the clip matcher has a result for loop()
+unsigned long playMS = 0; // millis() the last clip was played
+bool sweepSampleDue = false;  // a sample for the volume sweep
+
+// volume compensation table, saved in EEPROM. gain[v] scales the envelope at volume v
+//  to what it would be at REFERENCE_VOLUME.
+struct VolumeGainTable {
+  uint32_t magic;
+  uint16_t gain[MAX_VOLUME + 1];
+};
+VolumeGainTable volumeGains;
 
 // cloud variables to report statistics
 int maxFound = 0; // the maximum analog value found in the data set
 int minFound = 4095; // the minimum analog value found in the data set
+int syncOffset = 0; // ms the sound starts after the busy pin falls
+int syncConfidence = 0; // 0 - 100, how far to trust syncOffset
+char budgetReport[200]; // frame budget level and counters
+char memoryReport[200]; // arena blocks and high-water marks, and the free heap
+
+// text of the publishes, formatted in place
+char *publishText = NULL;
+TPP_ArenaBlock *publishBlock = NULL;
 
 // structure definition for clip data
 struct ClipData {
-  String clipNumber; // the track number on the SD card
-  String volume;     // the playback volume setting on the mini MP3 player
-  String nlproc;        // the non-linear processing type for clip data
-  String avSamples;  // the number of samples to average
-  String aMax;       // the largest analog value to map to servo upper limit
-  String aMin;       // the smallest analog value to map to the servo lower limit
+  int clipNumber; // the track number on the SD card
+  int volume;     // the playback volume setting on the mini MP3 player
+  int nlproc;        // the non-linear processing type for clip data
+  int avSamples;  // the number of samples to average
+  int aMax;       // the largest analog value to map to servo upper limit
+  int aMin;       // the smallest analog value to map to the servo lower limit
 };
 
 // define some clips
-ClipData welcome {"11", "23", "1", "1", "2500", "0"};
-ClipData pirate {"12", "23", "1", "1", "3000", "0"};
-ClipData walkAway {"13", "23", "1", "1", "3000", "0"};
+ClipData welcome {11, 23, 1, 1, 2500, 0};
+ClipData pirate {12, 23, 1, 1, 3000, 0};
+ClipData walkAway {13, 23, 1, 1, 3000, 0};
+ClipData *knownClips[] = {&welcome, &pirate, &walkAway};  // clips whose parameters apply when identified
+
+// the advert clip played by an interjection, from the ADVERT folder of the SD card. It
+//  plays at the volume of the clip it interrupts, so its volume is not used.
+ClipData interjection {1, 23, 1, 1, 3000, 0};
+
+// define the events that trigger an interjection
+enum InterjectionEvents {
+  interjectOff,     // none
+  interjectMotion,  // the PIR asserting again while a clip plays
+  interjectButton   // the button pressed while a clip plays
+};
+
+// interjection state, set by the "interjection" cloud function
+InterjectionEvents interjectionEvent = interjectOff;
+unsigned long interjectionLength = 2000UL; // ms the advert clip plays for
+ClipData interrupted; // the analog processing parameters of the clip interjected over
+bool interjecting = false;  // an advert is playing over the clip
+bool listening = false; // waiting for the advert's sound in the envelope
+bool onsetArmed = false;  // the envelope has been under INTERJECTION_ONSET since the trigger
+unsigned long triggerMS = 0;  // millis() of the trigger
+int interjectionLatency = 0;  // cloud variable: ms from the last trigger to its sound, -1 if not found
 
 // define enumerated state variable for loop() state machine
 enum StateVariable {
@@ -121,6 +287,21 @@ enum StateVariable {
   paused
 };
 
+StateVariable state = idle; // the loop() state machine, moved on by its timer too
+
+// define enumerated state variable for the volumeSweep() state machine
+enum SweepStates {
+  sweepOff,
+  sweepQuiet,   // measure the envelope with nothing playing
+  sweepStart,   // set the next volume and play the clip
+  sweepWaiting, // wait for busy to assert (low)
+  sweepPlaying  // add up the envelope until busy unasserts
+};
+
+// volume sweep state, set by the "volume sweep" cloud function
+SweepStates sweepState = sweepOff;
+int sweepClip = 0;
+
 // define enumerated state variable for buttonPressed() function
 enum ButtonStates {
   buttonOff,    // the button is not pressed
@@ -130,13 +311,13 @@ enum ButtonStates {
 };
 
 //function to set up the data and playback a clip
-void clipPlay(ClipData thisClip) {
-  analogMin(thisClip.aMin);
-  analogMax(thisClip.aMax);
-  nlp(thisClip.nlproc);
-  samples(thisClip.avSamples);
-  clipVolume(thisClip.volume);
-  clipNum(thisClip.clipNumber);
+void clipPlay(const ClipData &thisClip) {
+  setAnalogMin(thisClip.aMin);
+  setAnalogMax(thisClip.aMax);
+  setNlp(thisClip.nlproc);
+  setSamples(thisClip.avSamples);
+  setVolume(thisClip.volume);
+  playClip(thisClip.clipNumber);
 }  // end of clipPlay()
 
 void setup() {
@@ -156,8 +337,42 @@ void setup() {
   Particle.function("non-linear processing type", nlp);
   Particle.function("analog input max", analogMax);
   Particle.function("analog input min", analogMin);
+  Particle.function("envelope source", envSource);
+  Particle.function("envelope cutoff", envCutoff);
+  Particle.function("envelope benchmark", envBenchmark);
+  Particle.function("volume sweep", volumeSweepStart);
+  Particle.function("clip fingerprint", clipFingerprint);
+  Particle.function("sync measure", syncMeasure);
+  Particle.function("metrics", metricsPublish);
+  Particle.function("interjection", interjectionSet);
   Particle.variable("max envelope value", maxFound);
   Particle.variable("min envelope value", minFound);
+  Particle.variable("sync offset ms", syncOffset);
+  Particle.variable("sync confidence", syncConfidence);
+  Particle.variable("frame budget", budgetReport);
+  Particle.variable("memory", memoryReport);
+  Particle.variable("interjection ms", interjectionLatency);
+
+  // reserve the publish text
+  publishBlock = arena.reserve("publish", PUBLISH_TEXT_SIZE);
+  publishText = publishBlock ? (char *)publishBlock->getData() : NULL;
+
+  // load the volume compensation table, or start with no compensation
+  loadVolumeGains();
+
+  // load the clip fingerprints
+  clipMatcher.begin(SAMPLE_INTERVAL, arena);
+
+  // load the sync offset
+  syncMeter.begin(SAMPLE_INTERVAL, arena);
+  syncOffset = syncMeter.getOffsetMS();
+
+  // start timing loop()
+  frameBudget.begin(FRAME_BUDGET_US, numOptionalJobs);
+  frameBudget.report(budgetReport, sizeof(budgetReport));
+
+  // register the metrics
+  registerMetrics();
 
   // set up the mini MP3 player
   Serial1.begin(9600);
@@ -183,20 +398,54 @@ void setup() {
   digitalWrite(LED_PIN, HIGH);
   mouthServo.write(MOUTH_CLOSED);
 
+  // everything is reserved; nothing is allocated from here on
+  arena.seal();
+  reportMemory();
+
+  // start sampling the envelope, and refreshing the cloud variables
+  timers.schedule(sampleTimer, SAMPLE_INTERVAL, sampleDue);
+  timers.schedule(reportTimer, REPORT_INTERVAL, reportStatus);
+
 } // end of setup()
 
 void loop() {
-  static unsigned long busyTime = millis();
-  static StateVariable state = idle;
   static bool buttonToggle = false;   // if set true, put demo in pause mode
+  static bool lastMotion = false;   // the PIR at the last loop(), to see it assert again
 
-  // refresh the analog sampling and processing the mouth movement continuously
-  speak();
+  frameBudget.frameStart();
+
+  // time the busy pin for the sync meter, which also delays the mouth by the sync offset
+  syncMeter.update(digitalRead(BUSY_PIN) == LOW);
+
+  // run whatever is due: the analog sampling and mouth movement every 10 ms, and
+  //  the state machine's waits
+  timers.process();
+
+  // apply the parameters of a clip that has just been identified
+  if(matchReady == true) {
+    matchReady = false;
+    clipIdentified();
+  }
+
+  // while a volume sweep runs, it has the mini MP3 player to itself
+  if(volumeSweep() == true) {
+    frameBudget.frameEnd();
+    return;
+  }
 
-  // check button status and toggle pause mode if button has been pressed
+  // check button status and toggle pause mode if button has been pressed, unless the
+  //  button interjects in the clip that is playing
   if(buttonPressed() == true) {
-    buttonToggle = !buttonToggle;
+    if(interjectionEvent == interjectButton && state == clipPlaying) {
+      interject();
+    }
+    else {
+      buttonToggle = !buttonToggle;
+    }
   }
+  bool motion = (digitalRead(PIR_PIN) == HIGH);
+  bool newMotion = (motion == true && lastMotion == false);
+  lastMotion = motion;
   // the RED LED is the pause state indicator
   if(buttonToggle == true) {
     digitalWrite(RED_LED_PIN, HIGH);
@@ -213,7 +462,7 @@ void loop() {
         if(digitalRead(PIR_PIN) == HIGH) {
           digitalWrite(EYES_SIGNAL_PIN, HIGH);  // signal the eyes that motion occurred
           digitalWrite(GREEN_LED_PIN, HIGH);    // visual indication of motion    
-          busyTime = millis();    // update timer time
+          timers.schedule(stateTimer, EYES_START_TIME, eyesStarted);  // play the clip once the eyes are going
           state = motionDetected; // transition to the next state
         }
         else {
@@ -222,20 +471,12 @@ void loop() {
       }
       break;
     
-    case motionDetected:  // motion is detected, signal the eyes and wait
-      if( (millis() - busyTime) >= EYES_START_TIME) {
-          clipPlay(welcome);  // play the welcome clip
-          busyTime = millis();    // reset the timer for the next state
-          state = clipWaiting;  // transition to next state
-      }
-      else {
-        state = motionDetected; // stay in present state
-      }
+    case motionDetected:  // motion is detected, the eyes are signalled; eyesStarted() plays the clip
       break;
 
     case clipWaiting:   // wait for busy to assert (low)
       if(digitalRead(BUSY_PIN) == LOW) {   // now busy
-        busyTime = millis();    // reset the timer for the next state
+        startMetric.observe(millis() - playMS); // how long the player took to start
         state = clipPlaying;  // transition to next state
       }
       else {  // clip hasn't started yet
@@ -245,28 +486,27 @@ void loop() {
 
     case clipPlaying: // clip; playing, wait for busy to unassert (complete)
       if(digitalRead(BUSY_PIN) == HIGH) {   // not busy anymore, clip is done
-        busyTime = millis();    // reset the timer for the next state
+        if(interjecting == true) {  // the clip ended under the advert
+          timers.cancel(interjectionTimer);
+          interjectionDone(NULL);
+        }
+        timers.schedule(stateTimer, EYES_COMPLETE_TIME, eyesCompleted);
         state = clipComplete;  // transition to next state
       }
       else {  // clip still in process of playing
+        if(interjectionEvent == interjectMotion && newMotion == true) {
+          interject();  // someone else has arrived
+        }
         state = clipPlaying; // stay in present state
       }
       break;
 
-    case clipComplete:  // clip has finished, keep eyes going a little longer
-      if( (millis() - busyTime) >= EYES_COMPLETE_TIME) {
-        digitalWrite(EYES_SIGNAL_PIN, LOW); // tell eyes that we are done
-        digitalWrite(GREEN_LED_PIN, LOW); // reset indicator
-        state = clipEnd;  // transition to next state, don't update the timer!
-      }
-      else {
-        state = clipComplete; // stay in present state
-      }
+    case clipComplete:  // clip has finished, keep eyes going a little longer; eyesCompleted() ends them
       break;
 
     case clipEnd:   // just make sure busy pin has been unasserted long enough
       // test that busy pin is unasserted long enough and PIR is unasserted so don't retrigger
-      if( ((millis() - busyTime) >= BUSY_WAIT) && (digitalRead(PIR_PIN) == LOW) ) {  
+      if( (stateTimer.isPending() == false) && (digitalRead(PIR_PIN) == LOW) ) {  
           if(buttonToggle == false) { // no pause state indicated
             state = idle;
           }
@@ -293,70 +533,235 @@ void loop() {
       state = idle;
   }
 
+  frameBudget.frameEnd();
+
 } // end of loop()
 
+// timer callback: the eyes have had time to start, play the welcome clip
+void eyesStarted(void *context) {
+  clipPlay(welcome);
+  state = clipWaiting;
+} // end of eyesStarted()
 
+// timer callback: the eyes have gone on a little after the clip, tell them to stop.
+//  The state machine waits out the rest of BUSY_WAIT from the end of the clip.
+void eyesCompleted(void *context) {
+  digitalWrite(EYES_SIGNAL_PIN, LOW); // tell eyes that we are done
+  digitalWrite(GREEN_LED_PIN, LOW); // reset indicator
+  timers.schedule(stateTimer, BUSY_WAIT - EYES_COMPLETE_TIME);
+  state = clipEnd;
+} // end of eyesCompleted()
 
+// timer callback: refresh the frame budget and memory cloud variables
+void reportStatus(void *context) {
+  frameBudget.report(budgetReport, sizeof(budgetReport));
+  reportMemory();
+  timers.schedule(reportTimer, REPORT_INTERVAL, reportStatus);
+} // end of reportStatus()
 
+// timer callback: take an envelope sample. The next is timed from when this one
+//  was due, so one late loop() doesn't push every later sample back; if far
+//  behind, start again from now.
+void sampleDue(void *context) {
+  uint32_t due = sampleTimer.getDeadline();
+  sampleLateMetric.observe(millis() - due);
+  uint32_t next = due + SAMPLE_INTERVAL;
+  if( (millis() - due) >= SAMPLE_INTERVAL * SAMPLE_MAX_BEHIND) {
+    next = millis() + SAMPLE_INTERVAL;
+  }
+  timers.scheduleAt(sampleTimer, next, sampleDue);
+  if(sweepState != sweepOff) {
+    sweepSampleDue = true;  // the sweep measures at the same rate
+  }
+  speak();
+} // end of sampleDue()
+
+
+
+
+// function to take an envelope sample and move the mouth, called every
+//  SAMPLE_INTERVAL by sampleDue()
 void speak() {
-  static unsigned long lastSampleTime = millis();
   static unsigned int averagedData = 0;
   static unsigned int numberAveragedPoints = 0;
   static bool toggle = false;
   int servoCommand;
 
-  // read a sample every 10 ms (non-blocking)
-  if( (millis() - lastSampleTime) >= SAMPLE_INTERVAL) {
-    // average the samples
-    averagedData += analogRead(ANALOG_ENV_INPUT); // read in analog data and add
-    numberAveragedPoints++; // keep track of how many points are added
-    if(numberAveragedPoints >= numSamples) {  // number samples to average reached
-      averagedData = averagedData / numSamples; // average the sum
-      // non-linearly scale the averaged data
-      if(nlProcess == 1) {
-        averagedData = nlScale(averagedData);
-      }
-      // command the servo
-      servoCommand = map(averagedData, minValue, maxValue, MOUTH_CLOSED, MOUTH_OPENED);
-      // constrain the servo so it doesn't peg at 0 or 180 degrees.
-      servoCommand = constrain(servoCommand, 5, 175);
-      // send data to servo only if clip is playing, else close the mouth
-      if(digitalRead(BUSY_PIN) == LOW) {
-        mouthServo.write(servoCommand);
-      } else {
-        mouthServo.write(MOUTH_CLOSED);
-      }
+  // average the samples
+  int sample = readEnvelope(); // read in envelope data
+  samplesMetric.add();
+  averagedData += sample; // and add
+  if(listening == true) {
+    interjectionHeard(sample);
+  }
+  // the clip matcher works on the raw samples; its correlation doesn't care about volume
+  if(clipMatcher.addSample(sample, digitalRead(BUSY_PIN) == LOW) == true) {
+    matchReady = true;
+  }
+  // the sync capture must have every sample, or the sound is found late by as many
+  //  as are missing; only its publish is shed
+  if(syncMeter.addSample(sample) == true) {
+    syncMeasured();
+  }
+  numberAveragedPoints++; // keep track of how many points are added
+  if(numberAveragedPoints >= numSamples) {  // number samples to average reached
+    averagedData = averagedData / numSamples; // average the sum
+    // compensate for the player volume
+    averagedData = min((averagedData * volumeGain) >> 8, 4095U);
+    // non-linearly scale the averaged data
+    if(nlProcess == 1) {
+      averagedData = nlScale(averagedData);
+    }
+    // command the servo
+    servoCommand = map(averagedData, minValue, maxValue, MOUTH_CLOSED, MOUTH_OPENED);
+    // constrain the servo so it doesn't peg at 0 or 180 degrees.
+    servoCommand = constrain(servoCommand, 5, 175);
+    // send data to servo only if clip is playing (allowing for the sync offset), else close the mouth
+    if(syncMeter.audioPlaying() == true) {
+      mouthServo.write(servoCommand);
+    } else {
+      mouthServo.write(MOUTH_CLOSED);
+    }
 
-      // set max and min values found
+    // set max and min values found, unless shed while loop() is over budget
+    if(frameBudget.allows(jobStatistics) == true) {
       if(averagedData > maxFound) {
         maxFound = averagedData;
       } else if (averagedData < minFound) {
         minFound = averagedData;
       }
-
-      averagedData = 0; // reset for the next average
-      numberAveragedPoints = 0; // reset the average count
-
-      // toggle the D7 LED so that it will pulse at 1/2 averaged sample time
-      //    this will normally be too fast to see on the LED, but good pin to scope
-      if(toggle == false) {
-        digitalWrite(LED_PIN, LOW);
-        toggle = true;
-      } else {
-        digitalWrite(LED_PIN, HIGH);
-        toggle = false;
-      }
     }
 
-    lastSampleTime = millis();  // reset the sample timer
+    averagedData = 0; // reset for the next average
+    numberAveragedPoints = 0; // reset the average count
+
+    // toggle the D7 LED so that it will pulse at 1/2 averaged sample time
+    //    this will normally be too fast to see on the LED, but good pin to scope
+    if(toggle == false) {
+      digitalWrite(LED_PIN, LOW);
+      toggle = true;
+    } else {
+      digitalWrite(LED_PIN, HIGH);
+      toggle = false;
+    }
   }
 
 } // end of speak()
 
+// function to read the envelope from the selected source
+int readEnvelope() {
+  if(envelopeSource == 1) {
+    return softEnvelope.read();   // the latest value from the timer interrupt
+  }
+  return analogRead(ANALOG_ENV_INPUT);
+} // end of readEnvelope()
+
+// cloud function to select the envelope source: 0 = hardware on A0,
+//  1 = software detector on A1
+int envSource(String source) {
+  if(source.toInt() == 1) {
+    if(softEnvelope.begin(RAW_AUDIO_INPUT, AUDIO_OFFSET_INPUT)) {
+      envelopeSource = 1;
+    }
+  }
+  else {
+    envelopeSource = 0;
+    softEnvelope.end();   // stop the interrupt so it can't read the ADC under analogRead(A0)
+  }
+  return envelopeSource;
+} // end of envSource()
+
+// cloud function to set the software envelope low-pass cutoff in Hz
+int envCutoff(String cutoff) {
+  return softEnvelope.setCutoff(cutoff.toInt());
+} // end of envCutoff()
+
+// cloud function to report the CPU time used by the software envelope detector
+//  since the last call. Publishes the details, returns the load in 0.1% units.
+int envBenchmark(String unused) {
+  int load = softEnvelope.getLoadPermille();
+  publishFormatted("envelope benchmark", formatPublish(0, "%s: %.1f us per sample (max %.1f us) at %d Hz, CPU load %.1f%%, cutoff %d Hz",
+    softEnvelope.isRunning() ? "running" : "stopped", softEnvelope.getIsrMicros(),
+    softEnvelope.getIsrMaxMicros(), ENV_SAMPLE_RATE_HZ, load / 10.0, softEnvelope.getCutoff()));
+  softEnvelope.resetBenchmark();
+  return load;
+} // end of envBenchmark()
+
+// function to act on a clip match: publish it, and if the clip is one of the known
+//  clips, use its analog processing parameters. A clip's volume and number are
+//  left alone; it is already playing.
+void clipIdentified() {
+  int clip = clipMatcher.getClip();
+  bool publish = frameBudget.allows(jobTelemetry);  // the match is applied even when not published
+  if(clip == 0) {
+    if(publish == true) {
+      publishFormatted("clip match", formatPublish(0, "none (%lu us, %d fingerprints)",
+        clipMatcher.getMatchMicros(), clipMatcher.getCount()));
+    }
+    return;
+  }
+  matchesMetric.add();
+  if(publish == true) {
+    publishFormatted("clip match", formatPublish(0, "clip %d from %d ms, score %d%% (%lu us, %d fingerprints)",
+      clip, clipMatcher.getOffsetMS(), clipMatcher.getScorePercent(), clipMatcher.getMatchMicros(),
+      clipMatcher.getCount()));
+  }
+
+  if(sweepState != sweepOff) {
+    return; // the sweep's clip plays with the settings the sweep needs
+  }
+  for(unsigned int i = 0; i < sizeof(knownClips) / sizeof(knownClips[0]); i++) {
+    if(knownClips[i]->clipNumber == clip) {
+      setAnalogMin(knownClips[i]->aMin);
+      setAnalogMax(knownClips[i]->aMax);
+      setNlp(knownClips[i]->nlproc);
+      setSamples(knownClips[i]->avSamples);
+    }
+  }
+} // end of clipIdentified()
+
+// cloud function to manage the clip fingerprints:
+//  "learn N": the next clip played is recorded as clip N. Returns N, or -1 if full.
+//  "forget N": removes clip N. Returns N, or -1 if it wasn't known.
+//  "clear": removes them all.
+//  "benchmark": publishes the match time for 1 to 64 clips. Returns the time for 16 in us.
+//  Anything else returns the number of clips known.
+int clipFingerprint(String command) {
+  int clip = command.substring(command.indexOf(' ') + 1).toInt();
+  if(command.startsWith("learn")) {
+    return clipMatcher.learn(clip) ? clip : -1;
+  }
+  if(command.startsWith("forget")) {
+    return clipMatcher.forget(clip) ? clip : -1;
+  }
+  if(command == "clear") {
+    clipMatcher.clear();
+    return 0;
+  }
+  if(command == "benchmark") {
+    int length = formatPublish(0, "clips: us (rejected early)");
+    int result = 0;
+    for(int size = 1; size <= 64; size *= 2) {
+      int rejected;
+      unsigned long micros = clipMatcher.benchmark(size, rejected);
+      length = formatPublish(length, ", %d: %lu (%d%%)", size, micros, rejected);
+      if(size == 16) {
+        result = micros;
+      }
+    }
+    publishFormatted("clip fingerprint benchmark", length);
+    return result;
+  }
+  return clipMatcher.getCount();
+} // end of clipFingerprint()
+
 // cloud function to set the clip number and play the clip
-int clipNum(String playClip) {
-  int clip;
-  clip = playClip.toInt();
+int clipNum(String clipNumber) {
+  return playClip(clipNumber.toInt());
+} // end of clipNum()
+
+// function to play a clip
+int playClip(int clip) {
   if (clip < 0) {
     clip = 0;
   }
@@ -365,49 +770,386 @@ int clipNum(String playClip) {
   minFound = 4095;
   // play the clip
   miniMP3Player.play(clip);
+  playMS = millis();
+  playsMetric.add();
+  syncMeter.played(clip, clipMatcher.getFingerprint(clip));
   return clip;
-} // end of clipNum()
+} // end of playClip()
+
+// function to report a play timed by the sync meter
+void syncMeasured() {
+  syncOffset = syncMeter.getOffsetMS();
+  syncConfidence = syncMeter.getConfidencePercent();
+  if(frameBudget.allows(jobTelemetry) == false) {
+    return;
+  }
+  publishFormatted("sync measurement", formatPublish(0, "clip %d: sound %d ms, busy %d ms after play, score %d%%; offset %d ms, confidence %d%% over %d plays",
+    syncMeter.getLastClip(), syncMeter.getLastAudioMS(), syncMeter.getLastBusyMS(), syncMeter.getLastScorePercent(),
+    syncOffset, syncConfidence, syncMeter.getPlays()));
+} // end of syncMeasured()
+
+// cloud function for sync measurement:
+//  "on": time every play of a clip with a fingerprint
+//  "off": stop (the offset found is still used)
+//  "reset": forget the plays and go back to no offset
+//  "report": publish the distribution of the sound's delay after busy
+//  Returns the sync offset in ms.
+int syncMeasure(String command) {
+  if(command == "on") {
+    syncMeter.setMeasuring(true);
+  }
+  else if(command == "off") {
+    syncMeter.setMeasuring(false);
+  }
+  else if(command == "reset") {
+    syncMeter.reset();
+  }
+  else if(command == "report") {
+    publishFormatted("sync report", formatPublish(0, "%s, %d plays: 10%% %d ms, median %d ms, 90%% %d ms; offset %d ms, confidence %d%%",
+      syncMeter.isMeasuring() ? "measuring" : "not measuring", syncMeter.getPlays(), syncMeter.getPercentileMS(10),
+      syncMeter.getPercentileMS(50), syncMeter.getPercentileMS(90), syncMeter.getOffsetMS(),
+      syncMeter.getConfidencePercent()));
+  }
+  syncOffset = syncMeter.getOffsetMS();
+  syncConfidence = syncMeter.getConfidencePercent();
+  return syncOffset;
+} // end of syncMeasure()
+
+// function to play the interjection advert clip over the clip that is playing, and
+//  have the mouth follow it. The clip's parameters come back when interjectionTimer runs
+//  out. One interjection at a time; a trigger during one is ignored.
+void interject() {
+  if(interjecting == true) {
+    return;
+  }
+  triggerMS = millis();
+  miniMP3Player.advertise(interjection.clipNumber);  // first, it is what the latency is of
+  interrupted.nlproc = nlProcess;
+  interrupted.avSamples = numSamples;
+  interrupted.aMax = maxValue;
+  interrupted.aMin = minValue;
+  setAnalogMin(interjection.aMin);
+  setAnalogMax(interjection.aMax);
+  setNlp(interjection.nlproc);
+  setSamples(interjection.avSamples);
+  interjectionsMetric.add();
+  interjecting = true;
+  listening = true;
+  onsetArmed = false;
+  timers.schedule(interjectionTimer, interjectionLength, interjectionDone);
+} // end of interject()
+
+// timer callback: the advert clip is over, go back to the parameters of the clip it
+//  interrupted
+void interjectionDone(void *context) {
+  setAnalogMin(interrupted.aMin);
+  setAnalogMax(interrupted.aMax);
+  setNlp(interrupted.nlproc);
+  setSamples(interrupted.avSamples);
+  if(listening == true) { // its sound never came
+    listening = false;
+    interjectionMissed();
+  }
+  interjecting = false;
+} // end of interjectionDone()
+
+// function to listen for the advert's sound in each envelope sample after the trigger.
+//  The player holds the clip before the advert plays, so the advert starts where the
+//  envelope rises through INTERJECTION_ONSET after being under it.
+void interjectionHeard(int sample) {
+  unsigned long sinceTrigger = millis() - triggerMS;
+  int level = (sample * volumeGain) >> 8;
+  if(level < INTERJECTION_ONSET) {
+    onsetArmed = true;
+  }
+  else if(onsetArmed == true) {
+    listening = false;
+    interjectionLatency = sinceTrigger;
+    interjectionMetric.observe(sinceTrigger);
+    if(frameBudget.allows(jobTelemetry) == true) {
+      publishFormatted("interjection", formatPublish(0, "advert %d: sound %lu ms after the trigger",
+        interjection.clipNumber, sinceTrigger));
+    }
+    return;
+  }
+  if(sinceTrigger >= INTERJECTION_TIMEOUT) {
+    listening = false;
+    interjectionMissed();
+  }
+} // end of interjectionHeard()
+
+// function to report an interjection whose sound wasn't found
+void interjectionMissed() {
+  interjectionLatency = -1;
+  interjectionMissedMetric.add();
+  if(frameBudget.allows(jobTelemetry) == true) {
+    publishFormatted("interjection", formatPublish(0, "advert %d: no sound found in %lu ms",
+      interjection.clipNumber, INTERJECTION_TIMEOUT));
+  }
+} // end of interjectionMissed()
+
+// cloud function to set up interjections:
+//  "motion N [MS]": new motion while a clip plays interjects advert N, MS long
+//  "button N [MS]": the button does
+//  "off": neither
+//  "stop": ends the interjection playing now
+//  Returns the advert number, 0 when off, or -1 if not understood.
+int interjectionSet(String command) {
+  int space = command.indexOf(' ');
+  int second = command.indexOf(' ', space + 1);
+  if(command.startsWith("motion ") || command.startsWith("button ")) {
+    int advert = command.substring(space + 1).toInt();
+    if(advert < 1) {
+      return -1;
+    }
+    interjection.clipNumber = advert;
+    if(second > 0 && command.substring(second + 1).toInt() > 0) {
+      interjectionLength = command.substring(second + 1).toInt();
+    }
+    interjectionEvent = command.startsWith("motion") ? interjectMotion : interjectButton;
+    return advert;
+  }
+  if(command == "off") {
+    interjectionEvent = interjectOff;
+    return 0;
+  }
+  if(command == "stop") {
+    if(interjecting == true) {
+      miniMP3Player.stopAdvertise();
+      timers.cancel(interjectionTimer);
+      interjectionDone(NULL);
+    }
+    return interjection.clipNumber;
+  }
+  return -1;
+} // end of interjectionSet()
 
 // cloud function to set the playback volume
 int clipVolume(String volume) {
-  int vol;
-  vol = volume.toInt();
+  return setVolume(volume.toInt());
+} // end of clipVolume
+
+// function to set the playback volume and its envelope gain
+int setVolume(int vol) {
   if(vol > 30) {
     vol = 30;
   } else if(vol < 0) {
     vol = 0;
   }
   miniMP3Player.volume(vol);
+  currentVolume = vol;
+  volumeMetric.set(vol);
+  volumeGain = volumeGains.gain[vol]; // look up the compensation once, not per sample
   return vol;
-} // end of clipVolume
+} // end of setVolume()
+
+// function to load the volume compensation table from EEPROM. If none has
+//  been saved, every gain is 1.0.
+void loadVolumeGains() {
+  EEPROM.get(VOLUME_GAIN_EEPROM_ADDR, volumeGains);
+  if(volumeGains.magic != VOLUME_GAIN_MAGIC) {
+    volumeGains.magic = VOLUME_GAIN_MAGIC;
+    for(int v = 0; v <= MAX_VOLUME; v++) {
+      volumeGains.gain[v] = GAIN_ONE;
+    }
+  }
+  volumeGain = volumeGains.gain[currentVolume];
+} // end of loadVolumeGains()
+
+// cloud function to start a volume sweep. Pass the number of a clip with steady
+//  sound for a few seconds; it is played at every SWEEP_VOLUME_STEP volume and the
+//  average envelope at each is compared to the one at REFERENCE_VOLUME. Pass
+//  "clear" to go back to no compensation. Returns -1 if the demo is busy.
+int volumeSweepStart(String clip) {
+  if(clip == "clear") {
+    volumeGains.magic = 0;
+    EEPROM.put(VOLUME_GAIN_EEPROM_ADDR, volumeGains);
+    loadVolumeGains();
+    return 0;
+  }
+  if(digitalRead(BUSY_PIN) == LOW || digitalRead(EYES_SIGNAL_PIN) == HIGH) {
+    return -1;  // a clip is playing, try again later
+  }
+  sweepClip = clip.toInt();
+  volumeGain = GAIN_ONE;  // no compensation while measuring
+  timers.schedule(sweepTimer, SWEEP_QUIET_TIME);
+  sweepState = sweepQuiet;
+  Particle.publish("volume sweep", "started", PRIVATE);
+  return sweepClip;
+} // end of volumeSweepStart()
+
+// function to run the volume sweep state machine. Returns true while a sweep
+//  is running, when the demo state machine must leave the player alone.
+bool volumeSweep() {
+  static unsigned long envelopeSum = 0;
+  static unsigned long envelopeCount = 0;
+  static unsigned int quietLevel = 0;
+  static int sweepVolume = 0;
+  static unsigned int measured[MAX_VOLUME + 1];
+  static bool played[MAX_VOLUME + 1];  // the volumes measured[] was taken at
+
+  // sample the envelope at the speak() rate, raw (no gain)
+  bool sampleNow = sweepSampleDue;
+  sweepSampleDue = false;
+
+  switch(sweepState) {
+    case sweepOff:
+      return false;
+
+    case sweepQuiet:  // measure the envelope with no sound, then start at volume 0
+      if(sampleNow) {
+        envelopeSum += readEnvelope();
+        envelopeCount++;
+      }
+      if(sweepTimer.isPending() == false) {
+        quietLevel = (envelopeCount > 0) ? envelopeSum / envelopeCount : 0;
+        for(int v = 0; v <= MAX_VOLUME; v++) {  // nothing from an earlier sweep
+          measured[v] = 0;
+          played[v] = false;
+        }
+        sweepVolume = 0;
+        sweepState = sweepStart;
+      }
+      break;
+
+    case sweepStart:  // set the volume and play the clip
+      miniMP3Player.volume(sweepVolume);
+      miniMP3Player.play(sweepClip);
+      envelopeSum = 0;
+      envelopeCount = 0;
+      timers.schedule(sweepTimer, SWEEP_START_TIMEOUT);
+      sweepState = sweepWaiting;
+      break;
+
+    case sweepWaiting:  // wait for busy to assert (low)
+      if(digitalRead(BUSY_PIN) == LOW) {
+        sweepState = sweepPlaying;
+      }
+      else if(sweepTimer.isPending() == false) {
+        Particle.publish("volume sweep", "failed: clip did not play", PRIVATE);
+        setVolume(currentVolume);  // restore the volume and its gain
+        sweepState = sweepOff;
+      }
+      break;
+
+    case sweepPlaying:  // add up the envelope until the clip is done
+      if(sampleNow) {
+        envelopeSum += readEnvelope();
+        envelopeCount++;
+      }
+      if(digitalRead(BUSY_PIN) == HIGH) {
+        unsigned int average = (envelopeCount > 0) ? envelopeSum / envelopeCount : 0;
+        measured[sweepVolume] = (average > quietLevel) ? average - quietLevel : 0;
+        played[sweepVolume] = true;
+        // next volume, making sure REFERENCE_VOLUME and MAX_VOLUME are measured
+        int nextVolume = sweepVolume + SWEEP_VOLUME_STEP;
+        if(sweepVolume < REFERENCE_VOLUME && nextVolume > REFERENCE_VOLUME) {
+          nextVolume = REFERENCE_VOLUME;
+        }
+        if(sweepVolume < MAX_VOLUME && nextVolume > MAX_VOLUME) {
+          nextVolume = MAX_VOLUME;
+        }
+        if(sweepVolume >= MAX_VOLUME) {
+          volumeSweepFinish(measured, played);
+          sweepState = sweepOff;
+        }
+        else {
+          sweepVolume = nextVolume;
+          sweepState = sweepStart;
+        }
+      }
+      break;
+
+    default:
+      sweepState = sweepOff;
+  }
+
+  if(sweepState == sweepOff) { // finished: ready for the next sweep
+    envelopeSum = 0;
+    envelopeCount = 0;
+  }
+  return true;
+} // end of volumeSweep()
+
+// function to turn the sweep measurements into the volume compensation table,
+//  save it and publish it. Volumes between the played ones are interpolated.
+void volumeSweepFinish(unsigned int measured[], bool played[]) {
+  unsigned int reference = measured[REFERENCE_VOLUME];
+  int lastMeasured = -1;
+  for(int v = 0; v <= MAX_VOLUME; v++) {
+    if(played[v] == false) {
+      continue;
+    }
+    // gain to bring this volume's envelope to the reference level
+    long gain = GAIN_MAX;
+    if(measured[v] > 0) {
+      gain = ((long)reference * GAIN_ONE) / measured[v];
+    }
+    if(v == 0 || reference == 0) {
+      gain = GAIN_ONE;  // silence, or nothing to compare against
+    }
+    volumeGains.gain[v] = constrain(gain, GAIN_MIN, GAIN_MAX);
+    // fill in the volumes skipped since the last one measured
+    for(int between = lastMeasured + 1; lastMeasured >= 0 && between < v; between++) {
+      volumeGains.gain[between] = map(between, lastMeasured, v, volumeGains.gain[lastMeasured], volumeGains.gain[v]);
+    }
+    lastMeasured = v;
+  }
+  volumeGains.magic = VOLUME_GAIN_MAGIC;
+  EEPROM.put(VOLUME_GAIN_EEPROM_ADDR, volumeGains);
+
+  // report the table as gains x 100, volume 0 first
+  int length = formatPublish(0, "reference %u:", reference);
+  for(int v = 0; v <= MAX_VOLUME; v++) {
+    length = formatPublish(length, " %d", (volumeGains.gain[v] * 100) / GAIN_ONE);
+  }
+  publishFormatted("volume sweep", length);
+
+  setVolume(currentVolume);  // restore the volume and pick up its new gain
+} // end of volumeSweepFinish()
 
 // cloud function to set the number of samples to average
 int samples(String numberSamples) {
-  numSamples = numberSamples.toInt();
+  return setSamples(numberSamples.toInt());
+} // end of samples()
+
+// function to set the number of samples to average
+int setSamples(int number) {
+  numSamples = number;
   // make sure that the number is positive and non-zero
   if(numSamples < 1) {
     numSamples = 1;
   }
   return numSamples;
-} // end of samples()
+} // end of setSamples()
 
 // cloud function to set the global maxValue
 int analogMax(String theMax) {
-  maxValue = theMax.toInt();
+  return setAnalogMax(theMax.toInt());
+} // end of analogMax()
+
+// function to set the global maxValue
+int setAnalogMax(int theMax) {
+  maxValue = theMax;
   if (maxValue > 4095) {
     maxValue = 4095;
   }
   return maxValue;
-} // end of analogMax()
+} // end of setAnalogMax()
 
 // cloud function to set the global minValue
 int analogMin(String theMin) {
-  minValue = theMin.toInt();
+  return setAnalogMin(theMin.toInt());
+} // end of analogMin()
+
+// function to set the global minValue
+int setAnalogMin(int theMin) {
+  minValue = theMin;
   if (minValue < 0) {
     minValue = 0;
   }
   return minValue;
-} // end of analogMax()
+} // end of setAnalogMin()
 
 // function to non-linearly scale the averaged data values
 //  to better represent mouth movements
@@ -422,14 +1164,88 @@ unsigned int nlScale(unsigned int dataToScale) {
 //    data. 0 = no non-linear processing; 1 = sqrt processing, more
 //    types to be added later
 int nlp(String processType) {
-  nlProcess = processType.toInt();
-  return nlProcess;
+  return setNlp(processType.toInt());
 } // end of nlp()
 
+// function to select the type of non-linear processing
+int setNlp(int processType) {
+  nlProcess = processType;
+  return nlProcess;
+} // end of setNlp()
+
+// function to format text into the publish buffer, after the length characters
+//  already there. Returns the new length. Formats in place; nothing is allocated.
+int formatPublish(int length, const char *format, ...) {
+  if(publishText == NULL || length >= PUBLISH_TEXT_SIZE - 1) {
+    return length;
+  }
+  va_list args;
+  va_start(args, format);
+  length += vsnprintf(publishText + length, PUBLISH_TEXT_SIZE - length, format, args);
+  va_end(args);
+  return min(length, PUBLISH_TEXT_SIZE - 1);
+} // end of formatPublish()
+
+// function to publish the text formatted in the publish buffer
+void publishFormatted(const char *eventName, int length) {
+  if(publishText == NULL) {
+    return;
+  }
+  publishBlock->use(length + 1);
+  Particle.publish(eventName, publishText, PRIVATE);
+} // end of publishFormatted()
+
+// function to register the metrics: the sketch's own, those the libraries keep,
+//  and the frame budget's
+void registerMetrics() {
+  static const int32_t startBounds[] = {50, 100, 200, 300, 500, 1000, 2000};  // ms
+  static const int32_t lateBounds[] = {0, 1, 2, 5, 10, 20, 50};  // ms
+  static const int32_t interjectionBounds[] = {20, 50, 100, 150, 200, 300, 500};  // ms
+  playsMetric = metrics.counter("dfplayer_plays_total");
+  volumeMetric = metrics.gauge("dfplayer_volume");
+  volumeMetric.set(currentVolume);
+  startMetric = metrics.histogram("dfplayer_start_ms", startBounds, sizeof(startBounds) / sizeof(startBounds[0]));
+  samplesMetric = metrics.counter("envelope_samples_total");
+  sampleLateMetric = metrics.histogram("envelope_sample_late_ms", lateBounds, sizeof(lateBounds) / sizeof(lateBounds[0]));
+  metrics.gauge("envelope_max", []() -> int32_t { return maxFound; });
+  metrics.gauge("envelope_min", []() -> int32_t { return minFound; });
+  metrics.gauge("envelope_source", []() -> int32_t { return envelopeSource; });
+  matchesMetric = metrics.counter("clip_matches_total");
+  metrics.gauge("clip_fingerprints", []() -> int32_t { return clipMatcher.getCount(); });
+  metrics.counter("sync_plays_total", []() -> int32_t { return syncMeter.getPlays(); });
+  metrics.gauge("sync_offset_ms", []() -> int32_t { return syncMeter.getOffsetMS(); });
+  metrics.counter("budget_overruns_total", []() -> int32_t { return frameBudget.getOverruns(); });
+  metrics.counter("timers_expired_total", []() -> int32_t { return timers.getExpired(); });
+  metrics.gauge("timers_pending", []() -> int32_t { return timers.getPending(); });
+  interjectionsMetric = metrics.counter("interjections_total");
+  interjectionMetric = metrics.histogram("interjection_latency_ms", interjectionBounds, sizeof(interjectionBounds) / sizeof(interjectionBounds[0]));
+  interjectionMissedMetric = metrics.counter("interjections_missed_total");
+  frameBudget.registerMetrics(metrics);
+} // end of registerMetrics()
+
+// cloud function to publish the metrics as Prometheus text, a page at a time.
+//  Pass the index of the first metric in the page ("" for the first page). Returns
+//  the index to pass for the next page, or 0 after the last.
+int metricsPublish(String first) {
+  if(publishText == NULL) {
+    return 0;
+  }
+  int next = first.toInt();
+  int length = metrics.writeText(publishText, PUBLISH_TEXT_SIZE, next);
+  publishFormatted("metrics", length);
+  return (next < metrics.getCount()) ? next : 0;
+} // end of metricsPublish()
+
+// function to refresh the memory cloud variable: the arena and the free heap
+void reportMemory() {
+  int length = arena.report(memoryReport, sizeof(memoryReport));
+  snprintf(memoryReport + length, sizeof(memoryReport) - length, "; heap free %lu",
+    (unsigned long)System.freeMemory());
+} // end of reportMemory()
+
 // function to detect when the button is pressed, including debounce verification
 bool buttonPressed() {
   static ButtonStates _buttonState = buttonOff;
-  static unsigned long lastTime = millis();
 
   switch(_buttonState) {
 
@@ -439,7 +1255,7 @@ bool buttonPressed() {
         return false;
       }
       else {  // button is pressed, need to debounce and verify
-        lastTime = millis();  // set up the timer'
+        timers.schedule(debounceTimer, DEBOUNCE_TIME);  // set up the timer
         _buttonState = pressedTentative;
         return false;
       }
@@ -450,7 +1266,7 @@ bool buttonPressed() {
         return false;
       }
       else {  // button is pressed
-        if( (millis() - lastTime < DEBOUNCE_TIME)) { // button not yet debounced
+        if(debounceTimer.isPending() == true) { // button not yet debounced
           _buttonState = pressedTentative; 
           return false;
         }
@@ -466,14 +1282,14 @@ bool buttonPressed() {
         return false;
       }
       else {  // button tentatively released, need to verify
-        lastTime = millis();  // set timer for debounce
+        timers.schedule(debounceTimer, DEBOUNCE_TIME);  // set timer for debounce
         _buttonState = releasedTentative;
         return false;
       }
 
     case releasedTentative:  // button seems to be released, need verificaton
       if(digitalRead(BUTTON_PIN) == HIGH) { // button still released
-        if( (millis() - lastTime < DEBOUNCE_TIME)) {  // not yet debounced
+        if(debounceTimer.isPending() == true) {  // not yet debounced
           _buttonState = releasedTentative;
           return false;
         }
@@ -493,6 +1309,7 @@ bool buttonPressed() {
         return false;
       }
       else {  // button is pressed
+        timers.schedule(debounceTimer, DEBOUNCE_TIME);
         _buttonState = pressedTentative;
         return false;
       }
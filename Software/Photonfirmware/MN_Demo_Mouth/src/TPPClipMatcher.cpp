@@ -0,0 +1,346 @@
+/*
+ * TPPClipMatcher.cpp
+ *
+ * Team Practical Project clip identification by envelope fingerprint
+ *
+ * Normalized cross-correlation of the live envelope against the fingerprints of
+ * the known clips. See TPPClipMatcher.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include "TPPClipMatcher.h"
+
+/* ----- isqrt64 -----
+ * Integer square root, rounded down
+ */
+static uint32_t isqrt64(uint64_t value) {
+
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+
+}
+
+/* ----- begin -----
+ * Loads the fingerprints, and reserves the live capture from the arena. Without
+ * the capture, nothing is ever matched or learned.
+ */
+void TPP_ClipMatcher::begin(int sampleMS, TPP_Arena &arena) {
+
+    sampleMS_ = sampleMS;
+    liveBlock_ = arena.reserve("clip capture", FP_LENGTH);
+    live_ = liveBlock_ ? (uint8_t *)liveBlock_->getData() : NULL;
+    EEPROM.get(FP_EEPROM_ADDR, index_);
+    if (index_.magic != FP_MAGIC || index_.count > FP_MAX_CLIPS) {
+        index_.magic = FP_MAGIC;
+        index_.count = 0;
+    }
+
+}
+
+/* ----- addSample -----
+ * Call every sampleMS with the envelope (0 - 4095) and whether a clip is playing.
+ * Returns true once per clip, when a match has been tried.
+ */
+bool TPP_ClipMatcher::addSample(int envelope, bool playing) {
+
+    if (live_ == NULL) {
+        return false;
+    }
+    bool matched = collect(envelope, playing);
+    liveBlock_->use(liveCount_);
+    return matched;
+
+}
+
+/* ----- collect -----
+ * The work of addSample(): captures the start of the clip, and matches or learns it
+ */
+bool TPP_ClipMatcher::collect(int envelope, bool playing) {
+
+    uint8_t sample = constrain(envelope >> 4, 0, 255);
+
+    if (playing && !playing_) {         // a clip has started
+        liveCount_ = 0;
+        waited_ = 0;
+        collecting_ = (learnClip_ != 0);    // a fingerprint is recorded from the very start
+    }
+    if (!playing && playing_ && learnClip_ != 0 && liveCount_ > 0) {
+        // the clip was shorter than a fingerprint; the rest is silence
+        while (liveCount_ < FP_LENGTH) {
+            live_[liveCount_++] = 0;
+        }
+    }
+    playing_ = playing;
+
+    if (learnClip_ != 0 && liveCount_ == FP_LENGTH) {
+        // store the recording, in place of any older one for this clip
+        int slot = 0;
+        while (slot < index_.count && index_.clips[slot].clipNumber != learnClip_) {
+            slot++;
+        }
+        if (slot == index_.count) {
+            index_.count++;
+        }
+        index_.clips[slot].clipNumber = learnClip_;
+        memcpy(index_.clips[slot].samples, live_, FP_LENGTH);
+        save();
+        learnClip_ = 0;
+        liveCount_ = 0;
+        return false;
+    }
+    if (!playing) {
+        return false;
+    }
+
+    if (!collecting_) {
+        // wait for the clip to get loud, for as long as a window could still fit
+        if (waited_ > FP_LENGTH - FP_WINDOW) {
+            return false;
+        }
+        if (sample < FP_START_LEVEL) {
+            waited_++;
+            return false;
+        }
+        collecting_ = true;
+    }
+
+    if (liveCount_ < FP_LENGTH) {
+        live_[liveCount_++] = sample;
+    }
+    if (learnClip_ != 0 || liveCount_ != FP_WINDOW) {
+        return false;
+    }
+
+    // the window is full: find it
+    uint32_t startTicks = System.ticks();
+    prepareWindow();
+    matchClip_ = findBest(index_.count, matchOffset_, matchScore_);
+    matchMicros_ = (System.ticks() - startTicks) / System.ticksPerMicrosecond();
+    return true;
+
+}
+
+/* ----- learn -----
+ * Records the next clip that plays as the fingerprint of clipNumber. Returns false if
+ * there is no room for another clip.
+ */
+bool TPP_ClipMatcher::learn(int clipNumber) {
+
+    if (clipNumber <= 0) {
+        return false;
+    }
+    bool known = false;
+    for (int c = 0; c < index_.count; c++) {
+        known = known || (index_.clips[c].clipNumber == clipNumber);
+    }
+    if (!known && index_.count >= FP_MAX_CLIPS) {
+        return false;
+    }
+    learnClip_ = clipNumber;
+    // a clip already playing is not recorded from the middle: wait for the next one
+    playing_ = true;
+    collecting_ = false;
+    liveCount_ = 0;
+    waited_ = FP_LENGTH;
+    return true;
+
+}
+
+bool TPP_ClipMatcher::forget(int clipNumber) {
+
+    for (int c = 0; c < index_.count; c++) {
+        if (index_.clips[c].clipNumber == clipNumber) {
+            index_.count--;
+            memmove(&index_.clips[c], &index_.clips[c + 1], (index_.count - c) * sizeof(Fingerprint));
+            save();
+            return true;
+        }
+    }
+    return false;
+
+}
+
+/* ----- getFingerprint -----
+ * The FP_LENGTH samples of clipNumber, envelope >> 4, or NULL if it has none
+ */
+const uint8_t *TPP_ClipMatcher::getFingerprint(int clipNumber) {
+
+    for (int c = 0; c < index_.count; c++) {
+        if (index_.clips[c].clipNumber == clipNumber) {
+            return index_.clips[c].samples;
+        }
+    }
+    return NULL;
+
+}
+
+void TPP_ClipMatcher::clear() {
+
+    index_.count = 0;
+    learnClip_ = 0;
+    save();
+
+}
+
+void TPP_ClipMatcher::save() {
+
+    EEPROM.put(FP_EEPROM_ADDR, index_);
+
+}
+
+/* ----- prepareWindow -----
+ * Makes the live window zero mean. The values are scaled by FP_WINDOW so they stay
+ * integers: centered = FP_WINDOW * x - sum(x).
+ */
+void TPP_ClipMatcher::prepareWindow() {
+
+    int32_t sum = 0;
+    for (int i = 0; i < FP_WINDOW; i++) {
+        sum += live_[i];
+    }
+    for (int i = 0; i < FP_WINDOW; i++) {
+        centered_[i] = FP_WINDOW * live_[i] - sum;
+    }
+    suffixSum_[FP_WINDOW] = 0;
+    suffixEnergy_[FP_WINDOW] = 0;
+    for (int i = FP_WINDOW - 1; i >= 0; i--) {
+        suffixSum_[i] = suffixSum_[i + 1] + centered_[i];
+        suffixEnergy_[i] = suffixEnergy_[i + 1] + (int64_t)centered_[i] * centered_[i];
+    }
+    windowReady_ = true;
+
+}
+
+/* ----- findBest -----
+ * Correlates the live window against the first librarySize fingerprints (going round
+ * again if there are fewer, for the benchmark) at every offset. Returns the best
+ * clip number, or 0 if none scored FP_MIN_SCORE.
+ *
+ * With x the live window and y the fingerprint at this offset, both FP_WINDOW long,
+ * and sums over the window:
+ *      C  = sum(centered * y) = N * sum((x - mean x)(y - mean y))
+ *      Ex = sum(centered^2)   = N^2 * sum((x - mean x)^2)
+ *      Ey = N * sum(y^2) - sum(y)^2 = N * sum((y - mean y)^2)
+ *      score = C / sqrt(Ex * Ey / N), in Q15
+ * After the first k samples, with r = N - k left, Yr and YYr the sums of y and y^2
+ * over the rest, and Sr and Er the sums of centered and centered^2 over the rest, the
+ * rest of C is at most (sqrt(Er * r * (r * YYr - Yr^2)) + Yr * Sr) / r.
+ */
+int TPP_ClipMatcher::findBest(int librarySize, int &bestOffset, int32_t &bestScore) {
+
+    int bestClip = 0;
+    bestOffset = 0;
+    bestScore = FP_MIN_SCORE - 1;
+
+    int64_t energyX = suffixEnergy_[0];
+    if (index_.count == 0 || energyX < (int64_t)FP_WINDOW * FP_WINDOW * FP_WINDOW) {
+        return 0;   // no fingerprints, or the window is flat
+    }
+
+    uint32_t prefixY[FP_LENGTH + 1];
+    uint32_t prefixYY[FP_LENGTH + 1];
+
+    for (int entry = 0; entry < librarySize; entry++) {
+
+        const Fingerprint &clip = index_.clips[entry % index_.count];
+        prefixY[0] = prefixYY[0] = 0;
+        for (int i = 0; i < FP_LENGTH; i++) {
+            prefixY[i + 1] = prefixY[i] + clip.samples[i];
+            prefixYY[i + 1] = prefixYY[i] + clip.samples[i] * clip.samples[i];
+        }
+
+        for (int offset = 0; offset <= FP_LENGTH - FP_WINDOW; offset++) {
+
+            offsetsTried_++;
+            const int end = offset + FP_WINDOW;
+            int64_t sumY = prefixY[end] - prefixY[offset];
+            int64_t energyY = (int64_t)FP_WINDOW * (prefixYY[end] - prefixYY[offset]) - sumY * sumY;
+            uint32_t denominator = isqrt64((uint64_t)(energyX * energyY / FP_WINDOW));
+            if (denominator == 0) {
+                offsetsRejected_++;
+                continue;
+            }
+            // C has to beat this to improve on the best score
+            int64_t needed = ((int64_t)bestScore * denominator) >> 15;
+
+            const uint8_t *y = &clip.samples[offset];
+            int32_t correlation = 0;
+            bool rejected = false;
+            for (int k = 0; k < FP_WINDOW && !rejected; k += FP_CHECK_EVERY) {
+                for (int i = k; i < k + FP_CHECK_EVERY; i++) {
+                    correlation += centered_[i] * y[i];
+                }
+                int next = k + FP_CHECK_EVERY;
+                if (next < FP_WINDOW) {
+                    int64_t left = FP_WINDOW - next;
+                    int64_t restY = prefixY[end] - prefixY[offset + next];
+                    int64_t restYY = prefixYY[end] - prefixYY[offset + next];
+                    uint64_t spread = (uint64_t)(left * (left * restYY - restY * restY));
+                    int64_t bound = isqrt64((uint64_t)suffixEnergy_[next] * spread);
+                    int64_t shortfall = left * (needed - correlation) - restY * suffixSum_[next];
+                    rejected = shortfall > bound;
+                }
+            }
+            if (rejected) {
+                offsetsRejected_++;
+                continue;
+            }
+
+            int32_t score = ((int64_t)correlation << 15) / denominator;
+            if (score > bestScore) {
+                bestScore = score;
+                bestClip = clip.clipNumber;
+                bestOffset = offset;
+            }
+
+        }
+    }
+    return bestClip;
+
+}
+
+/* ----- benchmark -----
+ * Times one match of the last live window against librarySize fingerprints, in
+ * microseconds. The fingerprints are reused to make up the size. If nothing has played
+ * yet, the window is cut from the first fingerprint. Sets rejectedPercent to the share
+ * of offsets abandoned early. Returns 0 if there are no fingerprints.
+ */
+unsigned long TPP_ClipMatcher::benchmark(int librarySize, int &rejectedPercent) {
+
+    rejectedPercent = 0;
+    if (index_.count == 0 || librarySize <= 0 || live_ == NULL) {
+        return 0;
+    }
+    if (!windowReady_) {
+        memcpy(live_, &index_.clips[0].samples[(FP_LENGTH - FP_WINDOW) / 2], FP_WINDOW);
+        prepareWindow();
+    }
+
+    int offset;
+    int32_t score;
+    offsetsTried_ = 0;
+    offsetsRejected_ = 0;
+    uint32_t startTicks = System.ticks();
+    findBest(librarySize, offset, score);
+    unsigned long micros = (System.ticks() - startTicks) / System.ticksPerMicrosecond();
+    if (offsetsTried_ > 0) {
+        rejectedPercent = (offsetsRejected_ * 100) / offsetsTried_;
+    }
+    return micros;
+
+}
@@ -0,0 +1,112 @@
+/*
+ * TPPClipMatcher.h
+ *
+ * Team Practical Project clip identification by envelope fingerprint
+ *
+ * When a clip is started from the cloud, or the mini MP3 player goes on to the next
+ * track by itself, the mouth firmware has no way to ask the player which clip it is.
+ * This works it out from the sound: the first FP_WINDOW envelope samples after the
+ * clip gets loud are compared against a fingerprint of the first FP_LENGTH samples
+ * of every known clip, at every offset, by normalized cross-correlation. The best
+ * scoring clip over FP_MIN_SCORE, and the offset into it, are the result. The
+ * correlation is normalized, so the player volume doesn't matter.
+ *
+ * Fingerprints are learned on the device: .learn() arms the matcher, and the next
+ * clip that plays is recorded under that clip number and saved in EEPROM.
+ *
+ * All the arithmetic is integer; the Photon has no floating point hardware. The live
+ * window is made zero mean once, so each offset costs FP_WINDOW multiply-adds and the
+ * template's mean and energy come from prefix sums. Every FP_CHECK_EVERY samples the
+ * rest of the sum is bounded (Cauchy-Schwarz), and the offset is abandoned as soon as
+ * it can't beat the best score so far. Silence and wrong clips are mostly rejected
+ * after the first check.
+ *
+ * Key methods
+ *      .begin()        loads the fingerprints from EEPROM, and reserves the live
+ *                      capture from the arena
+ *      .addSample()    one envelope sample, every sampleMS. Returns true when a
+ *                      match has been tried; .getClip() is 0 if nothing matched.
+ *      .learn(), .forget(), .clear()
+ *                      manage the fingerprints
+ *      .benchmark()    times a match against a library of any size
+ *      .getFingerprint()   a clip's FP_LENGTH samples, for TPP_SyncMeter
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_CLIP_MATCHER_H
+#define _TPP_CLIP_MATCHER_H
+
+#include "Particle.h"
+#include "TPPArena.h"
+
+#define FP_LENGTH 64                    // fingerprint samples, from the start of the clip
+#define FP_WINDOW 32                    // live samples matched against them
+#define FP_MAX_CLIPS 16
+#define FP_CHECK_EVERY 8                // samples between early rejection checks
+#define FP_MIN_SCORE 26214              // 0.8 in Q15, the least correlation that counts
+#define FP_START_LEVEL 16               // the live window starts when the envelope is over this (0 - 255)
+#define FP_EEPROM_ADDR 128
+#define FP_MAGIC 0x54504650             // "TPFP", marks saved fingerprints
+
+class TPP_ClipMatcher {
+
+    public:
+        void begin(int sampleMS, TPP_Arena &arena);
+        bool addSample(int envelope, bool playing);
+        bool learn(int clipNumber);
+        bool forget(int clipNumber);
+        void clear();
+        int getCount() { return index_.count; }
+        const uint8_t *getFingerprint(int clipNumber);
+        int getClip() { return matchClip_; }
+        int getOffsetMS() { return matchOffset_ * sampleMS_; }
+        int getScorePercent() { return (matchScore_ * 100) >> 15; }
+        unsigned long getMatchMicros() { return matchMicros_; }
+        unsigned long benchmark(int librarySize, int &rejectedPercent);
+
+    private:
+        struct Fingerprint {
+            uint16_t clipNumber;
+            uint8_t samples[FP_LENGTH];     // envelope >> 4
+        };
+        struct FingerprintIndex {
+            uint32_t magic;
+            uint16_t count;
+            uint16_t reserved;
+            Fingerprint clips[FP_MAX_CLIPS];
+        };
+
+        bool collect(int envelope, bool playing);
+        void prepareWindow();
+        int findBest(int librarySize, int &bestOffset, int32_t &bestScore);
+        void save();
+
+        FingerprintIndex index_;
+        int sampleMS_ = 10;
+
+        bool playing_ = false;
+        bool collecting_ = false;
+        int waited_ = 0;                    // samples since the clip started
+        uint8_t *live_ = NULL;              // FP_LENGTH samples, in the arena
+        TPP_ArenaBlock *liveBlock_ = NULL;
+        int liveCount_ = 0;
+        int learnClip_ = 0;
+
+        // the live window made zero mean (times FP_WINDOW), and its suffix sums for the bound
+        int32_t centered_[FP_WINDOW];
+        int32_t suffixSum_[FP_WINDOW + 1];
+        int64_t suffixEnergy_[FP_WINDOW + 1];
+        bool windowReady_ = false;
+
+        int matchClip_ = 0;
+        int matchOffset_ = 0;
+        int32_t matchScore_ = 0;
+        unsigned long matchMicros_ = 0;
+        uint32_t offsetsTried_ = 0;         // for the benchmark
+        uint32_t offsetsRejected_ = 0;
+
+};
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * TPPEnvelopeDetector.cpp
+ *
+ * Team Practical Project software audio envelope detector
+ *
+ * Samples the raw preamp from a timer interrupt and filters it into an envelope.
+ * See TPPEnvelopeDetector.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include "TPPEnvelopeDetector.h"
+#include <SparkIntervalTimer.h>
+#include <math.h>
+
+#define ENV_Q 28                        // coefficient fraction bits
+#define ENV_SIGNAL_Q 16                 // signal fraction bits
+
+static IntervalTimer envTimer_;
+static TPP_EnvelopeDetector *active_ = NULL;   // the detector the interrupt feeds
+
+/* ----- begin -----
+ * Starts sampling signalPin, less the offset on offsetPin. Returns false if no
+ * hardware timer was free.
+ */
+bool TPP_EnvelopeDetector::begin(int signalPin, int offsetPin) {
+
+    if (running_) {
+        return true;
+    }
+    if (active_ != NULL && active_ != this) {
+        return false;   // there is one timer, for one detector
+    }
+    signalPin_ = signalPin;
+    offsetPin_ = offsetPin;
+    x1_ = x2_ = y1_ = y2_ = 0;
+    offset_ = analogRead(offsetPin_) << ENV_SIGNAL_Q;
+    offsetCountdown_ = ENV_OFFSET_EVERY;
+    setCutoff(cutoffHz_);
+    resetBenchmark();
+
+    active_ = this;
+    running_ = envTimer_.begin(timerISR, 1000000 / ENV_SAMPLE_RATE_HZ, uSec);
+    return running_;
+
+}
+
+void TPP_EnvelopeDetector::end() {
+
+    if (running_) {
+        envTimer_.end();
+        running_ = false;
+    }
+    output_ = 0;
+
+}
+
+/* ----- read -----
+ * The latest envelope value, 0 - 4095
+ */
+int TPP_EnvelopeDetector::read() {
+
+    return output_;
+
+}
+
+/* ----- setCutoff -----
+ * Works out the low-pass coefficients for cutoffHz and hands them to the interrupt.
+ * Returns the cutoff used, after limiting it to ENV_MIN_CUTOFF_HZ - ENV_MAX_CUTOFF_HZ.
+ */
+int TPP_EnvelopeDetector::setCutoff(int cutoffHz) {
+
+    cutoffHz_ = constrain(cutoffHz, ENV_MIN_CUTOFF_HZ, ENV_MAX_CUTOFF_HZ);
+
+    // RBJ cookbook low-pass, Q = 1/sqrt(2) for a Butterworth response
+    double w0 = 2.0 * M_PI * cutoffHz_ / ENV_SAMPLE_RATE_HZ;
+    double alpha = sin(w0) / (2.0 * M_SQRT1_2);
+    double a0 = 1.0 + alpha;
+    double scale = (double)(1L << ENV_Q) / a0;
+
+    int32_t b1 = (int32_t)lround((1.0 - cos(w0)) * scale);
+    int32_t b0 = b1 / 2;
+    int32_t a1 = (int32_t)lround(2.0 * cos(w0) * scale);
+    int32_t a2 = (int32_t)lround(-(1.0 - alpha) * scale);
+
+    ATOMIC_BLOCK() {
+        coeffs_.b0 = b0;
+        coeffs_.b1 = b1;
+        coeffs_.b2 = b0;
+        coeffs_.a1 = a1;
+        coeffs_.a2 = a2;
+    }
+    return cutoffHz_;
+
+}
+
+void TPP_EnvelopeDetector::timerISR() {
+
+    if (active_ != NULL) {
+        active_->sample();
+    }
+
+}
+
+/* ----- sample -----
+ * Runs in the timer interrupt: one sample through the rectifier and filter
+ */
+void TPP_EnvelopeDetector::sample() {
+
+    uint32_t startTicks = System.ticks();
+
+    if (--offsetCountdown_ == 0) {
+        int32_t offset = analogRead(offsetPin_) << ENV_SIGNAL_Q;
+        offset_ += (offset - offset_) >> 3;
+        offsetCountdown_ = ENV_OFFSET_EVERY;
+    }
+
+    // rectify
+    int32_t x0 = (analogRead(signalPin_) << ENV_SIGNAL_Q) - offset_;
+    if (x0 < 0) {
+        x0 = -x0;
+    }
+
+    // biquad, direct form I
+    int64_t acc = (int64_t)coeffs_.b0 * x0 + (int64_t)coeffs_.b1 * x1_ + (int64_t)coeffs_.b2 * x2_ +
+                  (int64_t)coeffs_.a1 * y1_ + (int64_t)coeffs_.a2 * y2_;
+    int32_t y0 = (int32_t)(acc >> ENV_Q);
+    x2_ = x1_;
+    x1_ = x0;
+    y2_ = y1_;
+    y1_ = y0;
+
+    int32_t out = (y0 * ENV_GAIN) >> ENV_SIGNAL_Q;
+    output_ = constrain(out, 0, 4095);
+
+    // benchmark
+    uint32_t ticks = System.ticks() - startTicks;
+    isrTicks_ += ticks;
+    if (ticks > isrMaxTicks_) {
+        isrMaxTicks_ = ticks;
+    }
+    isrCalls_++;
+
+}
+
+void TPP_EnvelopeDetector::resetBenchmark() {
+
+    ATOMIC_BLOCK() {
+        isrTicks_ = 0;
+        isrMaxTicks_ = 0;
+        isrCalls_ = 0;
+        benchmarkStartMS_ = millis();
+    }
+
+}
+
+/* ----- getIsrMicros -----
+ * Average time spent in the interrupt per sample
+ */
+float TPP_EnvelopeDetector::getIsrMicros() {
+
+    uint64_t ticks;
+    uint32_t calls;
+    ATOMIC_BLOCK() {
+        ticks = isrTicks_;
+        calls = isrCalls_;
+    }
+    if (calls == 0) {
+        return 0;
+    }
+    return (float)ticks / calls / System.ticksPerMicrosecond();
+
+}
+
+float TPP_EnvelopeDetector::getIsrMaxMicros() {
+
+    return (float)isrMaxTicks_ / System.ticksPerMicrosecond();
+
+}
+
+/* ----- getLoadPermille -----
+ * Share of the CPU used by the interrupt since the last resetBenchmark(), in 0.1%
+ */
+int TPP_EnvelopeDetector::getLoadPermille() {
+
+    uint64_t ticks;
+    ATOMIC_BLOCK() {
+        ticks = isrTicks_;
+    }
+    uint64_t elapsedTicks = (uint64_t)(millis() - benchmarkStartMS_) * 1000 * System.ticksPerMicrosecond();
+    if (elapsedTicks == 0) {
+        return 0;
+    }
+    return (int)(ticks * 1000 / elapsedTicks);
+
+}
@@ -0,0 +1,91 @@
+/*
+ * TPPEnvelopeDetector.h
+ *
+ * Team Practical Project software audio envelope detector
+ *
+ * Does in software what the rectifier and filter on the analog processor board do
+ * in hardware, so the bandwidth of the envelope is a setting instead of a parts change.
+ * A hardware timer interrupt samples the raw preamp on A1 at ENV_SAMPLE_RATE_HZ,
+ * subtracts the op-amp DC offset read on A2, rectifies, and low-pass filters with a
+ * fixed point biquad. The filter output is the envelope; speak() reads it every
+ * SAMPLE_INTERVAL in place of the hardware envelope on A0, which is a decimation of
+ * the filtered signal.
+ *
+ * The DC offset moves only with temperature and supply, so it is read once every
+ * ENV_OFFSET_EVERY samples and smoothed.
+ *
+ * The filter is a 2nd order Butterworth low-pass (RBJ cookbook). The cutoff is a tiny
+ * fraction of the sample rate, which puts the poles close to 1, so the coefficients
+ * are Q28 and the signal and filter history Q16; anything coarser rounds the response
+ * away. Products are 32 x 32 bit into 64 bit sums, which the Photon's M3 does in one
+ * multiply-accumulate instruction.
+ *
+ * Uses the SparkIntervalTimer library for the timer interrupt.
+ *
+ * Key methods
+ *      .begin()        starts the timer interrupt
+ *      .end()          stops it, so A0 to A2 can be read from loop() again
+ *      .read()         the latest envelope value, scaled like analogRead(): 0 - 4095
+ *      .setCutoff()    sets the low-pass cutoff in Hz. Safe to call while running.
+ *      .getIsrMicros(), .getIsrMaxMicros(), .getLoadPermille()
+ *                      CPU used by the interrupt, measured with the cycle counter
+ *                      since the last .resetBenchmark()
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_ENVELOPE_DETECTOR_H
+#define _TPP_ENVELOPE_DETECTOR_H
+
+#include "Particle.h"
+
+#define ENV_SAMPLE_RATE_HZ 4000
+#define ENV_OFFSET_EVERY 256            // samples between reads of the DC offset on A2
+#define ENV_DEFAULT_CUTOFF_HZ 15        // about what the hardware filter passes
+#define ENV_MIN_CUTOFF_HZ 2
+#define ENV_MAX_CUTOFF_HZ 200
+#define ENV_GAIN 2                      // the rectified average of a sine is 2/pi of its peak;
+                                        // this brings it near the hardware envelope's level
+
+class TPP_EnvelopeDetector {
+
+    public:
+        bool begin(int signalPin, int offsetPin);
+        void end();
+        bool isRunning() { return running_; }
+        int read();
+        int setCutoff(int cutoffHz);
+        int getCutoff() { return cutoffHz_; }
+        void resetBenchmark();
+        float getIsrMicros();
+        float getIsrMaxMicros();
+        int getLoadPermille();
+
+    private:
+        struct Biquad {
+            int32_t b0, b1, b2, a1, a2;     // Q28, a1 and a2 with the sign already flipped
+        };
+        static void timerISR();
+        void sample();
+
+        int signalPin_ = A1;
+        int offsetPin_ = A2;
+        bool running_ = false;
+        int cutoffHz_ = ENV_DEFAULT_CUTOFF_HZ;
+
+        volatile Biquad coeffs_;
+        int32_t x1_ = 0, x2_ = 0;           // filter history, Q16
+        int32_t y1_ = 0, y2_ = 0;
+        int32_t offset_ = 2048 << 16;       // DC offset, Q16, smoothed
+        uint16_t offsetCountdown_ = 0;
+        volatile int32_t output_ = 0;
+
+        volatile uint64_t isrTicks_ = 0;    // cycle counts for the benchmark
+        volatile uint32_t isrMaxTicks_ = 0;
+        volatile uint32_t isrCalls_ = 0;
+        unsigned long benchmarkStartMS_ = 0;  // System.ticks() wraps every 36 s, so elapsed time is in ms
+
+};
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * TPPFrameBudget.cpp
+ *
+ * Team Practical Project frame budget monitor
+ *
+ * Sheds optional work while loop() runs over its budget. See TPPFrameBudget.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include "TPPFrameBudget.h"
+
+Logger logBudget("app.budget");
+
+// upper bounds of the frame time histogram, us
+static const int32_t frameBounds[] = {500, 1000, 2000, 5000, 10000, 20000, 50000};
+
+void TPP_FrameBudget::begin(unsigned long budgetMicros, int numJobs) {
+
+    budgetMicros_ = max(1UL, budgetMicros);
+    numJobs_ = constrain(numJobs, 0, BUDGET_MAX_JOBS);
+    level_ = 0;
+    started_ = false;
+    smoothedMicros_ = 0;
+
+}
+
+/* ----- frameStart -----
+ * Marks the start of loop()
+ */
+void TPP_FrameBudget::frameStart() {
+
+    frameStartMicros_ = micros();
+    started_ = true;
+
+}
+
+/* ----- frameEnd -----
+ * Times the frame since frameStart() and moves the level up or down
+ */
+void TPP_FrameBudget::frameEnd() {
+
+    if (!started_) {
+        return;
+    }
+    started_ = false;
+    unsigned long frameMicros = micros() - frameStartMicros_;
+    unsigned long nowMS = millis();
+
+    smoothedMicros_ += frameMicros - smoothedMicros_ / BUDGET_SMOOTHING;
+    unsigned long smoothed = smoothedMicros_ / BUDGET_SMOOTHING;
+    if (frameMicros > frameMaxMicros_) {
+        frameMaxMicros_ = frameMicros;
+    }
+    if (frameMicros > budgetMicros_) {
+        overruns_++;
+    }
+    frameMetric_.observe(frameMicros);
+
+    // over budget: shed the next job
+    bool over = smoothed > budgetMicros_ || frameMicros > budgetMicros_ * BUDGET_SPIKE;
+    if (over && level_ < numJobs_ && nowMS - lastShedMS_ >= BUDGET_SHED_MS) {
+        lastShedMS_ = nowMS;
+        setLevel(level_ + 1);
+    }
+
+    // well under budget for long enough: bring the last job shed back
+    if (smoothed >= budgetMicros_ * BUDGET_RESTORE_PERCENT / 100 || over) {
+        under_ = false;
+    } else if (!under_) {
+        under_ = true;
+        underSinceMS_ = nowMS;
+    } else if (level_ > 0 && nowMS - underSinceMS_ >= BUDGET_RESTORE_MS) {
+        underSinceMS_ = nowMS;
+        setLevel(level_ - 1);
+    }
+
+}
+
+/* ----- allows -----
+ * true if optional job number job (1 is the first to be shed) should run
+ */
+bool TPP_FrameBudget::allows(int job) {
+
+    return job > level_;
+
+}
+
+int TPP_FrameBudget::getLevel() {
+
+    return level_;
+
+}
+
+unsigned long TPP_FrameBudget::getEntered(int level) {
+
+    return (level >= 0 && level <= numJobs_) ? entered_[level] : 0;
+
+}
+
+unsigned long TPP_FrameBudget::getOverruns() {
+
+    return overruns_;
+
+}
+
+unsigned long TPP_FrameBudget::getFrameMicros() {
+
+    return smoothedMicros_ / BUDGET_SMOOTHING;
+
+}
+
+unsigned long TPP_FrameBudget::getFrameMaxMicros() {
+
+    return frameMaxMicros_;
+
+}
+
+/* ----- report -----
+ * "level L, frame F us (max M us), N overruns, entered: l1:n1 l2:n2 ..."
+ * Returns the length of the string.
+ */
+int TPP_FrameBudget::report(char *buffer, int bufferSize) {
+
+    int len = snprintf(buffer, bufferSize, "level %d, frame %lu us (max %lu us), %lu overruns, entered:",
+        level_, getFrameMicros(), frameMaxMicros_, overruns_);
+    for (int level = 1; level <= numJobs_ && len < bufferSize; level++) {
+        len += snprintf(buffer + len, bufferSize - len, " %d:%lu", level, entered_[level]);
+    }
+    return min(len, bufferSize - 1);
+
+}
+
+/* ----- registerMetrics -----
+ * Adds budget_frame_us, a histogram of every frame's time, and budget_level
+ */
+void TPP_FrameBudget::registerMetrics(TPP_Metrics &metrics) {
+
+    frameMetric_ = metrics.histogram("budget_frame_us", frameBounds, sizeof(frameBounds) / sizeof(frameBounds[0]));
+    levelMetric_ = metrics.gauge("budget_level");
+    levelMetric_.set(level_);
+
+}
+
+void TPP_FrameBudget::setLevel(int level) {
+
+    logBudget.info("shed level %d -> %d, frame %lu us", level_, level, getFrameMicros());
+    level_ = level;
+    entered_[level]++;
+    levelMetric_.set(level);
+
+}
@@ -0,0 +1,86 @@
+/*
+ * TPPFrameBudget.h
+ *
+ * Team Practical Project frame budget monitor
+ *
+ * Everything in loop() shares one processor. When something blocks (the mini MP3
+ * player, a burst of logging, a slow cloud publish) everything after it runs late,
+ * and everything degrades together. This monitor times each loop() against a budget
+ * and, while loop() runs over, tells the sketch to stop doing optional work, one
+ * level at a time, so what matters (sampling the envelope, stepping the servos)
+ * stays on time.
+ *
+ * The sketch numbers its optional work 1, 2, 3 ... in the order it should be given up,
+ * and asks .allows(n) before doing job n. At level 0 everything runs; at level 2,
+ * jobs 1 and 2 are shed.
+ *
+ * The frame time is smoothed (an average over about BUDGET_SMOOTHING frames). While it
+ * is over budget, the level goes up one at most every BUDGET_SHED_MS. A single frame of
+ * more than BUDGET_SPIKE times the budget counts too, so one long block sheds at once.
+ * The level only comes down one at a time, after the smoothed frame time has been
+ * under BUDGET_RESTORE_PERCENT of the budget for BUDGET_RESTORE_MS. That gap between
+ * the two thresholds, and the wait, keep it from flapping.
+ *
+ * Key methods
+ *      .begin()        the budget in microseconds and the number of optional jobs
+ *      .frameStart()   call first thing in loop()
+ *      .frameEnd()     call last thing in loop(), and before any return. Times the frame.
+ *      .allows(job)    true if optional job (1 = first to go) should run this frame
+ *      .getLevel()     jobs shed now
+ *      .getEntered(level)  times each level was entered since power on
+ *      .report()       frame times and counters as text, for a cloud variable
+ *      .registerMetrics()  adds the frame time histogram and the level to a metrics registry
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_FRAME_BUDGET_H
+#define _TPP_FRAME_BUDGET_H
+
+#include "Particle.h"
+#include "TPPMetrics.h"
+
+#define BUDGET_MAX_JOBS 6
+#define BUDGET_SMOOTHING 8          // frames, a power of 2
+#define BUDGET_SPIKE 4              // one frame this many times the budget sheds at once
+#define BUDGET_SHED_MS 50           // shed no faster than a level this often
+#define BUDGET_RESTORE_PERCENT 60   // restore when under this much of the budget ...
+#define BUDGET_RESTORE_MS 2000      // ... for this long
+
+class TPP_FrameBudget {
+
+    public:
+        void begin(unsigned long budgetMicros, int numJobs);
+        void frameStart();
+        void frameEnd();
+        bool allows(int job);
+        int getLevel();
+        unsigned long getEntered(int level);
+        unsigned long getOverruns();
+        unsigned long getFrameMicros();
+        unsigned long getFrameMaxMicros();
+        int report(char *buffer, int bufferSize);
+        void registerMetrics(TPP_Metrics &metrics);
+
+    private:
+        void setLevel(int level);
+
+        unsigned long budgetMicros_ = 10000;
+        int numJobs_ = 0;
+        int level_ = 0;
+        bool started_ = false;                  // frameStart() called, frameEnd() not yet
+        unsigned long frameStartMicros_ = 0;
+        unsigned long smoothedMicros_ = 0;      // x BUDGET_SMOOTHING
+        unsigned long frameMaxMicros_ = 0;
+        unsigned long overruns_ = 0;            // frames over budget
+        unsigned long lastShedMS_ = 0;
+        unsigned long underSinceMS_ = 0;        // smoothed time under the restore threshold since
+        bool under_ = false;
+        unsigned long entered_[BUDGET_MAX_JOBS + 1] = {0};
+        TPP_Histogram frameMetric_;             // every frame's time
+        TPP_Gauge levelMetric_;
+
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * TPPMetricsFormat.h
+ *
+ * Team Practical Project metrics snapshot format
+ *
+ * How a snapshot of the metrics registry (TPPMetrics.h) is written: as compact
+ * binary records, or as Prometheus style text. The firmware writes both; the host
+ * tools read the binary and print the same text. This file is included by both, so
+ * change it in one place only.
+ *
+ * A binary snapshot is a MetricsSnapshotHeader, then count records one after the
+ * other, each
+ *
+ *      uint8_t type            eMetricType
+ *      uint8_t nameLength
+ *      char name[nameLength]   no 0 at the end
+ *      counter, gauge:         int32_t value
+ *      histogram:              uint8_t numBounds
+ *                              int32_t bounds[numBounds]       upper bounds, ascending
+ *                              uint32_t counts[numBounds + 1]  the last is over every bound
+ *                              int32_t sum
+ *
+ * A snapshot too big for one buffer is written in pages: first is the index of the
+ * first metric in the page, and total the number there are. The Photon and PCs are
+ * all little endian.
+ *
+ * The text is the Prometheus exposition format: "# TYPE" and the value of each
+ * metric, and for a histogram the cumulative count for each bound, the sum and the count.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_METRICS_FORMAT_H
+#define _TPP_METRICS_FORMAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define METRICS_FORMAT_MAGIC 0x4D505054     // "TPPM"
+#define METRICS_FORMAT_VERSION 1
+#define METRICS_MAX_BOUNDS 8                // histogram buckets, not counting the last
+#define METRICS_NAME_SIZE 32                // the longest name is 31 characters
+
+enum eMetricType {
+    metricCounter = 1,      // only goes up, wraps at 2^32
+    metricGauge,            // any value, set when it changes
+    metricHistogram         // counts of values in fixed buckets, and their sum
+};
+
+struct __attribute__((packed)) MetricsSnapshotHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t first;          // index of the first metric in this page
+    uint8_t count;          // metrics in this page
+    uint8_t total;          // metrics in the registry
+    uint32_t uptimeMS;      // millis() when the snapshot was taken
+};
+
+// One metric's name and values, as written and read. name is not 0 terminated.
+struct MetricsRecord {
+    int type;               // eMetricType
+    const char *name;
+    int nameLength;
+    int32_t value;          // counters and gauges; the sum for histograms
+    int numBounds;
+    int32_t bounds[METRICS_MAX_BOUNDS];
+    uint32_t counts[METRICS_MAX_BOUNDS + 1];
+};
+
+// Writes record to buffer. Returns the bytes written, or 0 if it doesn't fit.
+inline int metricsEncodeRecord(const MetricsRecord &record, uint8_t *buffer, int size) {
+
+    bool histogram = record.type == metricHistogram;
+    int length = 2 + record.nameLength + 4 + (histogram ? 1 + record.numBounds * 8 + 4 : 0);
+    if (length > size) {
+        return 0;
+    }
+    uint8_t *p = buffer;
+    *p++ = record.type;
+    *p++ = record.nameLength;
+    memcpy(p, record.name, record.nameLength);
+    p += record.nameLength;
+    if (histogram) {
+        *p++ = record.numBounds;
+        memcpy(p, record.bounds, record.numBounds * 4);
+        p += record.numBounds * 4;
+        memcpy(p, record.counts, (record.numBounds + 1) * 4);
+        p += (record.numBounds + 1) * 4;
+    }
+    memcpy(p, &record.value, 4);
+    return length;
+
+}
+
+// Reads a record from buffer. Returns the bytes read, or 0 if it is not a whole
+// record. record.name points into buffer.
+inline int metricsDecodeRecord(const uint8_t *buffer, int length, MetricsRecord &record) {
+
+    if (length < 2) {
+        return 0;
+    }
+    const uint8_t *p = buffer;
+    record.type = *p++;
+    record.nameLength = *p++;
+    record.name = (const char *)p;
+    p += record.nameLength;
+    record.numBounds = 0;
+    if (record.type == metricHistogram) {
+        if (p + 1 > buffer + length) {
+            return 0;
+        }
+        record.numBounds = *p++;
+        if (record.numBounds > METRICS_MAX_BOUNDS || p + record.numBounds * 8 + 4 > buffer + length) {
+            return 0;
+        }
+        memcpy(record.bounds, p, record.numBounds * 4);
+        p += record.numBounds * 4;
+        memcpy(record.counts, p, (record.numBounds + 1) * 4);
+        p += (record.numBounds + 1) * 4;
+    } else if (record.type != metricCounter && record.type != metricGauge) {
+        return 0;
+    }
+    if (p + 4 > buffer + length) {
+        return 0;
+    }
+    memcpy(&record.value, p, 4);
+    return (int)(p + 4 - buffer);
+
+}
+
+// Writes record as Prometheus text. Returns its length, or 0 if it doesn't fit.
+inline int metricsFormatText(const MetricsRecord &record, char *buffer, int size) {
+
+    static const char *typeNames[] = {"", "counter", "gauge", "histogram"};
+    int n = record.nameLength;
+    const char *name = record.name;
+    int length = snprintf(buffer, size, "# TYPE %.*s %s\n", n, name, typeNames[record.type]);
+    if (record.type == metricCounter) {
+        length += snprintf(buffer + length, size > length ? size - length : 0, "%.*s %lu\n", n, name,
+                           (unsigned long)(uint32_t)record.value);
+    } else if (record.type == metricGauge) {
+        length += snprintf(buffer + length, size > length ? size - length : 0, "%.*s %ld\n", n, name,
+                           (long)record.value);
+    } else {
+        unsigned long cumulative = 0;
+        for (int b = 0; b <= record.numBounds; b++) {
+            cumulative += record.counts[b];
+            if (b < record.numBounds) {
+                length += snprintf(buffer + length, size > length ? size - length : 0, "%.*s_bucket{le=\"%ld\"} %lu\n",
+                                   n, name, (long)record.bounds[b], cumulative);
+            } else {
+                length += snprintf(buffer + length, size > length ? size - length : 0, "%.*s_bucket{le=\"+Inf\"} %lu\n",
+                                   n, name, cumulative);
+            }
+        }
+        length += snprintf(buffer + length, size > length ? size - length : 0, "%.*s_sum %ld\n%.*s_count %lu\n",
+                           n, name, (long)record.value, n, name, cumulative);
+    }
+    return length < size ? length : 0;
+
+}
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * TPPSyncMeter.cpp
+ *
+ * Team Practical Project audio to mouth sync measurement
+ *
+ * Times each play against the clip's fingerprint. See TPPSyncMeter.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include "TPPSyncMeter.h"
+#include <math.h>
+
+/* ----- begin -----
+ * Loads the saved offset, and reserves the capture from the arena. Without the
+ * capture, the offset is used but no play is measured.
+ */
+void TPP_SyncMeter::begin(int sampleMS, TPP_Arena &arena) {
+
+    sampleMS_ = sampleMS;
+    liveBlock_ = arena.reserve("sync capture", SYNC_CAPTURE);
+    live_ = liveBlock_ ? (uint8_t *)liveBlock_->getData() : NULL;
+    EEPROM.get(SYNC_EEPROM_ADDR, saved_);
+    if (saved_.magic != SYNC_MAGIC) {
+        saved_.magic = SYNC_MAGIC;
+        saved_.offsetMS = 0;
+        saved_.plays = 0;
+    }
+
+}
+
+/* ----- update -----
+ * Call every loop() with BUSY (true when low, playing). Times the fall.
+ */
+void TPP_SyncMeter::update(bool busy) {
+
+    if (busy && !busy_) {
+        busyFallMS_ = millis();
+        if (busyDelayMS_ < 0) {
+            busyDelayMS_ = busyFallMS_ - playMS_;
+        }
+    }
+    busy_ = busy;
+
+}
+
+/* ----- played -----
+ * Call just after telling the player to play. In measuring mode, a clip with a
+ * fingerprint is captured for SYNC_CAPTURE samples and measured.
+ */
+void TPP_SyncMeter::played(int clipNumber, const uint8_t *fingerprint) {
+
+    playMS_ = millis();
+    busyDelayMS_ = -1;
+    fingerprint_ = (measuring_ && live_ != NULL) ? fingerprint : NULL;
+    clip_ = clipNumber;
+    liveCount_ = 0;
+    if (liveBlock_ != NULL) {
+        liveBlock_->use(0);
+    }
+
+}
+
+/* ----- addSample -----
+ * One envelope sample (0 - 4095), every sampleMS. Returns true when a play has been
+ * measured; the getLast... methods have the result.
+ */
+bool TPP_SyncMeter::addSample(int envelope) {
+
+    if (fingerprint_ == NULL) {
+        return false;
+    }
+    if (liveCount_ == 0) {
+        firstSampleMS_ = millis() - playMS_;
+    }
+    live_[liveCount_++] = constrain(envelope >> 4, 0, 255);
+    liveBlock_->use(liveCount_);
+    if (liveCount_ < SYNC_CAPTURE) {
+        return false;
+    }
+    measure();
+    fingerprint_ = NULL;
+    return true;
+
+}
+
+/* ----- audioPlaying -----
+ * BUSY, with its fall delayed by the sync offset: true once the sound has started.
+ * The sound can't be anticipated, so a negative offset is BUSY as it is.
+ */
+bool TPP_SyncMeter::audioPlaying() {
+
+    if (!busy_) {
+        return false;
+    }
+    return (saved_.offsetMS <= 0) || ((millis() - busyFallMS_) >= (unsigned long)saved_.offsetMS);
+
+}
+
+/* ----- measure -----
+ * Finds the lag of the fingerprint in the capture by normalized cross-correlation.
+ * The sound starts where the fingerprint first gets to FP_START_LEVEL, at that lag.
+ * This runs once per play, so it is in floating point.
+ */
+void TPP_SyncMeter::measure() {
+
+    const uint8_t *f = fingerprint_;
+    float meanF = 0;
+    for (int j = 0; j < FP_LENGTH; j++) {
+        meanF += f[j];
+    }
+    meanF /= FP_LENGTH;
+    float energyF = 0;
+    for (int j = 0; j < FP_LENGTH; j++) {
+        energyF += (f[j] - meanF) * (f[j] - meanF);
+    }
+
+    float scores[SYNC_MAX_LAG + 1];
+    int bestLag = 0;
+    for (int lag = 0; lag <= SYNC_MAX_LAG; lag++) {
+        const uint8_t *x = &live_[lag];
+        float meanX = 0;
+        for (int j = 0; j < FP_LENGTH; j++) {
+            meanX += x[j];
+        }
+        meanX /= FP_LENGTH;
+        float correlation = 0;
+        float energyX = 0;
+        for (int j = 0; j < FP_LENGTH; j++) {
+            correlation += (x[j] - meanX) * (f[j] - meanF);
+            energyX += (x[j] - meanX) * (x[j] - meanX);
+        }
+        scores[lag] = (energyX > 0 && energyF > 0) ? correlation / sqrtf(energyX * energyF) : 0;
+        if (scores[lag] > scores[bestLag]) {
+            bestLag = lag;
+        }
+    }
+
+    // a parabola through the peak and its neighbours, for the lag between samples
+    float lag = bestLag;
+    if (bestLag > 0 && bestLag < SYNC_MAX_LAG) {
+        float before = scores[bestLag - 1];
+        float after = scores[bestLag + 1];
+        float curve = before - 2 * scores[bestLag] + after;
+        if (curve < 0) {
+            lag += 0.5f * (before - after) / curve;
+        }
+    }
+
+    // where the fingerprint first gets loud, between samples
+    float onset = 0;
+    for (int j = 1; j < FP_LENGTH; j++) {
+        if (f[j] >= FP_START_LEVEL) {
+            onset = (f[j - 1] >= FP_START_LEVEL) ? j - 1 :
+                    j - 1 + (float)(FP_START_LEVEL - f[j - 1]) / (f[j] - f[j - 1]);
+            break;
+        }
+    }
+
+    lastClip_ = clip_;
+    lastScore_ = (int)(scores[bestLag] * 100);
+    lastAudioMS_ = lroundf(firstSampleMS_ + (lag + onset) * sampleMS_);
+    lastBusyMS_ = busyDelayMS_;
+    if (busyDelayMS_ < 0 || lastScore_ < SYNC_MIN_SCORE) {
+        return;     // BUSY never fell, or the sound didn't look like the clip
+    }
+
+    history_[next_] = lastAudioMS_ - busyDelayMS_;
+    scores_[next_] = lastScore_;
+    next_ = (next_ + 1) % SYNC_HISTORY;
+    plays_++;
+
+    if (plays_ >= SYNC_MIN_PLAYS) {
+        int offset = getPercentileMS(50);
+        if (offset != saved_.offsetMS) {
+            saved_.offsetMS = offset;
+            saved_.plays = min(plays_, 65535);
+            EEPROM.put(SYNC_EEPROM_ADDR, saved_);
+        }
+    }
+
+}
+
+/* ----- getPercentileMS -----
+ * The sound's delay after BUSY, over the good plays kept; 50 is the median
+ */
+int TPP_SyncMeter::getPercentileMS(int percent) {
+
+    int count = min(plays_, SYNC_HISTORY);
+    if (count == 0) {
+        return 0;
+    }
+    int16_t sorted[SYNC_HISTORY];
+    for (int i = 0; i < count; i++) {
+        int16_t value = history_[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    return sorted[(constrain(percent, 0, 100) * (count - 1) + 50) / 100];
+
+}
+
+/* ----- getSpreadMS -----
+ * 10th to 90th percentile
+ */
+int TPP_SyncMeter::getSpreadMS() {
+
+    return getPercentileMS(90) - getPercentileMS(10);
+
+}
+
+/* ----- getConfidencePercent -----
+ * 0 until SYNC_MIN_PLAYS good plays. Then the mean correlation of the plays kept,
+ * halved when the spread reaches four samples.
+ */
+int TPP_SyncMeter::getConfidencePercent() {
+
+    int count = min(plays_, SYNC_HISTORY);
+    if (plays_ < SYNC_MIN_PLAYS) {
+        return 0;
+    }
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        total += scores_[i];
+    }
+    int tolerance = 4 * sampleMS_;
+    return (total / count) * tolerance / (tolerance + getSpreadMS());
+
+}
+
+void TPP_SyncMeter::reset() {
+
+    plays_ = 0;
+    next_ = 0;
+    saved_.offsetMS = 0;
+    saved_.plays = 0;
+    EEPROM.put(SYNC_EEPROM_ADDR, saved_);
+
+}
@@ -0,0 +1,106 @@
+/*
+ * TPPSyncMeter.h
+ *
+ * Team Practical Project audio to mouth sync measurement
+ *
+ * Nobody knows how long the mini MP3 player takes between being told to play, the
+ * sound coming out, and its BUSY pin falling, and the mouth is only as well timed as
+ * that. In measuring mode, every play is timed: BUSY directly, and the sound by
+ * cross-correlating the envelope captured from the play command against the clip's
+ * fingerprint (see TPPClipMatcher.h) over lags of up to SYNC_MAX_LAG samples, with a
+ * parabola through the peak for a time finer than a sample. The fingerprint's own
+ * onset, where it first gets loud, marks the start of the sound in it.
+ *
+ * The sound's delay after BUSY falls is kept for the last SYNC_HISTORY plays. Once
+ * SYNC_MIN_PLAYS good ones are in, their median is the installation's sync offset,
+ * saved in EEPROM. .audioPlaying() applies it: it is BUSY, less the offset.
+ *
+ * Key methods
+ *      .begin()            loads the saved offset, and reserves the capture from the arena
+ *      .update()           call every loop() with the BUSY state
+ *      .played()           the player has been told to play a clip
+ *      .addSample()        one envelope sample, every sampleMS. Returns true when
+ *                          a play has been measured.
+ *      .audioPlaying()     BUSY, delayed by the sync offset
+ *      .getPercentileMS(), .getSpreadMS(), .getConfidencePercent()
+ *                          the latency distribution
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_SYNC_METER_H
+#define _TPP_SYNC_METER_H
+
+#include "Particle.h"
+#include "TPPClipMatcher.h"
+#include "TPPArena.h"
+
+#define SYNC_MAX_LAG 40                 // samples after the play command searched for the sound
+#define SYNC_CAPTURE (FP_LENGTH + SYNC_MAX_LAG)
+#define SYNC_HISTORY 64                 // plays kept for the distribution
+#define SYNC_MIN_PLAYS 8                // good plays before the offset is trusted
+#define SYNC_MIN_SCORE 70               // correlation percent for a good play
+#define SYNC_EEPROM_ADDR 1200           // after the fingerprints
+#define SYNC_MAGIC 0x54505359           // "TPSY", marks a saved offset
+
+class TPP_SyncMeter {
+
+    public:
+        void begin(int sampleMS, TPP_Arena &arena);
+        void update(bool busy);
+        void played(int clipNumber, const uint8_t *fingerprint);
+        bool addSample(int envelope);
+        bool audioPlaying();
+
+        void setMeasuring(bool measuring) { measuring_ = measuring; }
+        bool isMeasuring() { return measuring_; }
+        void reset();
+
+        int getOffsetMS() { return saved_.offsetMS; }
+        int getLastClip() { return lastClip_; }
+        int getLastBusyMS() { return lastBusyMS_; }         // play command to BUSY
+        int getLastAudioMS() { return lastAudioMS_; }       // play command to sound
+        int getLastScorePercent() { return lastScore_; }
+        int getPlays() { return plays_; }
+        int getPercentileMS(int percent);
+        int getSpreadMS();
+        int getConfidencePercent();
+
+    private:
+        void measure();
+
+        struct SavedOffset {
+            uint32_t magic;
+            int16_t offsetMS;               // sound after BUSY falls, may be negative
+            uint16_t plays;                 // how many plays it came from
+        };
+        SavedOffset saved_;
+        int sampleMS_ = 10;
+        bool measuring_ = false;
+
+        bool busy_ = false;
+        unsigned long busyFallMS_ = 0;
+        unsigned long playMS_ = 0;
+        long busyDelayMS_ = -1;             // play command to BUSY falling, -1 until it does
+
+        const uint8_t *fingerprint_ = NULL; // set while a play is being captured
+        int clip_ = 0;
+        uint8_t *live_ = NULL;              // SYNC_CAPTURE samples, in the arena
+        TPP_ArenaBlock *liveBlock_ = NULL;
+        int liveCount_ = 0;
+        int firstSampleMS_ = 0;             // when the first sample was taken, after the command
+
+        int lastClip_ = 0;
+        int lastBusyMS_ = 0;
+        int lastAudioMS_ = 0;
+        int lastScore_ = 0;
+
+        int16_t history_[SYNC_HISTORY];     // sound after BUSY, ms, of the good plays
+        uint8_t scores_[SYNC_HISTORY];
+        int plays_ = 0;
+        int next_ = 0;
+
+};
+
+#endif
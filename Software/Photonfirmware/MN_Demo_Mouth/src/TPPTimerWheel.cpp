@@ -0,0 +1,250 @@
+/*
+ * TPPTimerWheel.cpp
+ *
+ * Team Practical Project timer service
+ *
+ * Runs callbacks when they are due from a hierarchical timing wheel. See
+ * TPPTimerWheel.h.
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#include "TPPTimerWheel.h"
+
+#define SLOT_MASK (TIMER_SLOTS - 1)
+#define WHEEL_SPAN (1UL << (TIMER_SLOT_BITS * TIMER_LEVELS))   // ms the levels reach
+
+/* ----- schedule -----
+ * Runs callback(context) delayMS from now. If the timer is pending it is
+ * moved. callback may be NULL, for a timer that just expires.
+ */
+void TPP_TimerWheel::schedule(TPP_Timer &timer, uint32_t delayMS, TPP_TimerCallback callback, void *context) {
+
+    if (delayMS > TIMER_MAX_DELAY_MS) {
+        delayMS = TIMER_MAX_DELAY_MS;
+    }
+    scheduleAt(timer, millis() + delayMS, callback, context);
+
+}
+
+/* ----- scheduleAt -----
+ * Runs callback(context) at millis() deadlineMS, which must be within
+ * TIMER_MAX_DELAY_MS of now. A periodic timer schedules itself at its last
+ * deadline plus the period, so it doesn't slip when process() is late.
+ */
+void TPP_TimerWheel::scheduleAt(TPP_Timer &timer, uint32_t deadlineMS, TPP_TimerCallback callback, void *context) {
+
+    cancel(timer);
+
+    // with nothing waiting, the wheel may be anywhere: never used, or left behind
+    // the clock. Start it from now, unless process() has just done this ms.
+    uint32_t now = millis();
+    if (pending_ == 0 && next_ - now > 1) {
+        next_ = now;
+    }
+
+    timer.deadline_ = deadlineMS;
+    timer.callback_ = callback;
+    timer.context_ = context;
+    timer.pending_ = true;
+    pending_++;
+    insert(timer);
+    nextDue_ = nextTick();
+
+}
+
+/* ----- cancel -----
+ * Stops the timer if it is pending; its callback won't be called
+ */
+void TPP_TimerWheel::cancel(TPP_Timer &timer) {
+
+    if (timer.pending_) {
+        unlink(timer);
+        timer.pending_ = false;
+        pending_--;
+    }
+
+}
+
+/* ----- process -----
+ * Runs the callbacks of the timers due by now, in the order of their deadlines
+ * (those due in the same ms in no particular order). Returns how many ran.
+ */
+int TPP_TimerWheel::process() {
+
+    uint32_t now = millis();
+    if (pending_ == 0 || (int32_t)(now - nextDue_) < 0) {
+        return 0;
+    }
+
+    int expired = 0;
+    while (pending_ > 0) {
+
+        // straight to the next ms with anything in it
+        uint32_t tick = nextTick();
+        if ((int32_t)(tick - now) > 0) {
+            next_ = now + 1;
+            break;
+        }
+        next_ = tick;
+
+        // at the start of a turn of the first level, bring down the timers due in it
+        if ((next_ & SLOT_MASK) == 0) {
+            for (int level = 1; level < TIMER_LEVELS && cascade(level) == 0; level++) {
+            }
+        }
+
+        // take the timers in this ms out of the wheel, then run them, so a callback
+        // that schedules one for a turn later doesn't find it still here
+        int slot = next_ & SLOT_MASK;
+        due_ = slots_[0][slot];
+        slots_[0][slot] = NULL;
+        occupied_[0] &= ~(1ULL << slot);
+        for (TPP_Timer *timer = due_; timer != NULL; timer = timer->next_) {
+            timer->level_ = TIMER_LEVELS;
+        }
+        next_++;
+
+        while (due_ != NULL) {
+            TPP_Timer *timer = due_;
+            unlink(*timer);
+            timer->pending_ = false;
+            pending_--;
+            expired++;
+            if (timer->callback_ != NULL) {
+                timer->callback_(timer->context_);
+            }
+        }
+
+    }
+
+    nextDue_ = (pending_ > 0) ? nextTick() : next_;
+    expired_ += expired;
+    return expired;
+
+}
+
+/* ----- getNextDeadline -----
+ * Sets deadlineMS to the next millis() process() has anything to do at, and
+ * returns true, or returns false if no timer is pending. It is the deadline
+ * itself for a timer due within TIMER_SLOTS ms; further out it may be earlier,
+ * when timers are moved down a level, but never later.
+ */
+bool TPP_TimerWheel::getNextDeadline(uint32_t &deadlineMS) {
+
+    if (pending_ == 0) {
+        return false;
+    }
+    deadlineMS = nextTick();
+    return true;
+
+}
+
+/* ----- insert -----
+ * Links the timer into the slot for its deadline: the first level if it is due
+ * within TIMER_SLOTS ms of next_, and so on up. A timer due at or before next_
+ * goes in next_'s slot.
+ */
+void TPP_TimerWheel::insert(TPP_Timer &timer) {
+
+    uint32_t tick = timer.deadline_;
+    uint32_t delta = tick - next_;
+    if ((int32_t)delta < 0) {
+        tick = next_;
+        delta = 0;
+    }
+
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= (1UL << (TIMER_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    int shift = TIMER_SLOT_BITS * level;
+    int slot = (tick >> shift) & SLOT_MASK;
+    if (delta >= WHEEL_SPAN) {
+        // beyond the wheel: the top level's last slot this turn, to be sorted again then
+        slot = ((next_ >> shift) + SLOT_MASK) & SLOT_MASK;
+    }
+
+    TPP_Timer *&head = slots_[level][slot];
+    timer.prev_ = NULL;
+    timer.next_ = head;
+    if (head != NULL) {
+        head->prev_ = &timer;
+    }
+    head = &timer;
+    timer.level_ = level;
+    timer.slot_ = slot;
+    occupied_[level] |= 1ULL << slot;
+
+}
+
+/* ----- unlink -----
+ * Takes the timer out of its slot's list, or out of the list being run
+ */
+void TPP_TimerWheel::unlink(TPP_Timer &timer) {
+
+    bool running = (timer.level_ == TIMER_LEVELS);
+    TPP_Timer *&head = running ? due_ : slots_[timer.level_][timer.slot_];
+    if (timer.prev_ != NULL) {
+        timer.prev_->next_ = timer.next_;
+    } else {
+        head = timer.next_;
+    }
+    if (timer.next_ != NULL) {
+        timer.next_->prev_ = timer.prev_;
+    }
+    timer.next_ = NULL;
+    timer.prev_ = NULL;
+    if (!running && head == NULL) {
+        occupied_[timer.level_] &= ~(1ULL << timer.slot_);
+    }
+
+}
+
+/* ----- cascade -----
+ * Moves the timers in level's slot for next_ down to the levels below, now that
+ * they are due within that slot's span. Returns the slot, so the caller knows
+ * whether the level above is starting a turn too.
+ */
+int TPP_TimerWheel::cascade(int level) {
+
+    int slot = (next_ >> (TIMER_SLOT_BITS * level)) & SLOT_MASK;
+    TPP_Timer *timer = slots_[level][slot];
+    slots_[level][slot] = NULL;
+    occupied_[level] &= ~(1ULL << slot);
+    while (timer != NULL) {
+        TPP_Timer *next = timer->next_;
+        insert(*timer);
+        timer = next;
+    }
+    return slot;
+
+}
+
+/* ----- nextTick -----
+ * The next ms from next_ that has a timer due, or a slot of a higher level to
+ * bring down. Only while timers are pending.
+ */
+uint32_t TPP_TimerWheel::nextTick() {
+
+    uint32_t index = next_ & SLOT_MASK;
+    bool upper = false;
+    for (int level = 1; level < TIMER_LEVELS; level++) {
+        upper = upper || (occupied_[level] != 0);
+    }
+    if (upper && index == 0) {
+        return next_;       // the higher levels may have timers for this turn
+    }
+
+    uint64_t ahead = occupied_[0] >> index;
+    if (ahead != 0) {
+        return next_ + __builtin_ctzll(ahead);
+    }
+    uint32_t turn = (next_ | SLOT_MASK) + 1;
+    if (upper || occupied_[0] == 0) {
+        return turn;
+    }
+    return turn + __builtin_ctzll(occupied_[0]);      // early in the next turn
+
+}
@@ -0,0 +1,107 @@
+/*
+ * TPPTimerWheel.h
+ *
+ * Team Practical Project timer service
+ *
+ * Things that happen later (the next scene, the end of an idle wait, the next
+ * report) used to each keep a millis() and compare it every loop(), some in a
+ * signed int that goes wrong when millis() wraps. Instead, a subsystem schedules a
+ * TPP_Timer on the wheel with a callback, and the wheel calls it when it is due.
+ *
+ * The wheel is hierarchical: TIMER_LEVELS levels of TIMER_SLOTS slots, the first a
+ * slot per ms, each next level a slot per TIMER_SLOTS of the one below. A timer
+ * goes in the slot of the level its deadline falls in, found from the bits of the
+ * deadline, so scheduling and cancelling are O(1): a timer is a node in its slot's
+ * list, and nothing is searched or sorted. As time reaches a slot of a higher level,
+ * its timers move down a level, until they run from the first. The four levels reach
+ * 2^24 ms, about 4.6 hours; a timer further out waits at the far end and is sorted
+ * again from there. A bit per slot marks the ones in use, so process() skips over
+ * empty time in a step or two, and finding the next deadline is a count of zero bits.
+ *
+ * Times are uint32_t millis(), compared by the sign of their difference, so they
+ * keep working when millis() wraps after 49 days. The longest delay is
+ * TIMER_MAX_DELAY_MS, about 24 days.
+ *
+ * A timer is owned by the subsystem that uses it, usually as a member, and the
+ * wheel only links it in; nothing is allocated. A timer with no callback just
+ * expires: isPending() turns false when it is due, for a wait that is checked
+ * along with something else. Callbacks run in process(), from loop(); the wheel is
+ * not for use from interrupts. A callback may schedule or cancel any timer, its own
+ * too. A timer scheduled for now, or the past, runs at the next ms.
+ *
+ * Key methods
+ *      .schedule()     starts a timer to run in a delay, or restarts it if pending
+ *      .scheduleAt()   starts a timer to run at a millis() time
+ *      .cancel()       stops a pending timer
+ *      .process()      call every loop(). Runs the callbacks that are due; returns
+ *                      at once if nothing is.
+ *      .getNextDeadline()  the next millis() process() has anything to do at, for
+ *                      a loop that wants to know how long it may rest
+ *      .getPending(), .getExpired()  timers waiting now, and run since power on
+ *  TPP_Timer
+ *      .isPending()    scheduled, and not yet run or cancelled
+ *      .getDeadline()  when it is, or was, due
+ *
+ * (cc) Non-Commercial Share-Alike Attribution 2021 Bob Glicksman, Jim Schrempp
+ *
+ */
+
+#ifndef _TPP_TIMER_WHEEL_H
+#define _TPP_TIMER_WHEEL_H
+
+#include "Particle.h"
+
+#define TIMER_LEVELS 4
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+#define TIMER_MAX_DELAY_MS 0x7FFFFFFFUL     // half the range of millis()
+
+typedef void (*TPP_TimerCallback)(void *context);
+
+class TPP_Timer {
+
+    public:
+        bool isPending() { return pending_; }
+        uint32_t getDeadline() { return deadline_; }
+
+    private:
+        friend class TPP_TimerWheel;
+        TPP_Timer *next_ = NULL;            // in the slot's list
+        TPP_Timer *prev_ = NULL;
+        uint32_t deadline_ = 0;
+        TPP_TimerCallback callback_ = NULL;
+        void *context_ = NULL;
+        uint8_t level_ = 0;                 // TIMER_LEVELS while in the list being run
+        uint8_t slot_ = 0;
+        bool pending_ = false;
+
+};
+
+class TPP_TimerWheel {
+
+    public:
+        void schedule(TPP_Timer &timer, uint32_t delayMS, TPP_TimerCallback callback = NULL, void *context = NULL);
+        void scheduleAt(TPP_Timer &timer, uint32_t deadlineMS, TPP_TimerCallback callback = NULL,
+                        void *context = NULL);
+        void cancel(TPP_Timer &timer);
+        int process();
+        bool getNextDeadline(uint32_t &deadlineMS);
+        int getPending() { return pending_; }
+        unsigned long getExpired() { return expired_; }
+
+    private:
+        void insert(TPP_Timer &timer);
+        void unlink(TPP_Timer &timer);
+        int cascade(int level);
+        uint32_t nextTick();
+        TPP_Timer *slots_[TIMER_LEVELS][TIMER_SLOTS] = {};
+        uint64_t occupied_[TIMER_LEVELS] = {};     // a bit for each slot with timers in it
+        TPP_Timer *due_ = NULL;             // the timers process() is running now
+        uint32_t next_ = 0;                 // the next ms process() has to look at
+        uint32_t nextDue_ = 0;              // process() has nothing to do before this
+        int pending_ = 0;
+        unsigned long expired_ = 0;
+
+};
+
+#endif